@@ -22,7 +22,8 @@
   Boston, MA 02111-1307, USA.
 */
 
-/* GPSSIM Release version 1.03 -- 03/14/2011 Gary L. Flispart (GLF) for LVL1 White Star Balloon Group
+/* GPSSIM Release version 1.04 -- 10/19/2026 LVL1 White Star Balloon Group, from
+   GPSSIM Release version 1.03 -- 03/14/2011 Gary L. Flispart (GLF) for LVL1 White Star Balloon Group
    
        GPSSIM outputs a stream of simulated GPS data to the serial port which 
        matches a simulated balloon flight, including latitude, longitude, altitude,
@@ -79,12 +80,18 @@
                     Invoking from command line:
                        
                        Windows:   					   
-                          32gpssim [port spec] [port baud]
+                          32gpssim [port spec] [port baud] [trace file]
                        Linux terminal:   					   
-                          ./lxgpssim [port spec] [port baud]
+                          ./lxgpssim [port spec] [port baud] [trace file]
                     
                     If parameters are missing, output will go to the console
                     (can be redirected to file if desired). 
+
+                    If a trace file is named (use port spec 0 for console output),
+                    timing of waypoint segment setup, per-second output, and port
+                    writes/waits is recorded and written to the file at exit in
+                    Chrome trace (JSON) format -- view with chrome://tracing or 
+                    ui.perfetto.dev.  Memory use is bounded (oldest events dropped).
                     
                  04 Dec 2010 GLF (Gary L. Flispart)   
                     BETA version 0.9 --  GPS output to either COM port or debugging 
@@ -132,6 +139,35 @@
 		 14 Mar 2011 GLF (Gary L. Flispart)
                     Release version 1.03 -- Added  "#define PERFECT_SAT_FIXES" to
                     allow simulation with no dropouts, per request of ballooon team.
+
+		 19 Oct 2026 LVL1 White Star Balloon Group
+                    Release version 1.04 -- Optional event trace (TRACE=file) of setup, output and port I/O
+                                     Sentences table driven with a rate each -- added GSV, VTG, GLL, ZDA
+                                     Fixed GGA "no fix" output (NEMA23 misspelled, nsats = 0)
+                                     Windows/Linux KEYWORD=value and CONFIG=file settings, kernels
+                                        pre-built and selected once at startup (select_kernel())
+                                     ALMANAC=file: satellites in view from YUMA/SEM orbits (almanac lib)
+                                     GSA/GSV DOPs from the satellite geometry (geomdop() in matrix lib)
+                                     Arduino code path runs on Linux with AVR cycle budgets (avrsim)
+                                     FIXED_POINT integer pipeline, OUTPUT_HZ epochs (up to 10) a second
+                                     Arduino TX_RING: interrupt driven sends, epochs out on the second
+                                     PACKED_SCRIPT: delta coded flash waypoints (made by lvl1/wppack)
+                                     Sentences written a field at a time with running checksum (no st_*)
+                                     Arduino IDLE_SLEEP between epochs and DUTY_REPORT ($PGLFD)
+                                     Arduino Mega PORTn_BAUD/PORTn_RATES send on Serial1-3 as well
+                                     FLIGHT=file flies a balloon model instead of the waypoints
+                                     ENSEMBLE=n Monte Carlo landing footprint on all processors
+                                     WINDGRID=file carries position on gridded winds (windgrid lib)
+                                     Speed and track from the segment's motion (motion_setup())
+                                     wgs84 geodesy library for look angles, ENSEMBLE and flightgen
+                                     WMM=file: RMC magnetic variation from the World Magnetic Model
+                                     GEOID=file: GGA geoid height from a memory-mapped EGM grid
+                                     cos_safe()/atan2_safe() without libm (flash tables, degtrig lib)
+                                     ERROR/ERROR_TAU/NOISE receiver position error (gmnoise library)
+                                     u-blox UBX output: NAV-PVT, NAV-SAT and NAV-DOP (RATE_PVT etc.)
+                                     GLONASS, Galileo and BeiDou beside GPS (GNSS_SYSTEMS / GNSS)
+                                     Satellite changes and dropouts from a timeline; SCENARIO=file
+                                     CHECKPOINT=file and RESUME carry a stopped run on where it was
 */
 
 /*
@@ -580,6 +616,12 @@ NOTE:  The GPSSIM program will only output the sentences GPRMC, GPGSA, and GPGGA
    just a FEATURE <grin> dependent on the available precision.
 */   
 
+/* NOTE on configuration -- the compile options below (PERFECT_SAT_FIXES, NMEA23, RATE_xxx, 
+   BAUD_RATE, REALTIME, USE_RANDOM_VARY and the satellite timing values) are only DEFAULTS 
+   in the Windows/Linux version, which can change each of them at run time from the command 
+   line or a configuration file -- see read_config().  On Arduino they are fixed when the 
+   sketch is compiled, as before. */
+
 /* If the following is defined, avoid simulation of poor satellite conditions */
 #define PERFECT_SAT_FIXES
 
@@ -604,6 +646,13 @@ NOTE:  The GPSSIM program will only output the sentences GPRMC, GPGSA, and GPGGA
 /* The following Arduino includes and definition USEFLASH allow use of flash ROM tables */
 #include <avr/io.h>
 #include <avr/pgmspace.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+
+/* Serial1-Serial3 are on the Mega only */
+#if defined(MULTI_PORT) && !defined(UBRR3H)
+#error "PORTn_BAUD needs an Arduino Mega (Serial1-Serial3)"
+#endif
 
 #define USEFLASH 
 
@@ -619,6 +668,43 @@ NOTE:  The GPSSIM program will only output the sentences GPRMC, GPGSA, and GPGGA
 #include <time.h>
 
 #include "gftermio.h"
+#include <signal.h>
+
+#include "sidtime.h"
+#include "almanac.h"
+#include "matrix.h"
+#include "flight.h"
+#include "windgrid.h"
+#include "wgs84.h"
+#include "wmm.h"
+#include "geoid.h"
+#include "degtrig.h"
+#include "gmnoise.h"
+
+#if !defined(__MINGW32__)
+#include <pthread.h>
+#include <unistd.h>
+#else
+#include <io.h>
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+/* The simulation libraries -- evtrace, almanac, flight, windgrid, wgs84, wmm,
+   geoid, degtrig, gmnoise and geomdop() in matrix -- have prebuilt archives
+   for Linux only.  The Windows build (and a Linux one made with -DNO_SIM_LIBS)
+   leaves them out, and with them TRACE, ALMANAC, FLIGHT, ENSEMBLE, WINDGRID,
+   WMM, GEOID, ERROR and NOISE. */
+#if !defined(__MINGW32__) && !defined(NO_SIM_LIBS)
+#define HAVE_SIM_LIBS
+#endif
+
+#ifdef HAVE_SIM_LIBS
+#include "evtrace.h"
+#else
+#define EVTRACE_BEGIN(name)
+#define EVTRACE_END(name)
+#endif
 
 #endif
 
@@ -633,9 +719,75 @@ NOTE:  The GPSSIM program will only output the sentences GPRMC, GPGSA, and GPGGA
 /* select NMEA version 2.3 -- affects RMC and GGA sentences and lat-long resolution */
 #define NMEA23 
 
+/* NMEA sentence output rates in seconds (0 = not output) -- on Arduino a 
+   sentence with rate 0 is not compiled in at all, to save code space (unless
+   there are more ports, see PORTn_BAUD) */
+#define RATE_RMC 1
+#define RATE_GGA 1
+#define RATE_GSA 1
+#define RATE_GSV 0
+#define RATE_VTG 0
+#define RATE_GLL 0
+#define RATE_ZDA 0
+
+/* u-blox UBX binary message output rates in seconds, likewise -- NAV-PVT 
+   (position, velocity and time), NAV-SAT (satellites in view) and NAV-DOP.
+   NAV-PVT carries all of RMC, GGA and GSA's fix in 100 bytes against their 
+   190 or so, so e.g. 10 Hz fits 38400 baud with room to spare (see 
+   encode_ubx_pvt()) -- set the RATE_ values above to 0 for UBX only */
+#define RATE_PVT 0
+#define RATE_SAT 0
+#define RATE_DOP 0
+
+/* satellite systems simulated -- GNSS_GPS alone, or GPS with any of 
+   GNSS_GLONASS, GNSS_GALILEO and GNSS_BEIDOU added in (e.g. GNSS_GPS | 
+   GNSS_GLONASS).  With more than GPS, RMC, GGA, VTG, GLL and ZDA get the 
+   combined GN talker, GSA goes out as $GNGSA once for each system (with the 
+   NMEA 4.10 system ID at the end), and GSV as pages from each system's own 
+   talker with its own satellite IDs -- GPGSV, GLGSV (65-88), GAGSV (1-36)
+   and GBGSV (BeiDou 19 on).  Windows/Linux take the GNSS setting instead. */
+#define GNSS_GPS      1
+#define GNSS_GLONASS  2
+#define GNSS_GALILEO  4
+#define GNSS_BEIDOU   8
+#define GNSS_SYSTEMS  GNSS_GPS
+
 /* set baud for GPS output -- note 4800 baud is NMEA standard, but many devices allow 9600 or more */
 #define BAUD_RATE 57600
 
+/* define TX_RING (Arduino only) to send through an interrupt driven transmit
+   ring instead of Serial.print(), which waits for the UART on every byte --
+   with REALTIME each epoch's sentences are then made while the epoch before
+   is still going out, and are sent exactly on the next second (see tx_release()) */
+
+/* #define TX_RING */
+
+/* Arduino Mega only -- define PORTn_BAUD (n = 1, 2, 3) to send on Serial1, 
+   Serial2 or Serial3 as well, each at its own baud rate and with its own 
+   sentence rates in PORTn_RATES (seconds, 0 = not on that port) in the order
+   RMC, GGA, GSA, GSV, VTG, GLL, ZDA, PVT, SAT, DOP (missing ones are 0), so a
+   port can send NMEA, UBX or both.  Every port is made from the same epoch.
+   Needs TX_RING -- each port has its own ring, so a slow port does not hold
+   up a fast one.  Serial is port 0, with BAUD_RATE and the RATE_ values. */
+
+/* #define PORT1_BAUD 4800 */
+/* #define PORT1_RATES { 1, 1, 0, 0, 0, 0, 0 } */
+/* #define PORT2_BAUD 115200 */
+/* #define PORT2_RATES { 1, 1, 1, 1, 1, 1, 1 } */
+
+/* define IDLE_SLEEP (Arduino only) to sleep in idle mode between epochs, and 
+   while waiting for room in the transmit ring, instead of spinning -- the
+   millis() tick of timer 0 wakes it, so epochs go out no later (see idle_begin()) */
+
+/* #define IDLE_SLEEP */
+
+/* define DUTY_REPORT (Arduino only) as a number of seconds, at most 3600, to 
+   send a $PGLFD sentence that often with the fraction of time the sketch was 
+   working rather than waiting -- with IDLE_SLEEP, the fraction of time awake
+   (see encode_duty()) */
+
+/* #define DUTY_REPORT 60 */
+
 /* define DEBUG_OUTPUT if you want certain debugging information
    NOTE: in Windows/Linux version this overrides REALTIME below         */
   
@@ -651,12 +803,85 @@ NOTE:  The GPSSIM program will only output the sentences GPRMC, GPGSA, and GPGGA
    
 /* #define USE_RANDOM_VARY */
 
+
+/* define FIXED_POINT to fly the simulation in integer (fixed point) arithmetic
+   instead of floating point -- much faster on Arduino (see sim_segment_fixed()),
+   but without USE_RANDOM_VARY */
+
+/* #define FIXED_POINT */
+
+/* position reports (epochs) per second, 1 to 10 -- more than 1 needs FIXED_POINT 
+   on Arduino (Windows/Linux switch to fixed point by themselves) */
+#ifndef OUTPUT_HZ
+#define OUTPUT_HZ 1
+#endif
+
 /* define SHORT_TEST if you want to omit most of the data lines to save memory for early testing
    of port to Arduino -- if you turn off SHORT_TEST, you MUST turn on 
    USEFLASH */
 
 /* #define SHORT_TEST */
 
+/* define PACKED_SCRIPT to read the waypoints from packed_script[] (about 9 bytes 
+   of flash a waypoint) instead of the date_time[] and lat_long_alt[] tables (20 
+   bytes) -- see wp_next(), and linux/lvl1/wppack to pack a flight of your own */
+
+/* #define PACKED_SCRIPT */
+
+
+/* more than one output port -- unused ones have baud 0 and no sentences */
+#if defined(ARDUINO) && (defined(PORT1_BAUD) || defined(PORT2_BAUD) || defined(PORT3_BAUD))
+#define MULTI_PORT
+#define NUM_PORTS 4
+#ifndef TX_RING
+#error "PORTn_BAUD needs TX_RING"
+#endif
+#ifndef PORT1_BAUD
+#define PORT1_BAUD 0
+#define PORT1_RATES { 0 }
+#endif
+#ifndef PORT2_BAUD
+#define PORT2_BAUD 0
+#define PORT2_RATES { 0 }
+#endif
+#ifndef PORT3_BAUD
+#define PORT3_BAUD 0
+#define PORT3_RATES { 0 }
+#endif
+#else
+#define NUM_PORTS 1
+#endif
+
+/* sentences compiled in -- on Arduino only those with a rate, unless other
+   ports may want any of them */
+#if !defined(ARDUINO) || defined(MULTI_PORT) || (RATE_GSV > 0)
+#define HAVE_GSV
+#endif
+#if !defined(ARDUINO) || defined(MULTI_PORT) || (RATE_VTG > 0)
+#define HAVE_VTG
+#endif
+#if !defined(ARDUINO) || defined(MULTI_PORT) || (RATE_GLL > 0)
+#define HAVE_GLL
+#endif
+#if !defined(ARDUINO) || defined(MULTI_PORT) || (RATE_ZDA > 0)
+#define HAVE_ZDA
+#endif
+#if !defined(ARDUINO) || defined(MULTI_PORT) || (RATE_PVT > 0)
+#define HAVE_PVT
+#endif
+#if !defined(ARDUINO) || defined(MULTI_PORT) || (RATE_SAT > 0)
+#define HAVE_SAT
+#endif
+#if !defined(ARDUINO) || defined(MULTI_PORT) || (RATE_DOP > 0)
+#define HAVE_DOP
+#endif
+#if defined(HAVE_PVT) || defined(HAVE_SAT) || defined(HAVE_DOP)
+#define HAVE_UBX
+#endif
+#if !defined(ARDUINO) || (GNSS_SYSTEMS != GNSS_GPS)
+#define HAVE_MULTI_GNSS
+#endif
+
 
 
 #ifdef ARDUINO
@@ -687,6 +912,13 @@ int portspec = 0;
 /* Size of floats and doubles on Arduino is 32 bits */
 #define VERYBIG 1E+37
 
+/* no event tracing on Arduino -- see evtrace.h in Windows/Linux libraries
+   (the host build in linux/lvl1/avrsim supplies its own, for cycle counting) */
+#ifndef EVTRACE_BEGIN
+#define EVTRACE_BEGIN(name)
+#define EVTRACE_END(name)
+#endif
+
 /* Arduino only -- Stack space debugging support */
 
 /* This function places the current value of the heap and stack pointers in the
@@ -708,8 +940,245 @@ void check_mem() {
   stackptr =  (uint8_t *)(SP);           // save value of stack pointer
 }
 
+/* Arduino only -- idle waits */
+
+/* A wait for the next epoch, or for room in the transmit ring, is written
+
+      idle_begin();
+      while (not ready)
+        {
+         idle_sleep();
+        }
+      idle_end();
+
+   With IDLE_SLEEP the readiness is tested with interrupts off, and 
+   idle_sleep() sleeps in idle mode until the next interrupt -- timer 0's
+   overflow, which is the millis() tick, at the latest.  sei() takes effect
+   only after the instruction that follows it, the sleep, so an interrupt 
+   that comes after the test ends the sleep instead of being missed until
+   the next tick.  millis() only moves in that interrupt, so the wait ends
+   on the same tick as a busy loop would.  Timer 0 and the UART keep running
+   in idle mode.  Without IDLE_SLEEP these only keep the DUTY_REPORT count. */
+
+#ifdef DUTY_REPORT
+unsigned long idle_from;         /* micros() at idle_begin() */
+unsigned long idle_us = 0;       /* time in idle waits since the last report */
+unsigned long idle_wakes = 0;    /* wake-ups from sleep in that time */
+
+/* awake for each wake-up -- waking, the interrupt, and testing whether to 
+   sleep again, about 120 cycles at 16 MHz */
+#define IDLE_WAKE_US 8
+#endif
+
+void idle_begin(void)
+  {
+#ifdef DUTY_REPORT
+   idle_from = micros();
+#endif
+#ifdef IDLE_SLEEP
+   set_sleep_mode(SLEEP_MODE_IDLE);
+   cli();
+#endif
+  }
+
+
+/* called with interrupts off, and returns with them off */
+void idle_sleep(void)
+  {
+#ifdef IDLE_SLEEP
+   sleep_enable();
+   sei();
+   sleep_cpu();
+   sleep_disable();
+   cli();
+#ifdef DUTY_REPORT
+   idle_wakes++;
+#endif
+#endif
+  }
+
+
+void idle_end(void)
+  {
+#ifdef IDLE_SLEEP
+   sei();
+#endif
+#ifdef DUTY_REPORT
+   idle_us += micros() - idle_from;
+#endif
+  }
+
+
 /* Arduino only -- include support available in other libraries under Windows/Linux */
 
+#ifdef TX_RING
+
+/* Interrupt driven transmit ring.  serial_putc() only queues a byte, and the
+   UART's data register empty interrupt sends it.  The ISR sends up to 
+   tx_released -- bytes queued beyond that are the epoch being made (the back 
+   buffer), and wait for tx_release().  In REALTIME the sentences of each epoch
+   are queued while the epoch before is still being sent, and released on the 
+   next second, so making them and sending them overlap.  The ring indexes are 
+   single bytes, so the ISR and the sketch never see one half updated.
+
+   With MULTI_PORT each port has a ring and an ISR of its own, and 
+   serial_putc() queues to port tx_port -- a full ring on a slow port holds 
+   up only the sketch, never the other ports' interrupts. */
+
+/* Mega has four UARTs -- the first is Serial */
+#if defined(USART0_UDRE_vect)
+#define TX_UDRE_vect USART0_UDRE_vect
+#else
+#define TX_UDRE_vect USART_UDRE_vect
+#endif
+
+/* the host build (linux/lvl1/avrsim) runs its UART model while the ring is full */
+#ifndef TX_WAIT
+#define TX_WAIT()
+#endif
+
+unsigned char tx_ring[NUM_PORTS][256];
+volatile unsigned char tx_tail[NUM_PORTS];      /* next byte for the ISR to send */
+volatile unsigned char tx_released[NUM_PORTS];  /* ISR sends up to here */
+unsigned char tx_head[NUM_PORTS];               /* next free byte */
+int tx_paced = FALSE;                           /* TRUE -- sentences wait for tx_release() */
+
+#ifdef MULTI_PORT
+int tx_port = 0;                 /* port serial_putc() queues to -- 0 is Serial */
+#else
+#define tx_port 0
+#endif
+
+/* one port's ISR -- nothing released, quiet until tx_release() */
+#define TX_ISR(vect,port,ucsrb,udr,udrie) \
+   ISR(vect) \
+     { \
+      if (tx_tail[port] == tx_released[port]) \
+        { \
+         ucsrb &= ~(1 << udrie); \
+        } \
+      else \
+        { \
+         udr = tx_ring[port][tx_tail[port]++]; \
+        } \
+     }
+
+TX_ISR(TX_UDRE_vect,0,UCSR0B,UDR0,UDRIE0)
+#ifdef MULTI_PORT
+TX_ISR(USART1_UDRE_vect,1,UCSR1B,UDR1,UDRIE1)
+TX_ISR(USART2_UDRE_vect,2,UCSR2B,UDR2,UDRIE2)
+TX_ISR(USART3_UDRE_vect,3,UCSR3B,UDR3,UDRIE3)
+#endif
+
+
+/* send everything queued so far on one port */
+void tx_release_port(int port)
+  {
+   tx_released[port] = tx_head[port];
+   switch (port)
+     {
+      case 0:
+        {
+         UCSR0B |= (1 << UDRIE0);
+         break;
+        }
+#ifdef MULTI_PORT
+      case 1:
+        {
+         UCSR1B |= (1 << UDRIE1);
+         break;
+        }
+      case 2:
+        {
+         UCSR2B |= (1 << UDRIE2);
+         break;
+        }
+      case 3:
+        {
+         UCSR3B |= (1 << UDRIE3);
+         break;
+        }
+#endif
+     }
+  }
+
+
+/* send everything queued so far, on every port */
+void tx_release(void)
+  {
+   int port;
+
+   for (port=0; port<NUM_PORTS; port++)
+     {
+      tx_release_port(port);
+     }
+  }
+
+
+/* any byte -- UBX messages are binary */
+void serial_putb(unsigned char kar)
+  {
+   /* ring full -- wait for the ISR to make room, unless all of it is the
+      epoch being made (too many sentences for the ring), which must then
+      go out early */
+   if ((unsigned char)(tx_head[tx_port] + 1) == tx_tail[tx_port])
+     {
+      idle_begin();
+      while ((unsigned char)(tx_head[tx_port] + 1) == tx_tail[tx_port])
+        {
+         if (tx_released[tx_port] == tx_tail[tx_port])
+           {
+            tx_release_port(tx_port);
+           }
+         idle_sleep();
+         TX_WAIT();
+        }
+      idle_end();
+     }
+
+   tx_ring[tx_port][tx_head[tx_port]++] = kar;
+   if (!tx_paced)
+     {
+      tx_release_port(tx_port);
+     }
+  }
+
+
+/* text -- anything but 7 bit ASCII is dropped */
+void serial_putc(int kar)
+  {
+   if ((kar < 0x00) || (kar > 0x7F))
+     {
+      return;
+     } 
+   serial_putb((unsigned char)kar);
+  }
+
+
+/* messages are not paced */
+void serial_puts(char strg[])
+  {
+   while (*strg)
+     {
+      serial_putc(*strg++);
+     }
+   tx_release();
+  }
+
+#else
+
+/* sent as soon as made -- for pacing only */
+#define tx_release()
+#define tx_flush()
+
+/* any byte -- UBX messages are binary */
+void serial_putb(unsigned char kar)
+  {
+   Serial.write(kar);
+  }
+
+
+/* text -- anything but 7 bit ASCII is dropped */
 void serial_putc(int kar)
   {
    if ((kar < 0x00) || (kar > 0x7F))
@@ -726,11 +1195,11 @@ void serial_puts(char strg[])
    Serial.print(strg);
   }
 
+#endif
+
 
 void append_strg(int kar, char strg[], int size, int *len)
   {
-   int i;
-
    if (*len >= size)
      {
       *len = size;
@@ -986,6 +1455,7 @@ int seconds_elapsed(void)
 
 unsigned long time(unsigned long *dummy)
   {
+   (void)dummy;
    seconds_elapsed(); 
    return seconds_count;
   }
@@ -1017,14 +1487,56 @@ void wait_seconds(int secs)
      }  
   }
 
+#ifdef TX_RING
+
+/* at the end of the script -- send the last epoch on the next second, and 
+   wait until it has all gone */
+void tx_flush(void)
+  {
+   int port;
+
+   idle_begin();
+   if (tx_paced)
+     {
+      EVTRACE_BEGIN("wait_seconds");
+      while (!seconds_elapsed())
+        {
+         idle_sleep();
+        } 
+      EVTRACE_END("wait_seconds");
+     }
+   tx_release();
+
+   for (port=0; port<NUM_PORTS; port++)
+     {
+      while (tx_tail[port] != tx_head[port])
+        {
+         idle_sleep();
+         TX_WAIT();
+        }
+     }
+   idle_end();
+  }
+
+#endif
+
 void write_com(int port, int kar)
   {
+   (void)port;
    serial_putc(kar);
   }
 
 void com_string(int port,char strg[])
   {
+   (void)port;
+#ifdef TX_RING
+   while (*strg)
+     {
+      serial_putc(*strg++);
+     }
+#else
    Serial.print(strg);
+#endif
   }  
 
 void com_string_crlf(int port,char strg[])
@@ -1052,6 +1564,7 @@ void wait_seconds(int secs)
    time_t time_previous;
    time_t time_current;
    
+   EVTRACE_BEGIN("wait_seconds");
    time(&time_previous);
    time(&time_current);
    
@@ -1064,6 +1577,35 @@ void wait_seconds(int secs)
         } 
       time_previous = time_current;  
      }  
+   EVTRACE_END("wait_seconds");
+  }
+
+
+/* milliseconds on a clock that is not set -- for the epochs within a second */
+unsigned long host_ms(void)
+  {
+#if defined(__MINGW32__)
+   return (unsigned long)GetTickCount();
+#else
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC,&ts);
+   return ((unsigned long)ts.tv_sec * 1000UL) + (unsigned long)(ts.tv_nsec / 1000000L);
+#endif
+  }
+
+
+void sleep_ms(unsigned long msecs)
+  {
+#if defined(__MINGW32__)
+   Sleep(msecs);
+#else
+   struct timespec ts;
+
+   ts.tv_sec = (time_t)(msecs / 1000UL);
+   ts.tv_nsec = (long)(msecs % 1000UL) * 1000000L;
+   nanosleep(&ts,NULL);
+#endif
   }
 
 
@@ -1092,6 +1634,7 @@ void com_string(int port,char strg[])
 
 void com_string_crlf(int port,char strg[])
   {
+   EVTRACE_BEGIN("write_com");
    if (port)
      {   
       com_string(port,strg);
@@ -1102,6 +1645,7 @@ void com_string_crlf(int port,char strg[])
      {
 	  printf("%s\n",strg);
      }	 
+   EVTRACE_END("write_com");
   }  
 
 
@@ -1238,12 +1782,26 @@ char *dtostrf_chop(double val, signed char wid, unsigned char prec, char *s)
 /* Windows/Linux only -- used to process command line options */
 char inname[65];
 char outname[65];
+char tracename[65];
 FILE *infile;
 FILE *outfile;
 int chopcol;
 long endline;
 long numin;
 
+/* Windows/Linux only -- a long realtime run is usually ended with Ctrl-C.
+   The handler only raises early_stop:  the kernels see it at their next 
+   second and main() returns, so atexit() writes out the event trace from 
+   outside any tracing call (exit() in the handler could stop the program 
+   inside one, and evtrace_close() would wait on it for ever). */
+volatile sig_atomic_t early_stop = 0;
+
+void early_exit_signal(int sig)
+  {
+   (void)sig;
+   early_stop = 1;
+  }
+
 #endif
 
 
@@ -1251,7 +1809,7 @@ long numin;
 
 /* the following functions provide safer equivalents to certain math functions 
    in the C library, but also convert them implicitly to use degrees instead 
-   of radians 
+   of radians -- none of them calls the C library's trig functions 
 */
   
 #define RAD_TO_DEG  57.29577951
@@ -1263,52 +1821,210 @@ long numin;
 #define Z_ATTENUATE 0.15
   
   
+/* cos(0 to 90 degrees) in half degree steps, times 65536 (cos(0) held as 65535) 
+   -- for the fixed point pipeline's fx_cos(), and cos_safe() on the Arduino */
+#ifdef USEFLASH
+unsigned int fx_cos_q16[181] PROGMEM =
+#else
+unsigned int fx_cos_q16[181] =
+#endif
+  {
+   65535, 65534, 65526, 65514, 65496, 65474, 65446, 65414, 65376, 65334,
+   65287, 65234, 65177, 65115, 65048, 64975, 64898, 64816, 64729, 64637,
+   64540, 64439, 64332, 64220, 64104, 63983, 63856, 63725, 63589, 63449,
+   63303, 63152, 62997, 62837, 62672, 62503, 62328, 62149, 61966, 61777,
+   61584, 61386, 61183, 60976, 60764, 60547, 60326, 60100, 59870, 59635,
+   59396, 59152, 58903, 58650, 58393, 58131, 57865, 57594, 57319, 57040,
+   56756, 56468, 56175, 55879, 55578, 55273, 54963, 54650, 54332, 54010,
+   53684, 53354, 53020, 52682, 52339, 51993, 51643, 51289, 50931, 50569,
+   50203, 49834, 49461, 49084, 48703, 48318, 47930, 47538, 47143, 46744,
+   46341, 45935, 45525, 45112, 44695, 44275, 43852, 43425, 42995, 42562,
+   42126, 41686, 41243, 40797, 40348, 39896, 39441, 38982, 38521, 38057,
+   37590, 37120, 36647, 36172, 35693, 35212, 34729, 34242, 33754, 33262,
+   32768, 32271, 31772, 31271, 30767, 30261, 29753, 29242, 28729, 28214,
+   27697, 27177, 26656, 26132, 25607, 25080, 24550, 24019, 23486, 22951,
+   22415, 21876, 21336, 20795, 20252, 19707, 19161, 18613, 18064, 17514,
+   16962, 16409, 15855, 15299, 14742, 14185, 13626, 13066, 12505, 11943,
+   11380, 10817, 10252,  9687,  9121,  8554,  7987,  7419,  6850,  6281,
+    5712,  5142,  4572,  4001,  3430,  2859,  2287,  1716,  1144,   572,
+       0
+  };
+
+#ifdef USEFLASH
+#define FX_COS(i)   ((long)pgm_read_word(fx_cos_q16 + (i)))
+#else
+#define FX_COS(i)   ((long)fx_cos_q16[i])
+#endif
+
+
+#ifdef ARDUINO
+/* Without floating point hardware a libm cos() costs some 1700 cycles and an 
+   acos() 2200, so on the Arduino these two come from small flash tables, 
+   linear between entries -- cos from the half degree table (shared with the 
+   fixed point pipeline's fx_cos()), good to 2e-5, and atan from a table in 
+   64ths of the ratio, good to 0.002 degree.  That is well inside the 0.1 
+   degree (and 0.1 knot) that NMEA reports. */
+
+/* atan(0 to 1 in 64ths), in units of 0.001 degree */
+#ifdef USEFLASH
+unsigned int deg_atan_e3[65] PROGMEM =
+#else
+unsigned int deg_atan_e3[65] =
+#endif
+  {
+       0,   895,  1790,  2684,  3576,  4467,  5356,  6242,  7125,  8005,
+    8881,  9752, 10620, 11482, 12339, 13191, 14036, 14876, 15709, 16535,
+   17354, 18166, 18970, 19767, 20556, 21337, 22109, 22874, 23629, 24376,
+   25115, 25844, 26565, 27277, 27979, 28673, 29358, 30033, 30700, 31357,
+   32005, 32645, 33275, 33896, 34509, 35112, 35707, 36293, 36870, 37439,
+   37999, 38550, 39094, 39629, 40156, 40675, 41186, 41689, 42184, 42672,
+   43152, 43625, 44091, 44549, 45000
+  };
+
+#ifdef USEFLASH
+#define DEG_ATAN(i) ((long)pgm_read_word(deg_atan_e3 + (i)))
+#else
+#define DEG_ATAN(i) ((long)deg_atan_e3[i])
+#endif
+
+
 double cos_safe(double angle_deg)
   {
-   double angle_radian;    
-   
-   angle_radian = angle_deg * DEG_TO_RAD;
-   while (angle_radian < 0.000000001)
+   double angle;
+   double frac;
+   double sign = 1.0;
+   int step;
+
+   /* fold into 0 to 90 degrees */
+   angle = fabs(angle_deg);
+   while (angle >= 360.0)
      {
-      angle_radian += TWO_PI_VAL;              
+      angle -= 360.0;
      }
-   while (angle_radian > TWO_PI_VAL)
+   if (angle > 180.0)
      {
-      angle_radian -= TWO_PI_VAL;              
+      angle = 360.0 - angle;
      }
-   if (angle_radian < 0.000000001)
+   if (angle > 90.0)
      {
-      return 1.0;              
-     }               
-   return cos(angle_radian);                 
+      angle = 180.0 - angle;
+      sign = -1.0;
+     }
+
+   frac = angle * 2.0;
+   step = (int)frac;
+   if (step > 179)
+     {
+      step = 179;
+     }
+   frac -= (double)step;
+   return sign * ((double)FX_COS(step) + frac * (double)(FX_COS(step + 1) - FX_COS(step))) 
+                * (1.0 / 65536.0);
   }
-  
-double acos_safe(double cos_deg)
+
+
+/* direction of (x, y) from the x axis toward y, -180 to +180 degrees */
+double atan2_safe(double y, double x)
   {
-   double angle_radian;    
-   
-   if (cos_deg < -0.9999999999)
+   double ax, ay, ratio, angle;
+   int step;
+   int swap = FALSE;
+
+   ax = fabs(x);
+   ay = fabs(y);
+   if (ay > ax)
+     {
+      ratio = ax / ay;
+      swap = TRUE;
+     }
+   else if (ax > 0.0)
      {
-      return 180.0;          
+      ratio = ay / ax;
+     }
+   else
+     {
+      return 0.0;
      }
 
-   if (cos_deg > 0.9999999999)
+   ratio *= 64.0;
+   step = (int)ratio;
+   if (step > 63)
      {
-      return 0.0;          
+      step = 63;
      }
+   ratio -= (double)step;
+   angle = ((double)DEG_ATAN(step) + ratio * (double)(DEG_ATAN(step + 1) - DEG_ATAN(step))) 
+           * 0.001;
 
-   angle_radian = acos(cos_deg);     
-   return  angle_radian * RAD_TO_DEG;
+   /* out of the first octant */
+   if (swap)
+     {
+      angle = 90.0 - angle;
+     }
+   if (x < 0.0)
+     {
+      angle = 180.0 - angle;
+     }
+   if (y < 0.0)
+     {
+      angle = -angle;
+     }
+   return angle;
   }
-  
-  
-  
-double sqrt_safe(double val)
+
+#elif defined(HAVE_SIM_LIBS)
+/* Windows and Linux take them from the degtrig library -- polynomials in 
+   degrees, as accurate as libm's but with no reduction by pi and no library 
+   call */
+double cos_safe(double angle_deg)
   {
-   if (val < 0.000000001)
-     {
-      return 0.0;              
-     }        
+   return dt_cos(angle_deg);
+  }
+
+
+/* direction of (x, y) from the x axis toward y, -180 to +180 degrees */
+double atan2_safe(double y, double x)
+  {
+   return dt_atan2(y,x);
+  }
+#else
+/* without degtrig, from libm */
+double cos_safe(double angle_deg)
+  {
+   double angle_radian;    
+   
+   angle_radian = angle_deg * DEG_TO_RAD;
+   while (angle_radian < 0.000000001)
+     {
+      angle_radian += TWO_PI_VAL;              
+     }
+   while (angle_radian > TWO_PI_VAL)
+     {
+      angle_radian -= TWO_PI_VAL;              
+     }
+   if (angle_radian < 0.000000001)
+     {
+      return 1.0;              
+     }               
+   return cos(angle_radian);                 
+  }
+
+
+/* direction of (x, y) from the x axis toward y, -180 to +180 degrees */
+double atan2_safe(double y, double x)
+  {
+   return atan2(y,x) * RAD_TO_DEG;
+  }
+#endif
+  
+  
+  
+double sqrt_safe(double val)
+  {
+   if (val < 0.000000001)
+     {
+      return 0.0;              
+     }        
    return sqrt(val);         
   }     
   
@@ -1327,7 +2043,7 @@ double sqrt_safe(double val)
    interpolation of waypoints.
 */   
 
-#ifdef USE_RANDOM_VARY
+#if !defined(ARDUINO) || defined(USE_RANDOM_VARY)
 double rnd_offset_deg[100] =   /* use by generating a linearly random index 0-99 */
   {
    -0.0000014, 
@@ -1401,6 +2117,35 @@ unsigned int random_index(unsigned int range)  /* returns index 0 to range-1 */
 #endif
 
 
+#ifdef HAVE_MULTI_GNSS
+
+/* The satellites of GLONASS, Galileo and BeiDou are picked from a generator
+   of their own (a 16 bit xorshift, the same on every system), so turning them
+   on leaves the rand() sequence -- and the GPS satellites, winds and errors 
+   made from it -- just as it was. */
+
+unsigned int gnss_rand_state = 1;
+
+void gnss_srand(int seed)
+  {
+   gnss_rand_state = ((unsigned int)seed & 0xFFFFU);
+   if (gnss_rand_state == 0)
+     {
+      gnss_rand_state = 1;     /* never all zero */
+     }
+  }
+
+unsigned int gnss_random(unsigned int range)  /* returns index 0 to range-1 */
+  {
+   gnss_rand_state ^= ((gnss_rand_state << 7) & 0xFFFFU);
+   gnss_rand_state ^= (gnss_rand_state >> 9);
+   gnss_rand_state ^= ((gnss_rand_state << 8) & 0xFFFFU);
+   return (unsigned int)(((unsigned long)gnss_rand_state * (unsigned long)range) >> 16);
+  }
+
+#endif
+
+
 
 void random_vary_pos(int vary_spec, double *x, double *y, double *z)
   {
@@ -1420,7 +2165,7 @@ void random_vary_pos(int vary_spec, double *x, double *y, double *z)
      }
      
    /* variation in y -- latitude -- is straightforward */
-#ifdef USE_RANDOM_VARY   
+#if !defined(ARDUINO) || defined(USE_RANDOM_VARY)
    offset = (rnd_offset_deg[random_index(100)] * vary_spec);
 #else
    offset = 0;
@@ -1445,7 +2190,7 @@ void random_vary_pos(int vary_spec, double *x, double *y, double *z)
 /*   lat_adj = 1.000 / cos_safe(*y);    */
    lat_adj = 1.000;
 
-#ifdef USE_RANDOM_VARY   
+#if !defined(ARDUINO) || defined(USE_RANDOM_VARY)
    offset = (rnd_offset_deg[random_index(100)] * vary_spec);
 #else
    offset = 0;
@@ -1456,7 +2201,7 @@ void random_vary_pos(int vary_spec, double *x, double *y, double *z)
    /* variation in z -- altitude -- is straightforward but in different units and 
          assumed to be a reduced effect from that in x and y */
 
-#ifdef USE_RANDOM_VARY   
+#if !defined(ARDUINO) || defined(USE_RANDOM_VARY)
    offset = rnd_offset_deg[random_index(100)] * vary_spec 
                                     * METERS_PER_DEG_LAT * Z_ATTENUATE;
 #else
@@ -1600,6 +2345,59 @@ int flt_randomseed = RAND_SEED_VALUE;
 
 int flt_realtime = FALSE;
 
+
+/* Run-time configuration -- starts out as the compile options above, which is all
+   the Arduino version ever uses.  Windows/Linux may override any of these before the
+   script is opened (see read_config()). */
+
+#ifdef REALTIME
+#define DEFAULT_REALTIME TRUE
+#else
+#define DEFAULT_REALTIME FALSE
+#endif
+
+#ifdef NMEA23
+#define DEFAULT_NMEA23 TRUE
+#else
+#define DEFAULT_NMEA23 FALSE
+#endif
+
+#ifdef PERFECT_SAT_FIXES
+#define DEFAULT_PERFECT_SAT_FIXES TRUE
+#else
+#define DEFAULT_PERFECT_SAT_FIXES FALSE
+#endif
+
+#ifdef USE_RANDOM_VARY
+#define DEFAULT_RANDOM_VARY 4      /* stable realistic winds */
+#else
+#define DEFAULT_RANDOM_VARY 0
+#endif
+
+#ifdef FIXED_POINT
+#define DEFAULT_FIXED_POINT TRUE
+#else
+#define DEFAULT_FIXED_POINT FALSE
+#endif
+
+#if defined(ARDUINO) && (OUTPUT_HZ > 1) && !defined(FIXED_POINT)
+#error OUTPUT_HZ above 1 needs FIXED_POINT
+#endif
+
+int cfg_realtime = DEFAULT_REALTIME;
+int cfg_nmea23 = DEFAULT_NMEA23;
+int cfg_perfect_sat_fixes = DEFAULT_PERFECT_SAT_FIXES;
+int cfg_random_vary = DEFAULT_RANDOM_VARY;     /* 0 (none) to 100 */
+int cfg_stable_sat_seconds = STABLE_SAT_SECONDS;
+int cfg_dropout_sat_seconds = DROPOUT_SAT_SECONDS;
+int cfg_dropout_cycles = DROPOUT_CYCLES;
+int cfg_fixed_point = DEFAULT_FIXED_POINT;
+int cfg_output_hz = OUTPUT_HZ;
+
+/* what the simulation kernel actually does -- set once at startup */
+int flt_fixed = FALSE;      /* TRUE for the fixed point pipeline */
+int flt_hz = 1;             /* epochs per second */
+
 #ifdef ARDUINO
 unsigned long flt_time_previous;
 unsigned long flt_time_current;
@@ -1612,8 +2410,8 @@ int flt_fixtype;
 int flt_datapos = 0;
 
 int flt_var = 0;
-int flt_noise = 0;
-int flt_error = 0;
+double flt_noise = 0.0;     /* receiver error, 1 sigma meters (Windows/Linux -- */
+double flt_error = 0.0;     /*    see sim_error()) */
 
 int flt_firstyear = 0;
 long flt_secs_firstyear = 0L;
@@ -1643,38 +2441,32 @@ double flt_y_b = 0.0;
 double flt_z_m = 0.0;
 double flt_z_b = 0.0;
 
+/* speed and track of the segment as quadratics in the second -- value at the 
+   first second, slope there and curvature -- see motion_setup() */
+double flt_knots_0 = 0.0;
+double flt_knots_m = 0.0;
+double flt_knots_c = 0.0;
+double flt_track_0 = 0.0;
+double flt_track_m = 0.0;
+double flt_track_c = 0.0;
+double flt_motion_h = 0.0;       /* half the segment, seconds */
+
 double flt_climb_rate = 0.0;
 double flt_climb_user_input = 0.0;
 double flt_climb_offset = 0.0;
 char flt_indicate_climb[22] = "";
 
 
-/* these counters and predefined macros (above) set up cycle timing for simulated 
-   satellite visibility changes and simulated GPS reception dropouts */
+/* seconds from the start of the script -- the place in the fix-quality timeline
+   (see tl_action()), which sets the timing of simulated satellite visibility 
+   changes and GPS reception dropouts */
       
-int flt_stablect;
-int flt_dropoutct;
-int flt_cyclect;
-
+long flt_second;
 
-int checksum(char strg[])
-  {
-   int i;
-   unsigned char csum = 0;
-   
-   for (i=0; strg[i]; i++)
-     {
-      csum ^= strg[i];       
-     }               
-     
-   return (int)csum;  
-  }
-  
 
 /* convert coordinate to style used by GPS:  DEGMM.MMM   from fractional degree:  DEG.DDDDDD */
 double gps_coord(double deg_coord)
   {
-   int gps;
    int deg;
    double fracdeg; 
    double sgn = 1.0;
@@ -1725,16 +2517,111 @@ double deg_coord(double gps_coord)
   }
 
 
+#ifdef PACKED_SCRIPT
+/* packed_script[] decoder state -- see wp_next() */
+unsigned int wp_pos;             /* next byte */
+long wp_date, wp_time;           /* last waypoint read */
+long wp_lat, wp_long, wp_alt;    /* DDMM.mmm * 1000, meters * 10 */
+#endif
+
+#ifndef ARDUINO
+/* Windows/Linux only -- FLIGHT=file flies a balloon from the launch site and
+   balloon described in the file (see flight.h, and linux/lvl1/flightgen)
+   instead of following the built-in waypoints.  The whole flight -- ascent,
+   burst and descent through the standard atmosphere and the file's winds --
+   is worked out at startup, in a few milliseconds, as a waypoint every
+   WAYPOINT_SECS seconds and at burst and landing.  The simulation kernels
+   fly between those waypoints just as between the tables' ones. */
+char flightname[65] = "";
+int cfg_flight = FALSE;
+fl_params flt_model;
+fl_winds flt_winds;
+fl_batch flt_flight;
+fl_track flt_track;
+int flt_trackpos;
+
+/* Windows/Linux only -- WINDGRID=file replaces the random wind variation with
+   winds read on a latitude/longitude/altitude grid (see windgrid.h).  From
+   each waypoint the position is carried along by the grid's wind at its
+   altitude, second by second, and a steady correction spread over the
+   segment brings it onto the next waypoint -- so the route still keeps to
+   the waypoints, but wanders between them as the wind field says. */
+char windgridname[65] = "";
+int cfg_windgrid = FALSE;
+windgrid flt_grid;
+wg_cache flt_wind_cache;
+double flt_wind_x, flt_wind_y;   /* carried by the wind, degrees */
+double flt_wind_dx, flt_wind_dy; /* correction per second, degrees */
+double flt_wind_east, flt_wind_north, flt_wind_cos;   /* last wind_step() */
+
+/* Windows/Linux only -- WMM=file gives RMC the magnetic variation of the World
+   Magnetic Model (see wmm.h) at the simulated place and date, instead of the 
+   fixed -1.4.  The model is summed again only when the position has moved 
+   MAGVAR_KM or the clock MAGVAR_SECS since the last time. */
+char wmmname[65] = "";
+int cfg_wmm = FALSE;
+double cfg_magvar_km = 5.0;
+double cfg_magvar_secs = 3600.0;
+wmm_model flt_wmm;
+wmm_cache flt_wmm_cache;
+
+/* Windows/Linux only -- GEOID=file gives GGA the height of the geoid above 
+   the ellipsoid from an EGM2008 or EGM96 grid (see geoid.h), instead of the
+   fixed 47.1.  The EGM2008 grids are mapped, not read, so many simulators 
+   can share one copy. */
+char geoidname[65] = "";
+int cfg_geoid = FALSE;
+geoid_grid flt_geoid;
+gd_cache flt_geoid_cache;
+
+/* Windows/Linux only -- ERROR=m and NOISE=m give the reported position a 
+   receiver's error instead of none.  ERROR is the 1 sigma range error of a 
+   first order Gauss-Markov process with time constant ERROR_TAU seconds (the 
+   slowly wandering part -- atmosphere, orbits, multipath), NOISE that of 
+   white noise added to each fix, and both are multiplied by the DOP in 
+   force.  The errors are drawn a segment at a time (error_setup()). */
+#define ERR_BATCH 512
+double cfg_error = 0.0;
+double cfg_error_tau = 120.0;
+double cfg_noise = 0.0;
+int cfg_error_model = FALSE;
+gm_rng flt_err_rng;
+gm_process flt_err_gm[3];
+double flt_err_buf[3][ERR_BATCH];   /* east, north, up -- meters per unit of DOP */
+int flt_err_count = 0;
+int flt_err_pos = 0;
+long flt_err_left = 0L;             /* seconds of the segment not yet drawn */
+#endif
+
 void open_script(void)
   {
    flt_datapos = 0;
+#ifndef ARDUINO
+   flt_trackpos = 0;
+#endif
 
    /* DEFAULT randomized wind variation = 4 for stable realistic winds */
-   flt_var = 0;
-   flt_noise = 0;
-   flt_error = 0;
+   flt_var = cfg_random_vary;
+   flt_noise = 0.0;
+   flt_error = 0.0;
    
    srand(flt_randomseed);
+#ifdef HAVE_MULTI_GNSS
+   gnss_srand(flt_randomseed);
+#endif
+#ifdef HAVE_SIM_LIBS
+   if (cfg_error_model)
+     {
+      flt_noise = cfg_noise;
+      flt_error = cfg_error;
+      gm_seed(&flt_err_rng,(unsigned long)flt_randomseed);
+      gm_process_init(&flt_err_gm[0],cfg_error_tau,1.0);
+      gm_process_init(&flt_err_gm[1],cfg_error_tau,1.0);
+      gm_process_init(&flt_err_gm[2],cfg_error_tau,1.0);
+      flt_err_count = 0;
+      flt_err_pos = 0;
+     }
+#endif
    
    flt_firstpass = TRUE;
    flt_firstyear = 0;
@@ -1771,9 +2658,14 @@ void open_script(void)
    flt_climb_offset = 0.0;
    strcpy(flt_indicate_climb,"          |          ");
 
-   flt_stablect = 0;        
-   flt_dropoutct = 0;
-   flt_cyclect = 1;      /* when this returns to 0, a dropout will begin */
+   flt_second = 0L;
+
+#ifdef PACKED_SCRIPT
+   wp_pos = 0;
+   wp_lat = 0L;
+   wp_long = 0L;
+   wp_alt = 0L;
+#endif
   }
 
 
@@ -1785,6 +2677,8 @@ void open_script(void)
       Simulates the actual balloon flight of Spirit of Knoxville IV.
 */
 
+#ifndef PACKED_SCRIPT
+
 /* data is split into two sections -- long int date and time, and double x,y,z data */
 
 
@@ -2048,6 +2942,98 @@ void open_script(void)
    -1.0, -1.0, -1.0                  /* dummies for end of list */  
   };
 
+#else
+
+/* 101 waypoints from linux/lvl1/wppack/snox4.wpt, packed by wppack --
+   916 bytes instead of 2040 as date_time[] and lat_long_alt[] */
+
+#ifdef USEFLASH
+ unsigned char packed_script[] PROGMEM =
+#else
+ unsigned char packed_script[] =
+#endif
+  {
+   0xD4, 0x8F, 0x06, 0xB0, 0x6D, 0xEA, 0xA5, 0xB2, 0x03, 0xB9, 0xCA, 0xFB,
+   0x07, 0x80, 0x28, 0x78, 0x01, 0x00, 0x14, 0xB0, 0x09, 0x8D, 0x0B, 0xC2,
+   0x13, 0xFC, 0xB3, 0x02, 0xB0, 0x09, 0xD9, 0x13, 0xAA, 0x6A, 0xFC, 0x8D,
+   0x03, 0xB0, 0x09, 0xF9, 0x16, 0x84, 0xE9, 0x01, 0xB0, 0xCB, 0x03, 0xB0,
+   0x09, 0xC7, 0x1A, 0xF0, 0xB5, 0x02, 0xB0, 0xFD, 0x03, 0xB0, 0x09, 0xC8,
+   0x11, 0xA6, 0x89, 0x07, 0xF8, 0xA5, 0x01, 0xB0, 0x09, 0x80, 0x09, 0xD6,
+   0x94, 0x02, 0xFB, 0x07, 0xB0, 0x09, 0xF4, 0x0A, 0x94, 0x8E, 0x02, 0xE0,
+   0x12, 0xB0, 0x09, 0xB2, 0x15, 0x80, 0x80, 0x07, 0xDB, 0x06, 0xB0, 0x09,
+   0xC0, 0x13, 0xB8, 0x9B, 0x02, 0x83, 0x07, 0xB0, 0x09, 0xC2, 0x1A, 0x82,
+   0xA4, 0x02, 0xAC, 0x07, 0xB0, 0x09, 0x8E, 0x8B, 0x05, 0x86, 0xA6, 0x02,
+   0xB3, 0x06, 0xB0, 0x09, 0xBE, 0x1F, 0x98, 0x9B, 0x07, 0xEF, 0x0B, 0xB0,
+   0x09, 0xDA, 0x24, 0x90, 0xB2, 0x02, 0xA3, 0x12, 0xD0, 0x41, 0xB4, 0x24,
+   0xFC, 0xB5, 0x02, 0xD4, 0x1B, 0xA0, 0x38, 0xAE, 0xA7, 0x01, 0x96, 0xD3,
+   0x18, 0xC7, 0x15, 0xE0, 0x12, 0xDB, 0x01, 0x00, 0x00, 0xE0, 0x12, 0x97,
+   0x0F, 0xFE, 0x9B, 0x14, 0xE7, 0x2A, 0xB0, 0x09, 0xA9, 0x02, 0xEE, 0xD6,
+   0x02, 0xC4, 0x04, 0xB0, 0x09, 0x56, 0xD6, 0xA0, 0x0A, 0x27, 0x80, 0x4B,
+   0xBA, 0x14, 0xD6, 0xD2, 0x02, 0xB8, 0x08, 0xE0, 0x12, 0x96, 0x0E, 0xB4,
+   0xC5, 0x07, 0xF3, 0xB4, 0x02, 0x88, 0x0E, 0xA4, 0x9F, 0x01, 0xA2, 0xB5,
+   0x6F, 0xD4, 0xC7, 0x02, 0x88, 0xA4, 0x01, 0xA3, 0x01, 0x96, 0xCD, 0x02,
+   0xCC, 0x08, 0xE0, 0x12, 0x00, 0x00, 0x00, 0xC0, 0x25, 0x0E, 0xF0, 0xD8,
+   0x16, 0x90, 0x12, 0xB0, 0x09, 0xE4, 0x72, 0xAC, 0xDE, 0x24, 0x8F, 0x2B,
+   0xC0, 0x70, 0x9C, 0x39, 0xE6, 0xA4, 0x0F, 0xBB, 0x0F, 0xB0, 0x09, 0xC6,
+   0x35, 0xA6, 0xFF, 0x09, 0xD4, 0x0C, 0xB0, 0x09, 0xB2, 0x2F, 0x80, 0xF6,
+   0x09, 0xF4, 0x0D, 0xE0, 0x12, 0x8E, 0x16, 0x8C, 0xC0, 0x02, 0xAF, 0x0E,
+   0xB0, 0x09, 0xF6, 0x1A, 0xDC, 0xB3, 0x07, 0xD0, 0x05, 0xB0, 0x09, 0x94,
+   0x20, 0xC2, 0xBD, 0x02, 0xDF, 0x08, 0xE0, 0x12, 0xDA, 0x72, 0x00, 0xEB,
+   0x09, 0xE0, 0x12, 0x84, 0xE9, 0x05, 0xDA, 0xA3, 0x18, 0xC8, 0x10, 0xF0,
+   0x2E, 0xDC, 0x2A, 0xDE, 0xAB, 0x02, 0xDB, 0x01, 0xD0, 0x41, 0xE2, 0xDF,
+   0x01, 0xDE, 0xA3, 0x15, 0x3C, 0xB0, 0x09, 0xFA, 0xFB, 0x01, 0x90, 0x81,
+   0x10, 0xF7, 0x05, 0xB0, 0x09, 0x94, 0x33, 0x86, 0x8C, 0x07, 0xF3, 0x03,
+   0xB0, 0x09, 0xF4, 0x2A, 0xD6, 0x9A, 0x02, 0xBB, 0x05, 0xB0, 0x09, 0xCE,
+   0x8B, 0x01, 0xCA, 0xB2, 0x04, 0xC7, 0x01, 0x90, 0x1C, 0xF6, 0x2B, 0xB4,
+   0x90, 0x09, 0xEB, 0x04, 0xB0, 0x09, 0xAA, 0xA1, 0x05, 0xE6, 0x8A, 0x02,
+   0xA4, 0x03, 0xE0, 0x12, 0xFC, 0x68, 0x90, 0x8D, 0x09, 0xB7, 0x08, 0xB0,
+   0x09, 0x92, 0x3B, 0xE0, 0x8A, 0x02, 0x64, 0xB0, 0x09, 0xA6, 0x3F, 0xD4,
+   0x91, 0x02, 0xFC, 0x02, 0xB0, 0x09, 0x90, 0x44, 0xF0, 0x86, 0x07, 0x77,
+   0xB0, 0x09, 0xCA, 0x45, 0xF6, 0x99, 0x02, 0x8F, 0x08, 0xB0, 0x09, 0xCC,
+   0x46, 0xAE, 0x91, 0x02, 0xBB, 0x05, 0xB0, 0x09, 0xCE, 0x41, 0xBC, 0xF5,
+   0x06, 0xEB, 0x18, 0xB0, 0x09, 0xC8, 0x42, 0xA2, 0xFC, 0x01, 0xCF, 0x28,
+   0xB0, 0x09, 0xA2, 0x40, 0x88, 0xA6, 0x02, 0x8F, 0x17, 0xB0, 0x09, 0xE6,
+   0x4E, 0xB0, 0xFF, 0x06, 0x8B, 0x24, 0xB0, 0x09, 0x8E, 0x45, 0x94, 0x93,
+   0x02, 0xB3, 0x1A, 0xB0, 0x09, 0xA4, 0x44, 0xA2, 0x9C, 0x02, 0xCF, 0x23,
+   0xB0, 0x95, 0x15, 0x8A, 0xCE, 0x05, 0xEE, 0x9A, 0xF6, 0x01, 0xEB, 0x36,
+   0xB0, 0x09, 0xA2, 0x6B, 0xE8, 0xED, 0x06, 0xCF, 0x19, 0x90, 0x1C, 0xEA,
+   0xD5, 0x01, 0xC4, 0xE3, 0x03, 0xDF, 0x21, 0x90, 0x1C, 0xE0, 0x8E, 0x03,
+   0xC8, 0xA0, 0x0C, 0x8F, 0x5D, 0xB0, 0x09, 0xD6, 0x5F, 0xF8, 0xDF, 0x01,
+   0xB3, 0x10, 0x90, 0x67, 0x00, 0x00, 0x00, 0xB0, 0x54, 0xF2, 0xAB, 0x23,
+   0xBA, 0xEB, 0x37, 0xD3, 0x97, 0x03, 0xF0, 0x8F, 0x02, 0xD4, 0xDB, 0x30,
+   0xA4, 0xB6, 0x60, 0xC7, 0xBA, 0x01, 0xE0, 0x12, 0xA4, 0x5D, 0xBA, 0xD2,
+   0x01, 0x87, 0x18, 0xB0, 0x09, 0x9C, 0xA1, 0x01, 0xF4, 0x9E, 0x03, 0xFF,
+   0x54, 0x90, 0x1C, 0x82, 0xA9, 0x05, 0xF4, 0xB7, 0x01, 0xE3, 0x23, 0x90,
+   0x1C, 0x8E, 0x84, 0x01, 0x8E, 0xE8, 0x09, 0xE3, 0xB9, 0x01, 0xC0, 0x25,
+   0xB8, 0x53, 0xE2, 0x8D, 0x09, 0x9B, 0x4A, 0xF0, 0x2E, 0xF2, 0x29, 0xC0,
+   0x9D, 0x03, 0x94, 0x46, 0xAF, 0x09, 0x00, 0x00, 0x00, 0xB0, 0x09, 0x00,
+   0x00, 0x00, 0xE0, 0x12, 0x8A, 0x2D, 0x8E, 0xF4, 0x01, 0xA8, 0x5A, 0x90,
+   0x1C, 0x00, 0x00, 0x00, 0xB0, 0x09, 0xF4, 0xBF, 0x02, 0xE2, 0xA7, 0x0B,
+   0xE4, 0x8E, 0x02, 0xC0, 0x25, 0xFA, 0xB2, 0x07, 0xE2, 0xBF, 0x0B, 0xB4,
+   0x2E, 0xE0, 0x12, 0xF0, 0x5C, 0xC8, 0xE3, 0x01, 0xD8, 0x13, 0xE0, 0x5D,
+   0xF4, 0x8D, 0x02, 0xCC, 0xA4, 0x0A, 0xA7, 0x14, 0xB0, 0x09, 0x9C, 0xF6,
+   0x03, 0xAA, 0x8D, 0x15, 0x9B, 0x8D, 0x02, 0xB0, 0x09, 0xF0, 0x9C, 0x05,
+   0xB8, 0x90, 0x01, 0xC8, 0x33, 0xB0, 0x09, 0xA4, 0x32, 0xFC, 0xB3, 0x01,
+   0xBC, 0x0F, 0xE0, 0x12, 0xE2, 0x77, 0xD8, 0xA7, 0x03, 0xE8, 0x43, 0xE0,
+   0x12, 0xF6, 0x35, 0x92, 0xD4, 0x06, 0xE8, 0x25, 0xB0, 0x09, 0x94, 0x8C,
+   0x01, 0xCC, 0xF2, 0x03, 0xB0, 0x3B, 0xB0, 0x09, 0xDA, 0x58, 0xC6, 0xEE,
+   0x06, 0xCC, 0x2B, 0xB0, 0x09, 0xAC, 0x56, 0xC0, 0x80, 0x02, 0xA4, 0x1C,
+   0xB0, 0x09, 0x98, 0x4F, 0xCC, 0x93, 0x02, 0xE8, 0x16, 0xB0, 0x09, 0xAA,
+   0x4A, 0xCC, 0x9D, 0x02, 0x9C, 0x0E, 0xB0, 0x09, 0xA2, 0x43, 0xF8, 0x9B,
+   0x07, 0xE4, 0x1E, 0xB0, 0x09, 0xC8, 0x3F, 0xE6, 0xBC, 0x02, 0xC4, 0x0E,
+   0xB0, 0x09, 0xCE, 0x37, 0xFA, 0xC3, 0x02, 0xC4, 0x13, 0xB0, 0x09, 0xFE,
+   0xA7, 0x05, 0xC8, 0xAE, 0x01, 0xD3, 0x02, 0xB0, 0x09, 0xFA, 0x3B, 0xCA,
+   0xBC, 0x02, 0x8F, 0x12, 0xB0, 0x09, 0xDA, 0x44, 0xB0, 0xC9, 0x02, 0xCF,
+   0x3C, 0xB0, 0x09, 0x9C, 0x39, 0xCC, 0xC6, 0x07, 0xE7, 0x52, 0xB0, 0x09,
+   0x9A, 0x2E, 0xCA, 0xE5, 0x02, 0x97, 0x66, 0xB0, 0x09, 0xEE, 0x1D, 0xBC,
+   0xF4, 0x01, 0x97, 0x6B, 0xB0, 0x09, 0x9A, 0x08, 0xF8, 0x90, 0x01, 0xB3,
+   0x79, 0xB0, 0x09, 0x80, 0x09, 0xFC, 0x87, 0x06, 0xA3, 0x62, 0xB0, 0x09,
+   0x0F, 0xAE, 0xC0, 0x01, 0xBF, 0x52, 0xE0, 0x12, 0xBA, 0x10, 0xAC, 0xE4,
+   0x02, 0xFB, 0x52, 0x00
+  };
+
+#endif
+
 
 
 void close_script(void)
@@ -2274,40 +3260,18 @@ long date_secs(long date)
   
 
 
-int track_calc(double delta_x_deg, double delta_y_deg, double delta_t_secs, 
-               double lat_deg, 
-               double *knots, double *trackangle)
+/* speed and true track for a velocity of east_ms, north_ms meters per second --
+   returns FALSE (and 0 for both) if not moving */
+int velocity_track(double east_ms, double north_ms, double *knots, double *trackangle)
 
   {
-   double delta_x_meters;              
-   double delta_y_meters;              
-   double sin_track;
-   double cos_track;
-   
+   double angle;
    double mag;
 
-   /* Note x is in longitude degrees and y is in latitude degrees */
-                 
-   /* meters per second (toward east) at given latitude */
-   delta_x_meters = delta_x_deg * cos_safe(lat_deg) * METERS_PER_DEG_LONG_EQUATOR; 
-   
-   /* meters per second (toward north) */             
-   delta_y_meters = delta_y_deg * METERS_PER_DEG_LAT; 
-                 
    /* distance formula to calculate vecor magnitude and direction */              
-   mag = sqrt_safe(delta_x_meters * delta_x_meters  +  
-                          delta_y_meters * delta_y_meters);
+   mag = sqrt_safe(east_ms * east_ms  +  north_ms * north_ms);
                           
-   if (mag > 0.000000001)
-     {
-      /* Note: since 0 degrees points right and 90 deg up for math funcs, but
-               0 deg is North and 90 deg east for tracking, switch sin and cos
-               orientation from math-normal in calculations.
-      */              
-      cos_track = delta_y_meters / mag;                
-      sin_track = delta_x_meters / mag;                
-     }    
-   else
+   if (mag <= 0.000000001)
      {
       /* no magnitude, therefore no direction either -- signal this with a FALSE return
          value --  Program can decide whether to carry forward a prior direction.
@@ -2317,27 +3281,121 @@ int track_calc(double delta_x_deg, double delta_y_deg, double delta_t_secs,
       return FALSE;
      }              
 
+   /* Note: since 0 degrees points right and 90 deg up for math funcs, but
+            0 deg is North and 90 deg east for tracking, switch x and y
+            orientation from math-normal in calculations.
+   */              
+   angle = atan2_safe(east_ms,north_ms);
 
    /* track angle is normalized to true north,   <= trackangle <= 360, east is 90 */
-   if (delta_x_meters > 0.000000001)
+   if (east_ms > 0.000000001)
      {
       /* we're working the right (east) side of the circle */                
-      *trackangle = acos_safe(cos_track);           
+      *trackangle = angle;           
      }                
    else
      {
       /* we're working the left (west) side of the circle */                
-      *trackangle = 360.0 - (acos_safe(cos_track));           
+      *trackangle = 360.0 - fabs(angle);           
      }                
    
-   /* since magnitude is in total meters and delta_t_sec is in seconds, 
-      calculate meters per second and convert to knots */
-   *knots =  (mag * METERS_PER_SEC_TO_KNOTS) / delta_t_secs;
+   *knots = mag * METERS_PER_SEC_TO_KNOTS;
    return TRUE;          
   }  
 
 
 
+int track_calc(double delta_x_deg, double delta_y_deg, double delta_t_secs, 
+               double lat_deg, 
+               double *knots, double *trackangle)
+
+  {
+   /* Note x is in longitude degrees and y is in latitude degrees -- meters per 
+      second toward east at the given latitude, and toward north */
+   return velocity_track(delta_x_deg * cos_safe(lat_deg) * METERS_PER_DEG_LONG_EQUATOR / delta_t_secs,
+                         delta_y_deg * METERS_PER_DEG_LAT / delta_t_secs,
+                         knots,trackangle);
+  }  
+
+
+/* Along a straight segment the velocity in degrees per second is the slope of 
+   the interpolation (flt_x_m, flt_y_m) -- only the meters in a degree of 
+   longitude change, with cos(latitude), and smoothly.  So speed and track are 
+   worked out exactly at the start, middle and end of the segment, once, and 
+   each second takes them from the quadratic through those three 
+   (motion_track()) -- no finite differences, and no cos, sqrt or acos from 
+   second to second. */
+void segment_velocity(double lat_deg, double *knots, double *trackangle)
+
+  {
+   velocity_track(flt_x_m * cos_safe(lat_deg) * METERS_PER_DEG_LONG_EQUATOR,
+                  flt_y_m * METERS_PER_DEG_LAT, knots, trackangle);
+  }
+
+
+/* the short way round from track_0, should the track cross north */
+double track_from(double track_0, double track)
+
+  {
+   track -= track_0;
+   if (track > 180.0)
+     {
+      track -= 360.0;
+     }
+   if (track < -180.0)
+     {
+      track += 360.0;
+     }
+   return track;
+  }
+
+
+void motion_setup(void)
+
+  {
+   double knots_1, track_1, knots_2, track_2;
+   double h;
+
+   h = (flt_next_sec - flt_last_sec) / 2.0;
+   flt_motion_h = h;
+   segment_velocity(flt_last_lat, &flt_knots_0, &flt_track_0);
+   segment_velocity((flt_last_lat + flt_next_lat) / 2.0, &knots_1, &track_1);
+   segment_velocity(flt_next_lat, &knots_2, &track_2);
+
+   flt_knots_m = 0.0;
+   flt_knots_c = 0.0;
+   flt_track_m = 0.0;
+   flt_track_c = 0.0;
+   if (h > 0.0)
+     {
+      /* Newton's divided differences */
+      track_1 = track_from(flt_track_0,track_1);
+      track_2 = track_from(flt_track_0,track_2);
+      flt_knots_m = (knots_1 - flt_knots_0) / h;
+      flt_knots_c = (knots_2 - 2.0 * knots_1 + flt_knots_0) / (2.0 * h * h);
+      flt_track_m = track_1 / h;
+      flt_track_c = (track_2 - 2.0 * track_1) / (2.0 * h * h);
+     }
+  }
+
+
+void motion_track(double dsec, double *knots, double *trackangle)
+
+  {
+   *knots = flt_knots_0 + dsec * (flt_knots_m + (dsec - flt_motion_h) * flt_knots_c);
+   *trackangle = flt_track_0 + dsec * (flt_track_m + (dsec - flt_motion_h) * flt_track_c);
+   if (*trackangle > 360.0)
+     {
+      *trackangle -= 360.0;
+     }
+   if (*trackangle < 0.0)
+     {
+      *trackangle += 360.0;
+     }
+  }
+
+
+
 
 
 void interp_setup(void)
@@ -2346,6 +3404,8 @@ void interp_setup(void)
    double x = 0.0;
    double y = 0.0;  
    
+   EVTRACE_BEGIN("interp_setup");
+
    /* reset linear regression algorithm */
    linregress(-1,x,y);
    
@@ -2372,123 +3432,363 @@ void interp_setup(void)
    linregress(0,(double)(flt_next_sec-flt_last_sec),flt_next_alt);
    flt_z_m = linregress(2,x,y);
    flt_z_b = linregress(1,x,y);
+
+   motion_setup();
+
+   EVTRACE_END("interp_setup");
   }
 
 
-char st_normlat[BUFFLIMIT], st_normlong[BUFFLIMIT], st_hdilpos[BUFFLIMIT], st_vdilpos[BUFFLIMIT], st_pdilpos[BUFFLIMIT],
-     st_z[BUFFLIMIT], st_geoid_height[BUFFLIMIT],
-     st_knots[BUFFLIMIT], st_track_angle[BUFFLIMIT], st_norm_magvar[BUFFLIMIT],
-     st_work[BUFFLIMIT];
-   
-   
-/* global variables to track satellites by ID */
-int  totalsats = 0;
-char satarray[12][3];    /* sat IDs "" if none, "01" - "12" -- must be cleared and 
-                            built by functions below */  
-                            
-void clear_satellites(void)
+#ifndef ARDUINO
+/* one second of drift with the grid's wind at altitude z */
+void wind_step(double *wx, double *wy, double z)
   {
-   int i;
-  
-   for (i=0; i<12; i++)
-     {
-      satarray[i][0] = 0;
-     } 
-   totalsats = 0;  
-   flt_fixtype = 1;
+#ifdef HAVE_SIM_LIBS
+   wg_wind(&flt_grid,&flt_wind_cache,*wy,*wx,z,&flt_wind_east,&flt_wind_north);
+#else
+   (void)z;
+#endif
+   *wy += flt_wind_north / METERS_PER_DEG_LAT;
+   flt_wind_cos = cos_safe(*wy);
+   *wx += flt_wind_east / (METERS_PER_DEG_LAT * flt_wind_cos);
   }
- 
- 
-int clear_dilutions(double *hdpos, double *vdpos, double *pdpos)
+
+
+/* speed and track of the last second -- the wind, plus the correction toward 
+   the next waypoint */
+void wind_track(double *knots, double *trackangle)
   {
-   *hdpos = 9.9; 
-   *vdpos = 9.9; 
-   *pdpos = 9.9; 
+   velocity_track(flt_wind_east + flt_wind_dx * flt_wind_cos * METERS_PER_DEG_LONG_EQUATOR,
+                  flt_wind_north + flt_wind_dy * METERS_PER_DEG_LAT, knots, trackangle);
   }
 
 
-int sim_satellites(int forcenum, double *hdpos, double *vdpos, double *pdpos)
+/* magnetic variation (degrees, negative is west) at a place and simulated 
+   second -- lsec counts from the start of the first year.  The kernels call
+   it through sim_magvar, and the geoid height and receiver error through
+   sim_geoid and sim_error, which select_kernel() points once a run at the
+   model or the fixed value, so no setting is tested each second. */
+#ifdef HAVE_SIM_LIBS
+double magvar_model(double lat, double lon, double alt, long lsec)
   {
-   /* sort-of-randomly select a list of satellites visible */  
-   int randval;
-   int numsats;
-   
-   /* pick a number of satellites 3-6 -- about one per fifty set to 2 for simulated no fix */ 
-   /* also create a matching set of plausible satellite IDs */
-   
-   /* NOTE:  assumes totalsats was set and retained from prior call -- both totalsats an numsats
-             MUST be 0 to 6 at all times */
-   
-   if ((forcenum > 0) && (forcenum <= 6))
-     {
-      numsats = forcenum; 
-     }  
+   return wmm_cached_declination(&flt_wmm,&flt_wmm_cache,lat,lon,alt,
+                                 flt_firstyear + (double)lsec / flt_secs_firstyear);
+  }
+#endif
 
-   randval = random_index(50);   /* random 0 to 49 */ 
-   numsats = 4;                 /* stays 2 if randval == 0 */
-   flt_fixtype = 3;
 
-   if (randval == 0)
+double magvar_fixed(double lat, double lon, double alt, long lsec)
+  {
+   (void)lat;
+   (void)lon;
+   (void)alt;
+   (void)lsec;
+   return -1.4;
+  }
+
+double (*sim_magvar)(double lat, double lon, double alt, long lsec) = magvar_fixed;
+
+
+/* geoid height above the ellipsoid, meters */
+#ifdef HAVE_SIM_LIBS
+double geoid_model(double lat, double lon)
+  {
+   return gd_undulation(&flt_geoid,&flt_geoid_cache,lat,lon);
+  }
+#endif
+
+
+double geoid_fixed(double lat, double lon)
+  {
+   (void)lat;
+   (void)lon;
+   return 47.1;
+  }
+
+double (*sim_geoid)(double lat, double lon) = geoid_fixed;
+
+
+#ifdef HAVE_SIM_LIBS
+/* draw the next batch of receiver errors -- the rest of the segment, or 
+   ERR_BATCH seconds of it */
+void error_fill(void)
+  {
+   double white[ERR_BATCH];
+   int n, a, k;
+
+   n = ((flt_err_left > 0L) && (flt_err_left < ERR_BATCH)) ? (int)flt_err_left : ERR_BATCH;
+   for (a=0; a<3; a++)
      {
-      #ifndef PERFECT_SAT_FIXES
-         numsats = 2; 
-         flt_fixtype = 1;
-      #endif      /* otherwise remains 4 */
+      if (flt_error > 0.0)
+        {
+         gm_process_fill(&flt_err_gm[a],&flt_err_rng,n,flt_err_buf[a]);
+        }
+      else
+        {
+         memset(flt_err_buf[a],0,n * sizeof(double));
+        }
+      if (flt_noise > 0.0)
+        {
+         gm_normal_fill(&flt_err_rng,n,white);
+        }
+      else
+        {
+         memset(white,0,n * sizeof(double));
+        }
+      for (k=0; k<n; k++)
+        {
+         flt_err_buf[a][k] = (flt_error * flt_err_buf[a][k]) + (flt_noise * white[k]);
+        }
      }
-   if ((randval > 0) && (randval <= 6))
+   flt_err_left -= n;
+   flt_err_count = n;
+   flt_err_pos = 0;
+  }
+
+
+/* a segment's receiver errors are drawn at its start, all at once -- the 
+   Gauss-Markov processes carry on from the last second of the segment before */
+void error_setup(void)
+  {
+   if (!cfg_error_model)
      {
-      numsats = 3; 
-      flt_fixtype = 2;
+      return;
      }
-   if ((randval > 6) && (randval <= 16))
-     {
-      numsats = 4; 
-     } 
-   if ((randval > 16) && (randval <= 39))
+   flt_err_left = flt_next_sec - flt_last_sec;
+   error_fill();
+  }
+
+
+/* the position the receiver reports -- east and north each get the error 
+   times HDOP / sqrt(2) (so the horizontal error is HDOP times it), the 
+   altitude the error times VDOP */
+void error_add(double hdop, double vdop, double *x, double *y, double *z)
+  {
+   int k;
+
+   if (flt_err_pos >= flt_err_count)
      {
-      numsats = 5; 
+      error_fill();
      }
-   if ((randval > 39) && (randval <= 49))
+   k = flt_err_pos++;
+   *y += flt_err_buf[1][k] * hdop * 0.70710678118654752 / METERS_PER_DEG_LAT;
+   *x += flt_err_buf[0][k] * hdop * 0.70710678118654752 / (METERS_PER_DEG_LONG_EQUATOR * cos_safe(*y));
+   *z += flt_err_buf[2][k] * vdop;
+  }
+#endif
+
+
+/* no receiver error */
+void error_none(double hdop, double vdop, double *x, double *y, double *z)
+  {
+   (void)hdop;
+   (void)vdop;
+   (void)x;
+   (void)y;
+   (void)z;
+  }
+
+void (*sim_error)(double hdop, double vdop, double *x, double *y, double *z) = error_none;
+
+
+/* drift the segment once ahead of time to find where the wind alone would
+   leave the position, and spread the miss over the segment */
+void wind_setup(void)
+  {
+   long t, s;
+
+   t = flt_next_sec - flt_last_sec;
+   flt_wind_x = flt_last_long;
+   flt_wind_y = flt_last_lat;
+   for (s=1; s<=t; s++)
      {
-      numsats = 6; 
+      wind_step(&flt_wind_x,&flt_wind_y,flt_z_m * s + flt_z_b);
      }
-   
-   
-   /* sanity check -- should never happen, but if it does, this prevents a blowup... */
-   if ((totalsats > 6) || (numsats > 6))
+
+   flt_wind_dx = 0.0;
+   flt_wind_dy = 0.0;
+   if (t > 0)
      {
-      clear_satellites();
-      numsats = 0;
-      flt_fixtype = 1; 
+      flt_wind_dx = (flt_next_long - flt_wind_x) / t;
+      flt_wind_dy = (flt_next_lat - flt_wind_y) / t;
      }
-   
-   
-   /* if new number of satellites is less than prior, pick sats for deletion one at at time 
-      until count matches new number */
-   while (numsats < totalsats)
+   flt_wind_x = flt_last_long;
+   flt_wind_y = flt_last_lat;
+  }
+#endif
+
+
+/* global variables to track satellites by ID */
+int  totalsats = 0;
+char satarray[12][3];    /* sat IDs "" if none, "01" - "12" -- must be cleared and 
+                            built by functions below */  
+                            
+/* Satellite sky positions are not simulated yet -- elevation, azimuth and
+   signal strength are made up from the satellite's slot number so that they
+   stay put while the satellite remains in view (for GSV and UBX NAV-SAT). */
+#define SLOT_ELEV(i)  (15 + (((i) * 37) % 70))
+#define SLOT_AZIM(i)  (((i) * 30 + 15) % 360)
+#define SLOT_SNR(i)   (30 + (((i) * 7) % 20))
+
+/* PRN of a GPS satellite in satarray[] */
+#define SAT_PRN(i)    ((satarray[i][0] - '0') * 10 + (satarray[i][1] - '0'))
+
+
+#ifdef HAVE_MULTI_GNSS
+
+/* The other satellite systems -- GPS stays in satarray[] (or flt_view) as it
+   was.  Each system keeps only its satellites now in view, in short arrays of
+   their own, so a sky of 40 or more satellites costs a few hundred bytes and
+   the sentences walk only what is there. */
+
+#define GNSS_NUM       4        /* systems, GPS first */
+#define GNSS_MAX_VIEW  16       /* satellites in view of one system */
+
+typedef struct
+  {
+   int mask;                    /* GNSS_ bit */
+   char talker[3];              /* of its GSV */
+   unsigned char nmea_sys;      /* NMEA 4.10 system ID, for GSA */
+   unsigned char ubx_gnss;      /* UBX gnssId */
+   unsigned char id_offset;     /* NMEA satellite ID less PRN (slot) */
+   unsigned char first_prn;     /* random -- the constellation, from ... */
+   unsigned char slots;         /*   ... this many */
+   unsigned char min_view;      /* random -- satellites in view, from ... */
+   unsigned char max_view;      /*   ... to */
+  }
+   gnss_system;
+
+gnss_system gnss_table[GNSS_NUM] =
+  {
+   { GNSS_GPS,     "GP", 1, 0,  0,  0, 12, 0,  0 },   /* see sim_satellites() */
+   { GNSS_GLONASS, "GL", 2, 6, 64,  1, 24, 5, 10 },
+   { GNSS_GALILEO, "GA", 3, 2,  0,  1, 30, 5, 11 },
+   { GNSS_BEIDOU,  "GB", 4, 3,  0, 19, 30, 8, 16 },
+  };
+
+typedef struct
+  {
+   unsigned long slots;                /* random -- slots in view, a bit each */
+   unsigned char count;                /* in view */
+   unsigned char used;                 /* the first ones, used in the fix */
+   unsigned char prn[GNSS_MAX_VIEW];
+   unsigned char elev[GNSS_MAX_VIEW];  /* degrees */
+   unsigned char snr[GNSS_MAX_VIEW];   /* dB-Hz */
+   int azim[GNSS_MAX_VIEW];            /* degrees true */
+  }
+   gnss_sky;
+
+gnss_sky gnss_skies[GNSS_NUM - 1];     /* GLONASS, Galileo, BeiDou */
+#define GNSS_SKY(s)  (&gnss_skies[(s) - 1])
+
+int cfg_gnss = (GNSS_SYSTEMS | GNSS_GPS);
+#define GNSS_ON(s)   ((cfg_gnss & gnss_table[s].mask) != 0)
+#define GNSS_EXTRA   ((cfg_gnss & ~GNSS_GPS) != 0)
+
+
+void gnss_clear(void)
+  {
+   int s;
+
+   for (s=1; s<GNSS_NUM; s++)
      {
-      randval = random_index(12);  /* random 0 to 11 */ 
-      if (satarray[randval][0] != 0)   /* if random spot is NOT blank (in use)... */
-        {
-         satarray[randval][0] = 0;  /* clear it */
-         totalsats--;
-        } 
-     }   
+      GNSS_SKY(s)->slots = 0L;
+      GNSS_SKY(s)->count = 0;
+      GNSS_SKY(s)->used = 0;
+     }
+  }
 
-   /* if new number of satellites is greater than prior value, create a new ID in list */   
-   while (numsats > totalsats)
+
+/* the random satellites of the other systems -- as for GPS in 
+   sim_satellites(), a new number in view each time, reached by dropping or
+   adding satellites at random, so most stay from one time to the next.
+   Returns the number used in the fix. */
+int gnss_sim(void)
+  {
+   gnss_system *sys;
+   gnss_sky *sky;
+   unsigned long bit;
+   int s, j, k, n, have, used;
+
+   used = 0;
+   for (s=1; s<GNSS_NUM; s++)
      {
-      randval = random_index(12);  /* random 0 to 11 */
-      if (satarray[randval][0] == 0)   /* if random spot is blank (not in use)... */
+      if (!GNSS_ON(s))
         {
-         sprintf(satarray[randval],"%02d",randval);  /* sat ID is its own position number */
-         totalsats++;
-        } 
-     }   
+         continue;
+        }
+      sys = &gnss_table[s];
+      sky = GNSS_SKY(s);
+
+      n = sys->min_view + (int)gnss_random(sys->max_view - sys->min_view + 1);
+      have = sky->count;
+      while (n < have)
+        {
+         bit = 1UL << gnss_random(sys->slots);
+         if (sky->slots & bit)
+           {
+            sky->slots &= ~bit;
+            have--;
+           }
+        }
+      while (n > have)
+        {
+         bit = 1UL << gnss_random(sys->slots);
+         if (!(sky->slots & bit))
+           {
+            sky->slots |= bit;
+            have++;
+           }
+        }
+
+      k = 0;
+      for (j=0; j<sys->slots; j++)
+        {
+         if (sky->slots & (1UL << j))
+           {
+            sky->prn[k] = (unsigned char)(sys->first_prn + j);
+            sky->elev[k] = (unsigned char)SLOT_ELEV(j * 5 + s);
+            sky->azim[k] = SLOT_AZIM(j * 5 + s);
+            sky->snr[k] = (unsigned char)SLOT_SNR(j * 5 + s);
+            k++;
+           }
+        }
+      sky->count = (unsigned char)k;
+      sky->used = (unsigned char)((k > 12) ? 12 : k);
+      used += sky->used;
+     }
+   return used;
+  }
+
+#endif
 
+void clear_satellites(void)
+  {
+   int i;
+  
+   for (i=0; i<12; i++)
+     {
+      satarray[i][0] = 0;
+     } 
+   totalsats = 0;  
+   flt_fixtype = 1;
+#ifdef HAVE_MULTI_GNSS
+   gnss_clear();
+#endif
+  }
+ 
+ 
+void clear_dilutions(double *hdpos, double *vdpos, double *pdpos)
+  {
+   *hdpos = 9.9; 
+   *vdpos = 9.9; 
+   *pdpos = 9.9; 
+  }
 
 
-   /* dilution of position stats -- smaller is better, 1.0 is perfect */
+/* dilution of position stats -- smaller is better, 1.0 is perfect */
+void set_dilutions(int numsats, double *hdpos, double *vdpos, double *pdpos)
+  {
    switch (numsats)
      {
       case 3:
@@ -2526,527 +3826,4941 @@ int sim_satellites(int forcenum, double *hdpos, double *vdpos, double *pdpos)
          *pdpos = 9.9; 
          break; 
         } 
-     } 
-
-   return totalsats;
+     }
   }
 
 
+#ifdef HAVE_MULTI_GNSS
+/* DOPs for numsats from all systems together -- the usual values for 6, 
+   shrinking as the square root of the count beyond (a fix from n satellites
+   spread round the sky is about as good as n / 6 fixes from 6) down to half
+   at 24, about where real receivers level off */
+void gnss_dilutions(int numsats, double *hdpos, double *vdpos, double *pdpos)
+  {
+   double k;
 
-/* This function is called once per script line -- note that each script line
-   may represent many seconds (even perhaps hours) of simulated balloon flight
-   and so each call to this function will cause output of many lines
-   od\f data.  To continue looping, returns nonzero -- a 0 specifies loop is 
-   finished. 
-*/
+   if (numsats <= 6)
+     {
+      set_dilutions(numsats,hdpos,vdpos,pdpos);
+      return;
+     }
+   set_dilutions(6,hdpos,vdpos,pdpos);
+   k = sqrt(6.0 / ((numsats > 24) ? 24 : numsats));
+   *hdpos *= k;
+   *vdpos *= k;
+   *pdpos *= k;
+  }
+#endif
 
-int process_script(void)
+
+/* change the satellite list to numsats satellites -- the fix type is set by
+   the caller */
+int pick_satellites(int numsats, double *hdpos, double *vdpos, double *pdpos)
   {
-   long lsec;
-   double x,y,z;
-   double dsec;
+   int randval;
+
+   /* sanity check -- should never happen, but if it does, this prevents a blowup... */
+   if ((totalsats > 6) || (numsats > 6))
+     {
+      clear_satellites();
+      numsats = 0;
+      flt_fixtype = 1; 
+     }
+   
    
-   int keycode = 0;
+   /* if new number of satellites is less than prior, pick sats for deletion one at at time 
+      until count matches new number */
+   while (numsats < totalsats)
+     {
+      randval = random_index(12);  /* random 0 to 11 */ 
+      if (satarray[randval][0] != 0)   /* if random spot is NOT blank (in use)... */
+        {
+         satarray[randval][0] = 0;  /* clear it */
+         totalsats--;
+        } 
+     }   
 
-   int dt_pos;
-   int lla_pos;
-      
+   /* if new number of satellites is greater than prior value, create a new ID in list */   
+   while (numsats > totalsats)
+     {
+      randval = random_index(12);  /* random 0 to 11 */
+      if (satarray[randval][0] == 0)   /* if random spot is blank (not in use)... */
+        {
+         sprintf(satarray[randval],"%02d",randval);  /* sat ID is its own position number */
+         totalsats++;
+        } 
+     }   
+
+   set_dilutions(numsats,hdpos,vdpos,pdpos);
+
+   return totalsats;
+  }
+
+
+int sim_satellites(int forcenum, double *hdpos, double *vdpos, double *pdpos)
+  {
+   /* sort-of-randomly select a list of satellites visible */  
+   int randval;
+   int numsats;
    
-   double d_lat,d_long,d_alt;
-   long d_date, d_time, d_temp;
+   /* pick a number of satellites 3-6 -- about one per fifty set to 2 for simulated no fix */ 
+   /* also create a matching set of plausible satellite IDs */
+   
+   /* NOTE:  assumes totalsats was set and retained from prior call -- both totalsats an numsats
+             MUST be 0 to 6 at all times */
+   
+   if ((forcenum > 0) && (forcenum <= 6))
+     {
+      numsats = forcenum; 
+     }  
 
+   randval = random_index(50);   /* random 0 to 49 */ 
+   numsats = 4;                 /* stays 2 if randval == 0 */
+   flt_fixtype = 3;
 
-   char out_strg[120];
-   char work_strg[120];
+   if (randval == 0)
+     {
+      if (!cfg_perfect_sat_fixes)
+        {
+         numsats = 2; 
+         flt_fixtype = 1;
+        }           /* otherwise remains 4 */
+     }
+   if ((randval > 0) && (randval <= 6))
+     {
+      numsats = 3; 
+      flt_fixtype = 2;
+     }
+   if ((randval > 6) && (randval <= 16))
+     {
+      numsats = 4; 
+     } 
+   if ((randval > 16) && (randval <= 39))
+     {
+      numsats = 5; 
+     }
+   if ((randval > 39) && (randval <= 49))
+     {
+      numsats = 6; 
+     }
    
-   double normlat,normlong;
-   char northsouth,eastwest;
+   pick_satellites(numsats,hdpos,vdpos,pdpos);
 
-   int nsats;
-   double hdilpos,pdilpos,vdilpos,geoid_height;
+#ifdef HAVE_MULTI_GNSS
+   /* the other systems are in view whenever GPS has a fix -- together they 
+      always make it 3D */
+   if (GNSS_EXTRA)
+     {
+      if (flt_fixtype == 1)
+        {
+         gnss_clear();
+         return totalsats;
+        }
+      numsats = totalsats + gnss_sim();
+      flt_fixtype = 3;
+      gnss_dilutions(numsats,hdpos,vdpos,pdpos);
+      return numsats;
+     }
+#endif
 
-   char status_active;
-   double knots;
-   double track_angle;
-   double magvar_deg;   
-   double norm_magvar;
-   char magvar_eastwest;
+   return totalsats;
+  }
 
-   double t_secs;
-   double prior_x_deg;
-   double prior_y_deg;
-   double prior_t_secs;
-   
-   int firstloop;
 
+#define GPS_UTC_SECONDS 14     /* GPS-UTC leap seconds, 2006 to 2008 */
 
-   double linear_x, linear_y, linear_z;
+#ifndef ARDUINO
 
+/* Windows/Linux only -- when an almanac file is given (ALMANAC setting), the
+   satellites reported are the ones actually in view from the simulated position,
+   found each second by propagating every orbit in the almanac.  This replaces the
+   random satellite list of sim_satellites(). */
 
+almanac flt_alm;
+alm_view flt_view;
+char almname[65] = "";
+int cfg_almanac = FALSE;
+double cfg_elevation_mask = 5.0;
+int cfg_leap_seconds = GPS_UTC_SECONDS;
 
-   /* check for keywords first */  
-   
-   /* The default is that the random generator gives the same sequence for 
-      each run.  A user may optionally invoke "Random" in the script 
-      to change this behavior.  
-      Random 0 or without a parameter causes a time-based random seed different 
-      for each run.  Random with any nonzero parameter will set a repeatable 
-      random seed useful for replication of simulations (default case uses 1).
-   */   
 
-   /* assume is a normal script line with flight sim waypoint data */  
+/* GLONASS, Galileo and BeiDou have no almanac file -- their satellites come
+   from the nominal constellations (Walker patterns of their design orbits),
+   which put about the right number in view at about the right places */
 
-    
-   /* advance simulator to next flight segment -- each line represents a waypoint
-      with date/time and position x, y, and z -- the simulator will interpolate 
-      between waypoints for each second of simulated flight -- convert lat, long 
-      data (y, x) to decimal degrees as it is read in */
-   flt_last_date = flt_next_date;
-   flt_last_time = flt_next_time;
-   flt_last_lat = flt_next_lat;
-   flt_last_long = flt_next_long;
-   flt_last_alt = flt_next_alt;
-   
-   /* get data for simulator -- equivalent to extracting data from 
-      original balscript line */
-      
-   dt_pos = flt_datapos + flt_datapos;
-   lla_pos = flt_datapos + flt_datapos + flt_datapos;
+almanac gnss_alm[GNSS_NUM - 1];      /* GLONASS, Galileo, BeiDou */
 
+#ifdef HAVE_SIM_LIBS
+void gnss_almanacs(void)
+  {
+   alm_walker(&gnss_alm[0],24,3,1,64.8,25508000.0,1);    /* GLONASS, slots 1-24 */
+   alm_walker(&gnss_alm[1],24,3,1,56.0,29600000.0,1);    /* Galileo */
+   alm_walker(&gnss_alm[2],24,3,1,55.0,27906000.0,19);   /* BeiDou MEO, from PRN 19 */
+  }
 
-#ifdef USEFLASH
-   d_temp = (long)pgm_read_dword(date_time+dt_pos);   
-#else   
-   d_temp = date_time[dt_pos];   
-#endif
-      
-   if (d_temp == 0)
+
+/* the other systems' satellites in view, and the DOPs and fix of all the
+   satellites used together (GPS's already in flt_view and satarray[]) -- 
+   returns the number used */
+int sky_gnss(double gpssecs, double long_deg, double lat_deg, double alt_m,
+             double *hdpos, double *vdpos, double *pdpos)
+  {
+   alm_view view;
+   gnss_sky *sky;
+   double los_e[12 * GNSS_NUM], los_n[12 * GNSS_NUM], los_u[12 * GNSS_NUM];
+   dops dop;
+   int s, i, n;
+
+   for (n=0; n<totalsats; n++)
      {
-      return 0;   
+      los_e[n] = flt_view.los_e[n];
+      los_n[n] = flt_view.los_n[n];
+      los_u[n] = flt_view.los_u[n];
      }
 
+   for (s=1; s<GNSS_NUM; s++)
+     {
+      sky = GNSS_SKY(s);
+      sky->count = 0;
+      sky->used = 0;
+      if (!GNSS_ON(s))
+        {
+         continue;
+        }
+      alm_look(&gnss_alm[s - 1],gpssecs,lat_deg,long_deg,alt_m,cfg_elevation_mask,&view);
+      for (i=0; (i < view.count) && (i < GNSS_MAX_VIEW); i++)
+        {
+         sky->prn[i] = (unsigned char)view.prn[i];
+         sky->elev[i] = (unsigned char)(view.elev[i] + 0.5);
+         sky->azim[i] = (int)(view.azim[i] + 0.5) % 360;
+         sky->snr[i] = (unsigned char)view.snr[i];
+         if (i < 12)
+           {
+            los_e[n] = view.los_e[i];
+            los_n[n] = view.los_n[i];
+            los_u[n] = view.los_u[i];
+            n++;
+           }
+        }
+      sky->count = (unsigned char)i;
+      sky->used = (unsigned char)((i > 12) ? 12 : i);
+     }
 
-#ifdef DEBUG_OUTPUT  
+   flt_fixtype = 3;
+   if (n == 3)
+     {
+      flt_fixtype = 2;
+     }
+   if (n < 3)
+     {
+      flt_fixtype = 1;
+     }
 
+   if (geomdop(&dop,los_e,los_n,los_u,n))
+     {
+      *hdpos = dop.hdop;
+      *vdpos = dop.vdop;
+      *pdpos = dop.pdop;
+     }
+   else
+     {
+      set_dilutions(((n > 6) ? 6 : n),hdpos,vdpos,pdpos);
+     }
 
-#ifdef USEFLASH
-   d_lat  = (float)pgm_read_float(lat_long_alt + lla_pos);   
-   d_long = (float)pgm_read_float(lat_long_alt + lla_pos + 1);   
-   d_alt  = (float)pgm_read_float(lat_long_alt + lla_pos + 2);   
-#else   
-   d_lat  = lat_long_alt[lla_pos];   
-   d_long = lat_long_alt[lla_pos + 1];   
-   d_alt  = lat_long_alt[lla_pos + 2];   
-#endif   
+   return n;
+  }
 
-   dtostrf_chop(d_lat,-8,3,st_normlat);
-   dtostrf_chop(d_long,-8,3,st_normlong);
-   dtostrf_chop(d_alt,-8,3,st_work);
-   
-   sprintf(out_strg,"lat=%s long=%s alt=%s",
-                st_normlat,st_normlong,st_work);
-   com_string_crlf(portspec,out_strg);
+
+int sky_satellites(long lsec, double long_deg, double lat_deg, double alt_m,
+                   double *hdpos, double *vdpos, double *pdpos)
+  {
+   long ddmmyy, hhmmss;
+   int yr, i;
+   double gpssecs;
+   dops dop;
+
+   /* ddmmyy -- 2-digit years are assumed 1950-2049 as in date_secs() */
+   ddmmyy = secs_to_date(lsec);
+   hhmmss = secs_to_time(lsec);
+   yr = (int)(ddmmyy % 100L);
+   yr += ((yr <= 49) ? 2000 : 1900);
+
+   gpssecs = alm_gps_seconds(yr,(int)((ddmmyy / 100L) % 100L),(int)(ddmmyy / 10000L),
+                             (int)(hhmmss / 10000L),(int)((hhmmss / 100L) % 100L),
+                             (int)(hhmmss % 100L),cfg_leap_seconds);
+
+   alm_look(&flt_alm,gpssecs,lat_deg,long_deg,alt_m,cfg_elevation_mask,&flt_view);
+
+   /* GSA has room for 12 -- list the highest ones */
+   clear_satellites();
+   for (i=0; (i < flt_view.count) && (i < 12); i++)
+     {
+      sprintf(satarray[i],"%02d",flt_view.prn[i]);
+      totalsats++;
+     }
+
+   if (GNSS_EXTRA)
+     {
+      return sky_gnss(gpssecs,long_deg,lat_deg,alt_m,hdpos,vdpos,pdpos);
+     }
+
+   flt_fixtype = 3;
+   if (totalsats == 3)
+     {
+      flt_fixtype = 2;
+     }
+   if (totalsats < 3)
+     {
+      flt_fixtype = 1;
+     }
+
+   /* DOPs from the geometry of the satellites used -- too few for a 3D 
+      fix get the usual values by count */
+   if (geomdop(&dop,flt_view.los_e,flt_view.los_n,flt_view.los_u,totalsats))
+     {
+      *hdpos = dop.hdop;
+      *vdpos = dop.vdop;
+      *pdpos = dop.pdop;
+     }
+   else
+     {
+      set_dilutions(((totalsats > 6) ? 6 : totalsats),hdpos,vdpos,pdpos);
+     }
+
+   return totalsats;
+  }
+#endif
 
 #endif
 
 
-#ifdef USEFLASH
-   d_date = (long)pgm_read_dword(date_time+dt_pos);   
-   d_time = (long)pgm_read_dword(date_time+dt_pos+1);   
+/* --------- FIX-QUALITY TIMELINE --------------------------------------------------- */
+
+/* When the satellites change and when the fix drops out is laid out before the
+   flight starts, as a sorted list of intervals counted in seconds from the start
+   of the script.  In each interval the fix is the random 2D/3D one of 
+   sim_satellites(), a forced 2D fix from 3 satellites, or none at all (a 
+   dropout), with a new satellite set at the start and every so many seconds
+   after.  The status of any second is then a binary search of the list 
+   (tl_action()), which depends on no second before it -- so a run can start 
+   anywhere, or be rendered in pieces side by side.
+
+   tl_default() lays out the pattern of STABLE_SAT_SECONDS, DROPOUT_SAT_SECONDS
+   and DROPOUT_CYCLES, which repeats; on Windows/Linux SCENARIO=file reads a
+   list instead (see tl_read()). */
+
+#define TL_FIX    1      /* random fix -- sim_satellites() */
+#define TL_2D     2      /* 2D fix, 3 satellites */
+#define TL_NOFIX  4      /* no fix, satellites cleared every second */
+#define TL_NEW    8      /* tl_action() -- a new satellite set this second */
+#define TL_FRESH  16     /*   ... made from scratch (after a dropout) */
+
+#ifdef ARDUINO
+#define TL_MAX    3      /* just tl_default()'s */
 #else
-   d_date = date_time[dt_pos];   
-   d_time = date_time[dt_pos+1];   
+#define TL_MAX    500
 #endif
 
-   flt_next_date = d_date;
-   flt_next_time = d_time;
+typedef struct
+  {
+   long start;                 /* seconds from the start of the script */
+   int every;                  /* new satellite set every so many seconds, 0 = none */
+   unsigned char fix;          /* TL_FIX, TL_2D or TL_NOFIX */
+   unsigned char fresh;        /* a fix after a dropout -- its first set from scratch */
+  }
+   tl_interval;
 
-#ifdef USEFLASH
-   d_lat  = (float)pgm_read_float(lat_long_alt + lla_pos);   
-   d_long = (float)pgm_read_float(lat_long_alt + lla_pos + 1);   
-   d_alt  = (float)pgm_read_float(lat_long_alt + lla_pos + 2);   
-#else
-   d_lat  = lat_long_alt[lla_pos];   
-   d_long = lat_long_alt[lla_pos + 1];   
-   d_alt  = lat_long_alt[lla_pos + 2];   
+tl_interval tl_table[TL_MAX];
+int tl_count = 0;
+long tl_period = 0L;           /* the list starts over, 0 = the last interval goes on */
+
+
+/* add an interval, in order -- FALSE if out of order or no room */
+int tl_add(long start, int fix, int every)
+  {
+   tl_interval *t;
+
+   if ((tl_count >= TL_MAX) || ((tl_count > 0) && (start < tl_table[tl_count-1].start)))
+     {
+      return FALSE;
+     }
+   t = &tl_table[tl_count];
+   t->start = start;
+   t->every = every;
+   t->fix = (unsigned char)fix;
+   t->fresh = ((fix != TL_NOFIX) && (tl_count > 0) && (tl_table[tl_count-1].fix == TL_NOFIX));
+   tl_count++;
+   return TRUE;
+  }
+
+
+/* a new set every STABLE_SAT_SECONDS; after DROPOUT_CYCLES of them, unless 
+   perfect, a dropout of DROPOUT_SAT_SECONDS whose last second brings the 
+   fix back with a fresh set -- the first interval starts a second before the 
+   script, as if a set had just been made */
+void tl_default(int perfect)
+  {
+   long stable, dropout;
+
+   tl_count = 0;
+   tl_period = 0L;
+   tl_add(-1L,TL_FIX,cfg_stable_sat_seconds);
+   if (!perfect)
+     {
+      stable = (long)cfg_stable_sat_seconds * ((cfg_dropout_cycles > 1) ? cfg_dropout_cycles - 1 : 1);
+      dropout = ((cfg_dropout_sat_seconds > 1) ? cfg_dropout_sat_seconds : 1);
+      tl_add(stable,TL_NOFIX,0);
+      tl_add(stable + dropout - 1L,TL_FIX,cfg_stable_sat_seconds);
+      tl_period = stable + dropout;
+     }
+  }
+
+
+/* what happens in a second (from the start of the script) -- the interval's 
+   TL_FIX, TL_2D or TL_NOFIX, with TL_NEW (and TL_FRESH) when a new satellite 
+   set is made.  Before the first interval the satellites stay as they are. */
+int tl_action(long second)
+  {
+   tl_interval *t;
+   long offset;
+   int lo, hi, mid, action;
+
+   if (tl_period > 0L)
+     {
+      second %= tl_period;
+     }
+   if ((tl_count == 0) || ((second < tl_table[0].start) && (tl_period == 0L)))
+     {
+      return TL_FIX;
+     }
+   if (second < tl_table[0].start)
+     {
+      second += tl_period;     /* still in the last interval of the time before */
+     }
+
+   /* the last interval starting at or before second */
+   lo = 0;
+   hi = tl_count - 1;
+   while (lo < hi)
+     {
+      mid = (lo + hi + 1) / 2;
+      if (tl_table[mid].start <= second)
+        {
+         lo = mid;
+        }
+      else
+        {
+         hi = mid - 1;
+        }
+     }
+
+   t = &tl_table[lo];
+   action = t->fix;
+   if (t->fix == TL_NOFIX)
+     {
+      return action;
+     }
+   offset = second - t->start;
+   if (offset == 0L)
+     {
+      action |= (t->fresh ? (TL_NEW | TL_FRESH) : TL_NEW);
+     }
+   else if ((t->every > 0) && ((offset % t->every) == 0L))
+     {
+      action |= TL_NEW;
+     }
+   return action;
+  }
+
+
+/* a 2D fix from 3 satellites */
+int sim_satellites_2d(double *hdpos, double *vdpos, double *pdpos)
+  {
+   flt_fixtype = 2;
+#ifdef HAVE_MULTI_GNSS
+   gnss_clear();
 #endif
+   return pick_satellites(3,hdpos,vdpos,pdpos);
+  }
 
-   flt_next_lat  = deg_coord(d_lat);
-   flt_next_long = deg_coord(d_long);
 
-   flt_next_alt  = d_alt;
-   
-   flt_datapos++;
-   
+/* the new satellite set of a tl_action() */
+int new_satellites(int action, double *hdpos, double *vdpos, double *pdpos)
+  {
+   if (action & TL_2D)
+     {
+      return sim_satellites_2d(hdpos,vdpos,pdpos);
+     }
+   return sim_satellites(((action & TL_FRESH) ? 3 : 0),hdpos,vdpos,pdpos);
+  }
 
-   /* convert combination dates/times numbers of seconds elapsed 
-      since the beginning of the first year encountered */   
-   flt_last_sec = date_secs(flt_last_date) + time_secs(flt_last_time);   
-   flt_next_sec = date_secs(flt_next_date) + time_secs(flt_next_time);   
-   
-   /* if this is first pass through this function, there is not enough 
-      data to interpolate yet, so bypass processing */
-   if (flt_firstpass)
+
+#ifndef ARDUINO
+
+/* Windows/Linux only -- a scenario file lists the intervals one a line, in 
+   order of start:
+
+      second  fix|2d|nofix  [every]
+
+   with the seconds between satellite changes for fix and 2d (default 
+   STABLE_SAT_SECONDS, 0 for none).  A line "repeat seconds" starts the whole 
+   list over that often.  Blank lines and anything after # are ignored.  A
+   scenario is flown as written, so it turns PERFECT_SAT_FIXES off (asking
+   for both is an error). */
+
+char scenarioname[65] = "";
+char tl_error[120];
+int cfg_perfect_given = FALSE;     /* PERFECT_SAT_FIXES was set, not defaulted */
+
+int tl_read(char fname[])
+  {
+   FILE *unit;
+   char line[200], word[20];
+   char *p;
+   long start;
+   int every, fix, lineno, ok;
+
+   start = 0L;
+   unit = fopen(fname,"r");
+   if (unit == NULL)
      {
-      flt_firstpass = FALSE;               
-      return 1;
-     }   
-     
-   flt_firstpass = FALSE;               
-      
+      sprintf(tl_error,"Can't open scenario %.64s",fname);
+      return FALSE;
+     }
 
+   tl_count = 0;
+   tl_period = 0L;
+   lineno = 0;
+   ok = TRUE;
+   while (ok && (fgets(line,sizeof(line),unit) != NULL))
+     {
+      lineno++;
+      if ((p = strchr(line,'#')) != NULL)
+        {
+         *p = 0;
+        }
+      if (sscanf(line,"%19s",word) != 1)
+        {
+         continue;
+        }
+      if (strcmp(word,"repeat") == 0)
+        {
+         ok = ((sscanf(line,"%*s %ld",&tl_period) == 1) && (tl_period > 0L));
+         continue;
+        }
 
-   /* determine interpolation parameters for flight segment -- calculates a set 
-      of slopes and intercepts (e.g. m and b in: y = mx + b) for each component 
-      dimension x, y, and z which will be used later to interpolate between waypoints */
-   interp_setup();
-    
-   /* simulate all outputs for entire flight segment -- generate 1 second readings 
-      for all interpolated positions between specified "last" and "next" locations */
-   prior_x_deg = 0.0;
-   prior_y_deg = 0.0;
-   prior_t_secs = 0.0;
+      every = cfg_stable_sat_seconds;
+      fix = 0;
+      if (sscanf(line,"%ld %19s %d",&start,word,&every) >= 2)
+        {
+         fix = ((strcmp(word,"fix") == 0) ? TL_FIX :
+                (strcmp(word,"2d") == 0) ? TL_2D :
+                (strcmp(word,"nofix") == 0) ? TL_NOFIX : 0);
+        }
+      ok = ((fix != 0) && (start >= 0L) && (every >= 0) && tl_add(start,fix,every));
+     }
+   fclose(unit);
+
+   if (ok && (tl_count > 0) && (tl_period > 0L) && (tl_period <= tl_table[tl_count-1].start))
+     {
+      sprintf(tl_error,"Scenario %.64s -- repeat must be after the last interval",fname);
+      return FALSE;
+     }
+   if (!ok)
+     {
+      sprintf(tl_error,"Scenario %.64s -- bad line %d",fname,lineno);
+      return FALSE;
+     }
+   if (tl_count == 0)
+     {
+      sprintf(tl_error,"Scenario %.64s -- no intervals",fname);
+      return FALSE;
+     }
+   return TRUE;
+  }
 
 
-   /* preseed the real-time simulator with clock time */
-   time(&flt_time_previous);
+/* a 2D fix from the 3 highest satellites in view */
+int sky_satellites_2d(double *hdpos, double *vdpos, double *pdpos)
+  {
+   int i;
 
-   /* note that in the following loop, output for the FIRST second is skipped 
-      so that it won't be duplicated later -- for simulation purposes, can afford to 
-      miss the very first second (only) if all others are used -- however even the 
-      first one is processed to gather tracking data */
-      
-   firstloop = TRUE;  
+   for (i=3; i<12; i++)
+     {
+      satarray[i][0] = 0;
+     }
+   if (totalsats > 3)
+     {
+      totalsats = 3;
+     }
+   gnss_clear();
+   flt_fixtype = ((totalsats == 3) ? 2 : 1);
+   set_dilutions(totalsats,hdpos,vdpos,pdpos);
+   return totalsats;
+  }
 
-   /* will simulate sats coming and going */
-   clear_satellites();
-   nsats = sim_satellites(4,&hdilpos, &vdilpos, &pdilpos);     /* initialize to 3 satellites */
-   
-   for (lsec=flt_last_sec; lsec<=flt_next_sec; lsec++)
+#endif
+
+
+#ifndef ARDUINO
+
+/* --------- Windows/Linux only -- CHECKPOINT AND RESUME ---------------------------
+
+   A long REALTIME run that stops (power, a crash, a reboot) can carry on where
+   it was.  With CHECKPOINT=file, every CHECKPOINT_SECS seconds of output the
+   place reached is written to a small binary file -- to file.tmp first, flushed
+   to the disk, then renamed over the file, so the file is always a whole
+   checkpoint, the last one or the one before.  RESUME=on (or --resume) starts
+   from it.
+
+   The simulation is not taken up from saved variables:  rand(), the kernels'
+   interpolation and the random wind state can't all be saved portably, and
+   need not be -- with the same settings, script and seed a run is the same
+   every time.  A resumed run flies the flight again from the start with no
+   output and no waiting (a 36 hour flight takes seconds) and goes live at the
+   second the stopped run would be sending now, so REALTIME output stays on
+   the wall clock; without REALTIME it goes on from the checkpoint's second.
+   What the file does keep of the state -- the timeline second, the
+   satellites, the receiver error -- is checked against the replay when it
+   gets there, so a checkpoint from other settings or another script is
+   caught instead of being quietly wrong. */
+
+#define CKPT_VERSION  2L
+
+typedef struct
+  {
+   long version;
+   long second;                  /* flt_second -- whole seconds sent so far */
+   long next_lsec;               /* timeline second of the next one */
+   long hhmmss;                  /*   ... as time and date */
+   long ddmmyy;
+   long wall;                    /* time() then */
+   int seed;
+   int hz;
+   int fixed;
+   int gnss;
+   int totalsats;
+   int fixtype;
+   char sats[12][3];
+   unsigned long gnss_rand;
+   double err_x[3];              /* Gauss-Markov receiver error */
+  }
+   ckpt_state;
+
+/* The file is not the struct -- long, int, padding and byte order differ
+   between builds and hosts.  Each field goes at its own offset and width,
+   least significant byte first, doubles as their 8 IEEE bytes:
+
+      0  "GPSSIMCK"        8        52  gnss             4
+      8  version           4        56  totalsats        4
+     12  CKPT_BYTES        4        60  fixtype          4
+     16  second            4        64  sats            36
+     20  next_lsec         4       100  gnss_rand        4
+     24  hhmmss            4       104  err_x[3]        24
+     28  ddmmyy            4       128  sum of 0..127    4
+     32  wall              8
+     40  seed, hz, fixed   4 each                                          */
+
+#define CKPT_BYTES    132
+#define CKPT_SUM      128        /* offset of the sum */
+
+char ckptname[65] = "";
+int cfg_checkpoint_secs = 60;
+int cfg_resume = FALSE;
+char ckpt_error[120];
+
+ckpt_state ckpt_saved;           /* read by ckpt_read() */
+unsigned char ckpt_image[CKPT_BYTES];   /* ... as it was in the file */
+int ckpt_replay = FALSE;         /* flying up to the checkpoint, no output */
+long ckpt_last = -1L;            /* flt_second of the last one written */
+
+
+void ckpt_put(unsigned char *p, unsigned long val, int nbytes)
+  {
+   int i;
+
+   for (i=0; i<nbytes; i++)
+     {
+      p[i] = (unsigned char)(val & 0xFFUL);
+      val >>= 8;
+     }
+  }
+
+
+unsigned long ckpt_get(unsigned char *p, int nbytes)
+  {
+   unsigned long val;
+   int i;
+
+   val = 0UL;
+   for (i=nbytes-1; i>=0; i--)
+     {
+      val = (val << 8) | p[i];
+     }
+   return val;
+  }
+
+
+/* doubles are IEEE on every host GPSSIM runs on -- only the byte order
+   needs fixing */
+void ckpt_put_real(unsigned char *p, double x)
+  {
+   unsigned char b[8];
+   unsigned long one;
+   int i;
+
+   one = 1UL;
+   memcpy(b,&x,8);
+   for (i=0; i<8; i++)
+     {
+      p[i] = (*(unsigned char *)&one) ? b[i] : b[7-i];
+     }
+  }
+
+
+double ckpt_get_real(unsigned char *p)
+  {
+   unsigned char b[8];
+   unsigned long one;
+   double x;
+   int i;
+
+   one = 1UL;
+   for (i=0; i<8; i++)
+     {
+      b[i] = (*(unsigned char *)&one) ? p[i] : p[7-i];
+     }
+   memcpy(&x,b,8);
+   return x;
+  }
+
+
+unsigned long ckpt_sum(unsigned char image[])
+  {
+   unsigned long sum;
+   int i;
+
+   sum = 0UL;
+   for (i=0; i<CKPT_SUM; i++)
+     {
+      sum = ((sum * 31UL) + image[i]) & 0xFFFFFFFFUL;
+     }
+   return sum;
+  }
+
+
+void ckpt_pack(unsigned char image[], ckpt_state *c)
+  {
+   int i;
+
+   memcpy(image,"GPSSIMCK",8);
+   ckpt_put(image+8,(unsigned long)c->version,4);
+   ckpt_put(image+12,(unsigned long)CKPT_BYTES,4);
+   ckpt_put(image+16,(unsigned long)c->second,4);
+   ckpt_put(image+20,(unsigned long)c->next_lsec,4);
+   ckpt_put(image+24,(unsigned long)c->hhmmss,4);
+   ckpt_put(image+28,(unsigned long)c->ddmmyy,4);
+   ckpt_put(image+32,(unsigned long)c->wall,8);
+   ckpt_put(image+40,(unsigned long)c->seed,4);
+   ckpt_put(image+44,(unsigned long)c->hz,4);
+   ckpt_put(image+48,(unsigned long)c->fixed,4);
+   ckpt_put(image+52,(unsigned long)c->gnss,4);
+   ckpt_put(image+56,(unsigned long)c->totalsats,4);
+   ckpt_put(image+60,(unsigned long)c->fixtype,4);
+   memcpy(image+64,c->sats,36);
+   ckpt_put(image+100,c->gnss_rand,4);
+   for (i=0; i<3; i++)
+     {
+      ckpt_put_real(image+104+(8*i),c->err_x[i]);
+     }
+   ckpt_put(image+CKPT_SUM,ckpt_sum(image),4);
+  }
+
+
+/* FALSE if the image is not a whole checkpoint of this layout */
+int ckpt_unpack(unsigned char image[], ckpt_state *c)
+  {
+   int i;
+
+   if ((memcmp(image,"GPSSIMCK",8) != 0) || ((long)ckpt_get(image+8,4) != CKPT_VERSION) ||
+       (ckpt_get(image+12,4) != (unsigned long)CKPT_BYTES) ||
+       (ckpt_get(image+CKPT_SUM,4) != ckpt_sum(image)))
+     {
+      return FALSE;
+     }
+   c->version = (long)ckpt_get(image+8,4);
+   c->second = (long)ckpt_get(image+16,4);
+   c->next_lsec = (long)ckpt_get(image+20,4);
+   c->hhmmss = (long)ckpt_get(image+24,4);
+   c->ddmmyy = (long)ckpt_get(image+28,4);
+   c->wall = (long)ckpt_get(image+32,8);
+   c->seed = (int)ckpt_get(image+40,4);
+   c->hz = (int)ckpt_get(image+44,4);
+   c->fixed = (int)ckpt_get(image+48,4);
+   c->gnss = (int)ckpt_get(image+52,4);
+   c->totalsats = (int)ckpt_get(image+56,4);
+   c->fixtype = (int)ckpt_get(image+60,4);
+   memcpy(c->sats,image+64,36);
+   c->gnss_rand = ckpt_get(image+100,4);
+   for (i=0; i<3; i++)
+     {
+      c->err_x[i] = ckpt_get_real(image+104+(8*i));
+     }
+   return TRUE;
+  }
+
+
+/* the state at the start of second lsec, before its satellites are set */
+void ckpt_fill(ckpt_state *c, long lsec)
+  {
+   int i;
+
+   memset(c,0,sizeof(ckpt_state));
+   c->version = CKPT_VERSION;
+   c->second = flt_second;
+   c->next_lsec = lsec;
+   c->hhmmss = secs_to_time(lsec);
+   c->ddmmyy = secs_to_date(lsec);
+   c->seed = flt_randomseed;
+   c->hz = flt_hz;
+   c->fixed = flt_fixed;
+#ifdef HAVE_MULTI_GNSS
+   c->gnss = cfg_gnss;
+   c->gnss_rand = (unsigned long)gnss_rand_state;
+#endif
+   c->totalsats = totalsats;
+   c->fixtype = flt_fixtype;
+   memcpy(c->sats,satarray,sizeof(c->sats));
+   for (i=0; i<3; i++)
+     {
+      c->err_x[i] = flt_err_gm[i].x;
+     }
+  }
+
+
+/* write the checkpoint -- FALSE if it can't be */
+int ckpt_write(long lsec)
+  {
+   ckpt_state c;
+   unsigned char image[CKPT_BYTES];
+   char tmpname[70];
+   FILE *unit;
+   int ok;
+
+   ckpt_fill(&c,lsec);
+   c.wall = (long)time(NULL);
+   ckpt_pack(image,&c);
+
+   sprintf(tmpname,"%s.tmp",ckptname);
+   unit = fopen(tmpname,"wb");
+   if (unit == NULL)
+     {
+      return FALSE;
+     }
+   ok = (fwrite(image,CKPT_BYTES,1,unit) == 1);
+   ok = ((fflush(unit) == 0) && ok);
+#if defined(__MINGW32__)
+   _commit(fileno(unit));
+#else
+   fsync(fileno(unit));
+#endif
+   ok = ((fclose(unit) == 0) && ok);
+   if (!ok)
+     {
+      return FALSE;
+     }
+
+#if defined(__MINGW32__)
+   /* Windows won't rename over a file -- if it stops in between, file.tmp
+      is read instead */
+   remove(ckptname);
+#endif
+   return (rename(tmpname,ckptname) == 0);
+  }
+
+
+/* TRUE if fname holds a whole checkpoint -- a short or longer file is not one */
+int ckpt_load(char fname[])
+  {
+   FILE *unit;
+   int ok;
+
+   unit = fopen(fname,"rb");
+   if (unit == NULL)
+     {
+      return FALSE;
+     }
+   ok = ((fread(ckpt_image,CKPT_BYTES,1,unit) == 1) && (fgetc(unit) == EOF));
+   fclose(unit);
+   return (ok && ckpt_unpack(ckpt_image,&ckpt_saved));
+  }
+
+
+/* read the checkpoint to resume from -- or file.tmp, if the file went 
+   missing before it could be renamed */
+int ckpt_read(void)
+  {
+   char tmpname[70];
+   FILE *unit;
+
+   sprintf(tmpname,"%s.tmp",ckptname);
+   if (!ckpt_load(ckptname) && !ckpt_load(tmpname))
+     {
+      unit = fopen(ckptname,"rb");
+      if (unit == NULL)
+        {
+         sprintf(ckpt_error,"Can't read checkpoint %.64s",ckptname);
+        }
+      else
+        {
+         fclose(unit);
+         sprintf(ckpt_error,"%.64s is not a checkpoint of this GPSSIM",ckptname);
+        }
+      return FALSE;
+     }
+   ckpt_replay = TRUE;
+   return TRUE;
+  }
+
+
+/* called by the kernels before each epoch is paced and sent -- replays up
+   to the checkpoint, and writes one every CHECKPOINT_SECS.  Both go by
+   flt_second, which counts the seconds sent whatever the script does to
+   the clock -- a script may step its time back, lsec can't be used. */
+void ckpt_epoch(long lsec, int sub)
+  {
+   ckpt_state c;
+   unsigned char image[CKPT_BYTES];
+
+   if (sub != 0)
+     {
+      return;
+     }
+
+   if (ckpt_replay)
+     {
+      if (flt_second == ckpt_saved.second)
+        {
+         ckpt_fill(&c,lsec);
+         c.wall = ckpt_saved.wall;
+         ckpt_pack(image,&c);
+         if (memcmp(image,ckpt_image,CKPT_BYTES) != 0)
+           {
+            printf("Checkpoint %s doesn't match this run -- were the settings or script changed?\n",
+                   ckptname);
+            exit(1);
+           }
+        }
+
+      /* in REALTIME, the seconds since the checkpoint was written have gone by */
+      if ((flt_second < ckpt_saved.second) ||
+          (flt_realtime && (flt_second < ckpt_saved.second + ((long)time(NULL) - ckpt_saved.wall))))
+        {
+         return;
+        }
+      ckpt_replay = FALSE;
+      ckpt_last = flt_second;
+      return;
+     }
+
+   if (!ckptname[0])
+     {
+      return;
+     }
+   if (ckpt_last < 0L)
+     {
+      ckpt_last = flt_second;
+     }
+   if (flt_second - ckpt_last >= (long)cfg_checkpoint_secs)
+     {
+      ckpt_last = flt_second;
+      if (!ckpt_write(lsec))
+        {
+         printf("Can't write checkpoint %s -- no more will be written\n",ckptname);
+         ckptname[0] = 0;
+        }
+     }
+  }
+
+#endif
+
+
+/* --------- NMEA SENTENCE REGISTRY ------------------------------------------------- */
+
+/* Everything the sentence encoders need for one second of output is gathered
+   once per second into a gpsepoch.  Each encoder writes its sentence straight
+   out a field at a time through the nmea_* writer below, which keeps the
+   checksum as it goes -- numeric fields are formatted one at a time by
+   put_field() into a small buffer on the stack, so there is no sentence 
+   buffer and no set of field strings held for the whole second. */
+
+typedef struct
+  {
+   long lsec;              /* simulated seconds count */
+   long hhmmss;            /* time of day as used in sentences */
+   long ddmmyy;            /* date as used in sentences */
+   double normlat;         /* DDMM.MMMM -- always positive, see northsouth */
+   double normlong;        /* DDDMM.MMMM -- always positive, see eastwest */
+   char northsouth;
+   char eastwest;
+   double alt;             /* meters */
+   double geoid_height;    /* meters */
+   double climb;           /* meters per second -- the segment's average */
+   double knots;
+   double track_angle;     /* degrees true */
+   double magvar_deg;      /* signed, negative is west */
+   double norm_magvar;     /* always positive, see magvar_eastwest */
+   char magvar_eastwest;
+   char status_active;     /* 'A' or 'V' */
+   int nsats;
+   double hdilpos;
+   double vdilpos;
+   double pdilpos;
+   int csec;               /* hundredths of a second, 0 at 1 Hz */
+
+   /* the same values in fixed point, filled in instead of the doubles above 
+      by sim_segment_fixed() */
+   long fx_lat;            /* microdegrees -- always positive, see northsouth */
+   long fx_long;           /* microdegrees -- always positive, see eastwest */
+   long fx_alt;            /* millimeters */
+   long fx_climb;          /* millimeters per second */
+   int fx_knots;           /* tenths */
+   int fx_kmh;             /* tenths */
+   int fx_track;           /* tenths of a degree true */
+   int fx_magvar;          /* tenths of a degree, signed, negative is west */
+   int fx_geoid;           /* tenths of a meter */
+   int fx_hdop;            /* tenths */
+   int fx_vdop;
+   int fx_pdop;
+  }
+   gpsepoch;
+
+/* --------- streaming sentence writer -------------------------------------- */
+
+/* nmea_begin() starts a sentence with '$' and its address field, nmea_putc()
+   and the rest add to it, and nmea_end() finishes it with "*hh" and CRLF.
+   The checksum is the XOR of everything between '$' and '*', kept as each
+   character goes out.  On Arduino the characters go straight to the UART 
+   (through the transmit ring with TX_RING); elsewhere they are collected 
+   into nmea_line so that a sentence is still one write_com trace event and
+   one line on the console. */
+
+unsigned char nmea_sum;
+
+#ifndef ARDUINO
+char nmea_line[120];
+int nmea_len;
+#endif
+
+
+void nmea_putc(char kar)
+  {
+   nmea_sum ^= (unsigned char)kar;
+#ifdef ARDUINO
+   write_com(portspec,kar);
+#else
+   if (nmea_len < (int)sizeof(nmea_line) - 4)    /* room for "*hh" */
+     {
+      nmea_line[nmea_len++] = kar;
+     }
+#endif
+  }
+
+
+void nmea_puts(const char strg[])
+  {
+   while (*strg)
+     {
+      nmea_putc(*strg++);
+     }
+  }
+
+
+/* start a sentence -- address is e.g. "GPRMC" */
+void nmea_begin(const char address[])
+  {
+#ifdef ARDUINO
+   write_com(portspec,'$');
+#else
+   nmea_line[0] = '$';
+   nmea_len = 1;
+#endif
+   nmea_sum = 0;
+   nmea_puts(address);
+  }
+
+
+/* start a sentence of the fix -- type is e.g. "RMC", from the GN talker (a 
+   fix from more than one system) when other systems are on, otherwise GP */
+#ifdef HAVE_MULTI_GNSS
+void nmea_begin_fix(const char type[])
+  {
+   nmea_begin(GNSS_EXTRA ? "GN" : "GP");
+   nmea_puts(type);
+  }
+#else
+#define nmea_begin_fix(type)  nmea_begin("GP" type)
+#endif
+
+
+/* non-negative integer, zero padded to at least width digits like %0*ld */
+void nmea_int(long val, int width)
+  {
+   char digits[12];
+   int n = 0;
+
+   do
+     {
+      digits[n++] = (char)('0' + (int)(val % 10L));
+      val /= 10L;
+     }
+   while ((val > 0) || (n < width));
+
+   while (n > 0)
+     {
+      nmea_putc(digits[--n]);
+     }
+  }
+
+
+/* checksum and CRLF */
+void nmea_end(void)
+  {
+   static char hex[] = "0123456789ABCDEF";
+   unsigned char sum;
+
+   sum = nmea_sum;
+#ifdef ARDUINO
+   write_com(portspec,'*');
+   write_com(portspec,hex[sum >> 4]);
+   write_com(portspec,hex[sum & 0x0F]);
+   write_com(portspec,'\r');
+   write_com(portspec,'\n');
+#else
+   nmea_line[nmea_len++] = '*';
+   nmea_line[nmea_len++] = hex[sum >> 4];
+   nmea_line[nmea_len++] = hex[sum & 0x0F];
+   nmea_line[nmea_len] = 0;
+   if (!ckpt_replay)
+     {
+      com_string_crlf(portspec,nmea_line);
+     }
+#endif
+  }
+
+
+/* time of day field -- hhmmss, with hundredths above 1 Hz */
+void nmea_time(gpsepoch *ep)
+  {
+   nmea_int(ep->hhmmss,6);
+   if (flt_hz > 1)
+     {
+      nmea_putc('.');
+      nmea_int(ep->csec,2);
+     }
+  }
+
+
+/* Encoders whose layout depends on the NMEA version are written once, as an
+   ENCODER_BODY taking the version as a constant v23 flag, and instantiated as
+   separate _23 and _20 functions -- the compiler folds the flag away, so the
+   chosen version costs no test per sentence.  init_sentences() picks the
+   instance for the configured version.  Arduino compiles only the instance
+   selected by NMEA23, the others only name it. */
+
+#if defined(__GNUC__)
+#define ENCODER_BODY static __inline__ __attribute__((always_inline)) void
+#else
+#define ENCODER_BODY static void
+#endif
+
+#if !defined(ARDUINO)
+#define NMEA_VERSIONS(name)  void name##_23(gpsepoch *ep) { name(ep,TRUE); } \
+                             void name##_20(gpsepoch *ep) { name(ep,FALSE); }
+#define NMEA_DEFAULT(name)   name##_23
+#define NMEA_INSTANCES(name) name##_23, name##_20
+#else
+#ifdef NMEA23
+#define NMEA_VERSIONS(name)  void name##_23(gpsepoch *ep) { name(ep,TRUE); }
+#define NMEA_DEFAULT(name)   name##_23
+#else
+#define NMEA_VERSIONS(name)  void name##_20(gpsepoch *ep) { name(ep,FALSE); }
+#define NMEA_DEFAULT(name)   name##_20
+#endif
+#define NMEA_INSTANCES(name) NMEA_DEFAULT(name), NMEA_DEFAULT(name)
+#endif
+
+
+#if !defined(ARDUINO) || defined(FIXED_POINT)
+
+/* integer counterpart of dtostrf() for fixed point values -- val is scaled by
+   10^prec, e.g. fixtostr(-35,1,s) gives "-3.5" */
+char *fixtostr(long val, unsigned char prec, char *s)
+  {
+   char digits[12];
+   unsigned long uval;
+   int i = 0;
+   int n = 0;
+
+   if (val < 0)
+     {
+      s[i++] = '-';
+      uval = (unsigned long)(-val);
+     }
+   else
+     {
+      uval = (unsigned long)val;
+     }
+
+   /* digits come out lowest first -- at least one before the point */
+   do
+     {
+      digits[n++] = (char)('0' + (int)(uval % 10));
+      uval /= 10;
+     }
+   while ((uval > 0) || (n <= prec));
+
+   while (n > 0)
+     {
+      if (n == prec)
+        {
+         s[i++] = '.';
+        }
+      s[i++] = digits[--n];
+     }
+   s[i] = 0;
+   return s;
+  }
+
+
+/* microdegrees (positive) to the GPS style DDMM.MMMM (v23) or DDMM.MMM, scaled
+   for fixtostr() */
+long fx_degmin(long ud, int v23)
+  {
+   long deg;
+   long min;
+
+   deg = ud / 1000000L;
+   ud -= deg * 1000000L;
+
+   if (v23)
+     {
+      min = (ud * 60L + 50L) / 100L;        /* minutes x 10000 */
+      if (min >= 600000L)
+        {
+         deg++;
+         min -= 600000L;
+        }
+      return deg * 1000000L + min;
+     }
+
+   min = (ud * 60L + 500L) / 1000L;         /* minutes x 1000 */
+   if (min >= 60000L)
+     {
+      deg++;
+      min -= 60000L;
+     }
+   return deg * 100000L + min;
+  }
+
+
+/* divide and round half away from zero */
+long fx_div_round(long val, long div)
+  {
+   if (val < 0)
+     {
+      return -((-val + div / 2) / div);
+     }
+   return (val + div / 2) / div;
+  }
+
+#endif
+
+
+/* numeric fields of a gpsepoch, for put_field() */
+#define F_LAT       0     /* DDMM.MMMM (NMEA 2.3) or DDMM.MMM, see northsouth */
+#define F_LONG      1     /* DDDMM.MMMM or DDDMM.MMM, see eastwest */
+#define F_KNOTS     2
+#define F_KMH       3
+#define F_TRACK     4     /* degrees true */
+#define F_MAGTRACK  5     /* degrees magnetic */
+#define F_MAGVAR    6     /* always positive, see magvar_eastwest */
+#define F_HDOP      7
+#define F_VDOP      8
+#define F_PDOP      9
+#define F_ALT      10     /* meters */
+#define F_GEOID    11     /* meters */
+
+
+/* format one numeric field and send it -- from the doubles or, for an epoch
+   from sim_segment_fixed(), from the fixed point values.  field is a constant
+   wherever this is used, so each use comes down to the one format call. */
+ENCODER_BODY put_field(gpsepoch *ep, int field, int v23)
+  {
+   char strg[BUFFLIMIT];
+#if !defined(ARDUINO) || defined(FIXED_POINT)
+   long fx_val = 0;
+#endif
+#if !defined(ARDUINO) || !defined(FIXED_POINT)
+   double val = 0.0;
+   signed char wid = -3;
+#endif
+   unsigned char prec = 1;
+
+#if !defined(ARDUINO) || defined(FIXED_POINT)
+   if (flt_fixed)
+     {
+      switch (field)
+        {
+         case F_LAT:
+           {
+            fx_val = fx_degmin(ep->fx_lat,v23);
+            prec = (v23 ? 4 : 3);
+            break;
+           }
+         case F_LONG:
+           {
+            fx_val = fx_degmin(ep->fx_long,v23);
+            prec = (v23 ? 4 : 3);
+            break;
+           }
+         case F_KNOTS:
+           {
+            fx_val = ep->fx_knots;
+            break;
+           }
+         case F_KMH:
+           {
+            fx_val = ep->fx_kmh;
+            break;
+           }
+         case F_TRACK:
+           {
+            fx_val = ep->fx_track;
+            break;
+           }
+         case F_MAGTRACK:
+           {
+            /* west variation makes the magnetic track larger */
+            fx_val = ep->fx_track - ep->fx_magvar;
+            if (fx_val >= 3600)
+              {
+               fx_val -= 3600;
+              }
+            if (fx_val < 0)
+              {
+               fx_val += 3600;
+              }
+            break;
+           }
+         case F_MAGVAR:
+           {
+            fx_val = ((ep->fx_magvar < 0) ? -ep->fx_magvar : ep->fx_magvar);
+            break;
+           }
+         case F_HDOP:
+           {
+            fx_val = ep->fx_hdop;
+            break;
+           }
+         case F_VDOP:
+           {
+            fx_val = ep->fx_vdop;
+            break;
+           }
+         case F_PDOP:
+           {
+            fx_val = ep->fx_pdop;
+            break;
+           }
+         case F_ALT:
+           {
+            fx_val = fx_div_round(ep->fx_alt,100L);
+            break;
+           }
+         case F_GEOID:
+           {
+            fx_val = ep->fx_geoid;
+            break;
+           }
+        }
+      nmea_puts(fixtostr(fx_val,prec,strg));
+     }
+#endif
+#if !defined(ARDUINO) || !defined(FIXED_POINT)
+   if (!flt_fixed)
+     {
+      switch (field)
+        {
+         case F_LAT:
+           {
+            val = ep->normlat;
+            wid = (v23 ? -6 : -5);
+            prec = (v23 ? 4 : 3);
+            break;
+           }
+         case F_LONG:
+           {
+            val = ep->normlong;
+            wid = (v23 ? -6 : -5);
+            prec = (v23 ? 4 : 3);
+            break;
+           }
+         case F_KNOTS:
+           {
+            val = ep->knots;
+            wid = -5;
+            break;
+           }
+         case F_KMH:
+           {
+            val = ep->knots * 1.852;
+            wid = -5;
+            break;
+           }
+         case F_TRACK:
+           {
+            val = ep->track_angle;
+            wid = -5;
+            break;
+           }
+         case F_MAGTRACK:
+           {
+            val = ep->track_angle - ep->magvar_deg;
+            if (val >= 360.0)
+              {
+               val -= 360.0;
+              }
+            if (val < 0.0)
+              {
+               val += 360.0;
+              }
+            wid = -5;
+            break;
+           }
+         case F_MAGVAR:
+           {
+            val = ep->norm_magvar;
+            break;
+           }
+         case F_HDOP:
+           {
+            val = ep->hdilpos;
+            break;
+           }
+         case F_VDOP:
+           {
+            val = ep->vdilpos;
+            break;
+           }
+         case F_PDOP:
+           {
+            val = ep->pdilpos;
+            break;
+           }
+         case F_ALT:
+           {
+            val = ep->alt;
+            break;
+           }
+         case F_GEOID:
+           {
+            val = ep->geoid_height;
+            break;
+           }
+        }
+      nmea_puts(dtostrf_chop(val,wid,prec,strg));
+     }
+#endif
+  }
+
+
+/* ',' and then the field */
+#define NMEA_FIELD(ep,field,v23)  { nmea_putc(','); put_field(ep,field,v23); }
+
+
+/* --------------------- GPRMC sentence -------------------- */
+ENCODER_BODY encode_rmc(gpsepoch *ep, int v23)
+  {
+   nmea_begin_fix("RMC");
+
+   if ((flt_fixtype == 1) && (ep->nsats == 0))   /* invalid data -- no fix, nothing to report */
+     {
+      nmea_puts(",,");
+      nmea_putc(ep->status_active);
+      nmea_puts(",,,,,,,");
+      nmea_int(ep->ddmmyy,6);
+      nmea_puts(v23 ? ",,,N" : ",,");
+      nmea_end();
+      return;
+     }
+
+   /* without a fix the last position is repeated */
+   nmea_putc(',');
+   nmea_time(ep);
+   nmea_putc(',');
+   nmea_putc(ep->status_active);
+   NMEA_FIELD(ep,F_LAT,v23);
+   nmea_putc(',');
+   nmea_putc(ep->northsouth);
+   NMEA_FIELD(ep,F_LONG,v23);
+   nmea_putc(',');
+   nmea_putc(ep->eastwest);
+   NMEA_FIELD(ep,F_KNOTS,v23);
+   NMEA_FIELD(ep,F_TRACK,v23);
+   nmea_putc(',');
+   nmea_int(ep->ddmmyy,6);
+   NMEA_FIELD(ep,F_MAGVAR,v23);
+   nmea_putc(',');
+   nmea_putc(ep->magvar_eastwest);
+   if (v23)   /* NMEA 2.0 has no mode field */
+     {
+      nmea_putc(',');
+      nmea_putc((flt_fixtype != 1) ? 'A' : ep->status_active);
+     }
+   nmea_end();
+  }
+
+NMEA_VERSIONS(encode_rmc)
+
+
+/* --------------------- GPGGA sentence -------------------- */
+ENCODER_BODY encode_gga(gpsepoch *ep, int v23)
+  {
+   int quality;
+
+   nmea_begin_fix("GGA");
+
+   if (flt_fixtype != 1)
+     {
+      quality = 1;
+     }
+   else if (ep->nsats == 0)   /* invalid data -- no fix, nothing to report */
+     {
+      nmea_puts(",,,,,,0,00,,,M,,M,,");
+      nmea_end();
+      return;
+     }
+   else   /* invalid data -- no fix, last position is repeated */
+     {
+      quality = (v23 ? 6 : 0);     /* NMEA 2.3 -- estimated (dead reckoning) */
+     }
+
+   nmea_putc(',');
+   nmea_time(ep);
+   NMEA_FIELD(ep,F_LAT,v23);
+   nmea_putc(',');
+   nmea_putc(ep->northsouth);
+   NMEA_FIELD(ep,F_LONG,v23);
+   nmea_putc(',');
+   nmea_putc(ep->eastwest);
+   nmea_putc(',');
+   nmea_int(quality,1);
+   nmea_putc(',');
+   nmea_int(ep->nsats,2);
+   NMEA_FIELD(ep,F_HDOP,v23);
+   NMEA_FIELD(ep,F_ALT,v23);
+   nmea_puts(",M");
+   NMEA_FIELD(ep,F_GEOID,v23);
+   nmea_puts(",M,,");
+   nmea_end();
+  }
+
+NMEA_VERSIONS(encode_gga)
+
+
+/* --------------------- GPGSA sentence -------------------- */
+void encode_gsa(gpsepoch *ep)
+  {
+   int i;
+
+   nmea_begin("GPGSA");
+   nmea_putc(',');
+   nmea_putc(ep->status_active);
+   nmea_putc(',');
+   nmea_int(flt_fixtype,1);
+   for (i=0; i<12; i++)
+     {
+      nmea_putc(',');
+      nmea_puts(satarray[i]);
+     }
+   NMEA_FIELD(ep,F_PDOP,TRUE);
+   NMEA_FIELD(ep,F_HDOP,TRUE);
+   NMEA_FIELD(ep,F_VDOP,TRUE);
+   nmea_end();
+  }
+
+
+#ifdef HAVE_MULTI_GNSS
+/* --------------------- GNGSA sentences -------------------- */
+
+/* one for each system on -- its satellites used, the DOPs of the whole fix,
+   and its NMEA 4.10 system ID */
+void encode_gsa_multi(gpsepoch *ep)
+  {
+   gnss_sky *sky;
+   int s, i;
+
+   for (s=0; s<GNSS_NUM; s++)
+     {
+      if (!GNSS_ON(s))
+        {
+         continue;
+        }
+      nmea_begin("GNGSA");
+      nmea_putc(',');
+      nmea_putc(ep->status_active);
+      nmea_putc(',');
+      nmea_int(flt_fixtype,1);
+      for (i=0; i<12; i++)
+        {
+         nmea_putc(',');
+         if (s == 0)
+           {
+            nmea_puts(satarray[i]);
+           }
+         else
+           {
+            sky = GNSS_SKY(s);
+            if (i < sky->used)
+              {
+               nmea_int(sky->prn[i] + gnss_table[s].id_offset,2);
+              }
+           }
+        }
+      NMEA_FIELD(ep,F_PDOP,TRUE);
+      NMEA_FIELD(ep,F_HDOP,TRUE);
+      NMEA_FIELD(ep,F_VDOP,TRUE);
+      nmea_putc(',');
+      nmea_int(gnss_table[s].nmea_sys,1);
+      nmea_end();
+     }
+  }
+#endif
+
+
+#ifdef HAVE_GSV
+/* the start of each GSV sentence -- message count, number and satellites */
+void nmea_gsv_begin(const char talker[], int nmsgs, int msg, int nsats)
+  {
+   nmea_begin(talker);
+   nmea_puts("GSV");
+   nmea_putc(',');
+   nmea_int(nmsgs,1);
+   nmea_putc(',');
+   nmea_int(msg,1);
+   nmea_putc(',');
+   nmea_int(nsats,2);
+  }
+
+
+/* one satellite of a GSV sentence */
+void nmea_gsv_sat(int id, int elev, int azim, int snr)
+  {
+   nmea_putc(',');
+   nmea_int(id,2);
+   nmea_putc(',');
+   nmea_int(elev,2);
+   nmea_putc(',');
+   nmea_int(azim,3);
+   nmea_putc(',');
+   nmea_int(snr,2);
+  }
+
+
+/* --------------------- GPGSV sentence(s) -------------------- */
+
+void encode_gsv(gpsepoch *ep)
+  {
+   int nmsgs, msg, i, n;
+
+   (void)ep;                     /* the satellites are not in the epoch */
+
+   nmsgs = (totalsats + 3) / 4;
+   if (nmsgs == 0)
+     {
+      nmsgs = 1;
+     }
+
+   i = 0;
+   for (msg=1; msg<=nmsgs; msg++)
+     {
+      nmea_gsv_begin("GP",nmsgs,msg,totalsats);
+      for (n=0; (n < 4) && (i < 12); i++)
+        {
+         if (satarray[i][0] == 0)
+           {
+            continue;
+           }
+         nmea_gsv_sat(SAT_PRN(i),SLOT_ELEV(i),SLOT_AZIM(i),SLOT_SNR(i));
+         n++;
+        }
+      nmea_end();
+     }
+  }
+#endif
+
+
+#ifndef ARDUINO
+/* --------------------- GPGSV sentence(s) from almanac -------------------- */
+
+/* every satellite in view, highest first, up to 4 per sentence */
+void encode_gsv_sky(gpsepoch *ep)
+  {
+   int nmsgs, msg, i, n;
+
+   (void)ep;
+
+   nmsgs = (flt_view.count + 3) / 4;
+   if (nmsgs == 0)
+     {
+      nmsgs = 1;
+     }
+
+   i = 0;
+   for (msg=1; msg<=nmsgs; msg++)
+     {
+      nmea_gsv_begin("GP",nmsgs,msg,flt_view.count);
+      for (n=0; (n < 4) && (i < flt_view.count); n++, i++)
+        {
+         nmea_gsv_sat(flt_view.prn[i],
+                      (int)(flt_view.elev[i] + 0.5),
+                      (int)(flt_view.azim[i] + 0.5) % 360,
+                      flt_view.snr[i]);
+        }
+      nmea_end();
+     }
+  }
+#endif
+
+
+#if defined(HAVE_GSV) && defined(HAVE_MULTI_GNSS)
+/* one system's GSV pages, from its own talker with its own satellite IDs */
+void encode_gsv_gnss(int s)
+  {
+   gnss_sky *sky;
+   int nmsgs, msg, i, n;
+
+   sky = GNSS_SKY(s);
+   nmsgs = (sky->count + 3) / 4;
+   if (nmsgs == 0)
+     {
+      nmsgs = 1;
+     }
+
+   i = 0;
+   for (msg=1; msg<=nmsgs; msg++)
+     {
+      nmea_gsv_begin(gnss_table[s].talker,nmsgs,msg,sky->count);
+      for (n=0; (n < 4) && (i < sky->count); n++, i++)
+        {
+         nmea_gsv_sat(sky->prn[i] + gnss_table[s].id_offset,
+                      sky->elev[i],sky->azim[i],sky->snr[i]);
+        }
+      nmea_end();
+     }
+  }
+
+
+/* GPGSV as ever, then the other systems' */
+void encode_gsv_multi(gpsepoch *ep)
+  {
+   int s;
+
+#ifndef ARDUINO
+   if (cfg_almanac)
+     {
+      encode_gsv_sky(ep);
+     }
+   else
+#endif
+     {
+      encode_gsv(ep);
+     }
+   for (s=1; s<GNSS_NUM; s++)
+     {
+      if (GNSS_ON(s))
+        {
+         encode_gsv_gnss(s);
+        }
+     }
+  }
+#endif
+
+
+#ifdef HAVE_VTG
+/* --------------------- GPVTG sentence -------------------- */
+ENCODER_BODY encode_vtg(gpsepoch *ep, int v23)
+  {
+   nmea_begin_fix("VTG");
+
+   if (flt_fixtype == 1)   /* invalid data -- no fix */
+     {
+      nmea_puts(v23 ? ",,T,,M,,N,,K,N" : ",,T,,M,,N,,K");
+      nmea_end();
+      return;
+     }
+
+   NMEA_FIELD(ep,F_TRACK,v23);
+   nmea_puts(",T");
+   NMEA_FIELD(ep,F_MAGTRACK,v23);
+   nmea_puts(",M");
+   NMEA_FIELD(ep,F_KNOTS,v23);
+   nmea_puts(",N");
+   NMEA_FIELD(ep,F_KMH,v23);
+   nmea_puts(v23 ? ",K,A" : ",K");
+   nmea_end();
+  }
+
+NMEA_VERSIONS(encode_vtg)
+#endif
+
+
+#ifdef HAVE_GLL
+/* --------------------- GPGLL sentence -------------------- */
+ENCODER_BODY encode_gll(gpsepoch *ep, int v23)
+  {
+   nmea_begin_fix("GLL");
+
+   if ((flt_fixtype == 1) && (ep->nsats == 0))   /* invalid data -- nothing to report */
+     {
+      nmea_puts(v23 ? ",,,,,,V,N" : ",,,,,,V");
+      nmea_end();
+      return;
+     }
+
+   NMEA_FIELD(ep,F_LAT,v23);
+   nmea_putc(',');
+   nmea_putc(ep->northsouth);
+   NMEA_FIELD(ep,F_LONG,v23);
+   nmea_putc(',');
+   nmea_putc(ep->eastwest);
+   nmea_putc(',');
+   nmea_time(ep);
+   nmea_putc(',');
+   nmea_putc(ep->status_active);
+   if (v23)
+     {
+      nmea_putc(',');
+      nmea_putc((flt_fixtype != 1) ? 'A' : 'N');
+     }
+   nmea_end();
+  }
+
+NMEA_VERSIONS(encode_gll)
+#endif
+
+
+#ifdef HAVE_ZDA
+/* --------------------- GPZDA sentence -------------------- */
+void encode_zda(gpsepoch *ep)
+  {
+   long yr;
+
+   /* ddmmyy -- 2-digit years are assumed 1950-2049 as in date_secs() */
+   yr = ep->ddmmyy % 100L;
+   yr += ((yr <= 49) ? 2000 : 1900);
+
+   nmea_begin_fix("ZDA");
+   nmea_putc(',');
+   nmea_int(ep->hhmmss,6);
+   nmea_putc('.');
+   nmea_int(ep->csec,2);
+   nmea_putc(',');
+   nmea_int(ep->ddmmyy / 10000L,2);
+   nmea_putc(',');
+   nmea_int((ep->ddmmyy / 100L) % 100L,2);
+   nmea_putc(',');
+   nmea_int(yr,4);
+   nmea_puts(",00,00");
+   nmea_end();
+  }
+#endif
+
+
+#ifdef HAVE_UBX
+/* --------------------- UBX binary messages -------------------- */
+
+/* The u-blox receivers' binary protocol:  each message is the sync characters
+   0xB5 0x62, a class and an id, the payload length (2 bytes) and the payload,
+   then an 8 bit Fletcher checksum (2 bytes) over everything from the class to
+   the end of the payload.  Numbers are little-endian, whatever the processor.
+   As with the NMEA writer, ubx_begin() starts a message, ubx_putc() and the
+   rest add to it, keeping the checksum, and ubx_end() finishes it -- the
+   fields go straight out in payload order, so there is no payload struct to
+   be packed (and laid out in this processor's byte order) first.  On Arduino
+   the bytes go out through serial_putb(), which unlike serial_putc() passes
+   all 8 bits; Windows/Linux collect a message in ubx_frame, to send it as 
+   one write_com trace event, or with no port to show it on the console as a
+   line of hex. */
+
+#define UBX_NAV         0x01      /* class */
+#define UBX_NAV_DOP     0x04
+#define UBX_NAV_PVT     0x07
+#define UBX_NAV_SAT     0x35
+
+/* accuracy estimates -- range error (1 sigma) times the DOP for position, 
+   and fixed values for time and speed (ERROR and NOISE set the range error 
+   on Windows/Linux) */
+#define UBX_UERE_MM     3000L
+#define UBX_TACC_NS     50L
+#define UBX_SACC_MMS    200L
+#define UBX_MAGACC      50        /* hundredths of a degree */
+
+#ifdef ARDUINO
+#define UBX_LEAP_SECONDS GPS_UTC_SECONDS
+#else
+#define UBX_LEAP_SECONDS cfg_leap_seconds
+#endif
+
+unsigned char ubx_ck_a;
+unsigned char ubx_ck_b;
+
+#ifndef ARDUINO
+unsigned char ubx_frame[16 + 12 * (ALM_MAX_SATS + 3 * GNSS_MAX_VIEW)];   /* the longest NAV-SAT */
+int ubx_len;
+#endif
+
+
+void ubx_putc(unsigned char kar)
+  {
+   ubx_ck_a += kar;
+   ubx_ck_b += ubx_ck_a;
+#ifdef ARDUINO
+   serial_putb(kar);
+#else
+   if (ubx_len < (int)sizeof(ubx_frame) - 2)    /* room for the checksum */
+     {
+      ubx_frame[ubx_len++] = kar;
+     }
+#endif
+  }
+
+
+void ubx_u2(unsigned int val)
+  {
+   ubx_putc((unsigned char)(val & 0xFF));
+   ubx_putc((unsigned char)((val >> 8) & 0xFF));
+  }
+
+
+/* U4 and, in two's complement, I4 */
+void ubx_u4(unsigned long val)
+  {
+   ubx_u2((unsigned int)(val & 0xFFFFUL));
+   ubx_u2((unsigned int)((val >> 16) & 0xFFFFUL));
+  }
+
+
+/* reserved bytes */
+void ubx_zeros(int n)
+  {
+   while (n-- > 0)
+     {
+      ubx_putc(0);
+     }
+  }
+
+
+/* start a message of len payload bytes */
+void ubx_begin(unsigned char msg_class, unsigned char msg_id, unsigned int len)
+  {
+#ifdef ARDUINO
+   serial_putb(0xB5);
+   serial_putb(0x62);
+#else
+   ubx_frame[0] = 0xB5;
+   ubx_frame[1] = 0x62;
+   ubx_len = 2;
+#endif
+   ubx_ck_a = 0;
+   ubx_ck_b = 0;
+   ubx_putc(msg_class);
+   ubx_putc(msg_id);
+   ubx_u2(len);
+  }
+
+
+/* checksum */
+void ubx_end(void)
+  {
+#ifdef ARDUINO
+   serial_putb(ubx_ck_a);
+   serial_putb(ubx_ck_b);
+#else
+   int i;
+
+   ubx_frame[ubx_len++] = ubx_ck_a;
+   ubx_frame[ubx_len++] = ubx_ck_b;
+   if (ckpt_replay)
+     {
+      return;
+     }
+
+   EVTRACE_BEGIN("write_com");
+   for (i=0; i<ubx_len; i++)
+     {
+      if (portspec)
+        {
+         write_com(portspec,ubx_frame[i]);
+        }
+      else  /* display on console if no port specified */
+        {
+         printf((i < ubx_len - 1) ? "%02X " : "%02X\n",ubx_frame[i]);
+        }
+     }
+   EVTRACE_END("write_com");
+#endif
+  }
+
+
+/* days from 1 March of year 0 to a date -- March first, so a leap day is 
+   the last day of its year */
+long ubx_days(long yr, int mo, int dy)
+  {
+   if (mo <= 2)
+     {
+      yr--;
+      mo += 12;
+     }
+   return 365L * yr + yr / 4L - yr / 100L + yr / 400L + (153L * (mo - 3) + 2L) / 5L + dy - 1;
+  }
+
+
+/* GPS time of week in milliseconds (iTOW) -- UTC ahead by the leap seconds,
+   from the start of Sunday.  The seconds are worked out once a second. */
+long ubx_tow_lsec = -1L;
+unsigned long ubx_tow_secs;
+
+unsigned long ubx_itow(gpsepoch *ep)
+  {
+   long yr;
+   long secs;
+
+   if (ep->lsec != ubx_tow_lsec)
+     {
+      ubx_tow_lsec = ep->lsec;
+
+      /* ddmmyy -- 2-digit years are assumed 1950-2049 as in date_secs() */
+      yr = ep->ddmmyy % 100L;
+      yr += ((yr <= 49) ? 2000 : 1900);
+      secs = ((ubx_days(yr,(int)((ep->ddmmyy / 100L) % 100L),(int)(ep->ddmmyy / 10000L))
+               - ubx_days(1980L,1,6)) % 7L) * 86400L;    /* GPS time began on a Sunday */
+      secs += (ep->hhmmss / 10000L) * 3600L + ((ep->hhmmss / 100L) % 100L) * 60L 
+              + (ep->hhmmss % 100L) + UBX_LEAP_SECONDS;
+      if (secs >= 604800L)
+        {
+         secs -= 604800L;
+        }
+      ubx_tow_secs = (unsigned long)secs;
+     }
+   return ubx_tow_secs * 1000UL + (unsigned long)ep->csec * 10UL;
+  }
+
+
+/* the fix in UBX units */
+typedef struct
+  {
+   long lat;               /* 1e-7 degree */
+   long lon;
+   long height;            /* mm above the ellipsoid */
+   long hmsl;              /* mm above mean sea level */
+   long vel_n;             /* mm/s */
+   long vel_e;
+   long vel_d;
+   long gspeed;
+   long head;              /* 1e-5 degree, true */
+   int magdec;             /* 1e-2 degree, negative is west */
+   unsigned int hdop;      /* 0.01 */
+   unsigned int vdop;
+   unsigned int pdop;
+  }
+   ubx_fix;
+
+
+#if !defined(ARDUINO) || defined(FIXED_POINT)
+/* cos of a track in tenths of a degree, times 65536 -- from the half degree 
+   table, as fx_cos() */
+long ubx_fx_cos(int tenths)
+  {
+   long sign = 1L;
+   long c0;
+   int step;
+
+   while (tenths < 0)
+     {
+      tenths += 3600;
+     }
+   while (tenths >= 3600)
+     {
+      tenths -= 3600;
+     }
+   if (tenths > 1800)
+     {
+      tenths = 3600 - tenths;
+     }
+   if (tenths > 900)
+     {
+      tenths = 1800 - tenths;
+      sign = -1L;
+     }
+
+   step = tenths / 5;
+   c0 = FX_COS(step);
+   if (step < 180)
+     {
+      c0 -= ((c0 - FX_COS(step + 1)) * (tenths - step * 5) + 2L) / 5L;
+     }
+   return sign * c0;
+  }
+
+
+/* val times a Q16 fraction, rounded */
+long ubx_fx_mul(long val, long q16)
+  {
+   long long prod;
+
+   prod = (long long)val * q16;
+   return (long)((prod + ((prod < 0) ? -32768L : 32768L)) / 65536L);
+  }
+#endif
+
+
+#if !defined(ARDUINO) || !defined(FIXED_POINT)
+/* round half away from zero */
+long ubx_round(double val)
+  {
+   if (val < 0.0)
+     {
+      return -(long)(0.5 - val);
+     }
+   return (long)(val + 0.5);
+  }
+
+
+/* DDMM.MMMM to degrees */
+double ubx_degrees(double ddmm)
+  {
+   long deg;
+
+   deg = (long)(ddmm / 100.0);
+   return (double)deg + (ddmm - (double)deg * 100.0) / 60.0;
+  }
+#endif
+
+
+/* gather the fix from the doubles or, for an epoch from sim_segment_fixed(),
+   from the fixed point values -- as put_field() */
+void ubx_solution(gpsepoch *ep, ubx_fix *fix)
+  {
+#if !defined(ARDUINO) || defined(FIXED_POINT)
+   if (flt_fixed)
+     {
+      fix->lat = ep->fx_lat * 10L;
+      fix->lon = ep->fx_long * 10L;
+      fix->hmsl = ep->fx_alt;
+      fix->height = ep->fx_alt + (long)ep->fx_geoid * 100L;
+      fix->gspeed = ((long)ep->fx_knots * 51444L + 500L) / 1000L;
+      fix->head = (long)ep->fx_track * 10000L;
+      fix->vel_n = ubx_fx_mul(fix->gspeed,ubx_fx_cos(ep->fx_track));
+      fix->vel_e = ubx_fx_mul(fix->gspeed,ubx_fx_cos(ep->fx_track - 900));
+      fix->vel_d = -ep->fx_climb;
+      fix->magdec = ep->fx_magvar * 10;
+      fix->hdop = (unsigned int)ep->fx_hdop * 10U;
+      fix->vdop = (unsigned int)ep->fx_vdop * 10U;
+      fix->pdop = (unsigned int)ep->fx_pdop * 10U;
+     }
+#endif
+#if !defined(ARDUINO) || !defined(FIXED_POINT)
+   if (!flt_fixed)
+     {
+      fix->lat = ubx_round(ubx_degrees(ep->normlat) * 1.0e7);
+      fix->lon = ubx_round(ubx_degrees(ep->normlong) * 1.0e7);
+      fix->hmsl = ubx_round(ep->alt * 1000.0);
+      fix->height = ubx_round((ep->alt + ep->geoid_height) * 1000.0);
+      fix->gspeed = ubx_round(ep->knots * (1852000.0 / 3600.0));
+      fix->head = ubx_round(ep->track_angle * 1.0e5);
+      fix->vel_n = ubx_round(ep->knots * (1852000.0 / 3600.0) * cos_safe(ep->track_angle));
+      fix->vel_e = ubx_round(ep->knots * (1852000.0 / 3600.0) * cos_safe(ep->track_angle - 90.0));
+      fix->vel_d = ubx_round(ep->climb * -1000.0);
+      fix->magdec = (int)ubx_round(ep->magvar_deg * 100.0);
+      fix->hdop = (unsigned int)ubx_round(ep->hdilpos * 100.0);
+      fix->vdop = (unsigned int)ubx_round(ep->vdilpos * 100.0);
+      fix->pdop = (unsigned int)ubx_round(ep->pdilpos * 100.0);
+     }
+#endif
+   if (ep->northsouth == 'S')
+     {
+      fix->lat = -fix->lat;
+     }
+   if (ep->eastwest == 'W')
+     {
+      fix->lon = -fix->lon;
+     }
+  }
+
+
+/* range error for the accuracy estimates, mm */
+long ubx_uere(void)
+  {
+#ifndef ARDUINO
+   if (cfg_error_model)
+     {
+      return ubx_round(sqrt(cfg_error * cfg_error + cfg_noise * cfg_noise) * 1000.0);
+     }
+#endif
+   return UBX_UERE_MM;
+  }
+#endif
+
+
+#ifdef HAVE_PVT
+/* --------------------- UBX NAV-PVT message -------------------- */
+
+/* Everything RMC, GGA and GSA report, and the velocity north, east and down,
+   in 100 bytes.  Without a fix fixType is 0 and gnssFixOK clear, and the last
+   position is repeated -- flagged invalid (invalidLlh) if there never was one. */
+void encode_ubx_pvt(gpsepoch *ep)
+  {
+   ubx_fix fix;
+   long yr;
+   long uere;
+   long head_acc;
+
+   ubx_solution(ep,&fix);
+   uere = ubx_uere();
+   yr = ep->ddmmyy % 100L;
+   yr += ((yr <= 49) ? 2000 : 1900);
+
+   /* heading is as good as the speed across it */
+   head_acc = 18000000L;
+   if (fix.gspeed > UBX_SACC_MMS)
+     {
+      head_acc = (5729578L * UBX_SACC_MMS) / fix.gspeed;
+     }
+
+   ubx_begin(UBX_NAV,UBX_NAV_PVT,92);
+   ubx_u4(ubx_itow(ep));
+   ubx_u2((unsigned int)yr);
+   ubx_putc((unsigned char)((ep->ddmmyy / 100L) % 100L));
+   ubx_putc((unsigned char)(ep->ddmmyy / 10000L));
+   ubx_putc((unsigned char)(ep->hhmmss / 10000L));
+   ubx_putc((unsigned char)((ep->hhmmss / 100L) % 100L));
+   ubx_putc((unsigned char)(ep->hhmmss % 100L));
+   ubx_putc(0x0F);                          /* valid date, time, resolved, magDec */
+   ubx_u4(UBX_TACC_NS);
+   ubx_u4((unsigned long)ep->csec * 10000000UL);       /* nano */
+   ubx_putc((unsigned char)((flt_fixtype != 1) ? flt_fixtype : 0));
+   ubx_putc((unsigned char)((flt_fixtype != 1) ? 0x01 : 0x00));    /* gnssFixOK */
+   ubx_putc(0);
+   ubx_putc((unsigned char)ep->nsats);
+   ubx_u4((unsigned long)fix.lon);
+   ubx_u4((unsigned long)fix.lat);
+   ubx_u4((unsigned long)fix.height);
+   ubx_u4((unsigned long)fix.hmsl);
+   ubx_u4((unsigned long)((uere * (long)fix.hdop) / 100L));
+   ubx_u4((unsigned long)((uere * (long)fix.vdop) / 100L));
+   ubx_u4((unsigned long)fix.vel_n);
+   ubx_u4((unsigned long)fix.vel_e);
+   ubx_u4((unsigned long)fix.vel_d);
+   ubx_u4((unsigned long)fix.gspeed);
+   ubx_u4((unsigned long)fix.head);
+   ubx_u4(UBX_SACC_MMS);
+   ubx_u4((unsigned long)head_acc);
+   ubx_u2(fix.pdop);
+   ubx_u2(((flt_fixtype == 1) && (ep->nsats == 0)) ? 0x0001 : 0x0000);   /* invalidLlh */
+   ubx_zeros(4);
+   ubx_u4(0UL);                             /* headVeh -- not valid */
+   ubx_u2((unsigned int)fix.magdec);
+   ubx_u2(UBX_MAGACC);
+   ubx_end();
+  }
+#endif
+
+
+#ifdef HAVE_DOP
+/* --------------------- UBX NAV-DOP message -------------------- */
+
+/* The simulation has no receiver clock, so time DOP is 0 and geometric DOP 
+   the position DOP, and the horizontal DOP is shared evenly north and east. */
+void encode_ubx_dop(gpsepoch *ep)
+  {
+   ubx_fix fix;
+   unsigned int ne;
+
+   ubx_solution(ep,&fix);
+   ne = (unsigned int)(((long)fix.hdop * 7071L + 5000L) / 10000L);
+
+   ubx_begin(UBX_NAV,UBX_NAV_DOP,18);
+   ubx_u4(ubx_itow(ep));
+   ubx_u2(fix.pdop);                        /* gDOP */
+   ubx_u2(fix.pdop);
+   ubx_u2(0);                               /* tDOP */
+   ubx_u2(fix.vdop);
+   ubx_u2(fix.hdop);
+   ubx_u2(ne);
+   ubx_u2(ne);
+   ubx_end();
+  }
+#endif
+
+
+#ifdef HAVE_SAT
+/* --------------------- UBX NAV-SAT message -------------------- */
+
+/* signal quality, health and orbit source (flags) of a satellite used in the 
+   fix, and of one only in view:  code and carrier locked, or code only; 
+   healthy; ephemeris, and available */
+#define UBX_SAT_USED    0x0000091FUL
+#define UBX_SAT_VIEW    0x00000914UL
+
+/* the satellites' header */
+void ubx_sat_begin(gpsepoch *ep, int nsvs)
+  {
+   ubx_begin(UBX_NAV,UBX_NAV_SAT,(unsigned int)(8 + 12 * nsvs));
+   ubx_u4(ubx_itow(ep));
+   ubx_putc(1);                             /* version */
+   ubx_putc((unsigned char)nsvs);
+   ubx_zeros(2);
+  }
+
+
+/* one satellite -- gnssId 0 for GPS */
+void ubx_sat(int gnss, int prn, int elev, int azim, int snr, unsigned long flags)
+  {
+   ubx_putc((unsigned char)gnss);
+   ubx_putc((unsigned char)prn);
+   ubx_putc((unsigned char)snr);
+   ubx_putc((unsigned char)elev);
+   ubx_u2((unsigned int)azim);
+   ubx_u2(0);                               /* prRes */
+   ubx_u4(flags);
+  }
+
+
+#ifdef HAVE_MULTI_GNSS
+/* the other systems' satellites in view */
+int ubx_sat_gnss_count(void)
+  {
+   int s, n;
+
+   n = 0;
+   for (s=1; s<GNSS_NUM; s++)
+     {
+      n += GNSS_SKY(s)->count;
+     }
+   return n;
+  }
+
+
+void ubx_sat_gnss(void)
+  {
+   gnss_sky *sky;
+   int s, i;
+
+   for (s=1; s<GNSS_NUM; s++)
+     {
+      sky = GNSS_SKY(s);
+      for (i=0; i<sky->count; i++)
+        {
+         ubx_sat(gnss_table[s].ubx_gnss,sky->prn[i],sky->elev[i],sky->azim[i],sky->snr[i],
+                 ((i < sky->used) ? UBX_SAT_USED : UBX_SAT_VIEW));
+        }
+     }
+  }
+#endif
+
+
+/* the satellites of GSA, placed as GSV places them */
+void encode_ubx_sat(gpsepoch *ep)
+  {
+   int i, n;
+
+   n = 0;
+   for (i=0; i<12; i++)
+     {
+      if (satarray[i][0] != 0)
+        {
+         n++;
+        }
+     }
+#ifdef HAVE_MULTI_GNSS
+   n += ubx_sat_gnss_count();
+#endif
+
+   ubx_sat_begin(ep,n);
+   for (i=0; i<12; i++)
+     {
+      if (satarray[i][0] != 0)
+        {
+         ubx_sat(0,SAT_PRN(i),SLOT_ELEV(i),SLOT_AZIM(i),SLOT_SNR(i),UBX_SAT_USED);
+        }
+     }
+#ifdef HAVE_MULTI_GNSS
+   ubx_sat_gnss();
+#endif
+   ubx_end();
+  }
+
+
+#ifndef ARDUINO
+/* every satellite in view from the almanac, highest first -- those GSA lists
+   are the ones used -- then the other systems' */
+void encode_ubx_sat_sky(gpsepoch *ep)
+  {
+   int i;
+
+   ubx_sat_begin(ep,flt_view.count + ubx_sat_gnss_count());
+   for (i=0; i<flt_view.count; i++)
+     {
+      ubx_sat(0,flt_view.prn[i],
+              (int)(flt_view.elev[i] + 0.5),
+              (int)(flt_view.azim[i] + 0.5) % 360,
+              flt_view.snr[i],
+              (((i < 12) && (satarray[i][0] != 0)) ? UBX_SAT_USED : UBX_SAT_VIEW));
+     }
+   ubx_sat_gnss();
+   ubx_end();
+  }
+#endif
+#endif
+
+
+/* The registry lists every sentence (and UBX message) this build can produce,
+   in output order, with its default output rate in seconds (0 = not output).
+   Sentences left out of an Arduino build by a 0 rate cost no code space at all. */
+
+typedef struct
+  {
+   char id[4];                        /* "RMC", "GGA", ... */
+   int enabled;                       /* TRUE if sentence is output */
+   int rate;                          /* output once every rate seconds */
+   void (*encode23)(gpsepoch *ep);    /* NMEA 2.3 layout */
+   void (*encode20)(gpsepoch *ep);    /* NMEA 2.0 layout */
+  }
+   nmea_sentence;
+
+nmea_sentence sentence_table[] =
+  {
+   { "RMC", (RATE_RMC > 0), RATE_RMC, NMEA_INSTANCES(encode_rmc) },
+   { "GGA", (RATE_GGA > 0), RATE_GGA, NMEA_INSTANCES(encode_gga) },
+   { "GSA", (RATE_GSA > 0), RATE_GSA, encode_gsa, encode_gsa },
+#ifdef HAVE_GSV
+   { "GSV", (RATE_GSV > 0), RATE_GSV, encode_gsv, encode_gsv },
+#endif
+#ifdef HAVE_VTG
+   { "VTG", (RATE_VTG > 0), RATE_VTG, NMEA_INSTANCES(encode_vtg) },
+#endif
+#ifdef HAVE_GLL
+   { "GLL", (RATE_GLL > 0), RATE_GLL, NMEA_INSTANCES(encode_gll) },
+#endif
+#ifdef HAVE_ZDA
+   { "ZDA", (RATE_ZDA > 0), RATE_ZDA, encode_zda, encode_zda },
+#endif
+#ifdef HAVE_PVT
+   { "PVT", (RATE_PVT > 0), RATE_PVT, encode_ubx_pvt, encode_ubx_pvt },
+#endif
+#ifdef HAVE_SAT
+   { "SAT", (RATE_SAT > 0), RATE_SAT, encode_ubx_sat, encode_ubx_sat },
+#endif
+#ifdef HAVE_DOP
+   { "DOP", (RATE_DOP > 0), RATE_DOP, encode_ubx_dop, encode_ubx_dop },
+#endif
+  };
+
+#define NUM_SENTENCES ((int)(sizeof(sentence_table) / sizeof(sentence_table[0])))
+
+/* The enabled sentences are gathered once into the active list, together with
+   the encoder instance for the configured NMEA version, so that the once-per-second 
+   loop touches only sentences actually being output.  With MULTI_PORT a 
+   sentence is in the list once for each port it goes to, at that port's rate. */
+void (*active_encode[NUM_SENTENCES * NUM_PORTS])(gpsepoch *ep);
+int active_rate[NUM_SENTENCES * NUM_PORTS];
+int active_countdown[NUM_SENTENCES * NUM_PORTS];
+#ifdef MULTI_PORT
+int active_port[NUM_SENTENCES * NUM_PORTS];
+#endif
+int num_active = 0;
+
+#ifdef MULTI_PORT
+/* sentence rates on ports 1-3, in sentence_table order */
+int port_rate[NUM_PORTS-1][NUM_SENTENCES] = { PORT1_RATES, PORT2_RATES, PORT3_RATES };
+#endif
+
+
+/* add sentence i of the table to the active list */
+void add_active(int i, int rate, int port)
+  {
+   active_encode[num_active] = (cfg_nmea23 ? sentence_table[i].encode23 
+                                           : sentence_table[i].encode20);
+#ifndef ARDUINO
+   if (cfg_almanac && (sentence_table[i].encode23 == encode_gsv))
+     {
+      active_encode[num_active] = encode_gsv_sky;
+     }
+   if (cfg_almanac && (sentence_table[i].encode23 == encode_ubx_sat))
+     {
+      active_encode[num_active] = encode_ubx_sat_sky;
+     }
+#endif
+#ifdef HAVE_MULTI_GNSS
+   if (GNSS_EXTRA && (sentence_table[i].encode23 == encode_gsa))
+     {
+      active_encode[num_active] = encode_gsa_multi;
+     }
+#ifdef HAVE_GSV
+   if (GNSS_EXTRA && (sentence_table[i].encode23 == encode_gsv))
+     {
+      active_encode[num_active] = encode_gsv_multi;
+     }
+#endif
+#endif
+   active_rate[num_active] = rate;
+   active_countdown[num_active] = 1;     /* output on first second */
+#ifdef MULTI_PORT
+   active_port[num_active] = port;
+#else
+   (void)port;
+#endif
+   num_active++;
+  }
+
+
+void init_sentences(void)
+  {
+   int i;
+#ifdef MULTI_PORT
+   int port;
+#endif
+
+   num_active = 0;
+   for (i=0; i<NUM_SENTENCES; i++)
+     {
+      if (sentence_table[i].enabled && (sentence_table[i].rate > 0))
+        {
+         add_active(i,sentence_table[i].rate,0);
+        }
+     }
+
+#ifdef MULTI_PORT
+   for (port=1; port<NUM_PORTS; port++)
+     {
+      for (i=0; i<NUM_SENTENCES; i++)
+        {
+         if (port_rate[port-1][i] > 0)
+           {
+            add_active(i,port_rate[port-1][i],port);
+           }
+        }
+     }
+#endif
+  }
+
+
+#if defined(ARDUINO) && defined(DUTY_REPORT)
+/* --------------------- PGLFD sentence -------------------- */
+
+/* $PGLFD,secs,pct,pct_run -- proprietary duty cycle report: the seconds 
+   since the last report, and the percentage of time spent outside the idle 
+   waits over those seconds and since the start.  With IDLE_SLEEP each 
+   wake-up in the waits adds IDLE_WAKE_US, so that it is the time awake --
+   what a battery has to be sized for. */
+
+unsigned long duty_from;              /* micros() at the last report */
+unsigned long duty_run_ms = 0;        /* since the start */
+unsigned long duty_run_busy_ms = 0;
+int duty_countdown = DUTY_REPORT;
+
+/* tenths as "12.3" */
+void nmea_tenths(unsigned long val)
+  {
+   nmea_int((long)(val / 10UL),1);
+   nmea_putc('.');
+   nmea_int((long)(val % 10UL),1);
+  }
+
+
+void encode_duty(void)
+  {
+   unsigned long now;
+   unsigned long period_ms;
+   unsigned long busy_us;
+
+   /* micros() wraps after 71 minutes -- the difference is still right */
+   now = micros();
+   period_ms = (now - duty_from) / 1000UL;
+   busy_us = (now - duty_from) - idle_us + idle_wakes * IDLE_WAKE_US;
+   duty_from = now;
+   idle_us = 0;
+   idle_wakes = 0;
+   if (period_ms == 0)
+     {
+      return;
+     }
+
+   duty_run_ms += period_ms;
+   duty_run_busy_ms += busy_us / 1000UL;
+
+   nmea_begin("PGLFD");
+   nmea_putc(',');
+   nmea_int((long)((period_ms + 500UL) / 1000UL),1);
+   nmea_putc(',');
+   nmea_tenths(busy_us / period_ms);                  /* per mille */
+   nmea_putc(',');
+   if (duty_run_ms >= 1000UL)
+     {
+      nmea_tenths(duty_run_busy_ms / (duty_run_ms / 1000UL));
+     }
+   else
+     {
+      nmea_tenths(duty_run_busy_ms * 1000UL / duty_run_ms);
+     }
+   nmea_end();
+  }
+#endif
+
+
+/* output one epoch's worth of sentences -- above 1 Hz, a sentence with a rate
+   of more than 1 second goes out only with the epoch on the whole second */
+void emit_sentences(gpsepoch *ep)
+  {
+   int i;
+
+   for (i=0; i<num_active; i++)
+     {
+      if ((active_rate[i] > 1) && (ep->csec != 0))
+        {
+         continue;
+        }
+      if (--active_countdown[i] <= 0)
+        {
+         active_countdown[i] = active_rate[i];
+#ifdef MULTI_PORT
+         tx_port = active_port[i];
+#endif
+         active_encode[i](ep);
+        }
+     }
+#ifdef MULTI_PORT
+   tx_port = 0;
+#endif
+
+#if defined(ARDUINO) && defined(DUTY_REPORT)
+   if ((ep->csec == 0) && (--duty_countdown <= 0))
+     {
+      duty_countdown = DUTY_REPORT;
+      encode_duty();
+     }
+#endif
+  }
+
+
+
+/* --------- SIMULATION KERNELS ----------------------------------------------------- */
+
+/* The per-second loop for one flight segment is written once, in sim_segment(), with
+   the run-time choices of realtime output, perfect satellite fixes, random wind
+   variation and satellites from an almanac passed as constant flags.  Each combination is instantiated as its own
+   kernel function below, in which the compiler folds the flags away, and select_kernel() 
+   picks one kernel at startup -- so the loop never tests configuration from second to 
+   second.  The Arduino version instantiates only the kernel matching its compile options. 
+   
+   The wind variation is VARY_NONE, VARY_RANDOM (random_vary_pos()) or, on Windows/Linux, 
+   VARY_WIND -- carried along by a gridded wind field (WINDGRID setting, see wind_step()). */
+
+#define VARY_NONE    0
+#define VARY_RANDOM  1
+#define VARY_WIND    2
+
+#if defined(__GNUC__)
+#define KERNEL_BODY static __inline__ __attribute__((always_inline)) void
+#else
+#define KERNEL_BODY static void
+#endif
+
+KERNEL_BODY sim_segment(int k_realtime, int k_perfect, int k_vary, int k_sky)
+  {
+   long lsec;
+   double x,y,z;
+   double dsec;
+
+   gpsepoch epoch;
+   
+   double normlat,normlong;
+   char northsouth,eastwest;
+
+   int nsats;
+   int action, sky;
+   double hdilpos,pdilpos,vdilpos,geoid_height;
+
+   double knots;
+   double track_angle;
+   double magvar_deg;   
+   double norm_magvar;
+   char magvar_eastwest;
+
+   double t_secs;
+   double prior_x_deg;
+   double prior_y_deg;
+   double prior_t_secs;
+   
+   int firstloop;
+
+
+   double fix_x, fix_y, fix_z;      /* as reported -- with the receiver's error */
+
+
+   prior_x_deg = 0.0;
+   prior_y_deg = 0.0;
+   prior_t_secs = 0.0;
+
+
+   /* determine interpolation parameters for flight segment -- calculates a set 
+      of slopes and intercepts (e.g. m and b in: y = mx + b) for each component 
+      dimension x, y, and z which will be used later to interpolate between waypoints */
+   interp_setup();
+   epoch.climb = flt_z_m;          /* the segment's average climb rate */
+#ifndef ARDUINO
+   if (k_vary == VARY_WIND)
+     {
+      wind_setup();
+     }
+#endif
+#ifdef HAVE_SIM_LIBS
+   error_setup();
+#endif
+
+   /* preseed the real-time simulator with clock time */
+   time(&flt_time_previous);
+
+   /* note that in the following loop, output for the FIRST second is skipped 
+      so that it won't be duplicated later -- for simulation purposes, can afford to 
+      miss the very first second (only) if all others are used -- however even the 
+      first one is processed to gather tracking data */
+      
+   firstloop = TRUE;  
+
+   /* will simulate sats coming and going */
+   clear_satellites();
+   nsats = sim_satellites(4,&hdilpos, &vdilpos, &pdilpos);     /* initialize to 3 satellites */
+   
+   for (lsec=flt_last_sec; lsec<=flt_next_sec; lsec++)
+     {
+      /* use slopes and intercepts to interpolate x, y, z data between waypoints */                       
+      dsec = lsec-flt_last_sec;                       
+      x = flt_x_m * dsec + flt_x_b;                      
+      y = flt_y_m * dsec + flt_y_b;                      
+      z = flt_z_m * dsec + flt_z_b;     
+      t_secs = dsec;           
+      
+      /* Apply random variation to x, y, z -- DO NOT apply to either first or last 
+         iterations, taken from original waypoints assumed to be correct. 
+      */
+   
+      if ((k_vary == VARY_RANDOM) && (lsec != flt_last_sec) && (lsec != flt_next_sec))
+        {
+         random_vary_pos(flt_var,&x,&y,&z);
+        }
+#ifndef ARDUINO
+      if (k_vary == VARY_WIND)
+        {
+         /* carried by the wind since the waypoint, steered onto the next one */
+         if (lsec != flt_last_sec)
+           {
+            wind_step(&flt_wind_x,&flt_wind_y,z);
+           }
+         x = flt_wind_x + flt_wind_dx * dsec;
+         y = flt_wind_y + flt_wind_dy * dsec;
+        }
+#endif
+
+                             
+#ifndef ARDUINO
+      magvar_deg = sim_magvar(y,x,z,lsec);
+#else
+      magvar_deg = -1.4;   
+#endif
+      magvar_eastwest = 'E';
+
+      norm_magvar = magvar_deg;
+      if (norm_magvar < 0.000)
+        {
+         norm_magvar = -norm_magvar;
+         magvar_eastwest = 'W';
+        }
+
+#ifndef ARDUINO
+      geoid_height = sim_geoid(y,x);
+#else
+      geoid_height = 47.1;   /* arbitrary -- don't try to simulate this */
+#endif
+
+      if (!firstloop)
+        {
+         /* heading and speed from the segment's motion (see motion_setup()) -- but 
+            random offsets have no velocity of their own, so with those, from delta 
+            x, y, and t since the second before */
+#ifndef ARDUINO
+         if (k_vary == VARY_WIND)
+           {
+            wind_track(&knots, &track_angle);
+           }
+         else
+#endif
+         if (k_vary == VARY_RANDOM)
+           {
+            track_calc(x - prior_x_deg, y - prior_y_deg, 
+                       t_secs - prior_t_secs, y,
+                       &knots, &track_angle);
+           }
+         else
+           {
+            motion_track(t_secs, &knots, &track_angle);
+           }
+
+         /* NOTE:  for now, will ignore what happens if clock gets "behind" due to computer
+                   being too busy to keep up -- pretend it is on schedule.
+                   Later, should force a data droput for each "catch-up" second detected 
+         */          
+
+         /* since the slope of the z regression is in meters and t is in seconds      
+            it happens that flt_z_m is the average climb rate in meters per sec */
+
+         /* also apply any user-entered offset to climb rate for dynamic testing of 
+            onboard computer's response (ballast  drop, etc.) -- note that the user 
+            input is a second-by-second variation which superimposes on the scripted
+            fight path, therefore flt_climb_offset is cumulative for all seconds since 
+            a change is applied to climb rate -- this cumulative offset is added to scripted
+            altitude to get the altitude after user changes have been applied */
+    
+	
+#ifndef ARDUINO
+         if (early_stop)
+           {
+            return;
+           }
+         ckpt_epoch(lsec, 0);
+#endif
+
+	     /* Apply 1-second clock for realtime output (unless no port specified in Windows/Linux) */
+         if (k_realtime)
+           {
+            /* wait until next observed change of second on real time clock */
+            #ifdef ARDUINO		 
+               EVTRACE_BEGIN("wait_seconds");
+               idle_begin();
+               while (!seconds_elapsed())
+                 {
+                  idle_sleep();
+                 } 
+               idle_end();
+               EVTRACE_END("wait_seconds");
+
+               /* the epoch made last time round goes out now, on the second */
+               tx_release();
+            #else
+               if (!ckpt_replay)
+                 {
+                  wait_seconds(1);
+                 }
+			#endif
+           }
+
+        /* NOTE: Workaround is needed for lack of printf() floats in standard Arduino software 
+		   -- they CAN be had via printf(), but must compile with an alternate library and
+           current Arduino software does not OBVIOUSLY support alternate compile flags (they're 
+		   working on it, maybe) -- therefore standard Arduino code can't use %f or %lf formats */
+        
+        /* Arduino's inclusion of avr-libc SHOULD support a dtostrf() function which fills
+           the gap, but MinGW (Windows) DOES NOT have this function.  An emulated function is 
+		   supplied above to allow code for all OSes to use the same method as Arduino. */ 
+           
+
+/* --------- OUTPUT OF NMEA SENTENCES TO SERIAL PORT ---------------------------------- */
+
+         /* GPSSIM simulates acquisition of satellites such that at least some GPS readings
+            are simulated as "missed", with inadequate satellite reception.  This is partly
+            random, partly predetermined.  Acquisition is indicated by a "3" (for 3D) in the 
+            GSA sentence "3D fix" field -- a 1 indicates no fix.
+            
+            Randomly selected readings will be skipped to indicate signal dropouts.  Simulated
+            dropouts will routinely be short, a inute or two, but the simulator will ensure 
+            that at least one dropout in 6 simulated hours exceeds 10 minutes of "no fix" 
+            to allow testing the controller software in handling signal dropouts.
+            
+            When a droput occurs, only a GSA sentence will be output.
+         */   
+
+
+         /* keep satellite list stable for about a minute or two, then randomly change 
+            list -- when, and when the fix drops out, is looked up in the timeline */
+
+         action = tl_action(flt_second++);
+         if (k_perfect && (action & TL_NOFIX))
+           {
+            action = TL_FIX;      /* no dropouts -- the satellites stay */
+           }
+
+         if (action & (TL_NOFIX | TL_FRESH))
+           {
+            clear_satellites();
+            nsats = 0;
+            clear_dilutions(&hdilpos, &vdilpos, &pdilpos);  
+           }
+
+         /* with an almanac the satellites are the ones actually in view each 
+            second, except the fresh random set that ends a dropout */
+         sky = (k_sky && !(action & (TL_NOFIX | TL_FRESH)));
+         if ((action & TL_NEW) && !sky)
+           {
+            /* randomly simulate a list of satellites visible */  
+            nsats = new_satellites(action, &hdilpos, &vdilpos, &pdilpos);
+           }
+#ifdef HAVE_SIM_LIBS
+         if (sky)
+           {
+            nsats = sky_satellites(lsec, x, y, z, &hdilpos, &vdilpos, &pdilpos);
+            if (action & TL_2D)
+              {
+               nsats = sky_satellites_2d(&hdilpos, &vdilpos, &pdilpos);
+              }
+           }
+#endif
+
+         /* the receiver's own error goes on the reported position only, 
+            scaled by this second's dilutions */
+         fix_x = x;
+         fix_y = y;
+         fix_z = z;
+#ifndef ARDUINO
+         sim_error(hdilpos,vdilpos,&fix_x,&fix_y,&fix_z);
+#endif
+
+         /* convert lat, long data back to gps format from decimal degrees */
+         normlat = gps_coord(fix_y);
+         normlong = gps_coord(fix_x);
+         northsouth = 'N';
+         eastwest = 'E';
+         if (normlong < 0.000)
+           {
+            normlong = -normlong;
+            eastwest = 'W';
+           }
+         if (normlat < 0.000)
+           {
+            normlat = -normlat;
+            northsouth = 'S';
+           }
+
+         /* at this point satellites are set up -- the following executes once per second... */  
+         EVTRACE_BEGIN("render_epoch");
+
+         epoch.lsec = lsec;
+         epoch.hhmmss = secs_to_time(lsec);
+         epoch.ddmmyy = secs_to_date(lsec);
+         epoch.normlat = normlat;
+         epoch.normlong = normlong;
+         epoch.northsouth = northsouth;
+         epoch.eastwest = eastwest;
+         epoch.alt = fix_z;
+         epoch.geoid_height = geoid_height;
+         epoch.knots = knots;
+         epoch.track_angle = track_angle;
+         epoch.magvar_deg = magvar_deg;
+         epoch.norm_magvar = norm_magvar;
+         epoch.magvar_eastwest = magvar_eastwest;
+         epoch.status_active = ((flt_fixtype != 1) ? 'A' : 'V');
+         epoch.nsats = nsats;
+         epoch.hdilpos = hdilpos;
+         epoch.vdilpos = vdilpos;
+         epoch.pdilpos = pdilpos;
+         epoch.csec = 0;
+
+         emit_sentences(&epoch);
+         EVTRACE_END("render_epoch");
+        }
+        
+      firstloop = FALSE;  
+            
+      /* NOW FOR THE POINT of isolating the first loop -- hold the first data for deltas */
+      prior_x_deg = x;
+      prior_y_deg = y;
+      prior_t_secs =  t_secs;
+     }
+  }
+
+
+/* --------- FIXED POINT SIMULATION ------------------------------------------------- */
+
+/* sim_segment_fixed() flies the same segment as sim_segment() entirely in long
+   integers, for processors without floating point hardware (Arduino):
+
+      positions are microdegrees and millimeters, stepped from epoch to epoch by 
+         segment slopes in Q16.16 fixed point (fx_ramp)
+      cos(latitude) is interpolated from a table, speed comes from an integer 
+         square root, and the track angle from CORDIC
+      fields are formatted by fixtostr() instead of dtostrf()
+
+   Only the conversion of the waypoints when a segment starts, and the DOPs when
+   the satellites change, use floating point.  Output agrees with sim_segment() to
+   the last digit NMEA reports (rarely one count off where a value rounds the other
+   way).  This leaves enough time for OUTPUT_HZ epochs per second on Arduino.
+   There is no random wind variation or almanac in this pipeline. */
+
+#define FX_ONE 65536L                  /* 1.0 in Q16.16 */
+
+/* CORDIC angles atan(2^-i) in units of 0.0001 degree */
+#define FX_CORDIC_STEPS 16
+
+#ifdef USEFLASH
+long fx_atan_e4[FX_CORDIC_STEPS] PROGMEM =
+#else
+long fx_atan_e4[FX_CORDIC_STEPS] =
+#endif
+  {
+   450000L, 265651L, 140362L, 71250L, 35763L, 17899L, 8952L, 4476L, 
+   2238L, 1119L, 560L, 280L, 140L, 70L, 35L, 17L
+  };
+
+#ifdef USEFLASH
+#define FX_ATAN(i)  ((long)pgm_read_dword(fx_atan_e4 + (i)))
+#else
+#define FX_ATAN(i)  (fx_atan_e4[i])
+#endif
+
+
+/* cos(latitude) times 65536, latitude in microdegrees */
+long fx_cos(long lat_ud)
+  {
+   long step;
+   long frac;
+   long c0;
+
+   if (lat_ud < 0)
+     {
+      lat_ud = -lat_ud;
+     }
+   if (lat_ud >= 90000000L)
+     {
+      return 0L;
+     }
+
+   step = lat_ud / 500000L;
+   frac = lat_ud - step * 500000L;
+   c0 = FX_COS(step);
+
+   /* linear between half degrees -- good to about 1 part in 50000 */
+   return c0 - ((c0 - FX_COS(step + 1)) * frac + 250000L) / 500000L;
+  }
+
+
+/* rounded square root */
+unsigned long fx_sqrt(unsigned long val)
+  {
+   unsigned long root = 0;
+   unsigned long bit = 1UL << 30;
+
+   while (bit > val)
+     {
+      bit >>= 2;
+     }
+
+   while (bit != 0)
+     {
+      if (val >= root + bit)
+        {
+         val -= root + bit;
+         root = (root >> 1) + bit;
+        }
+      else
+        {
+         root >>= 1;
+        }
+      bit >>= 2;
+     }
+
+   if (val > root)
+     {
+      root++;
+     }
+   return root;
+  }
+
+
+/* direction of (east, north) clockwise from north, -180 to +180 degrees in units 
+   of 0.0001 degree, by CORDIC vectoring -- only shifts and adds */
+long fx_atan2(long east, long north)
+  {
+   long x, y, t;
+   long angle = 0L;
+   int i;
+
+   if ((east == 0L) && (north == 0L))
+     {
+      return 0L;
+     }
+
+   /* rotate into the northern half, where CORDIC converges */
+   x = north;
+   y = east;
+   if (x < 0L)
+     {
+      x = -x;
+      y = -y;
+      angle = 1800000L;
+     }
+
+   /* scale up for precision -- CORDIC grows the vector by about 1.65 */
+   while ((x < 0x2000000L) && (y < 0x2000000L) && (y > -0x2000000L))
+     {
+      x <<= 1;
+      y <<= 1;
+     }
+
+   for (i=0; i<FX_CORDIC_STEPS; i++)
+     {
+      t = x;
+      if (y > 0L)
+        {
+         x += (y >> i);
+         y -= (t >> i);
+         angle += FX_ATAN(i);
+        }
+      else
+        {
+         x -= (y >> i);
+         y += (t >> i);
+         angle -= FX_ATAN(i);
+        }
+     }
+
+   if (angle > 1800000L)
+     {
+      angle -= 3600000L;
+     }
+   return angle;
+  }
+
+
+/* a value stepped linearly from one waypoint to the next -- each step adds a
+   whole part and a Q16.16 fraction, so that no multiply is needed per epoch */
+typedef struct
+  {
+   long val;              /* current value */
+   long whole;            /* step, whole part (rounded down) */
+   long frac;             /* step, fraction times FX_ONE */
+   long acc;              /* fraction carried, times FX_ONE */
+  }
+   fx_ramp;
+
+
+void fx_ramp_setup(fx_ramp *r, long from, long to, long nsteps)
+  {
+   long delta;
+   long rem;
+
+   r->val = from;
+   r->acc = FX_ONE / 2;      /* so val is rounded, not truncated */
+   r->whole = 0L;
+   r->frac = 0L;
+
+   if (nsteps <= 0L)
+     {
+      return;
+     }
+
+   delta = to - from;
+   r->whole = delta / nsteps;
+   rem = delta - r->whole * nsteps;
+   if (rem < 0L)
+     {
+      r->whole--;
+      rem += nsteps;
+     }
+   r->frac = (long)((((long long)rem << 16) + nsteps / 2) / nsteps);
+  }
+
+
+void fx_ramp_step(fx_ramp *r)
+  {
+   r->val += r->whole;
+   r->acc += r->frac;
+   if (r->acc >= FX_ONE)
+     {
+      r->val++;
+      r->acc -= FX_ONE;
+     }
+  }
+
+
+/* round to a long count of 10^-digits -- for converting waypoints */
+long fx_from_double(double val, double scale)
+  {
+   val *= scale;
+   if (val < 0.0)
+     {
+      return -(long)(0.5 - val);
+     }
+   return (long)(val + 0.5);
+  }
+
+
+/* speed (tenths of a knot and of a km/h) and track (tenths of a degree) for 
+   the segment's motion of dlat_ud, dlong_ud microdegrees in dsecs seconds, at 
+   latitude lat_ud -- like track_calc() */
+void fx_track_calc(long dlat_ud, long dlong_ud, long dsecs, long lat_ud,
+                   int *knots, int *kmh, int *track)
+  {
+   long east;
+   long north;
+   long angle;
+   unsigned long ue, un, mag, q, r;
+   int shift = 0;
+
+   *knots = 0;
+   *kmh = 0;
+   *track = 0;
+   if (dsecs <= 0L)
+     {
+      return;
+     }
+
+   /* both in microdegrees of latitude -- east shrinks by cos(latitude) */
+   north = dlat_ud;
+   east = (long)(((long long)dlong_ud * fx_cos(lat_ud)) / 65536L);
+
+   if ((east == 0L) && (north == 0L))
+     {
+      return;
+     }
+
+   /* distance -- scaled down if needed so the squares fit */
+   ue = (unsigned long)((east < 0L) ? -east : east);
+   un = (unsigned long)((north < 0L) ? -north : north);
+   while ((ue > 46340UL) || (un > 46340UL))
+     {
+      ue >>= 1;
+      un >>= 1;
+      shift++;
+     }
+   mag = fx_sqrt(ue * ue + un * un) << shift;
+
+   /* microdegrees per second to tenths of a knot: 
+      0.111325 m/ud * 1.94384449 kt/(m/s) * 10 = 2.1640 */
+   q = mag / (unsigned long)dsecs;
+   r = mag - q * (unsigned long)dsecs;
+   *knots = (int)((q * 21640UL + (r * 21640UL) / (unsigned long)dsecs + 5000UL) / 10000UL);
+
+   /* and to tenths of a km/h -- 0.111325 * 3.6 * 10 = 4.0077 */
+   *kmh = (int)((q * 40077UL + (r * 40077UL) / (unsigned long)dsecs + 5000UL) / 10000UL);
+
+   /* true track, with the same convention as track_calc() -- east of the 
+      north-south line is 0 to 180, anything else 180 to 360 */
+   angle = fx_atan2(east,north);
+   if (east > 0L)
+     {
+      *track = (int)((angle + 500L) / 1000L);
+     }
+   else
+     {
+      *track = 3600 - (int)((((angle < 0L) ? -angle : angle) + 500L) / 1000L);
+     }
+  }
+
+
+void fx_dops(gpsepoch *ep, double hdilpos, double vdilpos, double pdilpos)
+  {
+   ep->fx_hdop = (int)fx_from_double(hdilpos,10.0);
+   ep->fx_vdop = (int)fx_from_double(vdilpos,10.0);
+   ep->fx_pdop = (int)fx_from_double(pdilpos,10.0);
+  }
+
+
+/* hhmmss for a simulated seconds count, as secs_to_time() -- the count starts at
+   midnight, so the time of day is just the remainder of a day */
+long fx_hhmmss(long lsec)
+  {
+   long secs;
+   long hr, min;
+
+   secs = lsec % 86400L;
+   hr = secs / 3600L;
+   secs -= hr * 3600L;
+   min = secs / 60L;
+   secs -= min * 60L;
+   return hr * 10000L + min * 100L + secs;
+  }
+
+
+#ifndef ARDUINO
+unsigned long second_ms = 0UL;   /* host_ms() when the second began */
+#endif
+
+/* wait for the epoch sub of the second -- the epochs are paced from the start
+   of the second, by millis() on Arduino and host_ms() on Windows/Linux */
+void wait_epoch(int sub)
+  {
+#ifndef ARDUINO
+   unsigned long due;
+   unsigned long gone;
+#endif
+
+   EVTRACE_BEGIN("wait_seconds");
+
+#ifdef ARDUINO
+   idle_begin();
+   if (sub == 0)
+     {
+      while (!seconds_elapsed())
+        {
+         idle_sleep();
+        } 
+     }
+   else
+     {
+      while ((millis() - last_time) < ((unsigned long)sub * 1000UL) / (unsigned long)flt_hz)
+        {
+         idle_sleep();
+        }
+     }
+   idle_end();
+#else
+   /* no waiting on the way to a checkpoint -- nor within the first second of
+      a run, which didn't begin here */
+   if (!ckpt_replay)
+     {
+      if (sub == 0)
+        {
+         wait_seconds(1);
+         second_ms = host_ms();
+        }
+      else
+        {
+         due = ((unsigned long)sub * 1000UL) / (unsigned long)flt_hz;
+         gone = host_ms() - second_ms;
+         if (gone < due)
+           {
+            sleep_ms(due - gone);
+           }
+        }
+     }
+#endif
+
+   EVTRACE_END("wait_seconds");
+
+#ifdef ARDUINO
+   /* the epoch made last time round goes out now, on its boundary */
+   tx_release();
+#endif
+  }
+
+
+KERNEL_BODY sim_segment_fixed(int k_realtime, int k_perfect)
+  {
+   gpsepoch epoch;
+   fx_ramp lat, lon, alt;
+   long from_lat, from_long;
+   long to_lat, to_long;
+   long from_alt, to_alt;
+   long nsteps, tick;
+   long lsec;
+   long prior_lsec;
+   long prior_day;
+   long dsecs;
+   int sub;
+   int nsats;
+   int action;
+   int knots, kmh, track;
+   double hdilpos,pdilpos,vdilpos;
+
+   EVTRACE_BEGIN("interp_setup");
+
+   /* the only floating point of the segment -- waypoints to fixed point */
+   from_lat = fx_from_double(flt_last_lat,1000000.0);
+   from_long = fx_from_double(flt_last_long,1000000.0);
+
+   to_lat = fx_from_double(flt_next_lat,1000000.0);
+   to_long = fx_from_double(flt_next_long,1000000.0);
+
+   dsecs = flt_next_sec - flt_last_sec;
+   nsteps = dsecs * flt_hz;
+   fx_ramp_setup(&lat,from_lat,to_lat,nsteps);
+   fx_ramp_setup(&lon,from_long,to_long,nsteps);
+   from_alt = fx_from_double(flt_last_alt,1000.0);
+   to_alt = fx_from_double(flt_next_alt,1000.0);
+   fx_ramp_setup(&alt,from_alt,to_alt,nsteps);
+#ifdef HAVE_PVT
+   epoch.fx_climb = ((dsecs > 0L) ? (to_alt - from_alt) / dsecs : 0L);
+#endif
+
+   EVTRACE_END("interp_setup");
+
+   time(&flt_time_previous);
+
+   epoch.fx_magvar = -14;       /* as in sim_segment() */
+#ifndef ARDUINO
+   /* WMM -- once a segment, at its middle */
+   epoch.fx_magvar = (int)fx_from_double(sim_magvar((flt_last_lat + flt_next_lat) / 2.0,
+                                                    (flt_last_long + flt_next_long) / 2.0,
+                                                    (flt_last_alt + flt_next_alt) / 2.0,
+                                                    (flt_last_sec + flt_next_sec) / 2L),10.0);
+#endif
+   epoch.magvar_eastwest = ((epoch.fx_magvar < 0) ? 'W' : 'E');
+   epoch.fx_geoid = 471;
+#ifndef ARDUINO
+   /* and the geoid, likewise */
+   epoch.fx_geoid = (int)fx_from_double(sim_geoid((flt_last_lat + flt_next_lat) / 2.0,
+                                                  (flt_last_long + flt_next_long) / 2.0),10.0);
+#endif
+   knots = 0;
+   kmh = 0;
+   track = 0;
+
+   /* will simulate sats coming and going -- exactly as sim_segment() does */
+   clear_satellites();
+   nsats = sim_satellites(4,&hdilpos, &vdilpos, &pdilpos);
+   fx_dops(&epoch,hdilpos,vdilpos,pdilpos);
+
+   prior_lsec = -1L;
+   prior_day = -1L;
+
+   /* epoch 0 is the last one of the segment before, and is not output */
+   for (tick=1; tick<=nsteps; tick++)
+     {
+      fx_ramp_step(&lat);
+      fx_ramp_step(&lon);
+      fx_ramp_step(&alt);
+
+      lsec = flt_last_sec + tick / flt_hz;
+      sub = (int)(tick % flt_hz);
+
+#ifndef ARDUINO
+      if (early_stop)
+        {
+         return;
+        }
+      ckpt_epoch(lsec, sub);
+#endif
+
+      if (k_realtime)
+        {
+         wait_epoch(sub);
+        }
+
+      /* satellites change on whole seconds, as in sim_segment() */
+      if (sub == 0)
+        {
+         action = tl_action(flt_second++);
+         if (k_perfect && (action & TL_NOFIX))
+           {
+            action = TL_FIX;      /* no dropouts -- the satellites stay */
+           }
+
+         if (action & (TL_NOFIX | TL_FRESH))
+           {
+            clear_satellites();
+            nsats = 0;
+            clear_dilutions(&hdilpos, &vdilpos, &pdilpos);  
+            fx_dops(&epoch,hdilpos,vdilpos,pdilpos);
+           }
+         if (action & TL_NEW)
+           {
+            nsats = new_satellites(action, &hdilpos, &vdilpos, &pdilpos);
+            fx_dops(&epoch,hdilpos,vdilpos,pdilpos);
+           }
+        }
+
+      EVTRACE_BEGIN("render_epoch");
+
+      /* time, speed and track once a second */
+      if (lsec != prior_lsec)
+        {
+         prior_lsec = lsec;
+         epoch.hhmmss = fx_hhmmss(lsec);
+         if (lsec / 86400L != prior_day)
+           {
+            prior_day = lsec / 86400L;
+            epoch.ddmmyy = secs_to_date(lsec);
+           }
+         fx_track_calc(to_lat - from_lat,to_long - from_long,dsecs,lat.val,
+                       &knots,&kmh,&track);
+        }
+
+      epoch.lsec = lsec;
+      epoch.csec = (sub * 100) / flt_hz;
+      epoch.fx_lat = lat.val;
+      epoch.northsouth = 'N';
+      if (lat.val < 0L)
+        {
+         epoch.fx_lat = -lat.val;
+         epoch.northsouth = 'S';
+        }
+      epoch.fx_long = lon.val;
+      epoch.eastwest = 'E';
+      if (lon.val < 0L)
+        {
+         epoch.fx_long = -lon.val;
+         epoch.eastwest = 'W';
+        }
+      epoch.fx_alt = alt.val;
+      epoch.fx_knots = knots;
+      epoch.fx_kmh = kmh;
+      epoch.fx_track = track;
+      epoch.status_active = ((flt_fixtype != 1) ? 'A' : 'V');
+      epoch.nsats = nsats;
+
+      emit_sentences(&epoch);
+      EVTRACE_END("render_epoch");
+     }
+  }
+
+
+/* kernel names are sim_kernel_<realtime><perfect><vary><sky>, and 
+   sim_kernel_fixed_<realtime><perfect> for the fixed point pipeline -- vary is 0, 1 or 2
+   for VARY_NONE, VARY_RANDOM or VARY_WIND */
+#define SIM_KERNEL(rt,perfect,vary,sky) \
+   void sim_kernel_##rt##perfect##vary##sky(void) { sim_segment(rt,perfect,vary,sky); }
+
+#define SIM_KERNEL_FIXED(rt,perfect) \
+   void sim_kernel_fixed_##rt##perfect(void) { sim_segment_fixed(rt,perfect); }
+
+#ifdef ARDUINO
+
+/* (no almanac on Arduino) */
+#if defined(FIXED_POINT) && defined(USE_RANDOM_VARY)
+#error FIXED_POINT has no random wind variation -- undefine USE_RANDOM_VARY
+#elif defined(FIXED_POINT) && defined(REALTIME) && defined(PERFECT_SAT_FIXES)
+SIM_KERNEL_FIXED(1,1)
+#define ARDUINO_KERNEL sim_kernel_fixed_11
+#elif defined(FIXED_POINT) && defined(REALTIME)
+SIM_KERNEL_FIXED(1,0)
+#define ARDUINO_KERNEL sim_kernel_fixed_10
+#elif defined(FIXED_POINT) && defined(PERFECT_SAT_FIXES)
+SIM_KERNEL_FIXED(0,1)
+#define ARDUINO_KERNEL sim_kernel_fixed_01
+#elif defined(FIXED_POINT)
+SIM_KERNEL_FIXED(0,0)
+#define ARDUINO_KERNEL sim_kernel_fixed_00
+#elif defined(REALTIME) && defined(PERFECT_SAT_FIXES) && defined(USE_RANDOM_VARY)
+SIM_KERNEL(1,1,1,0)
+#define ARDUINO_KERNEL sim_kernel_1110
+#elif defined(REALTIME) && defined(PERFECT_SAT_FIXES)
+SIM_KERNEL(1,1,0,0)
+#define ARDUINO_KERNEL sim_kernel_1100
+#elif defined(REALTIME) && defined(USE_RANDOM_VARY)
+SIM_KERNEL(1,0,1,0)
+#define ARDUINO_KERNEL sim_kernel_1010
+#elif defined(REALTIME)
+SIM_KERNEL(1,0,0,0)
+#define ARDUINO_KERNEL sim_kernel_1000
+#elif defined(PERFECT_SAT_FIXES) && defined(USE_RANDOM_VARY)
+SIM_KERNEL(0,1,1,0)
+#define ARDUINO_KERNEL sim_kernel_0110
+#elif defined(PERFECT_SAT_FIXES)
+SIM_KERNEL(0,1,0,0)
+#define ARDUINO_KERNEL sim_kernel_0100
+#elif defined(USE_RANDOM_VARY)
+SIM_KERNEL(0,0,1,0)
+#define ARDUINO_KERNEL sim_kernel_0010
+#else
+SIM_KERNEL(0,0,0,0)
+#define ARDUINO_KERNEL sim_kernel_0000
+#endif
+
+void (*active_kernel)(void) = ARDUINO_KERNEL;
+
+void select_kernel(void)
+  {
+   active_kernel = ARDUINO_KERNEL;
+  }
+
+#else
+
+SIM_KERNEL(0,0,0,0)
+SIM_KERNEL(0,0,0,1)
+SIM_KERNEL(0,0,1,0)
+SIM_KERNEL(0,0,1,1)
+SIM_KERNEL(0,1,0,0)
+SIM_KERNEL(0,1,0,1)
+SIM_KERNEL(0,1,1,0)
+SIM_KERNEL(0,1,1,1)
+SIM_KERNEL(1,0,0,0)
+SIM_KERNEL(1,0,0,1)
+SIM_KERNEL(1,0,1,0)
+SIM_KERNEL(1,0,1,1)
+SIM_KERNEL(1,1,0,0)
+SIM_KERNEL(1,1,0,1)
+SIM_KERNEL(1,1,1,0)
+SIM_KERNEL(1,1,1,1)
+SIM_KERNEL(0,0,2,0)
+SIM_KERNEL(0,0,2,1)
+SIM_KERNEL(0,1,2,0)
+SIM_KERNEL(0,1,2,1)
+SIM_KERNEL(1,0,2,0)
+SIM_KERNEL(1,0,2,1)
+SIM_KERNEL(1,1,2,0)
+SIM_KERNEL(1,1,2,1)
+
+SIM_KERNEL_FIXED(0,0)
+SIM_KERNEL_FIXED(0,1)
+SIM_KERNEL_FIXED(1,0)
+SIM_KERNEL_FIXED(1,1)
+
+/* indexed by (realtime * 12) + (perfect * 6) + (vary * 2) + sky */
+void (*kernel_table[24])(void) =
+  {
+   sim_kernel_0000, sim_kernel_0001, sim_kernel_0010, sim_kernel_0011, sim_kernel_0020, sim_kernel_0021,
+   sim_kernel_0100, sim_kernel_0101, sim_kernel_0110, sim_kernel_0111, sim_kernel_0120, sim_kernel_0121,
+   sim_kernel_1000, sim_kernel_1001, sim_kernel_1010, sim_kernel_1011, sim_kernel_1020, sim_kernel_1021,
+   sim_kernel_1100, sim_kernel_1101, sim_kernel_1110, sim_kernel_1111, sim_kernel_1120, sim_kernel_1121
+  };
+
+/* indexed by (realtime * 2) + perfect */
+void (*fixed_kernel_table[4])(void) =
+  {
+   sim_kernel_fixed_00, sim_kernel_fixed_01, sim_kernel_fixed_10, sim_kernel_fixed_11
+  };
+
+void (*active_kernel)(void) = sim_kernel_0000;
+
+/* call once the configuration is final -- flt_realtime must already reflect 
+   whether there is a port to pace, and flt_fixed the choice of pipeline --
+   also picks the magnetic variation, geoid and receiver error functions */
+void select_kernel(void)
+  {
+#ifdef HAVE_SIM_LIBS
+   sim_magvar = (cfg_wmm ? magvar_model : magvar_fixed);
+   sim_geoid = (cfg_geoid ? geoid_model : geoid_fixed);
+   sim_error = (cfg_error_model ? error_add : error_none);
+#endif
+
+   if (flt_fixed)
+     {
+      active_kernel = fixed_kernel_table[((flt_realtime != 0) * 2) 
+                                         + (cfg_perfect_sat_fixes != 0)];
+      return;
+     }
+
+   active_kernel = kernel_table[((flt_realtime != 0) * 12) 
+                                + ((cfg_perfect_sat_fixes != 0) * 6) 
+                                + (cfg_windgrid ? (VARY_WIND * 2) : ((cfg_random_vary > 0) * 2))
+                                + (cfg_almanac != 0)];
+  }
+
+#endif
+
+
+
+#ifdef PACKED_SCRIPT
+
+/* ------- waypoints packed by linux/lvl1/wppack (see wppack.c for the format) ------- */
+
+#ifdef USEFLASH
+#define WP_BYTE(i)  pgm_read_byte(packed_script + (i))
+#else
+#define WP_BYTE(i)  (packed_script[i])
+#endif
+
+unsigned long wp_varint(void)
+  {
+   unsigned long val = 0;
+   unsigned char shift = 0;
+   unsigned char b;
+
+   do
+     {
+      b = WP_BYTE(wp_pos++);
+      val |= (unsigned long)(b & 0x7F) << shift;
+      shift += 7;
+     }
+   while (b & 0x80);
+   return val;
+  }
+
+
+long wp_zigzag(void)
+  {
+   unsigned long u;
+
+   u = wp_varint();
+   return ((u & 1UL) ? -(long)(u >> 1) - 1L : (long)(u >> 1));
+  }
+
+
+/* next waypoint, decoded from flash as it is needed -- no table in RAM.  The 
+   scaled integers divide back to exactly the numbers given to wppack.  
+   Returns 0 at the end of the list. */
+int wp_next(long *date, long *time, double *lat, double *lon, double *alt)
+  {
+   long secs;
+
+   if (wp_pos == 0)
+     {
+      wp_date = (long)wp_varint();
+      wp_time = (long)wp_varint();
+     }
+   else
+     {
+      secs = wp_zigzag();
+      if (secs == 0L)
+        {
+         return 0;
+        }
+      secs += date_secs(wp_date) + time_secs(wp_time);
+      wp_date = secs_to_date(secs);
+      wp_time = secs_to_time(secs);
+     }
+
+   wp_lat += wp_zigzag();
+   wp_long += wp_zigzag();
+   wp_alt += wp_zigzag();
+
+   *date = wp_date;
+   *time = wp_time;
+   *lat = (double)wp_lat / 1000.0;
+   *lon = (double)wp_long / 1000.0;
+   *alt = (double)wp_alt / 10.0;
+   return 1;
+  }
+
+#else
+
+/* next waypoint from the date_time[] and lat_long_alt[] tables -- returns 0
+   at the end of the list */
+int tbl_next(long *date, long *time, double *lat, double *lon, double *alt)
+  {
+   int dt_pos;
+   int lla_pos;
+   long d_temp;
+
+   /* get data for simulator -- equivalent to extracting data from 
+      original balscript line */
+      
+   dt_pos = flt_datapos + flt_datapos;
+   lla_pos = flt_datapos + flt_datapos + flt_datapos;
+
+
+#ifdef USEFLASH
+   d_temp = (long)pgm_read_dword(date_time+dt_pos);   
+#else   
+   d_temp = date_time[dt_pos];   
+#endif
+      
+   if (d_temp == 0)
+     {
+      return 0;   
+     }
+
+
+#ifdef USEFLASH
+   *date = (long)pgm_read_dword(date_time+dt_pos);   
+   *time = (long)pgm_read_dword(date_time+dt_pos+1);   
+#else
+   *date = date_time[dt_pos];   
+   *time = date_time[dt_pos+1];   
+#endif
+
+
+#ifdef USEFLASH
+   *lat = (float)pgm_read_float(lat_long_alt + lla_pos);   
+   *lon = (float)pgm_read_float(lat_long_alt + lla_pos + 1);   
+   *alt = (float)pgm_read_float(lat_long_alt + lla_pos + 2);   
+#else
+   *lat = lat_long_alt[lla_pos];   
+   *lon = lat_long_alt[lla_pos + 1];   
+   *alt = lat_long_alt[lla_pos + 2];   
+#endif
+
+   flt_datapos++;
+   return 1;
+  }
+
+#endif
+
+#ifdef PACKED_SCRIPT
+#define script_next wp_next
+#else
+#define script_next tbl_next
+#endif
+
+
+#ifndef ARDUINO
+
+/* next waypoint of the flight flown by the balloon flight model, as if read
+   from the tables -- returns 0 at the end of the track */
+int flight_next(long *date, long *time, double *lat, double *lon, double *alt)
+  {
+   long secs;
+
+   if (flt_trackpos >= flt_track.count)
+     {
+      return 0;
+     }
+
+   if (flt_trackpos == 0)
+     {
+      *date = flt_model.date;
+      *time = flt_model.time;
+     }
+   else
+     {
+      secs = date_secs(flt_model.date) + time_secs(flt_model.time) + flt_track.secs[flt_trackpos];
+      *date = secs_to_date(secs);
+      *time = secs_to_time(secs);
+     }
+
+   *lat = gps_coord(flt_track.lat[flt_trackpos]);
+   *lon = gps_coord(flt_track.lon[flt_trackpos]);
+   *alt = flt_track.alt[flt_trackpos];
+   flt_trackpos++;
+   return 1;
+  }
+
+#endif
+
+
+/* This function is called once per script line -- note that each script line
+   may represent many seconds (even perhaps hours) of simulated balloon flight
+   and so each call to this function will cause output of many lines
+   od\f data.  To continue looping, returns nonzero -- a 0 specifies loop is 
+   finished. 
+*/
+
+int process_script(void)
+  {
+   double d_lat,d_long,d_alt;
+   long d_date, d_time;
+
+
+#ifdef DEBUG_OUTPUT  
+   char out_strg[120];
+   char st_lat[BUFFLIMIT], st_long[BUFFLIMIT], st_alt[BUFFLIMIT];
+#endif
+
+
+   /* check for keywords first */  
+   
+   /* The default is that the random generator gives the same sequence for 
+      each run.  A user may optionally invoke "Random" in the script 
+      to change this behavior.  
+      Random 0 or without a parameter causes a time-based random seed different 
+      for each run.  Random with any nonzero parameter will set a repeatable 
+      random seed useful for replication of simulations (default case uses 1).
+   */   
+
+   /* assume is a normal script line with flight sim waypoint data */  
+
+    
+   /* advance simulator to next flight segment -- each line represents a waypoint
+      with date/time and position x, y, and z -- the simulator will interpolate 
+      between waypoints for each second of simulated flight -- convert lat, long 
+      data (y, x) to decimal degrees as it is read in */
+   flt_last_date = flt_next_date;
+   flt_last_time = flt_next_time;
+   flt_last_lat = flt_next_lat;
+   flt_last_long = flt_next_long;
+   flt_last_alt = flt_next_alt;
+   
+#ifndef ARDUINO
+   /* or from the balloon flight model (FLIGHT setting) */
+   if (cfg_flight)
+     {
+      if (!flight_next(&d_date,&d_time,&d_lat,&d_long,&d_alt))
+        {
+         return 0;
+        }
+     }
+   else
+#endif
+   if (!script_next(&d_date,&d_time,&d_lat,&d_long,&d_alt))
+     {
+      return 0;
+     }
+
+#ifdef DEBUG_OUTPUT  
+   dtostrf_chop(d_lat,-8,3,st_lat);
+   dtostrf_chop(d_long,-8,3,st_long);
+   dtostrf_chop(d_alt,-8,3,st_alt);
+   
+   sprintf(out_strg,"lat=%s long=%s alt=%s",
+                st_lat,st_long,st_alt);
+   com_string_crlf(portspec,out_strg);
+#endif
+
+   flt_next_date = d_date;
+   flt_next_time = d_time;
+
+   flt_next_lat  = deg_coord(d_lat);
+   flt_next_long = deg_coord(d_long);
+
+   flt_next_alt  = d_alt;
+   
+
+   /* convert combination dates/times numbers of seconds elapsed 
+      since the beginning of the first year encountered */   
+   flt_last_sec = date_secs(flt_last_date) + time_secs(flt_last_time);   
+   flt_next_sec = date_secs(flt_next_date) + time_secs(flt_next_time);   
+   
+   /* if this is first pass through this function, there is not enough 
+      data to interpolate yet, so bypass processing */
+   if (flt_firstpass)
+     {
+      flt_firstpass = FALSE;               
+      return 1;
+     }   
+     
+   flt_firstpass = FALSE;               
+      
+
+
+   /* simulate all outputs for entire flight segment -- generate readings for all 
+      interpolated positions between specified "last" and "next" locations, using 
+      the simulation kernel selected for the run-time configuration (which sets up
+      its own interpolation first) */
+   active_kernel();
+
+   return 1;
+  }
+
+
+#ifndef ARDUINO
+
+/* ------- Windows/Linux only -- Monte Carlo landing footprint (ENSEMBLE) ---------------
+
+   ENSEMBLE=n flies n copies of the flight instead of sending NMEA.  Each one
+   follows the waypoints (tables, packed script or FLIGHT model) with its own
+   gusts, drawn each second from rnd_offset_deg[] times RANDOM_VARY just as
+   random_vary_pos() draws them -- but here each gust moves the balloon for
+   good, so that the gusts add up over the flight the way they would on a real
+   balloon drifting with the air.  On the way down a flight lands the second
+   its altitude reaches that of the last waypoint, so altitude gusts move the
+   landing along the track as well.
+
+   A flight keeps only its drift and its own random state, and only where it
+   landed is kept, so the flights are shared out over THREADS threads (default
+   one per processor) with no locking.  The landings are summed up as percentile
+   ellipses around their mean (from the covariance, assuming a 2-D normal spread),
+   each with the share of flights actually inside it, and as a grid of landing
+   counts in cells of ENSEMBLE_CELL meters, written to ENSEMBLE_GRID if given.
+*/
+
+#define ENS_MAX_THREADS  64
+#define ENS_MAX_CELLS   200      /* grid is at most this many cells each way */
+
+int cfg_ensemble = 0;
+int cfg_threads = 0;             /* 0 = one per processor */
+double cfg_ensemble_cell = 250.0;
+char ensemble_gridname[65] = "";
+
+typedef struct
+  {
+   int count;                    /* waypoints */
+   long *secs;
+   double *lat;                  /* degrees */
+   double *lon;
+   double *alt;                  /* meters */
+   int descent;                  /* first waypoint of the final descent */
+  }
+   ens_track;
+
+ens_track ens_wp;
+double *ens_land_lat;
+double *ens_land_lon;
+long *ens_land_secs;
+
+typedef struct
+  {
+   int first;                    /* flights first, first+step, ... */
+   int step;
+  }
+   ens_share;
+
+
+#ifdef HAVE_SIM_LIBS
+/* as random_index(), but from a state of its own -- the 15 bit rand() of
+   the C standard's example, so every flight has an independent stream */
+unsigned int ens_random_index(unsigned long *state, unsigned int range)
+  {
+   unsigned long r;
+
+   *state = (*state * 1103515245UL + 12345UL) & 0xFFFFFFFFUL;
+   r = (*state >> 16) & 0x7FFFUL;
+   return (unsigned int)((r * (unsigned long)range) >> 15);
+  }
+
+
+/* read the whole waypoint list, as process_script() would */
+int ens_load_track(ens_track *trk)
+  {
+   long d_date, d_time;
+   double d_lat, d_long, d_alt;
+   int more, size, i;
+
+   open_script();
+   memset(trk,0,sizeof(ens_track));
+   size = 0;
+
+   for (;;)
+     {
+      if (cfg_flight)
+        {
+         more = flight_next(&d_date,&d_time,&d_lat,&d_long,&d_alt);
+        }
+      else
+        {
+         more = script_next(&d_date,&d_time,&d_lat,&d_long,&d_alt);
+        }
+      if (!more)
+        {
+         break;
+        }
+
+      if (trk->count >= size)
+        {
+         size += 256;
+         trk->secs = (long *)realloc(trk->secs,size * sizeof(long));
+         trk->lat = (double *)realloc(trk->lat,size * sizeof(double));
+         trk->lon = (double *)realloc(trk->lon,size * sizeof(double));
+         trk->alt = (double *)realloc(trk->alt,size * sizeof(double));
+         if ((trk->secs == NULL) || (trk->lat == NULL) || (trk->lon == NULL) || (trk->alt == NULL))
+           {
+            return 0;
+           }
+        }
+      trk->secs[trk->count] = date_secs(d_date) + time_secs(d_time);
+      trk->lat[trk->count] = deg_coord(d_lat);
+      trk->lon[trk->count] = deg_coord(d_long);
+      trk->alt[trk->count] = d_alt;
+      trk->count++;
+     }
+   close_script();
+
+   /* the final descent starts at the highest waypoint */
+   trk->descent = 0;
+   for (i=1; i<trk->count; i++)
+     {
+      if (trk->alt[i] >= trk->alt[trk->descent])
+        {
+         trk->descent = i;
+        }
+     }
+   return trk->count;
+  }
+
+
+/* fly flights first, first+step, ... to the ground */
+void *ens_fly(void *arg)
+  {
+   ens_share *share;
+   ens_track *trk;
+   unsigned long state;
+   double dx, dy, dz, f, ground;
+   long s, dsecs, secs;
+   int i, j, landed;
+
+   share = (ens_share *)arg;
+   trk = &ens_wp;
+   ground = trk->alt[trk->count-1];
+
+   for (i=share->first; i<cfg_ensemble; i+=share->step)
+     {
+      /* independent seed for each flight, repeatable from RANDOM_SEED */
+      state = ((unsigned long)flt_randomseed * 2654435761UL + (unsigned long)i * 40503UL) & 0xFFFFFFFFUL;
+      ens_random_index(&state,100);
+
+      dx = 0.0;
+      dy = 0.0;
+      dz = 0.0;
+      landed = FALSE;
+      secs = trk->secs[trk->count-1];
+
+      for (j=0; (j < trk->count - 1) && !landed; j++)
+        {
+         dsecs = trk->secs[j+1] - trk->secs[j];
+         for (s=1; s<=dsecs; s++)
+           {
+            /* one second's gust in each axis, as random_vary_pos() -- the
+               east gust is as many meters as the north one, so it is scaled
+               to degrees of longitude at the balloon's latitude, as
+               wind_step() does */
+            f = (double)s / dsecs;
+            dy += rnd_offset_deg[ens_random_index(&state,100)] * flt_var;
+            dx += rnd_offset_deg[ens_random_index(&state,100)] * flt_var
+                    / cos_safe(trk->lat[j] + (trk->lat[j+1] - trk->lat[j]) * f + dy);
+            dz += rnd_offset_deg[ens_random_index(&state,100)] * flt_var
+                                       * METERS_PER_DEG_LAT * Z_ATTENUATE;
+
+            if ((j >= trk->descent) &&
+                (trk->alt[j] + (trk->alt[j+1] - trk->alt[j]) * s / dsecs + dz <= ground))
+              {
+               ens_land_lat[i] = trk->lat[j] + (trk->lat[j+1] - trk->lat[j]) * f + dy;
+               ens_land_lon[i] = trk->lon[j] + (trk->lon[j+1] - trk->lon[j]) * f + dx;
+               secs = trk->secs[j] + s;
+               landed = TRUE;
+               break;
+              }
+           }
+        }
+
+      if (!landed)
+        {
+         ens_land_lat[i] = trk->lat[trk->count-1] + dy;
+         ens_land_lon[i] = trk->lon[trk->count-1] + dx;
+        }
+      ens_land_secs[i] = secs - trk->secs[0];
+     }
+   return NULL;
+  }
+
+
+void ens_run_threads(int nthreads)
+  {
+   ens_share share[ENS_MAX_THREADS];
+   int t;
+#if !defined(__MINGW32__)
+   pthread_t thread[ENS_MAX_THREADS];
+   int started[ENS_MAX_THREADS];
+#endif
+
+   for (t=0; t<nthreads; t++)
+     {
+      share[t].first = t;
+      share[t].step = nthreads;
+     }
+
+#if defined(__MINGW32__)
+   for (t=0; t<nthreads; t++)
+     {
+      ens_fly(&share[t]);
+     }
+#else
+   /* thread 0's share is flown here, and any share whose thread won't start */
+   for (t=1; t<nthreads; t++)
+     {
+      started[t] = (pthread_create(&thread[t],NULL,ens_fly,&share[t]) == 0);
+     }
+   ens_fly(&share[0]);
+   for (t=1; t<nthreads; t++)
+     {
+      if (started[t])
+        {
+         pthread_join(thread[t],NULL);
+        }
+      else
+        {
+         ens_fly(&share[t]);
+        }
+     }
+#endif
+  }
+
+
+/* latitude and longitude of a point east, north of the mean landing */
+void ens_place(wgs_frame *here, double east, double north, double *lat, double *lon)
+  {
+   double up = 0.0;
+   double alt;
+
+   wgs_enu_to_lla(here,1,&east,&north,&up,lat,lon,&alt);
+  }
+
+
+/* landing grid of counts, north row first */
+void ens_write_grid(wgs_frame *here, double cell,
+                    double east_lo, double north_lo, int ncols, int nrows, int counts[])
+  {
+   FILE *unit;
+   double lat, lon;
+   int r, c;
+
+   unit = fopen(ensemble_gridname,"w");
+   if (unit == NULL)
+     {
+      printf("Can't write %s\n",ensemble_gridname);
+      return;
+     }
+   fprintf(unit,"# landings of %d flights -- %d columns (west to east) by %d rows (north to south)\n",
+           cfg_ensemble,ncols,nrows);
+   ens_place(here,east_lo + 0.5 * cell,north_lo + 0.5 * cell,&lat,&lon);
+   fprintf(unit,"# cell %.0f m, center of the southwest cell lat %.6f long %.6f\n",cell,lat,lon);
+   for (r=nrows-1; r>=0; r--)
+     {
+      for (c=0; c<ncols; c++)
+        {
+         fprintf(unit,"%s%d",(c ? " " : ""),counts[r * ncols + c]);
+        }
+      fprintf(unit,"\n");
+     }
+   fclose(unit);
+   printf("Landing grid written to %s\n",ensemble_gridname);
+  }
+
+
+void ens_summarize(void)
+  {
+   static double pct[4] = { 50.0, 90.0, 95.0, 99.0 };
+   double lat0, lon0, e, n, see, snn, sen, l1, l2, half, root, angle, k;
+   double east_lo, east_hi, north_lo, north_hi, cell, m, secs_sum;
+   double ca, sa, u, v, lat, lon;
+   double *east, *north, *up;
+   wgs_frame here;
+   int *counts;
+   int i, p, inside, ncols, nrows, c, r, best;
+
+   /* mean landing, then spread about it in meters east and north */
+   lat0 = 0.0;
+   lon0 = 0.0;
+   secs_sum = 0.0;
+   for (i=0; i<cfg_ensemble; i++)
+     {
+      lat0 += ens_land_lat[i];
+      lon0 += ens_land_lon[i];
+      secs_sum += ens_land_secs[i];
+     }
+   lat0 /= cfg_ensemble;
+   lon0 /= cfg_ensemble;
+
+   /* every landing into meters east, north (and up -- the earth's curve) on 
+      the WGS 84 ellipsoid at the mean landing, in one batch */
+   east = (double *)malloc(cfg_ensemble * sizeof(double));
+   north = (double *)malloc(cfg_ensemble * sizeof(double));
+   up = (double *)malloc(cfg_ensemble * sizeof(double));
+   if ((east == NULL) || (north == NULL) || (up == NULL))
+     {
+      printf("Out of memory for %d landings\n",cfg_ensemble);
+      free(east);
+      free(north);
+      free(up);
+      return;
+     }
+   wgs_frame_set(&here,lat0,lon0,0.0);
+   wgs_lla_to_enu(&here,cfg_ensemble,ens_land_lat,ens_land_lon,NULL,east,north,up);
+
+   see = snn = sen = 0.0;
+   east_lo = north_lo = 1e30;
+   east_hi = north_hi = -1e30;
+   for (i=0; i<cfg_ensemble; i++)
+     {
+      e = east[i];
+      n = north[i];
+      see += e * e;
+      snn += n * n;
+      sen += e * n;
+      east_lo = (e < east_lo) ? e : east_lo;
+      east_hi = (e > east_hi) ? e : east_hi;
+      north_lo = (n < north_lo) ? n : north_lo;
+      north_hi = (n > north_hi) ? n : north_hi;
+     }
+   see /= cfg_ensemble;
+   snn /= cfg_ensemble;
+   sen /= cfg_ensemble;
+
+   /* principal axes of the covariance */
+   half = 0.5 * (see + snn);
+   root = sqrt(0.25 * (see - snn) * (see - snn) + sen * sen);
+   l1 = half + root;
+   l2 = half - root;
+   l2 = (l2 > 0.0) ? l2 : 0.0;
+   angle = 0.5 * atan2(2.0 * sen,see - snn);       /* major axis, from east */
+   ca = cos(angle);
+   sa = sin(angle);
+
+   printf("\n%d flights landed around %s %.6f %s %.6f, %.0f s after the first waypoint (mean)\n",
+          cfg_ensemble,((lat0 < 0.0) ? "S" : "N"),fabs(lat0),((lon0 < 0.0) ? "W" : "E"),fabs(lon0),
+          secs_sum / cfg_ensemble);
+   printf("major axis bearing %.0f deg true\n",fmod(450.0 - angle * RAD_TO_DEG,180.0));
+   printf("  pct   semi-major m   semi-minor m   flights inside\n");
+
+   for (p=0; p<4; p++)
+     {
+      k = sqrt(-2.0 * log(1.0 - pct[p] / 100.0));
+      inside = 0;
+      for (i=0; i<cfg_ensemble; i++)
+        {
+         e = east[i];
+         n = north[i];
+         u = e * ca + n * sa;
+         v = n * ca - e * sa;
+         if (((l1 > 0.0) ? u * u / l1 : 0.0) + ((l2 > 0.0) ? v * v / l2 : 0.0) <= k * k)
+           {
+            inside++;
+           }
+        }
+      printf("  %3.0f   %12.0f   %12.0f   %6.1f%%\n",pct[p],k * sqrt(l1),k * sqrt(l2),
+             100.0 * inside / cfg_ensemble);
+     }
+
+   /* density grid -- cells grow if the spread would need too many */
+   cell = cfg_ensemble_cell;
+   m = ((east_hi - east_lo) > (north_hi - north_lo)) ? (east_hi - east_lo) : (north_hi - north_lo);
+   if (m / cell >= ENS_MAX_CELLS)
+     {
+      cell = m / (ENS_MAX_CELLS - 1);
+     }
+   ncols = (int)((east_hi - east_lo) / cell) + 1;
+   nrows = (int)((north_hi - north_lo) / cell) + 1;
+   counts = (int *)calloc(ncols * nrows,sizeof(int));
+   if (counts == NULL)
+     {
+      free(east);
+      free(north);
+      free(up);
+      return;
+     }
+   for (i=0; i<cfg_ensemble; i++)
+     {
+      c = (int)((east[i] - east_lo) / cell);
+      r = (int)((north[i] - north_lo) / cell);
+      counts[r * ncols + c]++;
+     }
+
+   best = 0;
+   for (i=1; i<ncols*nrows; i++)
+     {
+      best = (counts[i] > counts[best]) ? i : best;
+     }
+   ens_place(&here,east_lo + ((best % ncols) + 0.5) * cell,north_lo + ((best / ncols) + 0.5) * cell,
+             &lat,&lon);
+   printf("densest %.0f m cell: %d flights at %.6f %.6f\n",cell,counts[best],lat,lon);
+
+   if (ensemble_gridname[0])
+     {
+      ens_write_grid(&here,cell,east_lo,north_lo,ncols,nrows,counts);
+     }
+   free(counts);
+   free(east);
+   free(north);
+   free(up);
+  }
+
+
+int run_ensemble(void)
+  {
+   int nthreads;
+
+   if (cfg_random_vary <= 0)
+     {
+      printf("ENSEMBLE needs RANDOM_VARY above 0 -- the flights would all be the same\n");
+      return 0;
+     }
+   if (ens_load_track(&ens_wp) < 2)
+     {
+      printf("ENSEMBLE needs at least 2 waypoints\n");
+      return 0;
+     }
+   ens_land_lat = (double *)malloc(cfg_ensemble * sizeof(double));
+   ens_land_lon = (double *)malloc(cfg_ensemble * sizeof(double));
+   ens_land_secs = (long *)malloc(cfg_ensemble * sizeof(long));
+   if ((ens_land_lat == NULL) || (ens_land_lon == NULL) || (ens_land_secs == NULL))
+     {
+      printf("Out of memory for %d flights\n",cfg_ensemble);
+      return 0;
+     }
+
+   nthreads = cfg_threads;
+#if !defined(__MINGW32__)
+   if (nthreads <= 0)
+     {
+      nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+     }
+#endif
+   if (nthreads <= 0)
+     {
+      nthreads = 1;
+     }
+   if (nthreads > ENS_MAX_THREADS)
+     {
+      nthreads = ENS_MAX_THREADS;
+     }
+   if (nthreads > cfg_ensemble)
+     {
+      nthreads = cfg_ensemble;
+     }
+
+   printf("Ensemble of %d flights over %d waypoints (%ld s), RANDOM_VARY %d, %d thread%s\n",
+          cfg_ensemble,ens_wp.count,ens_wp.secs[ens_wp.count-1] - ens_wp.secs[0],flt_var,
+          nthreads,((nthreads > 1) ? "s" : ""));
+
+   ens_run_threads(nthreads);
+   ens_summarize();
+   return 1;
+  }
+#endif
+
+#endif
+
+
+#ifndef ARDUINO
+
+/* ------- Windows/Linux only -- run-time configuration --------------------------------
+
+   Settings are given as KEYWORD=value on the command line, or one per line as
+   KEYWORD value (or KEYWORD=value) in a configuration file named by CONFIG=file.  
+   Keywords are not case sensitive, and a line starting with # or ; is a comment.  
+   Settings are applied in order, so later ones override earlier ones.
+
+      PORT n                  serial port 1-8 (0 = output to screen)
+      BAUD n                  2400, 4800, 9600, 19200, 38400, 57600 or 115200
+      TRACE file              write an event trace file
+      REALTIME on|off         one output group per second (needs a PORT)
+      NMEA 23|20              NMEA version 2.3 or 2.0 sentence layouts
+      PERFECT_SAT_FIXES on|off
+      RANDOM_VARY n           random wind variation 0 (none) to 100
+      STABLE_SAT_SECONDS n    seconds before satellite list changes
+      DROPOUT_SAT_SECONDS n   length of long reception dropout
+      DROPOUT_CYCLES n        satellite list changes between long dropouts
+      SCENARIO file           when the satellites change and the fix is 2D or lost,
+                              from a file (instead of the three above) -- turns
+                              PERFECT_SAT_FIXES off
+      RANDOM_SEED n           seed for rand()
+      ALMANAC file            YUMA or SEM almanac -- report satellites in view
+      ELEVATION_MASK deg      lowest satellite reported (default 5)
+      LEAP_SECONDS n          GPS-UTC seconds for almanac time (default 14)
+      GNSS list               satellite systems -- GPS and any of GLONASS, GALILEO
+                              and BEIDOU, e.g. GPS,GLONASS,GALILEO (default GPS)
+      FLIGHT file             fly the balloon described in file (flight model)
+                              instead of the built-in waypoints
+      WINDGRID file           winds on a lat/long/altitude grid carry the position
+                              between waypoints (instead of RANDOM_VARY)
+      WMM file                World Magnetic Model coefficients (WMM.COF) for the
+                              RMC magnetic variation (default a fixed 1.4 W)
+      MAGVAR_KM km            sum the model again after moving this far (default 5)
+      MAGVAR_SECS n           or after this many seconds (default 3600)
+      GEOID file              EGM2008 binary or EGM96 ASCII geoid grid for the GGA
+                              geoid height (default a fixed 47.1 m)
+      ERROR m                 receiver error -- 1 sigma range error (times the DOP)
+                              of a slowly wandering (Gauss-Markov) error
+      ERROR_TAU n             its correlation time in seconds (default 120)
+      NOISE m                 and of white noise on each fix (default both 0)
+      ENSEMBLE n              fly n flights with random gusts and sum up where
+                              they land, instead of NMEA output (needs RANDOM_VARY)
+      THREADS n               threads for ENSEMBLE (default one per processor)
+      ENSEMBLE_CELL m         landing grid cell size in meters (default 250)
+      ENSEMBLE_GRID file      write the landing grid
+      FIXED_POINT on|off      integer simulation pipeline (no RANDOM_VARY, WINDGRID,
+                              ALMANAC, ERROR or NOISE)
+      OUTPUT_HZ n             epochs per second 1-10 -- above 1 uses FIXED_POINT
+      RATE_xxx n              output rate of sentence xxx in seconds (0 = off), 
+                              e.g. RATE_VTG 1 -- or of UBX message NAV-xxx, for
+                              RATE_PVT, RATE_SAT and RATE_DOP
+      CHECKPOINT file         save the place reached in file, to RESUME from
+      CHECKPOINT_SECS n       that often, in seconds of output (default 60)
+      RESUME on|off           carry on from the CHECKPOINT file after a stop --
+                              --resume on the command line is the same
+      CONFIG file             read settings from file
+*/
+
+/* a list of satellite systems, e.g. "gps,glonass" or "gps+galileo" -- GPS 
+   is always in.  Returns the GNSS_ bits, 0 for a name not known. */
+int gnss_systems(char strg[])
+  {
+   static const char *names[GNSS_NUM] = { "gps", "glonass", "galileo", "beidou" };
+   char name[20];
+   int mask, s, n;
+
+   mask = GNSS_GPS;
+   while (*strg)
+     {
+      n = 0;
+      while (*strg && (*strg != ',') && (*strg != '+'))
+        {
+         if ((*strg != ' ') && (n < 19))
+           {
+            name[n++] = *strg;
+           }
+         strg++;
+        }
+      name[n] = 0;
+      if (*strg)
+        {
+         strg++;
+        }
+      if (n == 0)
+        {
+         continue;
+        }
+      for (s=0; (s < GNSS_NUM) && (strcmp(name,names[s]) != 0); s++)
+        {
+        }
+      if (s == GNSS_NUM)
+        {
+         return 0;
+        }
+      mask |= gnss_table[s].mask;
+     }
+   return mask;
+  }
+
+
+int set_baud(char strg[])
+  {
+   int tval;
+
+   tval = stri(strg,0,0);
+   if (tval < 0)
+     {
+      tval = -tval;
+     }
+    
+   if ((tval == 2400) || (tval == 4800) || (tval == 9600) || (tval == 19200) || 
+       (tval == 38400) || (tval == 57600) || (tval == 115200))
+     {
+      portbaud = tval;                           
+      return TRUE;
+     }
+   return FALSE;
+  }
+
+
+void set_port(char strg[])
+  {
+   portspec = stri(strg,0,0);
+   if ((portspec < 1) || (portspec > 8))
+     {
+      portspec = 0;           
+     }
+  }
+
+
+/* returns TRUE or FALSE, or -1 if not recognized as either */
+int config_flag(char strg[])
+  {
+   if ((strcmp(strg,"on") == 0) || (strcmp(strg,"yes") == 0) || 
+       (strcmp(strg,"true") == 0) || (strcmp(strg,"1") == 0))
+     {
+      return TRUE;
+     }
+   if ((strcmp(strg,"off") == 0) || (strcmp(strg,"no") == 0) || 
+       (strcmp(strg,"false") == 0) || (strcmp(strg,"0") == 0))
+     {
+      return FALSE;
+     }
+   return -1;
+  }
+
+
+/* a whole number setting -- FALSE if strg isn't one (stri() would give 0) */
+int config_int(char strg[], int *n)
+  {
+   int i;
+
+   i = ((strg[0] == '-') || (strg[0] == '+'));
+   if (!isdigit((unsigned char)strg[i]))
+     {
+      return FALSE;
+     }
+   for ( ; strg[i]; i++)
+     {
+      if (!isdigit((unsigned char)strg[i]))
+        {
+         return FALSE;
+        }
+     }
+   *n = stri(strg,0,0);
+   return TRUE;
+  }
+
+
+/* a number setting -- FALSE if strg isn't one */
+int config_real(char strg[], double *x)
+  {
+   char *end;
+   double v;
+
+   v = strtod(strg,&end);
+   if ((end == strg) || (*end != 0))
+     {
+      return FALSE;
+     }
+   *x = v;
+   return TRUE;
+  }
+
+
+/* Apply one setting -- used as the line parser for batchprocfile(), so it returns 
+   "" if OK, "?message" to quit with an error, or a file name to be read next 
+   (CONFIG inside a configuration file) */
+char *config_setting(char strg[])
+  {
+   static char msg[100];
+   char key[40];
+   char val[100];
+   char lval[100];
+   int i, j, tval;
+
+   for (i=0; (strg[i] == ' ') || (strg[i] == '\t'); i++)
+     {
+     }
+   if ((strg[i] == 0) || (strg[i] == '#') || (strg[i] == ';') || 
+       (strg[i] == '\r') || (strg[i] == '\n'))
+     {
+      return "";   /* blank or comment line */
+     }
+
+   for (j=0; (strg[i] != 0) && (strg[i] != '=') && (strg[i] != ' ') && (strg[i] != '\t'); i++)
+     {
+      if (j < 39)
+        {
+         key[j++] = tolower(strg[i]);
+        }
+     }
+   key[j] = 0;
+
+   for ( ; (strg[i] == ' ') || (strg[i] == '\t') || (strg[i] == '='); i++)
+     {
+     }
+   strncpy(val,strg+i,99);
+   val[99] = 0;
+   for (j=strlen(val)-1; (j >= 0) && ((val[j] == ' ') || (val[j] == '\t') || 
+                                      (val[j] == '\r') || (val[j] == '\n')); j--)
+     {
+      val[j] = 0;
+     }
+   for (j=0; val[j]; j++)
+     {
+      lval[j] = tolower(val[j]);
+     }
+   lval[j] = 0;
+
+   if (strcmp(key,"port") == 0)
+     {
+      set_port(val);
+      return "";
+     }
+   if (strcmp(key,"baud") == 0)
+     {
+      if (set_baud(val))
+        {
+         return "";
+        }
+     }
+   else if (strcmp(key,"trace") == 0)
+     {
+      strncpy(tracename,val,64);
+      tracename[64] = 0;
+      return "";
+     }
+   else if (strcmp(key,"config") == 0)
+     {
+      strncpy(msg,val,99);
+      msg[99] = 0;
+      return msg;
+     }
+   else if (strcmp(key,"realtime") == 0)
+     {
+      if ((tval = config_flag(lval)) >= 0)
+        {
+         cfg_realtime = tval;
+         return "";
+        }
+     }
+   else if (strcmp(key,"perfect_sat_fixes") == 0)
+     {
+      if ((tval = config_flag(lval)) >= 0)
+        {
+         cfg_perfect_sat_fixes = tval;
+         cfg_perfect_given = TRUE;
+         return "";
+        }
+     }
+   else if (strcmp(key,"nmea") == 0)
+     {
+      if ((strcmp(val,"23") == 0) || (strcmp(val,"2.3") == 0))
+        {
+         cfg_nmea23 = TRUE;
+         return "";
+        }
+      if ((strcmp(val,"20") == 0) || (strcmp(val,"2.0") == 0))
+        {
+         cfg_nmea23 = FALSE;
+         return "";
+        }
+     }
+   else if (strcmp(key,"random_vary") == 0)
+     {
+      if (config_int(val,&tval) && (tval >= 0) && (tval <= 100))
+        {
+         cfg_random_vary = tval;
+         return "";
+        }
+     }
+   else if (strcmp(key,"stable_sat_seconds") == 0)
+     {
+      if (config_int(val,&tval) && (tval > 0))
+        {
+         cfg_stable_sat_seconds = tval;
+         return "";
+        }
+     }
+   else if (strcmp(key,"dropout_sat_seconds") == 0)
+     {
+      if (config_int(val,&tval) && (tval > 0))
+        {
+         cfg_dropout_sat_seconds = tval;
+         return "";
+        }
+     }
+   else if (strcmp(key,"dropout_cycles") == 0)
+     {
+      if (config_int(val,&tval) && (tval > 0))
+        {
+         cfg_dropout_cycles = tval;
+         return "";
+        }
+     }
+   else if (strcmp(key,"random_seed") == 0)
+     {
+      if (config_int(val,&tval))
+        {
+         flt_randomseed = tval;
+         return "";
+        }
+     }
+   else if (strcmp(key,"almanac") == 0)
+     {
+      strncpy(almname,val,64);
+      almname[64] = 0;
+      return "";
+     }
+   else if (strcmp(key,"elevation_mask") == 0)
+     {
+      if (config_real(val,&cfg_elevation_mask) &&
+          (cfg_elevation_mask >= 0.0) && (cfg_elevation_mask < 90.0))
+        {
+         return "";
+        }
+     }
+   else if (strcmp(key,"leap_seconds") == 0)
+     {
+      if (config_int(val,&tval) && (tval >= 0))
+        {
+         cfg_leap_seconds = tval;
+         return "";
+        }
+     }
+   else if (strcmp(key,"gnss") == 0)
+     {
+      if ((tval = gnss_systems(lval)) > 0)
+        {
+         cfg_gnss = tval;
+         return "";
+        }
+     }
+   else if (strcmp(key,"scenario") == 0)
+     {
+      strncpy(scenarioname,val,64);
+      scenarioname[64] = 0;
+      return "";
+     }
+   else if (strcmp(key,"checkpoint") == 0)
+     {
+      strncpy(ckptname,val,64);
+      ckptname[64] = 0;
+      return "";
+     }
+   else if (strcmp(key,"checkpoint_secs") == 0)
+     {
+      if (config_int(val,&tval) && (tval > 0))
+        {
+         cfg_checkpoint_secs = tval;
+         return "";
+        }
+     }
+   else if (strcmp(key,"resume") == 0)
+     {
+      if ((tval = config_flag(lval)) >= 0)
+        {
+         cfg_resume = tval;
+         return "";
+        }
+     }
+   else if (strcmp(key,"flight") == 0)
+     {
+      strncpy(flightname,val,64);
+      flightname[64] = 0;
+      return "";
+     }
+   else if (strcmp(key,"wmm") == 0)
+     {
+      strncpy(wmmname,val,64);
+      wmmname[64] = 0;
+      return "";
+     }
+   else if (strcmp(key,"magvar_km") == 0)
+     {
+      if (config_real(val,&cfg_magvar_km) && (cfg_magvar_km >= 0.0))
+        {
+         return "";
+        }
+     }
+   else if (strcmp(key,"magvar_secs") == 0)
+     {
+      if (config_real(val,&cfg_magvar_secs) && (cfg_magvar_secs >= 0.0))
+        {
+         return "";
+        }
+     }
+   else if (strcmp(key,"geoid") == 0)
+     {
+      strncpy(geoidname,val,64);
+      geoidname[64] = 0;
+      return "";
+     }
+   else if (strcmp(key,"error") == 0)
+     {
+      if (config_real(val,&cfg_error) && (cfg_error >= 0.0))
+        {
+         return "";
+        }
+     }
+   else if (strcmp(key,"error_tau") == 0)
+     {
+      if (config_real(val,&cfg_error_tau) && (cfg_error_tau >= 0.0))
+        {
+         return "";
+        }
+     }
+   else if (strcmp(key,"noise") == 0)
+     {
+      if (config_real(val,&cfg_noise) && (cfg_noise >= 0.0))
+        {
+         return "";
+        }
+     }
+   else if (strcmp(key,"windgrid") == 0)
+     {
+      strncpy(windgridname,val,64);
+      windgridname[64] = 0;
+      return "";
+     }
+   else if (strcmp(key,"ensemble") == 0)
      {
-      /* use slopes and intercepts to interpolate x, y, z data between waypoints */                       
-      dsec = lsec-flt_last_sec;                       
-      x = flt_x_m * dsec + flt_x_b;                      
-      y = flt_y_m * dsec + flt_y_b;                      
-      z = flt_z_m * dsec + flt_z_b;     
-      t_secs = dsec;           
-      
-      /* Apply random variation to x, y, z -- DO NOT apply to either first or last 
-         iterations, taken from original waypoints assumed to be correct. 
-      */
-   
-      /* hold original interpolated values for debug comparison */
-      linear_x = x;
-      linear_y = y;
-      linear_z = z;
-      
-      if ((lsec != flt_last_sec) && (lsec != flt_next_sec))
+      if (config_int(val,&tval) && (tval >= 0))
         {
-         random_vary_pos(flt_var,&x,&y,&z);
+         cfg_ensemble = tval;
+         return "";
         }
-
-                             
-/*    convert lat, long data back to gps format from decimal degrees */                             
-
-      /* set up strings for output as simulation of GPS */ 
-      normlat = gps_coord(y);
-      normlong = gps_coord(x);
-      northsouth = 'N';
-      eastwest = 'E';
-
-      status_active = 'A';    /* can be 'A' or 'V' */
- 
-
-      magvar_deg = -1.4;   
-      magvar_eastwest = 'E';
-
-      if (normlong < 0.000)
+     }
+   else if (strcmp(key,"threads") == 0)
+     {
+      if (config_int(val,&tval) && (tval >= 0))
         {
-         normlong = -normlong;
-         eastwest = 'W';
+         cfg_threads = tval;
+         return "";
         }
-      if (normlat < 0.000)
+     }
+   else if (strcmp(key,"ensemble_cell") == 0)
+     {
+      if (config_real(val,&cfg_ensemble_cell) && (cfg_ensemble_cell > 0.0))
         {
-         normlat = -normlat;
-         northsouth = 'S';
+         return "";
         }
-
-      norm_magvar = magvar_deg;
-      if (norm_magvar < 0.000)
+     }
+   else if (strcmp(key,"ensemble_grid") == 0)
+     {
+      strncpy(ensemble_gridname,val,64);
+      ensemble_gridname[64] = 0;
+      return "";
+     }
+   else if (strcmp(key,"fixed_point") == 0)
+     {
+      if ((tval = config_flag(lval)) >= 0)
         {
-         norm_magvar = -norm_magvar;
-         magvar_eastwest = 'W';
+         cfg_fixed_point = tval;
+         return "";
         }
-
-      geoid_height = 47.1;   /* arbitrary -- don't try to simulate this */
-
-      if (!firstloop)
+     }
+   else if (strcmp(key,"output_hz") == 0)
+     {
+      if (config_int(val,&tval) && (tval >= 1) && (tval <= 10))
+        {
+         cfg_output_hz = tval;
+         return "";
+        }
+     }
+   else if (strncmp(key,"rate_",5) == 0)
+     {
+      if (!config_int(val,&tval))
+        {
+         tval = -1;
+        }
+      for (i=0; i<NUM_SENTENCES; i++)
         {
-         /* calculate heading and speed from delta x, y, and t */
-         if (track_calc(x - prior_x_deg, y - prior_y_deg, 
-                        t_secs - prior_t_secs, y,
-                        &knots, &track_angle))
+         for (j=0; (j < 3) && (tolower(sentence_table[i].id[j]) == key[5+j]); j++)
            {
-            /* actually calculated a heading */                                                                             
-           }  
-         else
+           }
+         if ((j == 3) && (key[8] == 0) && (tval >= 0))
            {
-            /* no heading -- decide whether to carry forward prior heading with 0 speed */  
-           }                                                                              
-
-         /* NOTE:  for now, will ignore what happens if clock gets "behind" due to computer
-                   being too busy to keep up -- pretend it is on schedule.
-                   Later, should force a data droput for each "catch-up" second detected 
-         */          
-
-         /* since the slope of the z regression is in meters and t is in seconds      
-            it happens that flt_z_m is the average climb rate in meters per sec */
-
-         /* also apply any user-entered offset to climb rate for dynamic testing of 
-            onboard computer's response (ballast  drop, etc.) -- note that the user 
-            input is a second-by-second variation which superimposes on the scripted
-            fight path, therefore flt_climb_offset is cumulative for all seconds since 
-            a change is applied to climb rate -- this cumulative offset is added to scripted
-            altitude to get the altitude after user changes have been applied */
-    
-	
-	     /* Apply 1-second clock for realtime output (unless no port specified in Windows/Linux) */
-         #ifdef REALTIME
-
-            #ifdef ARDUINO		 
-            /* wait until next observed change of second on real time clock */
-               while (!seconds_elapsed())
-                 {
-                 } 
-            #else
-               if (portspec)
-                 {			   
-                  /* wait until next observed change of second on real time clock */
-                  wait_seconds(1);
-				 } 
-			#endif
-
-         #endif  
-
-        /* NOTE: Workaround is needed for lack of printf() floats in standard Arduino software 
-		   -- they CAN be had via printf(), but must compile with an alternate library and
-           current Arduino software does not OBVIOUSLY support alternate compile flags (they're 
-		   working on it, maybe) -- therefore standard Arduino code can't use %f or %lf formats */
-        
-        /* Arduino's inclusion of avr-libc SHOULD support a dtostrf() function which fills
-           the gap, but MinGW (Windows) DOES NOT have this function.  An emulated function is 
-		   supplied above to allow code for all OSes to use the same method as Arduino. */ 
-           
-
-/* --------- OUTPUT OF NMEA SENTENCES TO SERIAL PORT ---------------------------------- */
+            sentence_table[i].rate = tval;
+            sentence_table[i].enabled = (tval > 0);
+            return "";
+           }
+        }
+     }
+   else
+     {
+      sprintf(msg,"? Unknown setting: %s",key);
+      return msg;
+     }
 
-         /* GPSSIM simulates acquisition of satellites such that at least some GPS readings
-            are simulated as "missed", with inadequate satellite reception.  This is partly
-            random, partly predetermined.  Acquisition is indicated by a "3" (for 3D) in the 
-            GSA sentence "3D fix" field -- a 1 indicates no fix.
-            
-            Randomly selected readings will be skipped to indicate signal dropouts.  Simulated
-            dropouts will routinely be short, a inute or two, but the simulator will ensure 
-            that at least one dropout in 6 simulated hours exceeds 10 minutes of "no fix" 
-            to allow testing the controller software in handling signal dropouts.
-            
-            When a droput occurs, only a GSA sentence will be output.
-         */   
+   sprintf(msg,"? Invalid value for %.32s: %.40s",key,val);
+   return msg;
+  }
 
 
-         /* keep satellite list stable for about a minute or two, then randomly change list */
+/* Apply command line arguments -- KEYWORD=value settings, or the older positional
+   form: [port] [baud] [trace file], and --resume */
+void read_config(int argc, char *argv[])
+  {
+   char *ptr;
+   int i, npos;
 
-      #ifndef PERFECT_SAT_FIXES             
-         if (flt_cyclect == 0)  /* if it's time for a long dropout... */
+   npos = 0;
+   for (i=1; i<argc; i++)
+     {
+      if (strcmp(argv[i],"--resume") == 0)
+        {
+         cfg_resume = TRUE;
+         continue;
+        }
+      if (strchr(argv[i],'=') == NULL)
+        {
+         npos++;
+         if (npos == 1)
            {
-            /* SPECIAL -- force extended dropout period every 6 hours or so */
-            clear_satellites();
-            nsats = 0;
-            clear_dilutions(&hdilpos, &vdilpos, &pdilpos);  
-
-            flt_dropoutct++;
-            if (flt_dropoutct >= DROPOUT_SAT_SECONDS)
-              {
-               flt_dropoutct = 0;
-               flt_cyclect++;
-               nsats = sim_satellites(3, &hdilpos, &vdilpos, &pdilpos);
-              }
+            set_port(argv[i]);
            }
-         else
-           {
-      #else
-         if (1)
-           {
-      #endif  
-            flt_stablect++;
-            if (flt_stablect >= STABLE_SAT_SECONDS)
-              {
-               flt_stablect = 0; 
-    
-#ifndef PERFECT_SAT_FIXES
-               flt_cyclect++;
-               if (flt_cyclect >= DROPOUT_CYCLES)
-                 {
-                  flt_cyclect = 0; 
-                 }
-#endif    
-               /* randomly simulate a list of satellites visible */  
-               nsats = sim_satellites(0, &hdilpos, &vdilpos, &pdilpos);
-              }
-           }  
-
-         /* at this point satellites are set up -- the following executes once per second... */  
-
-         /* --------------------- GPRMC sentence -------------------- */
-#ifdef NMEA23
-         dtostrf_chop(normlat,-6,4,st_normlat);
-         dtostrf_chop(normlong,-6,4,st_normlong);
-#else
-         dtostrf_chop(normlat,-5,3,st_normlat);
-         dtostrf_chop(normlong,-5,3,st_normlong);
-#endif
-
-         dtostrf_chop(knots,-5,1,st_knots);
-         dtostrf_chop(track_angle,-5,1,st_track_angle);
-         dtostrf_chop(norm_magvar,-3,1,st_norm_magvar);
-
-         status_active = 'A';
-       
-         
-         if (flt_fixtype != 1)   
+         if (npos == 2)
            {
-            #ifdef NMEA23
-            sprintf(work_strg,"GPRMC,%06ld,%c,%s,%c,%s,%c,"
-                                    "%s,%s,%06ld,%s,%c,A",
-                                    secs_to_time(lsec),status_active,st_normlat,northsouth,st_normlong,eastwest,
-                                    st_knots,st_track_angle,secs_to_date(lsec),st_norm_magvar,magvar_eastwest);
-            #else
-            sprintf(work_strg,"GPRMC,%06ld,%c,%s,%c,%s,%c,"
-                                    "%s,%s,%06ld,%s,%c",
-                                    secs_to_time(lsec),status_active,st_normlat,northsouth,st_normlong,eastwest,
-                                    st_knots,st_track_angle,secs_to_date(lsec),st_norm_magvar,magvar_eastwest);
-            #endif
-           }  
-         else   /* invalid data -- no fix */
+            set_baud(argv[i]);    /* unrecognized baud keeps the default */
+           }
+         if (npos == 3)
            {
-            status_active = 'V'; 
-            if (nsats == 0)
-              {
-               #ifdef NMEA23
-               sprintf(work_strg,"GPRMC,,%c,,,,,,,%06ld,,,N",status_active,secs_to_date(lsec));
-               #else
-               sprintf(work_strg,"GPRMC,,%c,,,,,,,%06ld,,",status_active,secs_to_date(lsec));
-               #endif
-              }
-            else
-              {
-               #ifdef NMEA23
-               sprintf(work_strg,"GPRMC,%06ld,%c,%s,%c,%s,%c,"
-                                    "%s,%s,%06ld,%s,%c,%c",
-                                    secs_to_time(lsec),status_active,st_normlat,northsouth,st_normlong,eastwest,
-                                    st_knots,st_track_angle,secs_to_date(lsec),st_norm_magvar,magvar_eastwest,status_active);
-               #else
-               sprintf(work_strg,"GPRMC,%06ld,%c,%s,%c,%s,%c,"
-                                    "%s,%s,%06ld,%s,%c",
-                                    secs_to_time(lsec),status_active,st_normlat,northsouth,st_normlong,eastwest,
-                                    st_knots,st_track_angle,secs_to_date(lsec),st_norm_magvar,magvar_eastwest);
-               #endif
-              }  
-           }  
-  
-         sprintf(out_strg,"$%s*%02X",work_strg,checksum(work_strg));  /* still needs CRLF */
-         com_string_crlf(portspec,out_strg);
-
-         /* --------------------- GPGGA sentence -------------------- */
-      
-#ifdef NMEA23
-         dtostrf_chop(normlat,-6,4,st_normlat);
-         dtostrf_chop(normlong,-6,4,st_normlong);
-#else
-         dtostrf_chop(normlat,-5,3,st_normlat);
-         dtostrf_chop(normlong,-5,3,st_normlong);
-#endif
+            strncpy(tracename,argv[i],64);
+            tracename[64] = 0;
+           }
+         continue;
+        }
 
-         dtostrf_chop(hdilpos,-3,1,st_hdilpos);
-         dtostrf_chop(z,-3,1,st_z);
-         dtostrf_chop(geoid_height,-3,1,st_geoid_height);
-  
-  
-         if (flt_fixtype != 1)   
-           {
-            sprintf(work_strg,"GPGGA,%06ld,%s,%c,%s,%c,"
-                                    "%d,%02d,%s,%s,M,%s,M,,",
-                                    secs_to_time(lsec),st_normlat,northsouth,st_normlong,eastwest,
-                                    1,nsats,st_hdilpos,st_z,st_geoid_height);
-           }  
-         else   /* invalid data -- no fix */
+      ptr = config_setting(argv[i]);
+      if ((*ptr != 0) && (*ptr != '?'))    /* CONFIG=file */
+        {
+         ptr = batchprocfile(ptr,config_setting);
+         if (*ptr == 0)
            {
-            if (nsats = 0)
-              {
-               sprintf(work_strg,"GPGGA,,,,,,"
-                                    "%d,%02d,,,M,,M,,",0,nsats);
-              }
-            else
-              {
-               #ifdef NEMA23
-                sprintf(work_strg,"GPGGA,%06ld,%s,%c,%s,%c,"
-                                    "%d,%02d,%s,%s,M,%s,M,,",
-                                    secs_to_time(lsec),st_normlat,northsouth,st_normlong,eastwest,
-                                    6,nsats,st_hdilpos,st_z,st_geoid_height);
-               #else
-               sprintf(work_strg,"GPGGA,%06ld,%s,%c,%s,%c,"
-                                    "%d,%02d,%s,%s,M,%s,M,,",
-                                    secs_to_time(lsec),st_normlat,northsouth,st_normlong,eastwest,
-                                    0,nsats,st_hdilpos,st_z,st_geoid_height);
-               #endif                     
-              }  
-           }  
-     
-         sprintf(out_strg,"$%s*%02X",work_strg,checksum(work_strg));  /* still needs CRLF */
-         com_string_crlf(portspec,out_strg);
-   
-         /* --------------------- GPGSA sentence -------------------- */
-
-         dtostrf_chop(hdilpos,-3,1,st_hdilpos);
-         dtostrf_chop(pdilpos,-3,1,st_pdilpos);
-         dtostrf_chop(vdilpos,-3,1,st_vdilpos);
-
-         sprintf(work_strg,"GPGSA,%c,%d,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,%s,"
-                                        "%s,%s,%s",
-                                 status_active,       
-                                 flt_fixtype,
-                                 satarray[0],
-                                 satarray[1],
-                                 satarray[2],
-                                 satarray[3],
-                                 satarray[4],
-                                 satarray[5],
-                                 satarray[6],
-                                 satarray[7],
-                                 satarray[8],
-                                 satarray[9],
-                                 satarray[10],
-                                 satarray[11],
-                                 st_pdilpos,st_hdilpos,st_vdilpos);
-                                 
-   
-         sprintf(out_strg,"$%s*%02X",work_strg,checksum(work_strg));  /* still needs CRLF */
-         com_string_crlf(portspec,out_strg);
+            continue;
+           }
+         printf("Configuration file %s -- ",strchr(argv[i],'=')+1);
+        }
+      if (*ptr == '?')
+        {
+         printf("%s\n",ptr+2);
+         exit(1);
         }
-        
-      firstloop = FALSE;  
-            
-      /* NOW FOR THE POINT of isolating the first loop -- hold the first data for deltas */
-      prior_x_deg = x;
-      prior_y_deg = y;
-      prior_t_secs =  t_secs;
      }
-
-   return 1;
   }
 
-  
-  
+#endif
 
   
 #ifdef ARDUINO
@@ -3058,16 +8772,45 @@ void setup()                    // run once, when the sketch starts
 {
  /* initialize for seconds_elapsed() */
  last_time = millis();
+ #ifdef DUTY_REPORT
+    duty_from = micros();
+ #endif
 
  Serial.begin(BAUD_RATE);
+ #ifdef MULTI_PORT
+    if (PORT1_BAUD > 0)
+      {
+       Serial1.begin(PORT1_BAUD);
+      }
+    if (PORT2_BAUD > 0)
+      {
+       Serial2.begin(PORT2_BAUD);
+      }
+    if (PORT3_BAUD > 0)
+      {
+       Serial3.begin(PORT3_BAUD);
+      }
+ #endif
  
  #ifdef DEBUG_OUTPUT
-    serial_puts("GPSSIM 1.03 -- GLF 03/14/2011 for LVL1 -- GPS NMEA Output Emulator\r\n");
+    serial_puts("GPSSIM 1.04 -- 10/19/2026 for LVL1 -- GPS NMEA Output Emulator\r\n");
  #endif 
   
  /* main section of original Windows GPSSIM can largely go here */
 
+ flt_realtime = cfg_realtime;
+ flt_fixed = cfg_fixed_point;
+ flt_hz = cfg_output_hz;
+ select_kernel();
+ tl_default(cfg_perfect_sat_fixes);
+
+ #ifdef TX_RING
+    /* in REALTIME each epoch waits in the ring for its second */
+    tx_paced = flt_realtime;
+ #endif
+
  open_script();
+ init_sentences();
 
  while (process_script())
    {
@@ -3079,9 +8822,18 @@ void setup()                    // run once, when the sketch starts
    }
       
  close_script();
+ tx_flush();
+
+ #ifdef AVR_HOST
+    /* host build (linux/lvl1/avrsim) -- report cycle budget and exit */
+    avrhost_finish();
+ #endif
 
  for (;;)
    {
+    idle_begin();
+    idle_sleep();
+    idle_end();
     #ifdef DEBUG_OUTPUT    
        if (seconds_elapsed())
          {
@@ -3109,56 +8861,167 @@ main(int argc, char *argv[])
 
 {
  char strg[1000];
+#ifdef DEBUG_OUTPUT
  char work[100];
+#endif
  long recct;
  int recshow;
- int tval;
 
  double val;
 
- printf("\nGPSSIM 1.03 -- GLF 03/14/2011 for LVL1 -- GPS NMEA Output Emulator\n"
+ printf("\nGPSSIM 1.04 -- 10/19/2026 for LVL1 -- GPS NMEA Output Emulator\n"
           "--------------------------------------------------------------------------\n");  
  
- if (argc > 1)
+ portbaud = BAUD_RATE;
+ portspec = 0;
+ tracename[0] = 0;
+
+ read_config(argc,argv);
+
+#ifndef HAVE_SIM_LIBS
+ if (tracename[0] || almname[0] || flightname[0] || (cfg_ensemble > 0) || windgridname[0] ||
+     wmmname[0] || geoidname[0] || (cfg_error > 0.0) || (cfg_noise > 0.0))
+   {
+    printf("TRACE, ALMANAC, FLIGHT, ENSEMBLE, WINDGRID, WMM, GEOID, ERROR and NOISE need the\n"
+           "simulation libraries, which this build is made without\n");
+    exit(1);
+   }
+#else
+ if (almname[0])
    {
-    strncpy(work,argv[1],64);
-    work[64] = 0;
+    if (alm_read(&flt_alm,almname) == 0)
+      {
+       printf("No satellites read from almanac %s\n",almname);
+       exit(1);
+      }
+    printf("Almanac %s -- %d satellites\n",almname,flt_alm.count);
+    cfg_almanac = TRUE;
+    gnss_almanacs();
    }
 
- portbaud = BAUD_RATE;
- portspec = stri(work,0,0);
- if ((portspec < 1) || (portspec > 8))
+ if (flightname[0])
    {
-    portspec = 0;           
+    fl_default_params(&flt_model);
+    if (!fl_read_params(&flt_model,flightname) ||
+        (flt_model.winds[0] && (fl_read_winds(&flt_winds,flt_model.winds) == 0)))
+      {
+       printf("%s\n",fl_error);
+       exit(1);
+      }
+    if (!fl_batch_init(&flt_flight,&flt_model,1))
+      {
+       printf("Out of memory for the flight model\n");
+       exit(1);
+      }
+    if (fl_fly(&flt_flight,&flt_model,&flt_winds,&flt_track) > 0)
+      {
+       printf("Flight %s -- burst at %.0f m after %.0f s, landed after %.0f s, %d waypoints\n",
+              flightname,flt_flight.burst_alt[0],flt_flight.burst_secs[0],
+              flt_flight.land_secs[0],flt_track.count);
+      }
+    else
+      {
+       printf("Flight %s -- still up after %.1f hours, %d waypoints\n",
+              flightname,flt_model.max_hours,flt_track.count);
+      }
+    fl_batch_free(&flt_flight);
+    cfg_flight = TRUE;
    }
 
- if (argc > 2)
+ if (wmmname[0])
    {
-    strncpy(work,argv[2],64);
-    work[64] = 0;
+    if (wmm_read(&flt_wmm,wmmname) == 0)
+      {
+       printf("%s\n",wmm_error);
+       exit(1);
+      }
+    wmm_cache_init(&flt_wmm_cache,cfg_magvar_km,cfg_magvar_secs);
+    printf("Magnetic model %s (epoch %.1f, degree %d) -- summed again every %.1f km or %.0f s\n",
+           flt_wmm.name,flt_wmm.epoch,flt_wmm.degree,cfg_magvar_km,cfg_magvar_secs);
+    cfg_wmm = TRUE;
+   }
 
-    tval = stri(work,0,0);
-    if (tval < 0)
+ if (geoidname[0])
+   {
+    if (gd_open(&flt_geoid,geoidname) == 0)
       {
-       tval = -tval;
+       printf("%s\n",gd_error);
+       exit(1);
       }
-    
-    if ((tval == 2400) || (tval == 4800) || (tval == 9600) || 
-                                  (tval == 19200) || (tval == 38400))
+    gd_cache_clear(&flt_geoid_cache);
+    printf("Geoid grid %s -- %d x %d, %.4f deg spacing%s\n",geoidname,flt_geoid.nrows,
+           flt_geoid.ncols,flt_geoid.dlat,(flt_geoid.mapped ? ", mapped" : ""));
+    cfg_geoid = TRUE;
+   }
+#endif
+
+ /* the fix-quality timeline, from a scenario file or the dropout settings */
+ if (scenarioname[0])
+   {
+    if (cfg_perfect_sat_fixes && cfg_perfect_given)
+      {
+       printf("SCENARIO can't be used with PERFECT_SAT_FIXES on -- its dropouts would be ignored\n");
+       exit(1);
+      }
+    cfg_perfect_sat_fixes = FALSE;
+    if (!tl_read(scenarioname))
       {
-       portbaud = tval;                           
+       printf("%s\n",tl_error);
+       exit(1);
       }
+    printf("Scenario %s -- %d intervals%s\n",scenarioname,tl_count,
+           ((tl_period > 0L) ? ", repeating" : ""));
+   }
+ else
+   {
+    tl_default(cfg_perfect_sat_fixes);
    }
-   
- flt_realtime = FALSE;
-  
 
-#ifdef REALTIME
- if (portspec)
+#ifdef HAVE_SIM_LIBS
+ if ((cfg_error > 0.0) || (cfg_noise > 0.0))
+   {
+    printf("Receiver error %.1f m (Gauss-Markov, %.0f s) and noise %.1f m, times the DOP\n",
+           cfg_error,cfg_error_tau,cfg_noise);
+    cfg_error_model = TRUE;
+   }
+
+ if (windgridname[0])
+   {
+    if (wg_read(&flt_grid,windgridname) == 0)
+      {
+       printf("%s\n",wg_error);
+       exit(1);
+      }
+    wg_cache_clear(&flt_wind_cache);
+    printf("Wind grid %s -- %d x %d x %d (lat x long x altitude)\n",
+           windgridname,flt_grid.nlat,flt_grid.nlon,flt_grid.nalt);
+    cfg_windgrid = TRUE;
+   }
+
+ /* a landing footprint instead of a flight's NMEA */
+ if (cfg_ensemble > 0)
    {
-    flt_realtime = TRUE;
+    exit(run_ensemble() ? 0 : 1);
    }
 #endif
+
+ /* more than one epoch a second is only done in fixed point */
+ flt_hz = cfg_output_hz;
+ flt_fixed = (cfg_fixed_point || (flt_hz > 1));
+ if (flt_fixed && ((cfg_random_vary > 0) || cfg_windgrid || cfg_almanac || cfg_error_model))
+   {
+    printf("FIXED_POINT (or OUTPUT_HZ above 1) can't be used with RANDOM_VARY, WINDGRID, ALMANAC,\n"
+           "ERROR or NOISE\n");
+    exit(1);
+   }
+ if (flt_fixed)
+   {
+    printf("Fixed point simulation -- %d epoch%s per second\n",flt_hz,((flt_hz > 1) ? "s" : ""));
+   }
+
+ /* realtime output only makes sense when there is a port to pace */
+ flt_realtime = (cfg_realtime && portspec);
+ select_kernel();
  
  if (portspec)
    {
@@ -3192,7 +9055,43 @@ main(int argc, char *argv[])
       } 
    }   
   
+#ifdef HAVE_SIM_LIBS
+ if (tracename[0])
+   {
+    if (evtrace_open(tracename,EVTRACE_DEFAULT_EVENTS))
+      {
+       printf("Event trace will be written to %s\n\n",tracename);
+       atexit(evtrace_close);
+       signal(SIGINT,early_exit_signal);
+       signal(SIGTERM,early_exit_signal);
+      }
+   }
+#endif
+
  open_script();
+ init_sentences();
+
+ /* a checkpoint to carry on from -- or the file to write them to */
+ if (cfg_resume)
+   {
+    if (!ckptname[0])
+      {
+       printf("RESUME needs a CHECKPOINT file\n");
+       exit(1);
+      }
+    if (!ckpt_read())
+      {
+       printf("%s\n",ckpt_error);
+       exit(1);
+      }
+    printf("Resuming from checkpoint %s -- written %ld s ago at %06ld %06ld%s\n",ckptname,
+           (long)time(NULL) - ckpt_saved.wall,ckpt_saved.hhmmss,ckpt_saved.ddmmyy,
+           (flt_realtime ? ", output goes on at the second due now" : ""));
+   }
+ if (ckptname[0])
+   {
+    printf("Checkpoint every %d s to %s\n",cfg_checkpoint_secs,ckptname);
+   }
 
  recct = 0;
 
@@ -3422,12 +9321,22 @@ main(int argc, char *argv[])
     printf("Processing waypoint script lines (accelerated output)...\n\n");
    }
 
- while (process_script())
+ while (!early_stop && process_script())
    {
     recct++;
    }
       
  close_script();
+
+ if (early_stop)
+   {
+    printf("\nStopped\n");
+   }
+
+ if (ckpt_replay)
+   {
+    printf("The flight in checkpoint %s had already ended\n",ckptname);
+   }
         
  printf("\n%8ld records processed\n",recct);
  
@@ -3440,4 +9349,4 @@ main(int argc, char *argv[])
  close_com(portspec);            
 }
 
-#endif
+#endif
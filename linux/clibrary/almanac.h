@@ -0,0 +1,95 @@
+/* almanac.h -- header file for
+                GPS almanac library which reads a YUMA or SEM format almanac
+                file and propagates the orbits of all satellites in it, to
+                give the satellites in view (elevation and azimuth) from any
+                place on earth at any time
+
+   The almanac is held as a structure of arrays -- one array per orbital
+   element, indexed by satellite -- and alm_propagate() works through all
+   satellites one element array at a time, in a single pass with no
+   per-satellite branching (Kepler's equation is solved with a fixed
+   number of iterations), so the compiler can keep the loops tight.
+
+   Times are GPS seconds since the GPS epoch (00:00 6 Jan 1980), see
+   alm_gps_seconds().  Satellite positions are earth-fixed (ECEF) meters,
+   computed as described for the almanac in IS-GPS-200 -- the rotation of
+   the earth (sidereal time) is carried by the Omega-E terms, since the
+   almanac's right ascension is measured from Greenwich at the start of
+   the GPS week.
+*/
+
+#ifndef ALMANAC_H__
+#define ALMANAC_H__
+
+#include <stdio.h>
+
+#define ALM_MAX_SATS 32
+
+#define ALM_MU         3.986005e14       /* WGS 84 earth gravitational constant m^3/s^2 */
+#define ALM_OMEGA_E    7.2921151467e-5   /* WGS 84 earth rotation rate rad/s */
+#define ALM_SECS_WEEK  604800.0
+#define ALM_GPS_EPOCH_JD  44244.5        /* 6 Jan 1980 as given by jd_sid() */
+
+typedef struct
+  {
+   int count;                        /* number of satellites loaded */
+   int prn[ALM_MAX_SATS];
+   int health[ALM_MAX_SATS];         /* 0 = healthy */
+   int week[ALM_MAX_SATS];           /* GPS week, maybe modulo 1024 */
+   double toa[ALM_MAX_SATS];         /* time of applicability, seconds of week */
+   double ecc[ALM_MAX_SATS];         /* eccentricity */
+   double incl[ALM_MAX_SATS];        /* inclination, radians */
+   double omegadot[ALM_MAX_SATS];    /* rate of right ascension, radians/s */
+   double sqrta[ALM_MAX_SATS];       /* square root of semi-major axis, m^1/2 */
+   double omega0[ALM_MAX_SATS];      /* right ascension at week, radians */
+   double argper[ALM_MAX_SATS];      /* argument of perigee, radians */
+   double m0[ALM_MAX_SATS];          /* mean anomaly, radians */
+   double af0[ALM_MAX_SATS];         /* clock bias, s */
+   double af1[ALM_MAX_SATS];         /* clock drift, s/s */
+  }
+   almanac;
+
+typedef struct
+  {
+   int count;                        /* satellites above the mask angle */
+   int prn[ALM_MAX_SATS];            /* sorted by descending elevation */
+   double elev[ALM_MAX_SATS];        /* degrees */
+   double azim[ALM_MAX_SATS];        /* degrees true, 0 to 360 */
+   int snr[ALM_MAX_SATS];            /* plausible C/N0, dB-Hz */
+   double los_e[ALM_MAX_SATS];       /* unit line of sight, east north up */
+   double los_n[ALM_MAX_SATS];
+   double los_u[ALM_MAX_SATS];
+  }
+   alm_view;
+
+
+/* read a YUMA or SEM almanac (format is detected) -- returns the number
+   of satellites loaded, 0 if none or the file can't be read */
+int alm_read(almanac *alm, char fname[]);
+int alm_read_yuma(almanac *alm, FILE *unit);
+int alm_read_sem(almanac *alm, FILE *unit);
+
+/* a nominal constellation in place of an almanac -- nsats satellites in
+   circular orbits of semi-major axis a_m, evenly spaced in nplanes planes
+   at incl_deg, each plane's satellites phased by phasing / nsats of a turn
+   from the plane before (the Walker delta pattern nsats/nplanes/phasing,
+   e.g. 24/3/1 at 64.8 degrees for GLONASS, 24/3/1 at 56 degrees for
+   Galileo), numbered from first_prn plane by plane -- returns alm->count */
+int alm_walker(almanac *alm, int nsats, int nplanes, int phasing,
+               double incl_deg, double a_m, int first_prn);
+
+/* GPS seconds for a UTC date and time (year 1950-2050) -- leapsecs is
+   GPS-UTC, e.g. 14 for 2006-2008 */
+double alm_gps_seconds(int yr, int mo, int da, int hh, int mi, int ss, int leapsecs);
+
+/* earth-fixed positions (meters) of all satellites at time gpssecs -- the
+   arrays must hold alm->count entries */
+void alm_propagate(almanac *alm, double gpssecs, double x[], double y[], double z[]);
+
+/* satellites in view from geodetic lat, long (degrees, east positive)
+   and alt (meters) which are healthy and above mask_deg elevation --
+   returns view->count */
+int alm_look(almanac *alm, double gpssecs, double lat_deg, double long_deg,
+                           double alt_m, double mask_deg, alm_view *view);
+
+#endif
@@ -0,0 +1,63 @@
+#=======================================================================
+#@V@:Note: File automatically generated by VIDE - 2.00/10Apr03 (gcc).
+# Generated 11:46:11 AM 19 Oct 2026
+# This file regenerated each time you run VIDE, so save under a
+#    new name if you hand edit, or it will be overwritten.
+#=======================================================================
+
+# Standard defines:
+CC  	=	gcc
+LD  	=	gcc
+WRES	=	windres
+HOMEV	=	
+VPATH	=	$(HOMEV)/include
+oDir	=	.
+Bin	=	.
+libDirs	=	-L../../clibrary
+
+incDirs	=	-I../../clibrary
+
+LD_FLAGS =	-s
+LIBS	=	-lsidtime -lwgs84 -ldegtrig -lgflib -lm
+C_FLAGS	=	-O
+
+SRCS	=\
+	almanac.c
+
+EXOBJS	=\
+	$(oDir)/almanac.o
+
+ALLOBJS	=	$(EXOBJS)
+ALLBIN	=	$(Bin)/libalmanac.a
+ALLTGT	=	$(Bin)/libalmanac.a
+
+# User defines:
+
+#@# Targets follow ---------------------------------
+
+all:	$(ALLTGT)
+
+objs:	$(ALLOBJS)
+
+cleanobjs:
+	rm -f $(ALLOBJS)
+
+cleanbin:
+	rm -f $(ALLBIN)
+
+clean:	cleanobjs cleanbin
+
+cleanall:	cleanobjs cleanbin
+
+#@# User Targets follow ---------------------------------
+
+
+#@# Dependency rules follow -----------------------------
+
+$(Bin)/libalmanac.a: $(EXOBJS)
+	rm -f $(Bin)/libalmanac.a
+	ar cr $(Bin)/libalmanac.a $(EXOBJS)
+	ranlib $(Bin)/libalmanac.a
+
+$(oDir)/almanac.o: almanac.c ../../clibrary/sidtime.h ../../clibrary/wgs84.h ../../clibrary/gflib.h almanac.h
+	$(CC) $(C_FLAGS) $(incDirs) -c -o $@ $<
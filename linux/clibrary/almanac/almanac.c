@@ -0,0 +1,418 @@
+/* almanac.c -- GPS almanac library -- reads YUMA or SEM almanac files and
+                propagates the satellite orbits to find the satellites in
+                view from a given place and time -- see almanac.h
+
+                Orbit equations from the almanac/ephemeris user algorithm
+                of IS-GPS-200 (20.3.3.4.3), with the almanac's reduced set
+                of elements (no harmonic corrections).
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+#include "sidtime.h"
+#include "wgs84.h"
+#include "almanac.h"
+
+#define ALM_PI          3.1415926535897932384626433832795
+#define ALM_RAD_TO_DEG  57.295779513082320876798154814105
+
+/* Newton iterations for Kepler's equation -- GPS orbits are nearly
+   circular (e < 0.03), 6 steps converge to full double precision */
+#define ALM_KEPLER_ITER 6
+
+
+
+/* ------------------------------------------------------------------------ */
+
+static void alm_clear(almanac *alm)
+  {
+   memset(alm,0,sizeof(almanac));
+  }
+
+
+/* YUMA -- one block of "Label:   value" lines per satellite, starting
+   with the ID line, e.g.
+
+   ******** Week 446 almanac for PRN-01 ********
+   ID:                         01
+   Health:                     000
+   Eccentricity:               0.4870891571E-002
+   ...
+*/
+int alm_read_yuma(almanac *alm, FILE *unit)
+  {
+   char line[200];
+   char key[40];
+   char *colon;
+   double val;
+   int i, j;
+
+   alm_clear(alm);
+   i = -1;
+
+   while (fgets(line,199,unit) != NULL)
+     {
+      colon = strchr(line,':');
+      if (colon == NULL)
+        {
+         continue;
+        }
+
+      for (j=0; (line+j < colon) && (j < 39); j++)
+        {
+         key[j] = tolower(line[j]);
+        }
+      key[j] = 0;
+      val = atof(colon+1);
+
+      if (strncmp(key,"id",2) == 0)
+        {
+         if (i >= ALM_MAX_SATS-1)
+           {
+            break;
+           }
+         i++;
+         alm->prn[i] = (int)val;
+         alm->count = i+1;
+         continue;
+        }
+      if (i < 0)
+        {
+         continue;   /* no satellite started yet */
+        }
+
+      if (strncmp(key,"health",6) == 0)
+        {
+         alm->health[i] = (int)val;
+        }
+      else if (strncmp(key,"eccentricity",12) == 0)
+        {
+         alm->ecc[i] = val;
+        }
+      else if (strncmp(key,"time of applicability",21) == 0)
+        {
+         alm->toa[i] = val;
+        }
+      else if (strncmp(key,"orbital inclination",19) == 0)
+        {
+         alm->incl[i] = val;
+        }
+      else if (strncmp(key,"rate of right ascen",19) == 0)
+        {
+         alm->omegadot[i] = val;
+        }
+      else if (strncmp(key,"sqrt(a)",7) == 0)
+        {
+         alm->sqrta[i] = val;
+        }
+      else if (strncmp(key,"right ascen at week",19) == 0)
+        {
+         alm->omega0[i] = val;
+        }
+      else if (strncmp(key,"argument of perigee",19) == 0)
+        {
+         alm->argper[i] = val;
+        }
+      else if (strncmp(key,"mean anom",9) == 0)
+        {
+         alm->m0[i] = val;
+        }
+      else if (strncmp(key,"af0",3) == 0)
+        {
+         alm->af0[i] = val;
+        }
+      else if (strncmp(key,"af1",3) == 0)
+        {
+         alm->af1[i] = val;
+        }
+      else if (strncmp(key,"week",4) == 0)
+        {
+         alm->week[i] = (int)val;
+        }
+     }
+
+   return alm->count;
+  }
+
+
+/* SEM -- a header giving the number of records, then week and time of
+   applicability, then one record per satellite:
+
+      PRN
+      SVN
+      URA
+      eccentricity  inclination offset  rate of right ascension
+      sqrt(A)  right ascension at week  argument of perigee
+      mean anomaly  af0  af1
+      health
+      configuration
+
+   Angles are in semicircles, and inclination is an offset from 0.30
+   semicircles (54 degrees). */
+int alm_read_sem(almanac *alm, FILE *unit)
+  {
+   char line[200];
+   int nrec, week, i;
+   int prn, svn, ura, health, config;
+   double toa, ecc, incofs, omegadot, sqrta, omega0, argper, m0, af0, af1;
+
+   alm_clear(alm);
+
+   if (fscanf(unit,"%d",&nrec) != 1)
+     {
+      return 0;
+     }
+   fgets(line,199,unit);     /* rest of title line */
+   if (fscanf(unit,"%d %lf",&week,&toa) != 2)
+     {
+      return 0;
+     }
+
+   for (i=0; (i < nrec) && (i < ALM_MAX_SATS); i++)
+     {
+      if ((fscanf(unit,"%d %d %d",&prn,&svn,&ura) != 3) ||
+          (fscanf(unit,"%lf %lf %lf",&ecc,&incofs,&omegadot) != 3) ||
+          (fscanf(unit,"%lf %lf %lf",&sqrta,&omega0,&argper) != 3) ||
+          (fscanf(unit,"%lf %lf %lf",&m0,&af0,&af1) != 3) ||
+          (fscanf(unit,"%d %d",&health,&config) != 2))
+        {
+         break;
+        }
+
+      alm->prn[i] = prn;
+      alm->health[i] = health;
+      alm->week[i] = week;
+      alm->toa[i] = toa;
+      alm->ecc[i] = ecc;
+      alm->incl[i] = (0.30 + incofs) * ALM_PI;
+      alm->omegadot[i] = omegadot * ALM_PI;
+      alm->sqrta[i] = sqrta;
+      alm->omega0[i] = omega0 * ALM_PI;
+      alm->argper[i] = argper * ALM_PI;
+      alm->m0[i] = m0 * ALM_PI;
+      alm->af0[i] = af0;
+      alm->af1[i] = af1;
+      alm->count = i+1;
+     }
+
+   return alm->count;
+  }
+
+
+int alm_read(almanac *alm, char fname[])
+  {
+   FILE *unit;
+   char line[200];
+   int i, yuma;
+
+   alm_clear(alm);
+
+   unit = fopen(fname,"r");
+   if (unit == NULL)
+     {
+      return 0;
+     }
+
+   /* a SEM file starts with the record count, a YUMA file has labelled
+      lines (maybe after a "****" banner or comment lines) */
+   yuma = 0;
+   while (fgets(line,199,unit) != NULL)
+     {
+      for (i=0; isspace(line[i]); i++)
+        {
+        }
+      if (strchr(line,':') != NULL)
+        {
+         yuma = 1;
+         break;
+        }
+      if (isdigit(line[i]))
+        {
+         break;
+        }
+     }
+   rewind(unit);
+
+   if (yuma)
+     {
+      alm_read_yuma(alm,unit);
+     }
+   else
+     {
+      alm_read_sem(alm,unit);
+     }
+
+   fclose(unit);
+   return alm->count;
+  }
+
+
+/* ------------------------------------------------------------------------ */
+
+/* the elements hold at the start of GPS week 0 -- alm_propagate() takes
+   the week nearest the time asked for, so the pattern is never stale */
+int alm_walker(almanac *alm, int nsats, int nplanes, int phasing,
+               double incl_deg, double a_m, int first_prn)
+  {
+   int i, per_plane, plane;
+
+   alm_clear(alm);
+   if ((nplanes < 1) || (nsats < nplanes) || (nsats > ALM_MAX_SATS))
+     {
+      return 0;
+     }
+   per_plane = nsats / nplanes;
+
+   for (i=0; i<nsats; i++)
+     {
+      plane = i / per_plane;
+      alm->prn[i] = first_prn + i;
+      alm->incl[i] = incl_deg / ALM_RAD_TO_DEG;
+      alm->sqrta[i] = sqrt(a_m);
+      alm->omega0[i] = (2.0 * ALM_PI * plane) / nplanes;
+      alm->m0[i] = (2.0 * ALM_PI * (i % per_plane)) / per_plane
+                   + (2.0 * ALM_PI * phasing * plane) / nsats;
+     }
+   alm->count = nsats;
+   return alm->count;
+  }
+
+
+double alm_gps_seconds(int yr, int mo, int da, int hh, int mi, int ss, int leapsecs)
+  {
+   double days;
+
+   days = jd_sid(yr,mo,da) - ALM_GPS_EPOCH_JD;
+   return (days * 86400.0) + (hh * 3600.0) + (mi * 60.0) + ss + leapsecs;
+  }
+
+
+void alm_propagate(almanac *alm, double gpssecs, double x[], double y[], double z[])
+  {
+   double tk[ALM_MAX_SATS];
+   double mk[ALM_MAX_SATS];
+   double ek[ALM_MAX_SATS];
+   double weeknow, wk;
+   double a, e, sinek, cosek, nu, u, r, xp, yp, omegak, cosi;
+   int i, iter, nsats;
+
+   nsats = alm->count;
+   weeknow = gpssecs / ALM_SECS_WEEK;
+
+   /* time from applicability -- a week number may have rolled over
+      (10 bits), so take the week nearest the requested time */
+   for (i=0; i<nsats; i++)
+     {
+      wk = alm->week[i];
+      wk += 1024.0 * floor(((weeknow - wk) / 1024.0) + 0.5);
+      tk[i] = gpssecs - ((wk * ALM_SECS_WEEK) + alm->toa[i]);
+     }
+
+   /* mean anomaly -- mean motion n = sqrt(mu / a^3) */
+   for (i=0; i<nsats; i++)
+     {
+      a = alm->sqrta[i];
+      mk[i] = alm->m0[i] + ((sqrt(ALM_MU) / (a * a * a)) * tk[i]);
+      ek[i] = mk[i];
+     }
+
+   /* eccentric anomaly -- all satellites step together */
+   for (iter=0; iter<ALM_KEPLER_ITER; iter++)
+     {
+      for (i=0; i<nsats; i++)
+        {
+         e = alm->ecc[i];
+         ek[i] -= (ek[i] - (e * sin(ek[i])) - mk[i]) / (1.0 - (e * cos(ek[i])));
+        }
+     }
+
+   /* position in the orbital plane, rotated to earth-fixed axes */
+   for (i=0; i<nsats; i++)
+     {
+      e = alm->ecc[i];
+      a = alm->sqrta[i] * alm->sqrta[i];
+      sinek = sin(ek[i]);
+      cosek = cos(ek[i]);
+
+      nu = atan2(sqrt(1.0 - (e * e)) * sinek, cosek - e);
+      u = nu + alm->argper[i];
+      r = a * (1.0 - (e * cosek));
+      xp = r * cos(u);
+      yp = r * sin(u);
+
+      omegak = alm->omega0[i] + ((alm->omegadot[i] - ALM_OMEGA_E) * tk[i])
+                              - (ALM_OMEGA_E * alm->toa[i]);
+      cosi = cos(alm->incl[i]);
+
+      x[i] = (xp * cos(omegak)) - (yp * cosi * sin(omegak));
+      y[i] = (xp * sin(omegak)) + (yp * cosi * cos(omegak));
+      z[i] = yp * sin(alm->incl[i]);
+     }
+  }
+
+
+int alm_look(almanac *alm, double gpssecs, double lat_deg, double long_deg,
+                           double alt_m, double mask_deg, alm_view *view)
+  {
+   double x[ALM_MAX_SATS];
+   double y[ALM_MAX_SATS];
+   double z[ALM_MAX_SATS];
+   wgs_frame here;
+   double e, n, u, range, elev;
+   double sinmask;
+   int i, j, k;
+
+   view->count = 0;
+   alm_propagate(alm,gpssecs,x,y,z);
+
+   /* all satellites into the observer's east, north, up at once */
+   wgs_frame_set(&here,lat_deg,long_deg,alt_m);
+   wgs_ecef_to_enu(&here,alm->count,x,y,z,x,y,z);
+
+   sinmask = sin(mask_deg / ALM_RAD_TO_DEG);
+
+   for (i=0; i<alm->count; i++)
+     {
+      e = x[i];
+      n = y[i];
+      u = z[i];
+      range = sqrt((e * e) + (n * n) + (u * u));
+
+      if ((alm->health[i] != 0) || (range <= 0.0) || ((u / range) < sinmask))
+        {
+         continue;
+        }
+
+      elev = asin(u / range) * ALM_RAD_TO_DEG;
+
+      /* insert by descending elevation */
+      for (j=view->count; (j > 0) && (view->elev[j-1] < elev); j--)
+        {
+        }
+      for (k=view->count; k > j; k--)
+        {
+         view->prn[k] = view->prn[k-1];
+         view->elev[k] = view->elev[k-1];
+         view->azim[k] = view->azim[k-1];
+         view->snr[k] = view->snr[k-1];
+         view->los_e[k] = view->los_e[k-1];
+         view->los_n[k] = view->los_n[k-1];
+         view->los_u[k] = view->los_u[k-1];
+        }
+
+      view->prn[j] = alm->prn[i];
+      view->elev[j] = elev;
+      view->azim[j] = sm_normalize_angle(atan2(e,n)) * ALM_RAD_TO_DEG;
+      view->snr[j] = 30 + (int)(20.0 * (u / range));   /* stronger overhead */
+      view->los_e[j] = e / range;
+      view->los_n[j] = n / range;
+      view->los_u[j] = u / range;
+      view->count++;
+     }
+
+   return view->count;
+  }
@@ -0,0 +1,57 @@
+/* degtrig.h -- header file for
+                degree trigonometry library which works out sin, cos, atan2
+                and acos of angles in degrees by polynomials, with no call
+                into the C library's math functions
+
+   Angles stay in degrees until the last step, so the reduction to the
+   nearest multiple of 90 degrees is exact (no rounding of pi), and the
+   quadrant is chosen by arithmetic and selects rather than branches.
+   The kernels are the Taylor series of sin and cos over -45 to +45
+   degrees, and of atan over 0 to tan(15 degrees) (larger ratios are
+   moved down by 30 degrees with atan(t) = 30 + atan((t*sqrt(3) - 1) /
+   (sqrt(3) + t))), each cut off where the next term falls below half a
+   unit in the last place.
+
+   Error bounds, against the exact values (checked against long double
+   over 10 million random angles):
+
+      dt_sin, dt_cos        within 2.3e-16 (absolute), for |deg| < 1e9
+      dt_atan2              within 3e-14 degrees
+      dt_acos               within 3e-14 degrees, argument clamped to -1..1
+
+   -- as good as the C library's for everything this code asks of them
+   (the NMEA sentences report a track to 0.1 degree).
+
+   The array calls run the same kernels over whole arrays in single loops
+   with no branching from element to element, so the compiler can
+   vectorize them (gcc -O3 turns each loop into SIMD code; the C
+   library's sin and cos would stop it).  The scalar calls are the
+   kernels one at a time.
+
+   The Arduino sketch can't link this library -- gpssim.pde carries its
+   own small table variants (cos from a half degree table, atan from a 64
+   step table) for processors without floating point hardware.
+*/
+
+#ifndef DEGTRIG_H__
+#define DEGTRIG_H__
+
+#define DT_DEG_TO_RAD  0.017453292519943295769236907684886
+#define DT_RAD_TO_DEG  57.295779513082320876798154814105
+
+double dt_sin(double deg);
+double dt_cos(double deg);
+void dt_sincos(double deg, double *s, double *c);
+
+/* direction of (x, y) from the x axis toward y, -180 to +180 degrees
+   (atan2(y,x) in degrees) -- 0 for (0, 0) */
+double dt_atan2(double y, double x);
+
+/* 0 to 180 degrees */
+double dt_acos(double c);
+
+/* whole arrays -- s or c may be NULL, an output may be an input */
+void dt_sincos_array(int n, double deg[], double s[], double c[]);
+void dt_atan2_array(int n, double y[], double x[], double deg[]);
+
+#endif
@@ -0,0 +1,63 @@
+#=======================================================================
+#@V@:Note: File automatically generated by VIDE - 2.00/10Apr03 (gcc).
+# Generated 11:36:38 AM 19 Oct 2026
+# This file regenerated each time you run VIDE, so save under a
+#    new name if you hand edit, or it will be overwritten.
+#=======================================================================
+
+# Standard defines:
+CC  	=	gcc
+LD  	=	gcc
+WRES	=	windres
+HOMEV	=	
+VPATH	=	$(HOMEV)/include
+oDir	=	.
+Bin	=	.
+libDirs	=	-L../../clibrary
+
+incDirs	=	-I../../clibrary
+
+LD_FLAGS =	-s
+LIBS	=	-lm
+C_FLAGS	=	-O
+
+SRCS	=\
+	evtrace.c
+
+EXOBJS	=\
+	$(oDir)/evtrace.o
+
+ALLOBJS	=	$(EXOBJS)
+ALLBIN	=	$(Bin)/libevtrace.a
+ALLTGT	=	$(Bin)/libevtrace.a
+
+# User defines:
+
+#@# Targets follow ---------------------------------
+
+all:	$(ALLTGT)
+
+objs:	$(ALLOBJS)
+
+cleanobjs:
+	rm -f $(ALLOBJS)
+
+cleanbin:
+	rm -f $(ALLBIN)
+
+clean:	cleanobjs cleanbin
+
+cleanall:	cleanobjs cleanbin
+
+#@# User Targets follow ---------------------------------
+
+
+#@# Dependency rules follow -----------------------------
+
+$(Bin)/libevtrace.a: $(EXOBJS)
+	rm -f $(Bin)/libevtrace.a
+	ar cr $(Bin)/libevtrace.a $(EXOBJS)
+	ranlib $(Bin)/libevtrace.a
+
+$(oDir)/evtrace.o: evtrace.c evtrace.h
+	$(CC) $(C_FLAGS) $(incDirs) -c -o $@ $<
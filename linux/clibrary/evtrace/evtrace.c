@@ -0,0 +1,331 @@
+/* evtrace.c -- event tracing library -- records begin/end events into
+                per-thread ring buffers and writes them as a Chrome trace
+                (JSON) file -- see evtrace.h for usage notes
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__MINGW32__)
+#include <sys/time.h>
+#else
+#include <time.h>
+#endif
+
+#include "evtrace.h"
+
+
+/* MinGW (gcc 3.x) has neither thread-local storage nor the __sync
+   builtins -- the simulator is single threaded there, so a single
+   ring is shared by "all" threads and the ring list is a plain list */
+#if defined(__MINGW32__)
+#define EVTRACE_TLS
+#else
+#define EVTRACE_TLS __thread
+#endif
+
+
+typedef struct evtrace_ring_s
+  {
+   evtrace_rec *rec;            /* size entries, size is a power of 2 */
+   unsigned long size;
+   unsigned long mask;
+   volatile unsigned long head; /* total events ever written to ring */
+   volatile int busy;           /* its thread is writing an event */
+   int tid;                     /* small sequential thread number */
+   struct evtrace_ring_s *next;
+  }
+   evtrace_ring;
+
+
+volatile int evtrace_enabled = 0;
+
+static char trace_name[260] = "";
+static unsigned long trace_size = 0;
+static double trace_start_us = 0.0;
+static evtrace_ring * volatile ring_list = NULL;
+static volatile int ring_count = 0;
+
+static EVTRACE_TLS evtrace_ring *my_ring = NULL;
+
+
+/* -------------------------------------------------------- */
+
+static double now_us(void)
+  {
+#if defined(__MINGW32__)
+   struct timeval tv;
+
+   gettimeofday(&tv,NULL);
+   return ((double)tv.tv_sec * 1000000.0) + (double)tv.tv_usec;
+#else
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC,&ts);
+   return ((double)ts.tv_sec * 1000000.0) + ((double)ts.tv_nsec / 1000.0);
+#endif
+  }
+
+
+/* allocate and publish a ring for the calling thread -- the ring list
+   is only ever pushed onto, so a compare-and-swap is enough */
+static evtrace_ring *new_ring(void)
+  {
+   evtrace_ring *ring;
+
+   ring = (evtrace_ring *)malloc(sizeof(evtrace_ring));
+   if (ring == NULL)
+     {
+      return NULL;
+     }
+   ring->rec = (evtrace_rec *)malloc(trace_size * sizeof(evtrace_rec));
+   if (ring->rec == NULL)
+     {
+      free(ring);
+      return NULL;
+     }
+   ring->size = trace_size;
+   ring->mask = trace_size - 1;
+   ring->head = 0;
+   ring->busy = 0;
+
+#if defined(__MINGW32__)
+   ring->tid = ++ring_count;
+   ring->next = ring_list;
+   ring_list = ring;
+#else
+   ring->tid = __sync_add_and_fetch(&ring_count,1);
+   do
+     {
+      ring->next = ring_list;
+     }
+   while (!__sync_bool_compare_and_swap(&ring_list,ring->next,ring));
+#endif
+
+   return ring;
+  }
+
+
+/* the ring is marked busy while an event goes in, and recording is 
+   checked again after that -- evtrace_close() turns recording off first
+   and then waits for every busy ring, so it never reads a ring that is
+   being written (each side's fence keeps its two steps in order) */
+static void record(const char *name, int ph)
+  {
+   evtrace_ring *ring;
+   evtrace_rec *rec;
+
+   ring = my_ring;
+   if (ring == NULL)
+     {
+      /* first event on this thread */
+      ring = new_ring();
+      if (ring == NULL)
+        {
+         return;
+        }
+      my_ring = ring;
+     }
+
+   ring->busy = 1;
+#if !defined(__MINGW32__)
+   __sync_synchronize();
+#endif
+   if (!evtrace_enabled)
+     {
+      ring->busy = 0;
+      return;
+     }
+
+   rec = &ring->rec[ring->head & ring->mask];
+   rec->ts = now_us() - trace_start_us;
+   rec->name = name;
+   rec->ph = ph;
+
+   /* the slot must be complete before head says it exists -- only the
+      compiler can reorder here (same thread), no fence is needed */
+#if defined(__GNUC__)
+   __asm__ __volatile__("" : : : "memory");
+#endif
+   ring->head = ring->head + 1;
+#if defined(__GNUC__)
+   __asm__ __volatile__("" : : : "memory");
+#endif
+   ring->busy = 0;
+  }
+
+
+void evtrace_begin(const char *name)
+  {
+   record(name,'B');
+  }
+
+
+void evtrace_end(const char *name)
+  {
+   record(name,'E');
+  }
+
+
+/* -------------------------------------------------------- */
+
+int evtrace_open(char fname[], long events_per_thread)
+  {
+   evtrace_ring *ring;
+   unsigned long size;
+
+   evtrace_close();
+
+   if ((fname == NULL) || (fname[0] == 0))
+     {
+      return 0;
+     }
+
+   if (events_per_thread <= 0)
+     {
+      events_per_thread = EVTRACE_DEFAULT_EVENTS;
+     }
+
+   /* round ring size up to a power of 2 so slot = head & mask */
+   size = 16;
+   while (size < (unsigned long)events_per_thread)
+     {
+      size += size;
+     }
+
+   strncpy(trace_name,fname,259);
+   trace_name[259] = 0;
+
+   /* other threads may still hold the rings of an earlier trace, so
+      those keep the size they were made with */
+   if (ring_list == NULL)
+     {
+      trace_size = size;
+     }
+
+   /* rings left over from an earlier trace are emptied for reuse */
+   for (ring=ring_list; ring != NULL; ring=ring->next)
+     {
+      ring->head = 0;
+     }
+
+   trace_start_us = now_us();
+   evtrace_enabled = 1;
+   return 1;
+  }
+
+
+long evtrace_dropped(void)
+  {
+   evtrace_ring *ring;
+   long dropped = 0L;
+
+   for (ring=ring_list; ring != NULL; ring=ring->next)
+     {
+      if (ring->head > ring->size)
+        {
+         dropped += (long)(ring->head - ring->size);
+        }
+     }
+   return dropped;
+  }
+
+
+static void put_name(FILE *unit, const char *name)
+  {
+   fputc('"',unit);
+   for ( ; *name; name++)
+     {
+      if ((*name == '"') || (*name == '\\'))
+        {
+         fputc('\\',unit);
+        }
+      if ((unsigned char)*name >= ' ')
+        {
+         fputc(*name,unit);
+        }
+     }
+   fputc('"',unit);
+  }
+
+
+void evtrace_close(void)
+  {
+   FILE *unit;
+   evtrace_ring *ring;
+   evtrace_rec *rec;
+   unsigned long i, first, last;
+   int depth;
+   int count = 0;
+
+   if (!evtrace_enabled)
+     {
+      return;
+     }
+   evtrace_enabled = 0;
+
+   /* let any event being written on another thread finish */
+#if !defined(__MINGW32__)
+   __sync_synchronize();
+#endif
+   for (ring=ring_list; ring != NULL; ring=ring->next)
+     {
+      while (ring->busy)
+        {
+        }
+     }
+
+   unit = fopen(trace_name,"w");
+   if (unit == NULL)
+     {
+      fprintf(stderr,"evtrace: unable to write %s\n",trace_name);
+      return;
+     }
+
+   fprintf(unit,"{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+   for (ring=ring_list; ring != NULL; ring=ring->next)
+     {
+      last = ring->head;
+      first = 0;
+      if (last > ring->size)
+        {
+         first = last - ring->size;
+        }
+
+      fprintf(unit,"%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                   "\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",
+                   (count ? ",\n" : ""),ring->tid,ring->tid);
+      count++;
+
+      /* oldest events may have been overwritten -- an end event whose
+         begin was dropped would confuse the viewer, so skip those */
+      depth = 0;
+      for (i=first; i<last; i++)
+        {
+         rec = &ring->rec[i & ring->mask];
+         if (rec->ph == 'E')
+           {
+            if (depth == 0)
+              {
+               continue;
+              }
+            depth--;
+           }
+         else
+           {
+            depth++;
+           }
+
+         fprintf(unit,",\n{\"name\":");
+         put_name(unit,rec->name);
+         fprintf(unit,",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%d}",
+                      rec->ph,rec->ts,ring->tid);
+        }
+     }
+
+   fprintf(unit,"\n],\"otherData\":{\"dropped_events\":%ld,"
+                "\"events_per_thread\":%lu}}\n",evtrace_dropped(),trace_size);
+   fclose(unit);
+  }
@@ -0,0 +1,675 @@
+/* flight.c -- balloon flight model library -- flies latex sounding balloons
+               up to burst and down under a parachute, through the 1976 US
+               Standard Atmosphere and a layered wind profile -- see flight.h
+
+               Each step, for every flight:  the gas volume from the ideal
+               gas law at the outside pressure and temperature, buoyancy less
+               weight for the vertical force, and drag taken at the end of
+               the step (so that no step size makes it unstable), then the
+               drift with the wind, interpolated between the profile's
+               altitudes.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+#include "flight.h"
+
+#define FL_PI           3.1415926535897932384626433832795
+#define FL_RAD_TO_DEG   57.295779513082320876798154814105
+
+#define FL_EARTH_R      6371008.8         /* mean earth radius, m */
+#define FL_G0           9.80665           /* standard gravity, m/s^2 */
+#define FL_GAS_R        8.31446           /* gas constant, J/(mol K) */
+#define FL_AIR_M        0.0289644         /* molar mass of air, kg/mol */
+#define FL_HELIUM_M     0.0040026         /* molar mass of helium, kg/mol */
+
+/* standard atmosphere table -- 0 to 85 km every 100 m */
+#define FL_ATMOS_STEP   100.0
+#define FL_ATMOS_N      851
+
+char fl_error[200] = "";
+
+static int fl_atmos_made = 0;
+static double fl_density[FL_ATMOS_N];
+static double fl_pressure[FL_ATMOS_N];
+static double fl_temp[FL_ATMOS_N];
+
+static unsigned long fl_rand_state;
+
+
+/* ------------------------------------------------------------------------ */
+
+/* 1976 US Standard Atmosphere to 86 km -- layers of constant lapse rate in
+   geopotential altitude, each starting from the temperature and pressure
+   at the top of the one below */
+static void fl_make_atmosphere(void)
+  {
+   static double base[8] = { 0.0, 11000.0, 20000.0, 32000.0, 47000.0, 51000.0, 71000.0, 84852.0 };
+   static double lapse[7] = { -0.0065, 0.0, 0.001, 0.0028, 0.0, -0.0028, -0.002 };
+   double tb[7], pb[7];
+   double z, h, t, p;
+   int i, j;
+
+   tb[0] = 288.15;
+   pb[0] = 101325.0;
+   for (j=0; j<6; j++)
+     {
+      tb[j+1] = tb[j] + lapse[j] * (base[j+1] - base[j]);
+      if (lapse[j] == 0.0)
+        {
+         pb[j+1] = pb[j] * exp(-FL_G0 * FL_AIR_M * (base[j+1] - base[j]) / (FL_GAS_R * tb[j]));
+        }
+      else
+        {
+         pb[j+1] = pb[j] * pow(tb[j] / tb[j+1],FL_G0 * FL_AIR_M / (FL_GAS_R * lapse[j]));
+        }
+     }
+
+   for (i=0; i<FL_ATMOS_N; i++)
+     {
+      z = i * FL_ATMOS_STEP;
+      h = 6356766.0 * z / (6356766.0 + z);     /* geopotential altitude */
+      for (j=6; (j > 0) && (h < base[j]); j--)
+        {
+        }
+      t = tb[j] + lapse[j] * (h - base[j]);
+      if (lapse[j] == 0.0)
+        {
+         p = pb[j] * exp(-FL_G0 * FL_AIR_M * (h - base[j]) / (FL_GAS_R * tb[j]));
+        }
+      else
+        {
+         p = pb[j] * pow(tb[j] / t,FL_G0 * FL_AIR_M / (FL_GAS_R * lapse[j]));
+        }
+      fl_temp[i] = t;
+      fl_pressure[i] = p;
+      fl_density[i] = p * FL_AIR_M / (FL_GAS_R * t);
+     }
+
+   fl_atmos_made = 1;
+  }
+
+
+void fl_atmosphere(double alt, double *density, double *pressure, double *temp)
+  {
+   double x, f;
+   int i;
+
+   if (!fl_atmos_made)
+     {
+      fl_make_atmosphere();
+     }
+
+   x = alt / FL_ATMOS_STEP;
+   if (x <= 0.0)
+     {
+      i = 0;
+      f = 0.0;
+     }
+   else if (x >= FL_ATMOS_N - 1)
+     {
+      i = FL_ATMOS_N - 2;
+      f = 1.0;
+     }
+   else
+     {
+      i = (int)x;
+      f = x - i;
+     }
+
+   *density = fl_density[i] + f * (fl_density[i+1] - fl_density[i]);
+   *pressure = fl_pressure[i] + f * (fl_pressure[i+1] - fl_pressure[i]);
+   *temp = fl_temp[i] + f * (fl_temp[i+1] - fl_temp[i]);
+  }
+
+
+/* wind at an altitude -- *layer is the profile altitude at or below the
+   last one asked for, so a climbing or falling balloon moves it one
+   layer at a time instead of searching */
+static void fl_wind(fl_winds *w, double alt, int *layer, double *east, double *north)
+  {
+   int j;
+   double f;
+
+   if ((w == NULL) || (w->count == 0))
+     {
+      *east = 0.0;
+      *north = 0.0;
+      return;
+     }
+
+   j = *layer;
+   while ((j > 0) && (alt < w->alt[j]))
+     {
+      j--;
+     }
+   while ((j < w->count - 1) && (alt >= w->alt[j+1]))
+     {
+      j++;
+     }
+   *layer = j;
+
+   if ((alt <= w->alt[j]) || (j == w->count - 1))
+     {
+      *east = w->east[j];
+      *north = w->north[j];
+     }
+   else
+     {
+      f = (alt - w->alt[j]) / (w->alt[j+1] - w->alt[j]);
+      *east = w->east[j] + f * (w->east[j+1] - w->east[j]);
+      *north = w->north[j] + f * (w->north[j+1] - w->north[j]);
+     }
+  }
+
+
+/* -1 to 1, repeatable from the seed and independent of rand() */
+static double fl_spread(void)
+  {
+   fl_rand_state = (fl_rand_state * 1103515245UL + 12345UL) & 0xFFFFFFFFUL;
+   return (double)((fl_rand_state >> 8) & 0xFFFFUL) / 32767.5 - 1.0;
+  }
+
+
+/* ------------------------------------------------------------------------ */
+
+void fl_default_params(fl_params *p)
+  {
+   memset(p,0,sizeof(fl_params));
+   p->date = 100308L;
+   p->time = 14000L;
+   p->lat = 35.962483;
+   p->lon = -83.873550;
+   p->alt = 256.0;
+   p->balloon_mass = 1.2;
+   p->payload_mass = 2.0;
+   p->gas_volume = 4.5;
+   p->burst_diameter = 8.63;
+   p->balloon_cd = 0.3;
+   p->chute_diameter = 1.5;
+   p->chute_cd = 1.5;
+   p->steps = 2;
+   p->waypoint_secs = 60;
+   p->max_hours = 12.0;
+   p->seed = 1UL;
+  }
+
+
+int fl_read_params(fl_params *p, char fname[])
+  {
+   FILE *unit;
+   char line[200];
+   char key[40];
+   char val[120];
+   int lineno = 0;
+   int i, j;
+
+   unit = fopen(fname,"r");
+   if (unit == NULL)
+     {
+      sprintf(fl_error,"Can't open %.150s",fname);
+      return 0;
+     }
+
+   while (fgets(line,199,unit) != NULL)
+     {
+      lineno++;
+      for (i=0; (line[i] == ' ') || (line[i] == '\t'); i++)
+        {
+        }
+      if ((line[i] == 0) || (line[i] == '#') || (line[i] == ';') ||
+          (line[i] == '\r') || (line[i] == '\n'))
+        {
+         continue;
+        }
+
+      for (j=0; (line[i] != 0) && (line[i] != '=') && !isspace((unsigned char)line[i]); i++)
+        {
+         if (j < 39)
+           {
+            key[j++] = tolower(line[i]);
+           }
+        }
+      key[j] = 0;
+      for ( ; (line[i] == '=') || ((line[i] != 0) && isspace((unsigned char)line[i])); i++)
+        {
+        }
+      for (j=0; (line[i] != 0) && !isspace((unsigned char)line[i]) && (j < 119); i++)
+        {
+         val[j++] = line[i];
+        }
+      val[j] = 0;
+
+      if (val[0] == 0)
+        {
+         sprintf(fl_error,"%.100s line %d: no value for %s",fname,lineno,key);
+         fclose(unit);
+         return 0;
+        }
+
+      if (strcmp(key,"date") == 0)
+        {
+         p->date = atol(val);
+        }
+      else if (strcmp(key,"time") == 0)
+        {
+         p->time = atol(val);
+        }
+      else if (strcmp(key,"lat") == 0)
+        {
+         p->lat = atof(val);
+        }
+      else if (strcmp(key,"long") == 0)
+        {
+         p->lon = atof(val);
+        }
+      else if (strcmp(key,"alt") == 0)
+        {
+         p->alt = atof(val);
+        }
+      else if (strcmp(key,"balloon_mass") == 0)
+        {
+         p->balloon_mass = atof(val);
+        }
+      else if (strcmp(key,"payload_mass") == 0)
+        {
+         p->payload_mass = atof(val);
+        }
+      else if (strcmp(key,"gas_volume") == 0)
+        {
+         p->gas_volume = atof(val);
+        }
+      else if (strcmp(key,"burst_diameter") == 0)
+        {
+         p->burst_diameter = atof(val);
+        }
+      else if (strcmp(key,"balloon_cd") == 0)
+        {
+         p->balloon_cd = atof(val);
+        }
+      else if (strcmp(key,"chute_diameter") == 0)
+        {
+         p->chute_diameter = atof(val);
+        }
+      else if (strcmp(key,"chute_cd") == 0)
+        {
+         p->chute_cd = atof(val);
+        }
+      else if (strcmp(key,"steps") == 0)
+        {
+         p->steps = atoi(val);
+        }
+      else if (strcmp(key,"waypoint_secs") == 0)
+        {
+         p->waypoint_secs = atoi(val);
+        }
+      else if (strcmp(key,"max_hours") == 0)
+        {
+         p->max_hours = atof(val);
+        }
+      else if (strcmp(key,"vary_gas") == 0)
+        {
+         p->vary_gas = atof(val);
+        }
+      else if (strcmp(key,"vary_burst") == 0)
+        {
+         p->vary_burst = atof(val);
+        }
+      else if (strcmp(key,"vary_wind") == 0)
+        {
+         p->vary_wind = atof(val);
+        }
+      else if (strcmp(key,"seed") == 0)
+        {
+         p->seed = (unsigned long)atol(val);
+        }
+      else if (strcmp(key,"winds") == 0)
+        {
+         strncpy(p->winds,val,99);
+         p->winds[99] = 0;
+        }
+      else
+        {
+         sprintf(fl_error,"%.100s line %d: unknown setting %s",fname,lineno,key);
+         fclose(unit);
+         return 0;
+        }
+     }
+   fclose(unit);
+
+   if ((p->steps < 1) || (p->steps > 100) || (p->waypoint_secs < 1) ||
+       (p->gas_volume <= 0.0) || (p->burst_diameter <= 0.0) ||
+       (p->balloon_mass + p->payload_mass <= 0.0) || (p->chute_diameter <= 0.0))
+     {
+      sprintf(fl_error,"%.100s: STEPS, WAYPOINT_SECS, masses, volume and diameters must be positive",fname);
+      return 0;
+     }
+   return 1;
+  }
+
+
+int fl_read_winds(fl_winds *w, char fname[])
+  {
+   FILE *unit;
+   char line[200];
+   double alt, speed, dir;
+   int lineno = 0;
+
+   w->count = 0;
+   unit = fopen(fname,"r");
+   if (unit == NULL)
+     {
+      sprintf(fl_error,"Can't open %.150s",fname);
+      return 0;
+     }
+
+   while (fgets(line,199,unit) != NULL)
+     {
+      lineno++;
+      if ((line[strspn(line," \t\r\n")] == 0) || (line[strspn(line," \t")] == '#'))
+        {
+         continue;
+        }
+      if ((sscanf(line,"%lf %lf %lf",&alt,&speed,&dir) != 3) ||
+          ((w->count > 0) && (alt <= w->alt[w->count-1])))
+        {
+         sprintf(fl_error,"%.100s line %d: expected altitude (ascending), speed, direction",fname,lineno);
+         fclose(unit);
+         w->count = 0;
+         return 0;
+        }
+      if (w->count >= FL_MAX_LAYERS)
+        {
+         sprintf(fl_error,"%.100s: more than %d altitudes",fname,FL_MAX_LAYERS);
+         fclose(unit);
+         w->count = 0;
+         return 0;
+        }
+
+      /* from the direction given, toward the opposite one */
+      w->alt[w->count] = alt;
+      w->east[w->count] = -speed * sin(dir / FL_RAD_TO_DEG);
+      w->north[w->count] = -speed * cos(dir / FL_RAD_TO_DEG);
+      w->count++;
+     }
+   fclose(unit);
+
+   if (w->count == 0)
+     {
+      sprintf(fl_error,"%.100s: no winds",fname);
+     }
+   return w->count;
+  }
+
+
+/* ------------------------------------------------------------------------ */
+
+int fl_batch_init(fl_batch *b, fl_params *p, int n)
+  {
+   double density, pressure, temp;
+   double r;
+   int i;
+
+   memset(b,0,sizeof(fl_batch));
+   b->lat = (double *)calloc(n,sizeof(double));
+   b->lon = (double *)calloc(n,sizeof(double));
+   b->alt = (double *)calloc(n,sizeof(double));
+   b->vz = (double *)calloc(n,sizeof(double));
+   b->phase = (int *)calloc(n,sizeof(int));
+   b->layer = (int *)calloc(n,sizeof(int));
+   b->gas_moles = (double *)calloc(n,sizeof(double));
+   b->mass = (double *)calloc(n,sizeof(double));
+   b->burst_diameter = (double *)calloc(n,sizeof(double));
+   b->wind_scale = (double *)calloc(n,sizeof(double));
+   b->burst_secs = (double *)calloc(n,sizeof(double));
+   b->burst_alt = (double *)calloc(n,sizeof(double));
+   b->land_secs = (double *)calloc(n,sizeof(double));
+   b->land_lat = (double *)calloc(n,sizeof(double));
+   b->land_lon = (double *)calloc(n,sizeof(double));
+   if ((b->lat == NULL) || (b->lon == NULL) || (b->alt == NULL) || (b->vz == NULL) ||
+       (b->phase == NULL) || (b->layer == NULL) || (b->gas_moles == NULL) ||
+       (b->mass == NULL) || (b->burst_diameter == NULL) || (b->wind_scale == NULL) ||
+       (b->burst_secs == NULL) || (b->burst_alt == NULL) || (b->land_secs == NULL) ||
+       (b->land_lat == NULL) || (b->land_lon == NULL))
+     {
+      fl_batch_free(b);
+      return 0;
+     }
+
+   b->count = n;
+   b->secs = 0.0;
+   b->ground = p->alt;
+   b->balloon_cd = p->balloon_cd;
+   b->chute_cd = p->chute_cd;
+   b->chute_area = 0.25 * FL_PI * p->chute_diameter * p->chute_diameter;
+
+   /* helium to fill gas_volume at the launch site */
+   fl_atmosphere(p->alt,&density,&pressure,&temp);
+   fl_rand_state = p->seed;
+
+   for (i=0; i<n; i++)
+     {
+      b->lat[i] = p->lat;
+      b->lon[i] = p->lon;
+      b->alt[i] = p->alt;
+      b->phase[i] = FL_ASCENT;
+      b->mass[i] = p->balloon_mass + p->payload_mass;
+      b->gas_moles[i] = pressure * p->gas_volume / (FL_GAS_R * temp);
+      b->burst_diameter[i] = p->burst_diameter;
+      b->wind_scale[i] = 1.0;
+      b->burst_secs[i] = -1.0;
+      b->land_secs[i] = -1.0;
+
+      if (i > 0)
+        {
+         r = fl_spread();
+         b->gas_moles[i] *= 1.0 + r * p->vary_gas / 100.0;
+         r = fl_spread();
+         b->burst_diameter[i] *= 1.0 + r * p->vary_burst / 100.0;
+         r = fl_spread();
+         b->wind_scale[i] += r * p->vary_wind / 100.0;
+        }
+     }
+   return 1;
+  }
+
+
+void fl_batch_free(fl_batch *b)
+  {
+   free(b->lat);
+   free(b->lon);
+   free(b->alt);
+   free(b->vz);
+   free(b->phase);
+   free(b->layer);
+   free(b->gas_moles);
+   free(b->mass);
+   free(b->burst_diameter);
+   free(b->wind_scale);
+   free(b->burst_secs);
+   free(b->burst_alt);
+   free(b->land_secs);
+   free(b->land_lat);
+   free(b->land_lon);
+   memset(b,0,sizeof(fl_batch));
+  }
+
+
+void fl_step(fl_batch *b, fl_winds *w, double dt)
+  {
+   double density, pressure, temp;
+   double r, g, vol, diam, force, m, area, cd, kd, v, east, north, f;
+   int i;
+
+   for (i=0; i<b->count; i++)
+     {
+      if (b->phase[i] == FL_LANDED)
+        {
+         continue;
+        }
+
+      fl_atmosphere(b->alt[i],&density,&pressure,&temp);
+      r = FL_EARTH_R + b->alt[i];
+      g = FL_G0 * (FL_EARTH_R / r) * (FL_EARTH_R / r);
+
+      vol = 0.0;
+      diam = 0.0;
+      if (b->phase[i] == FL_ASCENT)
+        {
+         vol = b->gas_moles[i] * FL_GAS_R * temp / pressure;
+         diam = cbrt(6.0 * vol / FL_PI);
+         if (diam >= b->burst_diameter[i])
+           {
+            b->phase[i] = FL_DESCENT;
+            b->burst_secs[i] = b->secs;
+            b->burst_alt[i] = b->alt[i];
+           }
+        }
+
+      if (b->phase[i] == FL_ASCENT)
+        {
+         m = b->mass[i] + b->gas_moles[i] * FL_HELIUM_M;
+         force = (density * vol - m) * g;
+         m += 0.5 * density * vol;       /* the air pushed aside moves too */
+         area = 0.25 * FL_PI * diam * diam;
+         cd = b->balloon_cd;
+        }
+      else
+        {
+         m = b->mass[i];                 /* what is left of the balloon comes down with the payload */
+         force = -m * g;
+         area = b->chute_area;
+         cd = b->chute_cd;
+        }
+
+      v = b->vz[i];
+      kd = 0.5 * density * cd * area / m;
+      v = (v + force / m * dt) / (1.0 + kd * fabs(v) * dt);
+      b->vz[i] = v;
+      b->alt[i] += v * dt;
+
+      fl_wind(w,b->alt[i],&b->layer[i],&east,&north);
+      b->lat[i] += b->wind_scale[i] * north * dt / r * FL_RAD_TO_DEG;
+      b->lon[i] += b->wind_scale[i] * east * dt / (r * cos(b->lat[i] / FL_RAD_TO_DEG)) * FL_RAD_TO_DEG;
+
+      if ((b->phase[i] == FL_DESCENT) && (b->alt[i] <= b->ground))
+        {
+         /* part of the step it was still in the air */
+         f = (v < 0.0) ? (b->alt[i] - v * dt - b->ground) / (-v * dt) : 1.0;
+         b->phase[i] = FL_LANDED;
+         b->land_secs[i] = b->secs + f * dt;
+         b->land_lat[i] = b->lat[i];
+         b->land_lon[i] = b->lon[i];
+         b->alt[i] = b->ground;
+         b->vz[i] = 0.0;
+        }
+     }
+
+   b->secs += dt;
+  }
+
+
+/* ------------------------------------------------------------------------ */
+
+static void fl_record(fl_track *trk, fl_batch *b, long secs)
+  {
+   long *s;
+   double *la, *lo, *al;
+
+   if (trk->count >= trk->size)
+     {
+      s = (long *)realloc(trk->secs,(trk->size + 256) * sizeof(long));
+      if (s != NULL)
+        {
+         trk->secs = s;
+        }
+      la = (double *)realloc(trk->lat,(trk->size + 256) * sizeof(double));
+      if (la != NULL)
+        {
+         trk->lat = la;
+        }
+      lo = (double *)realloc(trk->lon,(trk->size + 256) * sizeof(double));
+      if (lo != NULL)
+        {
+         trk->lon = lo;
+        }
+      al = (double *)realloc(trk->alt,(trk->size + 256) * sizeof(double));
+      if (al != NULL)
+        {
+         trk->alt = al;
+        }
+      if ((s == NULL) || (la == NULL) || (lo == NULL) || (al == NULL))
+        {
+         return;       /* out of memory -- the track stops here */
+        }
+      trk->size += 256;
+     }
+
+   trk->secs[trk->count] = secs;
+   trk->lat[trk->count] = b->lat[0];
+   trk->lon[trk->count] = b->lon[0];
+   trk->alt[trk->count] = b->alt[0];
+   trk->count++;
+  }
+
+
+int fl_fly(fl_batch *b, fl_params *p, fl_winds *w, fl_track *trk)
+  {
+   double dt;
+   long sec, maxsecs;
+   int phase0, landed, i, k;
+
+   dt = 1.0 / p->steps;
+   maxsecs = (long)(p->max_hours * 3600.0);
+
+   if (trk != NULL)
+     {
+      trk->count = 0;
+      fl_record(trk,b,0L);
+     }
+
+   landed = 0;
+   for (sec=1; (sec <= maxsecs) && (landed < b->count); sec++)
+     {
+      phase0 = b->phase[0];
+      for (k=0; k<p->steps; k++)
+        {
+         fl_step(b,w,dt);
+        }
+
+      /* every waypoint_secs, and the second of burst or landing */
+      if ((trk != NULL) && (phase0 != FL_LANDED) &&
+          (((sec % p->waypoint_secs) == 0) || (b->phase[0] != phase0)))
+        {
+         fl_record(trk,b,sec);
+        }
+
+      for (landed=0, i=0; i<b->count; i++)
+        {
+         landed += (b->phase[i] == FL_LANDED);
+        }
+     }
+
+   /* still up at max_hours -- end the track where it got to */
+   if ((trk != NULL) && (b->phase[0] != FL_LANDED) && (trk->count > 0) &&
+       (trk->secs[trk->count-1] != sec - 1))
+     {
+      fl_record(trk,b,sec - 1);
+     }
+
+   return landed;
+  }
+
+
+void fl_track_free(fl_track *trk)
+  {
+   free(trk->secs);
+   free(trk->lat);
+   free(trk->lon);
+   free(trk->alt);
+   memset(trk,0,sizeof(fl_track));
+  }
@@ -0,0 +1,150 @@
+/* flight.h -- header file for
+               balloon flight model library which flies a latex sounding
+               balloon from launch -- ascent under buoyancy, burst, then
+               descent under a parachute -- through a standard atmosphere
+               and a layered wind profile, to give the balloon's position
+               every second of the flight
+
+   The flights are held as a structure of arrays -- one array per state
+   variable, indexed by flight -- and fl_step() advances every flight of
+   a batch by one fixed time step in a single pass, so that many
+   scenarios (e.g. launch gas and burst size varied a few percent) are
+   flown together as cheaply as one.
+
+   Model:  the gas is helium at the temperature and pressure of the air
+   around it (zero pressure balloon), so the balloon swells as it rises
+   until its diameter reaches the burst diameter.  Lift is the weight of
+   the air displaced less the weight of balloon, payload and gas, against
+   a quadratic drag on the balloon's cross section (on the parachute's on
+   the way down).  The balloon drifts with the wind at its altitude.  The
+   air is the 1976 US Standard Atmosphere, from a table at 100 m steps.
+   The ground is flat, at the launch altitude.
+
+   Positions are geodetic degrees (east and north positive) and meters
+   above sea level, on a spherical earth -- good to a few hundred meters
+   over a flight, well inside what the winds are known to.
+*/
+
+#ifndef FLIGHT_H__
+#define FLIGHT_H__
+
+#include <stdio.h>
+
+#define FL_MAX_LAYERS   200               /* wind profile altitudes */
+
+#define FL_ASCENT       0                 /* phase of each flight */
+#define FL_DESCENT      1
+#define FL_LANDED       2
+
+typedef struct
+  {
+   long date;                        /* launch, DDMMYY */
+   long time;                        /* launch, HHMMSS UTC */
+   double lat;                       /* launch site, degrees */
+   double lon;
+   double alt;                       /* meters -- also the ground for landing */
+   double balloon_mass;              /* kg */
+   double payload_mass;              /* kg, parachute included */
+   double gas_volume;                /* helium at launch, m^3 */
+   double burst_diameter;            /* m */
+   double balloon_cd;                /* drag coefficient, sphere */
+   double chute_diameter;            /* m */
+   double chute_cd;
+   int steps;                        /* integration steps per second */
+   int waypoint_secs;                /* seconds between waypoints recorded */
+   double max_hours;                 /* flights still up are stopped then */
+   double vary_gas;                  /* batch spread, percent (+ or -) */
+   double vary_burst;
+   double vary_wind;
+   unsigned long seed;               /* for the batch spread */
+   char winds[100];                  /* wind profile file, "" for calm */
+  }
+   fl_params;
+
+typedef struct
+  {
+   int count;                        /* altitudes, ascending */
+   double alt[FL_MAX_LAYERS];        /* meters */
+   double east[FL_MAX_LAYERS];       /* wind velocity (toward), m/s */
+   double north[FL_MAX_LAYERS];
+  }
+   fl_winds;
+
+typedef struct
+  {
+   int count;                        /* flights */
+   double secs;                      /* time since launch */
+   double ground;                    /* landing altitude */
+   double balloon_cd;
+   double chute_cd;
+   double chute_area;
+
+   /* state */
+   double *lat;                      /* degrees */
+   double *lon;
+   double *alt;                      /* meters */
+   double *vz;                       /* vertical speed, m/s */
+   int *phase;                       /* FL_ASCENT, FL_DESCENT or FL_LANDED */
+   int *layer;                       /* wind layer below, kept from step to step */
+
+   /* per flight constants (spread for a batch) */
+   double *gas_moles;
+   double *mass;                     /* balloon and payload, kg */
+   double *burst_diameter;
+   double *wind_scale;
+
+   /* results */
+   double *burst_secs;
+   double *burst_alt;
+   double *land_secs;
+   double *land_lat;
+   double *land_lon;
+  }
+   fl_batch;
+
+typedef struct
+  {
+   int count;                        /* waypoints recorded */
+   int size;
+   long *secs;                       /* whole seconds since launch */
+   double *lat;                      /* degrees */
+   double *lon;
+   double *alt;                      /* meters */
+  }
+   fl_track;
+
+
+/* last error from fl_read_params() or fl_read_winds() */
+extern char fl_error[];
+
+/* defaults -- a 1200 g balloon lifting a 2 kg payload */
+void fl_default_params(fl_params *p);
+
+/* read "KEYWORD value" lines into p (starting from whatever p holds) --
+   returns 0 and sets fl_error if the file can't be read or has a bad line */
+int fl_read_params(fl_params *p, char fname[]);
+
+/* read a wind profile, one "altitude_m  speed_m/s  direction_deg" line
+   per altitude, direction being where the wind blows from -- returns the
+   number of altitudes, 0 (and fl_error set) if none */
+int fl_read_winds(fl_winds *w, char fname[]);
+
+/* air density (kg/m^3), pressure (Pa) and temperature (K) at an altitude */
+void fl_atmosphere(double alt, double *density, double *pressure, double *temp);
+
+/* allocate and launch n flights -- flight 0 as given, the others spread
+   by the vary_ percentages -- returns 0 if out of memory */
+int fl_batch_init(fl_batch *b, fl_params *p, int n);
+void fl_batch_free(fl_batch *b);
+
+/* advance every flight of the batch by dt seconds */
+void fl_step(fl_batch *b, fl_winds *w, double dt);
+
+/* fly the batch until every flight has landed (or max_hours), recording
+   flight 0 in trk (if not NULL) at launch, every waypoint_secs, at burst
+   and at landing -- returns the number of flights landed */
+int fl_fly(fl_batch *b, fl_params *p, fl_winds *w, fl_track *trk);
+
+void fl_track_free(fl_track *trk);
+
+#endif
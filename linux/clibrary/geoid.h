@@ -0,0 +1,78 @@
+/* geoid.h -- header file for
+              geoid undulation library which maps a worldwide geoid grid
+              (EGM2008 or EGM96) into memory and interpolates the height of
+              the geoid above the WGS 84 ellipsoid at any place
+
+   Two kinds of grid file are read:
+
+   - The NGA's EGM2008 binary grids, e.g.
+     Und_min2.5x2.5_egm2008_isw=82_WGS84_TideFree_SE (or the 1 minute
+     one):  rows from 90 N to 90 S, each a Fortran unformatted record --
+     a 4 byte length, the row's 4 byte floats from 0 E eastward, and the
+     length again.  These are mapped straight into memory (mmap, or a
+     file mapping on Windows), never read:  only the pages around the
+     places asked for are ever touched, and every process mapping the
+     same file shares one copy in the system's page cache.  Either byte
+     order is accepted.
+
+   - The NGA's EGM96 15 minute ASCII grid WW15MGH.GRD -- a header line of
+     south north west east lat_spacing long_spacing, then the rows from
+     north to south, west to east.  This is read into memory (4 MB).
+
+   gd_undulation() interpolates bilinearly between the 4 grid points
+   around a place.  It keeps the last cell and its 4 values in a
+   gd_cache, so a receiver moving within one cell -- 4.6 km of latitude
+   for the 2.5 minute grid -- costs only the bounds test and the blend,
+   with no memory touched outside the cache.  Keep one cache per moving
+   point.
+*/
+
+#ifndef GEOID_H__
+#define GEOID_H__
+
+typedef struct
+  {
+   int nrows;                        /* north to south */
+   int ncols;                        /* west to east from lon_w */
+   double lat_n;                     /* first row, degrees */
+   double lon_w;                     /* first column, degrees east */
+   double dlat;                      /* spacing, degrees */
+   double dlon;
+   int wrap;                         /* columns go all the way round */
+   const unsigned char *base;        /* first value of the first row */
+   long row_bytes;                   /* from row to row */
+   int swap;                         /* values in the other byte order */
+
+   /* how the file is held */
+   int mapped;
+   void *map;
+   long map_size;
+   void *map_handle;
+  }
+   geoid_grid;
+
+typedef struct
+  {
+   int valid;
+   double lat_s, lat_n;              /* bounds of the cell */
+   double lon_w, lon_e;
+   double v[4];                      /* sw, se, nw, ne */
+   long misses;                      /* times a new cell was loaded */
+  }
+   gd_cache;
+
+
+/* last error from gd_open() */
+extern char gd_error[];
+
+/* open a grid file -- returns the number of grid points, 0 (and gd_error
+   set) if the file can't be read or is not a grid */
+long gd_open(geoid_grid *g, char fname[]);
+void gd_close(geoid_grid *g);
+
+void gd_cache_clear(gd_cache *c);
+
+/* geoid height above the ellipsoid (m) at a place (degrees) */
+double gd_undulation(geoid_grid *g, gd_cache *c, double lat, double lon);
+
+#endif
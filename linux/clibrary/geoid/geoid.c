@@ -0,0 +1,338 @@
+/* geoid.c -- geoid undulation library -- maps EGM2008 binary geoid grids into
+              memory (or reads the EGM96 ASCII grid) and interpolates the
+              geoid height, keeping the last grid cell -- see geoid.h
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(_WIN32) || defined(__MINGW32__)
+#include <windows.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "geoid.h"
+
+char gd_error[200] = "";
+
+
+/* ------------------------------------------------------------------------ */
+
+/* map a whole file read only -- returns NULL if it can't be */
+static void *gd_map(geoid_grid *g, char fname[])
+  {
+#if defined(_WIN32) || defined(__MINGW32__)
+   HANDLE file, mapping;
+   void *p;
+
+   file = CreateFileA(fname,GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,
+                      FILE_ATTRIBUTE_NORMAL,NULL);
+   if (file == INVALID_HANDLE_VALUE)
+     {
+      return NULL;
+     }
+   g->map_size = (long)GetFileSize(file,NULL);
+   mapping = CreateFileMappingA(file,NULL,PAGE_READONLY,0,0,NULL);
+   CloseHandle(file);
+   if (mapping == NULL)
+     {
+      return NULL;
+     }
+   p = MapViewOfFile(mapping,FILE_MAP_READ,0,0,0);
+   if (p == NULL)
+     {
+      CloseHandle(mapping);
+      return NULL;
+     }
+   g->map_handle = (void *)mapping;
+   return p;
+#else
+   struct stat st;
+   void *p;
+   int fd;
+
+   fd = open(fname,O_RDONLY);
+   if (fd < 0)
+     {
+      return NULL;
+     }
+   if ((fstat(fd,&st) != 0) || (st.st_size < 16))
+     {
+      close(fd);
+      return NULL;
+     }
+   g->map_size = (long)st.st_size;
+   p = mmap(NULL,(size_t)st.st_size,PROT_READ,MAP_SHARED,fd,0);
+   close(fd);
+   return (p == MAP_FAILED) ? NULL : p;
+#endif
+  }
+
+
+static void gd_unmap(geoid_grid *g)
+  {
+#if defined(_WIN32) || defined(__MINGW32__)
+   UnmapViewOfFile(g->map);
+   CloseHandle((HANDLE)g->map_handle);
+#else
+   munmap(g->map,(size_t)g->map_size);
+#endif
+  }
+
+
+static unsigned long gd_swap4(unsigned long v)
+  {
+   return ((v & 0xffUL) << 24) | ((v & 0xff00UL) << 8) | ((v >> 8) & 0xff00UL) | ((v >> 24) & 0xffUL);
+  }
+
+
+/* a Fortran record marker, 4 bytes */
+static unsigned long gd_marker(const unsigned char *p, int swap)
+  {
+   unsigned int v;
+
+   memcpy(&v,p,4);
+   return swap ? gd_swap4((unsigned long)v) : (unsigned long)v;
+  }
+
+
+/* the EGM2008 binary layout -- rows of ncols floats between record markers */
+static int gd_binary(geoid_grid *g)
+  {
+   const unsigned char *p;
+   unsigned long m;
+   long rec;
+   int swap;
+
+   p = (const unsigned char *)g->map;
+   for (swap=0; swap<2; swap++)
+     {
+      m = gd_marker(p,swap);
+      rec = (long)m + 8L;
+      if ((m < 16UL) || ((m % 4UL) != 0UL) || (rec > g->map_size) || ((g->map_size % rec) != 0L) ||
+          (gd_marker(p + 4 + m,swap) != m))
+        {
+         continue;
+        }
+      g->ncols = (int)(m / 4UL);
+      g->nrows = (int)(g->map_size / rec);
+      if (g->nrows < 2)
+        {
+         continue;
+        }
+      g->dlon = 360.0 / g->ncols;
+      g->dlat = 180.0 / (g->nrows - 1);
+      g->lat_n = 90.0;
+      g->lon_w = 0.0;
+      g->base = p + 4;
+      g->row_bytes = rec;
+      g->swap = swap;
+      return 1;
+     }
+   return 0;
+  }
+
+
+/* the EGM96 ASCII layout -- read into memory as floats */
+static int gd_ascii(geoid_grid *g, char fname[])
+  {
+   FILE *unit;
+   double south, north, west, east, v;
+   float *vals;
+   long i, n;
+
+   unit = fopen(fname,"r");
+   if (unit == NULL)
+     {
+      sprintf(gd_error,"Can't open %.150s",fname);
+      return 0;
+     }
+   if ((fscanf(unit,"%lf %lf %lf %lf %lf %lf",&south,&north,&west,&east,&g->dlat,&g->dlon) != 6) ||
+       (north <= south) || (east <= west) || (g->dlat <= 0.0) || (g->dlon <= 0.0))
+     {
+      sprintf(gd_error,"%.100s: not an EGM2008 binary grid, nor a grid with a "
+                       "south north west east spacing header",fname);
+      fclose(unit);
+      return 0;
+     }
+   g->nrows = (int)floor((north - south) / g->dlat + 0.5) + 1;
+   g->ncols = (int)floor((east - west) / g->dlon + 0.5) + 1;
+   g->lat_n = north;
+   g->lon_w = west;
+
+   n = (long)g->nrows * g->ncols;
+   vals = (float *)malloc(n * sizeof(float));
+   if (vals == NULL)
+     {
+      sprintf(gd_error,"%.100s: out of memory for %ld points",fname,n);
+      fclose(unit);
+      return 0;
+     }
+   for (i=0; i<n; i++)
+     {
+      if (fscanf(unit,"%lf",&v) != 1)
+        {
+         sprintf(gd_error,"%.100s: expected %ld heights, found %ld",fname,n,i);
+         free(vals);
+         fclose(unit);
+         return 0;
+        }
+      vals[i] = (float)v;
+     }
+   fclose(unit);
+
+   g->base = (const unsigned char *)vals;
+   g->row_bytes = (long)g->ncols * (long)sizeof(float);
+   g->swap = 0;
+   return 1;
+  }
+
+
+long gd_open(geoid_grid *g, char fname[])
+  {
+   memset(g,0,sizeof(geoid_grid));
+
+   g->map = gd_map(g,fname);
+   if ((g->map != NULL) && gd_binary(g))
+     {
+      g->mapped = 1;
+     }
+   else
+     {
+      if (g->map != NULL)
+        {
+         gd_unmap(g);
+         g->map = NULL;
+        }
+      if (!gd_ascii(g,fname))
+        {
+         return 0;
+        }
+     }
+
+   /* whether the columns close around the earth */
+   g->wrap = ((g->ncols * g->dlon) >= 359.999999);
+   return (long)g->nrows * g->ncols;
+  }
+
+
+void gd_close(geoid_grid *g)
+  {
+   if (g->mapped)
+     {
+      gd_unmap(g);
+     }
+   else
+     {
+      free((void *)g->base);
+     }
+   memset(g,0,sizeof(geoid_grid));
+  }
+
+
+void gd_cache_clear(gd_cache *c)
+  {
+   memset(c,0,sizeof(gd_cache));
+  }
+
+
+/* one grid value */
+static double gd_value(geoid_grid *g, int row, int col)
+  {
+   unsigned int u;
+   float f;
+
+   memcpy(&u,g->base + (long)row * g->row_bytes + (long)col * 4L,4);
+   if (g->swap)
+     {
+      u = (unsigned int)gd_swap4((unsigned long)u);
+     }
+   memcpy(&f,&u,4);
+   return (double)f;
+  }
+
+
+/* load the cell holding a place -- lon is already east of lon_w */
+static void gd_find(geoid_grid *g, gd_cache *c, double lat, double lon)
+  {
+   int r, r1, col, col1;
+
+   r = (int)((g->lat_n - lat) / g->dlat);
+   r = (r > g->nrows - 2) ? g->nrows - 2 : r;
+   r = (r < 0) ? 0 : r;
+   r1 = r + 1;
+
+   col = (int)(lon / g->dlon);
+   col1 = col + 1;
+   if (col1 >= g->ncols)
+     {
+      if (g->wrap)
+        {
+         col = g->ncols - 1;
+         col1 = 0;
+        }
+      else
+        {
+         col = g->ncols - 2;
+         col1 = g->ncols - 1;
+        }
+     }
+
+   c->lat_n = g->lat_n - r * g->dlat;
+   c->lat_s = c->lat_n - g->dlat;
+   c->lon_w = col * g->dlon;
+   c->lon_e = c->lon_w + g->dlon;
+   c->v[0] = gd_value(g,r1,col);
+   c->v[1] = gd_value(g,r1,col1);
+   c->v[2] = gd_value(g,r,col);
+   c->v[3] = gd_value(g,r,col1);
+   c->valid = 1;
+   c->misses++;
+  }
+
+
+double gd_undulation(geoid_grid *g, gd_cache *c, double lat, double lon)
+  {
+   double fx, fy, s, n;
+   double top;
+
+   /* longitude east of the first column, latitude inside the grid */
+   lon -= g->lon_w;
+   while (lon < 0.0)
+     {
+      lon += 360.0;
+     }
+   while (lon >= 360.0)
+     {
+      lon -= 360.0;
+     }
+   top = g->lat_n - (g->nrows - 1) * g->dlat;
+   lat = (lat > g->lat_n) ? g->lat_n : ((lat < top) ? top : lat);
+   if (!g->wrap)
+     {
+      /* off a regional grid -- the nearer edge */
+      top = (g->ncols - 1) * g->dlon;
+      if (lon > top)
+        {
+         lon = (lon > 0.5 * (top + 360.0)) ? 0.0 : top;
+        }
+     }
+
+   if (!c->valid || (lat < c->lat_s) || (lat > c->lat_n) || (lon < c->lon_w) || (lon > c->lon_e))
+     {
+      gd_find(g,c,lat,lon);
+     }
+
+   fx = (lon - c->lon_w) / g->dlon;
+   fy = (lat - c->lat_s) / g->dlat;
+   s = c->v[0] + fx * (c->v[1] - c->v[0]);
+   n = c->v[2] + fx * (c->v[3] - c->v[2]);
+   return s + fy * (n - s);
+  }
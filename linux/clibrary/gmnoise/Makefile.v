@@ -0,0 +1,63 @@
+#=======================================================================
+#@V@:Note: File automatically generated by VIDE - 2.00/10Apr03 (gcc).
+# Generated 01:07:54 PM 19 Oct 2026
+# This file regenerated each time you run VIDE, so save under a
+#    new name if you hand edit, or it will be overwritten.
+#=======================================================================
+
+# Standard defines:
+CC  	=	gcc
+LD  	=	gcc
+WRES	=	windres
+HOMEV	=	
+VPATH	=	$(HOMEV)/include
+oDir	=	.
+Bin	=	.
+libDirs	=	-L../../clibrary
+
+incDirs	=	-I../../clibrary
+
+LD_FLAGS =	-s
+LIBS	=	-lm
+C_FLAGS	=	-O
+
+SRCS	=\
+	gmnoise.c
+
+EXOBJS	=\
+	$(oDir)/gmnoise.o
+
+ALLOBJS	=	$(EXOBJS)
+ALLBIN	=	$(Bin)/libgmnoise.a
+ALLTGT	=	$(Bin)/libgmnoise.a
+
+# User defines:
+
+#@# Targets follow ---------------------------------
+
+all:	$(ALLTGT)
+
+objs:	$(ALLOBJS)
+
+cleanobjs:
+	rm -f $(ALLOBJS)
+
+cleanbin:
+	rm -f $(ALLBIN)
+
+clean:	cleanobjs cleanbin
+
+cleanall:	cleanobjs cleanbin
+
+#@# User Targets follow ---------------------------------
+
+
+#@# Dependency rules follow -----------------------------
+
+$(Bin)/libgmnoise.a: $(EXOBJS)
+	rm -f $(Bin)/libgmnoise.a
+	ar cr $(Bin)/libgmnoise.a $(EXOBJS)
+	ranlib $(Bin)/libgmnoise.a
+
+$(oDir)/gmnoise.o: gmnoise.c gmnoise.h
+	$(CC) $(C_FLAGS) $(incDirs) -c -o $@ $<
@@ -708,6 +708,140 @@ double toradians(double degrees)
   }
 
 
+
+/* ------------------------------------------------------------------------
+   The following provide dilution of precision (DOP) from satellite geometry
+   without the FIFO workspace
+*/
+
+/* geometries are worked in blocks of this many -- the inner loops run
+   across a block with no branches, so they can be vectorized */
+#define DOPBLOCK 32
+
+#define DOPNEARZERO 1.0e-12
+
+
+int geomdop_batch(dops dop[], double los_e[], double los_n[], double los_u[],
+                  int count[], int maxsats, int ngeom)
+
+  {
+   /* the 10 distinct terms of the symmetric normal matrix
+         | a b c d |
+         | b f g h |
+         | c g k l |
+         | d h l p |
+      for each geometry of the block */
+   double a[DOPBLOCK], b[DOPBLOCK], c[DOPBLOCK], d[DOPBLOCK], f[DOPBLOCK];
+   double g[DOPBLOCK], h[DOPBLOCK], k[DOPBLOCK], l[DOPBLOCK], p[DOPBLOCK];
+   double q0[DOPBLOCK], q1[DOPBLOCK], q2[DOPBLOCK], q3[DOPBLOCK], det[DOPBLOCK];
+   double e, n, u, w;
+   double kp_ll, gp_lh, gl_kh, cp_ld, cl_kd, ch_gd, fp_hh, bp_hd, bh_fd;
+   int first, nblk, i, j, m;
+   int solved = 0;
+
+   for (first=0; first<ngeom; first+=DOPBLOCK)
+     {
+      nblk = ngeom - first;
+      if (nblk > DOPBLOCK)
+        {
+         nblk = DOPBLOCK;
+        }
+
+      for (j=0; j<nblk; j++)
+        {
+         a[j] = b[j] = c[j] = d[j] = f[j] = 0.0;
+         g[j] = h[j] = k[j] = l[j] = p[j] = 0.0;
+        }
+
+      /* accumulate normal matrix -- a satellite beyond count[] is replaced
+         by zeros (not multiplied by 0), so whatever the caller left in the
+         padding, even a NaN, can't reach the sums */
+      for (i=0; i<maxsats; i++)
+        {
+         m = (i * ngeom) + first;
+         for (j=0; j<nblk; j++)
+           {
+            e = los_e[m+j];
+            n = los_n[m+j];
+            u = los_u[m+j];
+            w = (i < count[first+j]) ? 1.0 : 0.0;
+            e = (i < count[first+j]) ? e : 0.0;
+            n = (i < count[first+j]) ? n : 0.0;
+            u = (i < count[first+j]) ? u : 0.0;
+            a[j] += e * e;
+            b[j] += e * n;
+            c[j] += e * u;
+            d[j] += e;
+            f[j] += n * n;
+            g[j] += n * u;
+            h[j] += n;
+            k[j] += u * u;
+            l[j] += u;
+            p[j] += w;
+           }
+        }
+
+      /* diagonal of the inverse -- diagonal cofactors over determinant */
+      for (j=0; j<nblk; j++)
+        {
+         kp_ll = (k[j] * p[j]) - (l[j] * l[j]);
+         gp_lh = (g[j] * p[j]) - (l[j] * h[j]);
+         gl_kh = (g[j] * l[j]) - (k[j] * h[j]);
+         cp_ld = (c[j] * p[j]) - (l[j] * d[j]);
+         cl_kd = (c[j] * l[j]) - (k[j] * d[j]);
+         ch_gd = (c[j] * h[j]) - (g[j] * d[j]);
+         fp_hh = (f[j] * p[j]) - (h[j] * h[j]);
+         bp_hd = (b[j] * p[j]) - (h[j] * d[j]);
+         bh_fd = (b[j] * h[j]) - (f[j] * d[j]);
+
+         q0[j] = (f[j] * kp_ll) - (g[j] * gp_lh) + (h[j] * gl_kh);
+         q1[j] = (a[j] * kp_ll) - (c[j] * cp_ld) + (d[j] * cl_kd);
+         q2[j] = (a[j] * fp_hh) - (b[j] * bp_hd) + (d[j] * bh_fd);
+         q3[j] = (a[j] * ((f[j] * k[j]) - (g[j] * g[j])))
+                 - (b[j] * ((b[j] * k[j]) - (g[j] * c[j])))
+                 + (c[j] * ((b[j] * g[j]) - (f[j] * c[j])));
+
+         det[j] = (a[j] * q0[j])
+                  - (b[j] * ((b[j] * kp_ll) - (g[j] * cp_ld) + (h[j] * cl_kd)))
+                  + (c[j] * ((b[j] * gp_lh) - (f[j] * cp_ld) + (h[j] * ch_gd)))
+                  - (d[j] * ((b[j] * gl_kh) - (f[j] * cl_kd) + (g[j] * ch_gd)));
+        }
+
+      for (j=0; j<nblk; j++)
+        {
+         if ((count[first+j] < 4) || (det[j] < DOPNEARZERO) || 
+             (q0[j] < 0.0) || (q1[j] < 0.0) || (q2[j] < 0.0) || (q3[j] < 0.0))
+           {
+            dop[first+j].gdop = DOP_SINGULAR;
+            dop[first+j].pdop = DOP_SINGULAR;
+            dop[first+j].hdop = DOP_SINGULAR;
+            dop[first+j].vdop = DOP_SINGULAR;
+            dop[first+j].tdop = DOP_SINGULAR;
+            continue;
+           }
+
+         w = 1.0 / det[j];
+         dop[first+j].hdop = sqrt((q0[j] + q1[j]) * w);
+         dop[first+j].vdop = sqrt(q2[j] * w);
+         dop[first+j].pdop = sqrt((q0[j] + q1[j] + q2[j]) * w);
+         dop[first+j].tdop = sqrt(q3[j] * w);
+         dop[first+j].gdop = sqrt((q0[j] + q1[j] + q2[j] + q3[j]) * w);
+         solved++;
+        }
+     }
+
+   return solved;
+  }
+
+
+int geomdop(dops *dop, double los_e[], double los_n[], double los_u[], int nsats)
+
+  {
+   /* one geometry is a batch of one -- satellite i is at [i * 1 + 0] */
+   return geomdop_batch(dop,los_e,los_n,los_u,&nsats,nsats,1);
+  }
+
+
 /* The following are examples of vector and matrix constant assignments:
 
    static vectr vec1 =
@@ -158,6 +158,42 @@ double todegrees(double radians);
 double toradians(double degrees);
 
 
+/* ------------------------------------------------------------------------
+   The following compute dilution of precision (DOP) from satellite
+   geometry.  Each satellite gives a row [e n u 1] of the geometry matrix
+   (unit line of sight in local east, north, up, plus receiver clock), and
+   the diagonal of the inverse of the 4 x 4 normal matrix gives the DOPs.
+   These do NOT use the FIFO workspace, so they may be called any number
+   of times in a statement, or from several threads.
+*/
+
+typedef struct
+  {
+   double gdop;
+   double pdop;
+   double hdop;
+   double vdop;
+   double tdop;
+  }
+   dops;
+
+/* value given to all DOPs when geometry can't be solved */
+#define DOP_SINGULAR 99.9
+
+/* DOP for one geometry of nsats satellites -- returns 0 (FALSE) and sets
+   all DOPs to DOP_SINGULAR if geometry can't be solved (fewer than 4
+   satellites, or all in one plane), else returns 1 (TRUE) */
+int geomdop(dops *dop, double los_e[], double los_n[], double los_u[], int nsats);
+
+/* DOP for ngeom geometries at once (epochs, or receivers) -- geometry k
+   uses count[k] satellites (at most maxsats), whose line of sight
+   components are stored satellite by satellite with the geometries side
+   by side: los_e[(i * ngeom) + k] for satellite i of geometry k -- fills
+   dop[0] to dop[ngeom-1] and returns the number of geometries solved */
+int geomdop_batch(dops dop[], double los_e[], double los_n[], double los_u[],
+                  int count[], int maxsats, int ngeom);
+
+
 /* the following are examples of matrix and vector constant assignments:
 
    static vectr vec1 =
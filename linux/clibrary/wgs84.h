@@ -0,0 +1,79 @@
+/* wgs84.h -- header file for
+              WGS 84 geodesy library which converts positions between
+              geodetic latitude/longitude/altitude (LLA), earth-fixed
+              X/Y/Z (ECEF) and local east/north/up (ENU) meters, and finds
+              the distance and bearings between two places on the ellipsoid
+
+   The conversions work on whole arrays of points at once -- one array
+   per coordinate, as in the almanac library -- in single loops with no
+   branching from point to point, so the compiler can keep them tight
+   and vectorize the arithmetic (e.g. gcc -O3; with -ffast-math gcc can
+   also hand the sin/cos/sqrt to its vector math library).  Converting a
+   few hundred points costs little more per point than the floating
+   point operations themselves.
+
+   Latitude and longitude are degrees (north and east positive), altitude
+   is meters above the ellipsoid (not sea level -- see the geoid), ECEF
+   and ENU are meters.  Unless noted, an output array may be the same as
+   an input array.
+*/
+
+#ifndef WGS84_H__
+#define WGS84_H__
+
+#define WGS84_A     6378137.0                    /* semi-major axis, m */
+#define WGS84_F     (1.0 / 298.257223563)        /* flattening */
+#define WGS84_B     (WGS84_A * (1.0 - WGS84_F))  /* semi-minor axis, m */
+#define WGS84_E2    0.00669437999014             /* first eccentricity squared */
+#define WGS84_EP2   0.00673949674228             /* second eccentricity squared */
+
+/* local east, north, up frame at a place */
+typedef struct
+  {
+   double lat;                       /* origin, degrees and meters */
+   double lon;
+   double alt;
+   double x0;                        /* origin, ECEF */
+   double y0;
+   double z0;
+   double sinlat, coslat;
+   double sinlon, coslon;
+  }
+   wgs_frame;
+
+
+/* geodetic to earth-fixed -- alt may be NULL for points on the ellipsoid */
+void wgs_lla_to_ecef(int n, double lat[], double lon[], double alt[],
+                     double x[], double y[], double z[]);
+
+/* earth-fixed to geodetic -- good to well under a millimeter from the
+   center of the earth out past the GPS orbits */
+void wgs_ecef_to_lla(int n, double x[], double y[], double z[],
+                     double lat[], double lon[], double alt[]);
+
+/* set up the east, north, up frame at a place */
+void wgs_frame_set(wgs_frame *f, double lat, double lon, double alt);
+
+void wgs_ecef_to_enu(wgs_frame *f, int n, double x[], double y[], double z[],
+                     double e[], double nn[], double u[]);
+void wgs_enu_to_ecef(wgs_frame *f, int n, double e[], double nn[], double u[],
+                     double x[], double y[], double z[]);
+
+/* geodetic straight to east, north, up, and back -- alt may be NULL */
+void wgs_lla_to_enu(wgs_frame *f, int n, double lat[], double lon[], double alt[],
+                    double e[], double nn[], double u[]);
+void wgs_enu_to_lla(wgs_frame *f, int n, double e[], double nn[], double u[],
+                    double lat[], double lon[], double alt[]);
+
+/* meters in a degree of latitude and of longitude, at a latitude */
+void wgs_meters_per_deg(double lat, double *m_lat, double *m_lon);
+
+/* distance (m) on the ellipsoid and the bearings (degrees true, 0 to
+   360) at the start and at the end, by Vincenty's inverse method -- good
+   to a fraction of a millimeter.  Returns 0 if the iteration did not
+   settle, which happens only for places nearly opposite each other on
+   the earth (then the answers are the last, rough, iteration's). */
+int wgs_inverse(double lat1, double lon1, double lat2, double lon2,
+                double *dist, double *az1, double *az2);
+
+#endif
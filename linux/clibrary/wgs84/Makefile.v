@@ -0,0 +1,63 @@
+#=======================================================================
+#@V@:Note: File automatically generated by VIDE - 2.00/10Apr03 (gcc).
+# Generated 12:49:32 PM 19 Oct 2026
+# This file regenerated each time you run VIDE, so save under a
+#    new name if you hand edit, or it will be overwritten.
+#=======================================================================
+
+# Standard defines:
+CC  	=	gcc
+LD  	=	gcc
+WRES	=	windres
+HOMEV	=	
+VPATH	=	$(HOMEV)/include
+oDir	=	.
+Bin	=	.
+libDirs	=	-L../../clibrary
+
+incDirs	=	-I../../clibrary
+
+LD_FLAGS =	-s
+LIBS	=	-ldegtrig -lm
+C_FLAGS	=	-O
+
+SRCS	=\
+	wgs84.c
+
+EXOBJS	=\
+	$(oDir)/wgs84.o
+
+ALLOBJS	=	$(EXOBJS)
+ALLBIN	=	$(Bin)/libwgs84.a
+ALLTGT	=	$(Bin)/libwgs84.a
+
+# User defines:
+
+#@# Targets follow ---------------------------------
+
+all:	$(ALLTGT)
+
+objs:	$(ALLOBJS)
+
+cleanobjs:
+	rm -f $(ALLOBJS)
+
+cleanbin:
+	rm -f $(ALLBIN)
+
+clean:	cleanobjs cleanbin
+
+cleanall:	cleanobjs cleanbin
+
+#@# User Targets follow ---------------------------------
+
+
+#@# Dependency rules follow -----------------------------
+
+$(Bin)/libwgs84.a: $(EXOBJS)
+	rm -f $(Bin)/libwgs84.a
+	ar cr $(Bin)/libwgs84.a $(EXOBJS)
+	ranlib $(Bin)/libwgs84.a
+
+$(oDir)/wgs84.o: wgs84.c ../../clibrary/degtrig.h wgs84.h
+	$(CC) $(C_FLAGS) $(incDirs) -c -o $@ $<
@@ -0,0 +1,289 @@
+/* wgs84.c -- WGS 84 geodesy library -- converts arrays of positions between
+              geodetic, earth-fixed and local east/north/up coordinates, and
+              solves the inverse problem (distance and bearings) on the
+              ellipsoid -- see wgs84.h
+
+              Earth-fixed to geodetic is Bowring's method, taken through a
+              fixed two steps (no convergence test, so no branching), with
+              the angles kept as sines and cosines between the steps --
+              that is already past double precision near the earth and
+              well under a millimeter at GPS orbit heights.  The inverse
+              problem is T. Vincenty, Survey Review XXIII, 176 (1975).
+
+              The sines, cosines and atan2s of the array conversions come
+              a chunk at a time from the degtrig library's array calls, so
+              these loops have no C library calls left in them (Vincenty's
+              iteration, one pair of places at a time, keeps to libm).
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "degtrig.h"
+#include "wgs84.h"
+
+#define WGS_PI          3.1415926535897932384626433832795
+#define WGS_RAD_TO_DEG  57.295779513082320876798154814105
+
+/* points converted at a time by the LLA <-> ENU calls, and the sines and
+   cosines (or atan2s) worked out at a time */
+#define WGS_CHUNK       64
+
+/* Vincenty iterations before giving up -- nearby places need 3 or 4 */
+#define WGS_VINCENTY_ITER 200
+
+
+/* ------------------------------------------------------------------------ */
+
+void wgs_lla_to_ecef(int n, double lat[], double lon[], double alt[],
+                     double x[], double y[], double z[])
+  {
+   double sinlat[WGS_CHUNK], coslat[WGS_CHUNK], sinlon[WGS_CHUNK], coslon[WGS_CHUNK];
+   double nrad, h;
+   int i, j, m;
+
+   for (i=0; i<n; i+=WGS_CHUNK)
+     {
+      m = ((n - i) < WGS_CHUNK) ? (n - i) : WGS_CHUNK;
+      dt_sincos_array(m,&lat[i],sinlat,coslat);
+      dt_sincos_array(m,&lon[i],sinlon,coslon);
+      for (j=0; j<m; j++)
+        {
+         h = (alt != NULL) ? alt[i+j] : 0.0;
+         nrad = WGS84_A / sqrt(1.0 - (WGS84_E2 * sinlat[j] * sinlat[j]));
+         x[i+j] = (nrad + h) * coslat[j] * coslon[j];
+         y[i+j] = (nrad + h) * coslat[j] * sinlon[j];
+         z[i+j] = ((nrad * (1.0 - WGS84_E2)) + h) * sinlat[j];
+        }
+     }
+  }
+
+
+void wgs_ecef_to_lla(int n, double x[], double y[], double z[],
+                     double lat[], double lon[], double alt[])
+  {
+   double ex[WGS_CHUNK], ey[WGS_CHUNK], nx[WGS_CHUNK], ny[WGS_CHUNK];
+   double p, zi, bx, by, r, sinb, cosb, px, py, sinphi, cosphi;
+   int i, j, m;
+
+   for (i=0; i<n; i+=WGS_CHUNK)
+     {
+      m = ((n - i) < WGS_CHUNK) ? (n - i) : WGS_CHUNK;
+      for (j=0; j<m; j++)
+        {
+         ex[j] = x[i+j];
+         ey[j] = y[i+j];
+         zi = z[i+j];
+         p = sqrt((ex[j] * ex[j]) + (ey[j] * ey[j]));
+
+         /* the angles are carried as their sine and cosine (tangent as y 
+            over x) -- parametric latitude to start, then two of Bowring's 
+            steps */
+         bx = (1.0 - WGS84_F) * p;
+         by = zi;
+         r = sqrt((bx * bx) + (by * by)) + 1e-300;
+         sinb = by / r;
+         cosb = bx / r;
+         py = zi + (WGS84_EP2 * WGS84_B * sinb * sinb * sinb);
+         px = p - (WGS84_E2 * WGS84_A * cosb * cosb * cosb);
+
+         bx = px;
+         by = (1.0 - WGS84_F) * py;
+         r = sqrt((bx * bx) + (by * by)) + 1e-300;
+         sinb = by / r;
+         cosb = bx / r;
+         py = zi + (WGS84_EP2 * WGS84_B * sinb * sinb * sinb);
+         px = p - (WGS84_E2 * WGS84_A * cosb * cosb * cosb);
+
+         /* height along the normal -- no division by cos, so good at the 
+            poles too */
+         r = sqrt((px * px) + (py * py)) + 1e-300;
+         sinphi = py / r;
+         cosphi = px / r;
+         nx[j] = px;
+         ny[j] = py;
+         alt[i+j] = (p * cosphi) + (zi * sinphi)
+                    - (WGS84_A * sqrt(1.0 - (WGS84_E2 * sinphi * sinphi)));
+        }
+      dt_atan2_array(m,ey,ex,&lon[i]);
+      dt_atan2_array(m,ny,nx,&lat[i]);
+     }
+  }
+
+
+void wgs_frame_set(wgs_frame *f, double lat, double lon, double alt)
+  {
+   double nrad;
+
+   f->lat = lat;
+   f->lon = lon;
+   f->alt = alt;
+   dt_sincos(lat,&f->sinlat,&f->coslat);
+   dt_sincos(lon,&f->sinlon,&f->coslon);
+   nrad = WGS84_A / sqrt(1.0 - (WGS84_E2 * f->sinlat * f->sinlat));
+   f->x0 = (nrad + alt) * f->coslat * f->coslon;
+   f->y0 = (nrad + alt) * f->coslat * f->sinlon;
+   f->z0 = ((nrad * (1.0 - WGS84_E2)) + alt) * f->sinlat;
+  }
+
+
+void wgs_ecef_to_enu(wgs_frame *f, int n, double x[], double y[], double z[],
+                     double e[], double nn[], double u[])
+  {
+   double dx, dy, dz;
+   int i;
+
+   for (i=0; i<n; i++)
+     {
+      dx = x[i] - f->x0;
+      dy = y[i] - f->y0;
+      dz = z[i] - f->z0;
+      e[i] = (-f->sinlon * dx) + (f->coslon * dy);
+      nn[i] = (-f->sinlat * f->coslon * dx) - (f->sinlat * f->sinlon * dy) + (f->coslat * dz);
+      u[i] = (f->coslat * f->coslon * dx) + (f->coslat * f->sinlon * dy) + (f->sinlat * dz);
+     }
+  }
+
+
+void wgs_enu_to_ecef(wgs_frame *f, int n, double e[], double nn[], double u[],
+                     double x[], double y[], double z[])
+  {
+   double de, dn, du;
+   int i;
+
+   for (i=0; i<n; i++)
+     {
+      de = e[i];
+      dn = nn[i];
+      du = u[i];
+      x[i] = f->x0 - (f->sinlon * de) - (f->sinlat * f->coslon * dn) + (f->coslat * f->coslon * du);
+      y[i] = f->y0 + (f->coslon * de) - (f->sinlat * f->sinlon * dn) + (f->coslat * f->sinlon * du);
+      z[i] = f->z0 + (f->coslat * dn) + (f->sinlat * du);
+     }
+  }
+
+
+void wgs_lla_to_enu(wgs_frame *f, int n, double lat[], double lon[], double alt[],
+                    double e[], double nn[], double u[])
+  {
+   double x[WGS_CHUNK], y[WGS_CHUNK], z[WGS_CHUNK];
+   int i, m;
+
+   for (i=0; i<n; i+=WGS_CHUNK)
+     {
+      m = ((n - i) < WGS_CHUNK) ? (n - i) : WGS_CHUNK;
+      wgs_lla_to_ecef(m,&lat[i],&lon[i],((alt != NULL) ? &alt[i] : NULL),x,y,z);
+      wgs_ecef_to_enu(f,m,x,y,z,&e[i],&nn[i],&u[i]);
+     }
+  }
+
+
+void wgs_enu_to_lla(wgs_frame *f, int n, double e[], double nn[], double u[],
+                    double lat[], double lon[], double alt[])
+  {
+   double x[WGS_CHUNK], y[WGS_CHUNK], z[WGS_CHUNK];
+   int i, m;
+
+   for (i=0; i<n; i+=WGS_CHUNK)
+     {
+      m = ((n - i) < WGS_CHUNK) ? (n - i) : WGS_CHUNK;
+      wgs_enu_to_ecef(f,m,&e[i],&nn[i],&u[i],x,y,z);
+      wgs_ecef_to_lla(m,x,y,z,&lat[i],&lon[i],&alt[i]);
+     }
+  }
+
+
+void wgs_meters_per_deg(double lat, double *m_lat, double *m_lon)
+  {
+   double sinlat, coslat, w;
+
+   dt_sincos(lat,&sinlat,&coslat);
+   w = 1.0 - (WGS84_E2 * sinlat * sinlat);
+
+   /* radii of curvature in the meridian and across it */
+   *m_lat = (WGS84_A * (1.0 - WGS84_E2) / (w * sqrt(w))) / WGS_RAD_TO_DEG;
+   *m_lon = (WGS84_A / sqrt(w)) * coslat / WGS_RAD_TO_DEG;
+  }
+
+
+/* degrees 0 to 360 from radians */
+static double wgs_bearing(double rad)
+  {
+   rad *= WGS_RAD_TO_DEG;
+   return (rad < 0.0) ? rad + 360.0 : rad;
+  }
+
+
+int wgs_inverse(double lat1, double lon1, double lat2, double lon2,
+                double *dist, double *az1, double *az2)
+  {
+   double ll, u1, u2, sinu1, cosu1, sinu2, cosu2, lambda, lambda_prev;
+   double sinlam, coslam, sinsig, cossig, sigma, sinalpha, cos2alpha, cos2sm, c;
+   double usq, a, b, dsig;
+   int iter;
+
+   ll = (lon2 - lon1) / WGS_RAD_TO_DEG;
+   while (ll > WGS_PI)
+     {
+      ll -= 2.0 * WGS_PI;
+     }
+   while (ll < -WGS_PI)
+     {
+      ll += 2.0 * WGS_PI;
+     }
+
+   /* reduced latitudes */
+   u1 = atan((1.0 - WGS84_F) * tan(lat1 / WGS_RAD_TO_DEG));
+   u2 = atan((1.0 - WGS84_F) * tan(lat2 / WGS_RAD_TO_DEG));
+   sinu1 = sin(u1);
+   cosu1 = cos(u1);
+   sinu2 = sin(u2);
+   cosu2 = cos(u2);
+
+   lambda = ll;
+   sinlam = coslam = sinsig = cossig = sigma = cos2alpha = cos2sm = 0.0;
+   for (iter=0; iter<WGS_VINCENTY_ITER; iter++)
+     {
+      sinlam = sin(lambda);
+      coslam = cos(lambda);
+      sinsig = sqrt(((cosu2 * sinlam) * (cosu2 * sinlam)) +
+                    ((cosu1 * sinu2 - sinu1 * cosu2 * coslam) *
+                     (cosu1 * sinu2 - sinu1 * cosu2 * coslam)));
+      if (sinsig == 0.0)
+        {
+         /* the same place */
+         *dist = 0.0;
+         *az1 = 0.0;
+         *az2 = 0.0;
+         return 1;
+        }
+      cossig = (sinu1 * sinu2) + (cosu1 * cosu2 * coslam);
+      sigma = atan2(sinsig,cossig);
+      sinalpha = cosu1 * cosu2 * sinlam / sinsig;
+      cos2alpha = 1.0 - (sinalpha * sinalpha);
+
+      /* along the equator cos2alpha is 0, and so is this term */
+      cos2sm = (cos2alpha != 0.0) ? cossig - (2.0 * sinu1 * sinu2 / cos2alpha) : 0.0;
+
+      c = WGS84_F / 16.0 * cos2alpha * (4.0 + WGS84_F * (4.0 - 3.0 * cos2alpha));
+      lambda_prev = lambda;
+      lambda = ll + (1.0 - c) * WGS84_F * sinalpha *
+               (sigma + c * sinsig * (cos2sm + c * cossig * (-1.0 + 2.0 * cos2sm * cos2sm)));
+      if (fabs(lambda - lambda_prev) < 1e-12)
+        {
+         break;
+        }
+     }
+
+   usq = cos2alpha * ((WGS84_A * WGS84_A) - (WGS84_B * WGS84_B)) / (WGS84_B * WGS84_B);
+   a = 1.0 + usq / 16384.0 * (4096.0 + usq * (-768.0 + usq * (320.0 - 175.0 * usq)));
+   b = usq / 1024.0 * (256.0 + usq * (-128.0 + usq * (74.0 - 47.0 * usq)));
+   dsig = b * sinsig * (cos2sm + b / 4.0 * (cossig * (-1.0 + 2.0 * cos2sm * cos2sm)
+          - b / 6.0 * cos2sm * (-3.0 + 4.0 * sinsig * sinsig) * (-3.0 + 4.0 * cos2sm * cos2sm)));
+
+   *dist = WGS84_B * a * (sigma - dsig);
+   *az1 = wgs_bearing(atan2(cosu2 * sinlam,(cosu1 * sinu2) - (sinu1 * cosu2 * coslam)));
+   *az2 = wgs_bearing(atan2(cosu1 * sinlam,(-sinu1 * cosu2) + (cosu1 * sinu2 * coslam)));
+   return (iter < WGS_VINCENTY_ITER);
+  }
@@ -0,0 +1,75 @@
+/* windgrid.h -- header file for
+                 gridded wind field library which reads winds given on a
+                 latitude/longitude/altitude grid and interpolates them
+                 (trilinear) at any position
+
+   Like geolib's struct gridarray, but of any size and in three
+   dimensions:  latitude and longitude are evenly spaced, the altitudes
+   may be at any spacing (e.g. the heights of pressure levels), and each
+   node holds the east and north wind in m/s.  Outside the grid the wind
+   at the nearest edge is used.
+
+   A moving balloon stays in one grid cell for many seconds, so
+   wg_wind() keeps the cell it found last, with its 8 corner winds, in a
+   wg_cache -- while the position stays in that cell a lookup is only
+   the bounds test and the interpolation.  Keep one cache per moving
+   point.
+
+   Grid file (free format, # to end of line is a comment):
+
+      grid   nlat nlon nalt
+      lat    first_lat  spacing        degrees, south to north
+      long   first_long spacing        degrees, west to east, east positive
+      alt    alt1 alt2 ... altn        meters, ascending
+      then nlat*nlon*nalt pairs "east north" (m/s), lowest altitude
+      first, each altitude by latitude rows south to north, each row
+      west to east
+*/
+
+#ifndef WINDGRID_H__
+#define WINDGRID_H__
+
+typedef struct
+  {
+   int nlat;                         /* grid points each way */
+   int nlon;
+   int nalt;
+   double lat0;                      /* first latitude and spacing, degrees */
+   double dlat;
+   double lon0;
+   double dlon;
+   double *alt;                      /* nalt altitudes, meters */
+   double *wind;                     /* east, north pairs by altitude, lat, long */
+  }
+   windgrid;
+
+typedef struct
+  {
+   int k;                            /* altitude index of the cell, -1 before any */
+   double lat_lo, lat_hi;            /* bounds of the cell */
+   double lon_lo, lon_hi;
+   double alt_lo, alt_hi;
+   double rlat, rlon, ralt;          /* 1 / cell size */
+   double east[8];                   /* corner winds, bit 0 long, bit 1 lat, bit 2 alt */
+   double north[8];
+   long misses;                      /* times the cell had to be found again */
+  }
+   wg_cache;
+
+
+/* last error from wg_read() */
+extern char wg_error[];
+
+/* read a grid file -- returns the number of nodes, 0 (and wg_error set)
+   if the file can't be read or is not complete */
+long wg_read(windgrid *g, char fname[]);
+void wg_free(windgrid *g);
+
+/* forget the cached cell (e.g. for a new grid) */
+void wg_cache_clear(wg_cache *c);
+
+/* wind (m/s, toward east and north) at a position */
+void wg_wind(windgrid *g, wg_cache *c, double lat, double lon, double alt,
+             double *east, double *north);
+
+#endif
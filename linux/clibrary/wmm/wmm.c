@@ -0,0 +1,281 @@
+/* wmm.c -- World Magnetic Model library -- reads WMM.COF coefficient files
+            and sums the model for the magnetic field at a place and date,
+            with a cache for receivers asking again from nearly the same
+            place -- see wmm.h
+
+            Equations from "The US/UK World Magnetic Model for 2020-2025"
+            (NOAA technical report), sections 1.2 and 1.3.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "wgs84.h"
+#include "wmm.h"
+
+#define WMM_RAD_TO_DEG  57.295779513082320876798154814105
+#define WMM_RADIUS      6371.2            /* geomagnetic reference radius, km */
+
+char wmm_error[200] = "";
+
+
+/* ------------------------------------------------------------------------ */
+
+int wmm_read(wmm_model *mod, char fname[])
+  {
+   FILE *unit;
+   char line[200];
+   int n, m, k, count;
+   double g, h, gd, hd;
+
+   memset(mod,0,sizeof(wmm_model));
+   unit = fopen(fname,"r");
+   if (unit == NULL)
+     {
+      sprintf(wmm_error,"Can't open %.150s",fname);
+      return 0;
+     }
+
+   if ((fgets(line,200,unit) == NULL) ||
+       (sscanf(line,"%lf %31s",&mod->epoch,mod->name) != 2) || (mod->epoch < 1900.0))
+     {
+      sprintf(wmm_error,"%.100s: expected the epoch and model name first",fname);
+      fclose(unit);
+      return 0;
+     }
+
+   count = 0;
+   while (fgets(line,200,unit) != NULL)
+     {
+      if (strncmp(line,"9999",4) == 0)
+        {
+         break;
+        }
+      if (sscanf(line,"%d %d %lf %lf %lf %lf",&n,&m,&g,&h,&gd,&hd) != 6)
+        {
+         continue;
+        }
+      if ((n < 1) || (n > WMM_MAX_DEGREE) || (m < 0) || (m > n))
+        {
+         sprintf(wmm_error,"%.100s: term n %d m %d is not in a degree %d model",fname,n,m,
+                 WMM_MAX_DEGREE);
+         fclose(unit);
+         return 0;
+        }
+      k = WMM_INDEX(n,m);
+      mod->g[k] = g;
+      mod->h[k] = h;
+      mod->gdot[k] = gd;
+      mod->hdot[k] = hd;
+      mod->degree = (n > mod->degree) ? n : mod->degree;
+      count++;
+     }
+   fclose(unit);
+
+   if (count == 0)
+     {
+      sprintf(wmm_error,"%.100s: no coefficients",fname);
+      return 0;
+     }
+
+   /* the Legendre recursion's factors depend only on n and m */
+   mod->rec_d[0] = 0.0;
+   mod->rec_d[1] = 1.0;
+   for (n=2; n<=WMM_MAX_DEGREE; n++)
+     {
+      mod->rec_d[n] = sqrt((2.0 * n - 1.0) / (2.0 * n));
+     }
+   for (n=1; n<=WMM_MAX_DEGREE; n++)
+     {
+      for (m=0; m<n; m++)
+        {
+         k = WMM_INDEX(n,m);
+         mod->rec_a[k] = (2.0 * n - 1.0) / sqrt((double)(n * n - m * m));
+         mod->rec_b[k] = sqrt((double)((n - 1) * (n - 1) - m * m)) / sqrt((double)(n * n - m * m));
+        }
+     }
+
+   mod->date_year = -1.0;
+   return mod->degree;
+  }
+
+
+/* coefficients at a date, from the epoch's and the secular variation */
+static void wmm_to_date(wmm_model *mod, double year)
+  {
+   double dt;
+   int k;
+
+   dt = year - mod->epoch;
+   for (k=0; k<WMM_TERMS; k++)
+     {
+      mod->gt[k] = mod->g[k] + (dt * mod->gdot[k]);
+      mod->ht[k] = mod->h[k] + (dt * mod->hdot[k]);
+     }
+   mod->date_year = year;
+  }
+
+
+void wmm_field(wmm_model *mod, double lat, double lon, double alt, double year,
+               double *decl, double *incl, double *horiz, double *total)
+  {
+   double p[WMM_TERMS];              /* Schmidt semi-normalized P(n,m) */
+   double dp[WMM_TERMS];             /* and d/d(colatitude) */
+   double cosm[WMM_MAX_DEGREE + 1];  /* cos(m lon), sin(m lon) */
+   double sinm[WMM_MAX_DEGREE + 1];
+   double sinlat, coslat, rc, pp, zz, r, x, s, ratio, scale;
+   double bx, by, bz, sx, sy, sz, gh, hx, hz, psi_s, psi_c;
+   int n, m, k;
+
+   if (year != mod->date_year)
+     {
+      wmm_to_date(mod,year);
+     }
+
+   /* geodetic to geocentric spherical, in km */
+   sinlat = sin(lat / WMM_RAD_TO_DEG);
+   coslat = cos(lat / WMM_RAD_TO_DEG);
+   rc = (WGS84_A / 1000.0) / sqrt(1.0 - (WGS84_E2 * sinlat * sinlat));
+   pp = (rc + alt / 1000.0) * coslat;
+   zz = ((rc * (1.0 - WGS84_E2)) + alt / 1000.0) * sinlat;
+   r = sqrt((pp * pp) + (zz * zz));
+   x = zz / r;                       /* sin(geocentric latitude) = cos(colatitude) */
+   s = pp / r;                       /* cos(geocentric latitude) = sin(colatitude) */
+   if (s < 1e-10)
+     {
+      s = 1e-10;                     /* the poles -- declination has no meaning */
+     }
+
+   cosm[0] = 1.0;
+   sinm[0] = 0.0;
+   cosm[1] = cos(lon / WMM_RAD_TO_DEG);
+   sinm[1] = sin(lon / WMM_RAD_TO_DEG);
+   for (m=2; m<=mod->degree; m++)
+     {
+      cosm[m] = (cosm[m-1] * cosm[1]) - (sinm[m-1] * sinm[1]);
+      sinm[m] = (sinm[m-1] * cosm[1]) + (cosm[m-1] * sinm[1]);
+     }
+
+   /* Legendre functions, each n from the two before it (m = n from the
+      diagonal) */
+   p[0] = 1.0;
+   dp[0] = 0.0;
+   for (n=1; n<=mod->degree; n++)
+     {
+      for (m=0; m<n; m++)
+        {
+         k = WMM_INDEX(n,m);
+         if (n - 2 >= m)
+           {
+            p[k] = (mod->rec_a[k] * x * p[WMM_INDEX(n-1,m)]) - (mod->rec_b[k] * p[WMM_INDEX(n-2,m)]);
+            dp[k] = (mod->rec_a[k] * ((x * dp[WMM_INDEX(n-1,m)]) - (s * p[WMM_INDEX(n-1,m)])))
+                    - (mod->rec_b[k] * dp[WMM_INDEX(n-2,m)]);
+           }
+         else
+           {
+            p[k] = mod->rec_a[k] * x * p[WMM_INDEX(n-1,m)];
+            dp[k] = mod->rec_a[k] * ((x * dp[WMM_INDEX(n-1,m)]) - (s * p[WMM_INDEX(n-1,m)]));
+           }
+        }
+      k = WMM_INDEX(n,n);
+      p[k] = mod->rec_d[n] * s * p[WMM_INDEX(n-1,n-1)];
+      dp[k] = mod->rec_d[n] * ((x * p[WMM_INDEX(n-1,n-1)]) + (s * dp[WMM_INDEX(n-1,n-1)]));
+     }
+
+   /* field in spherical coordinates -- north, east, down */
+   sx = sy = sz = 0.0;
+   ratio = WMM_RADIUS / r;
+   scale = ratio * ratio;
+   for (n=1; n<=mod->degree; n++)
+     {
+      scale *= ratio;                /* (a/r)^(n+2) */
+      bx = by = bz = 0.0;
+      for (m=0; m<=n; m++)
+        {
+         k = WMM_INDEX(n,m);
+         gh = (mod->gt[k] * cosm[m]) + (mod->ht[k] * sinm[m]);
+         bx += gh * dp[k];
+         by += m * ((mod->gt[k] * sinm[m]) - (mod->ht[k] * cosm[m])) * p[k];
+         bz += gh * p[k];
+        }
+      sx += scale * bx;
+      sy += scale * by;
+      sz -= scale * (n + 1) * bz;
+     }
+   sy /= s;
+
+   /* rotate from geocentric to geodetic -- psi is geocentric less geodetic
+      latitude */
+   psi_s = (x * coslat) - (s * sinlat);
+   psi_c = (s * coslat) + (x * sinlat);
+   hx = (sx * psi_c) - (sz * psi_s);
+   hz = (sx * psi_s) + (sz * psi_c);
+
+   if (decl != NULL)
+     {
+      *decl = atan2(sy,hx) * WMM_RAD_TO_DEG;
+     }
+   if (incl != NULL)
+     {
+      *incl = atan2(hz,sqrt((hx * hx) + (sy * sy))) * WMM_RAD_TO_DEG;
+     }
+   if (horiz != NULL)
+     {
+      *horiz = sqrt((hx * hx) + (sy * sy));
+     }
+   if (total != NULL)
+     {
+      *total = sqrt((hx * hx) + (sy * sy) + (hz * hz));
+     }
+  }
+
+
+double wmm_declination(wmm_model *mod, double lat, double lon, double alt, double year)
+  {
+   double decl;
+
+   wmm_field(mod,lat,lon,alt,year,&decl,NULL,NULL,NULL);
+   return decl;
+  }
+
+
+void wmm_cache_init(wmm_cache *c, double max_km, double max_secs)
+  {
+   memset(c,0,sizeof(wmm_cache));
+   c->max_km = max_km;
+   c->max_years = max_secs / (365.25 * 86400.0);
+  }
+
+
+double wmm_cached_declination(wmm_model *mod, wmm_cache *c,
+                              double lat, double lon, double alt, double year)
+  {
+   double de, dn, du, dt;
+
+   c->calls++;
+   if (c->valid)
+     {
+      de = (lon - c->lon) * c->km_lon;
+      dn = (lat - c->lat) * c->km_lat;
+      du = (alt - c->alt) / 1000.0;
+      dt = year - c->year;
+      if ((((de * de) + (dn * dn) + (du * du)) <= (c->max_km * c->max_km)) &&
+          (dt <= c->max_years) && (dt >= -c->max_years))
+        {
+         return c->decl;
+        }
+     }
+
+   c->decl = wmm_declination(mod,lat,lon,alt,year);
+   c->lat = lat;
+   c->lon = lon;
+   c->alt = alt;
+   c->year = year;
+   c->km_lat = 111.32;
+   c->km_lon = 111.32 * cos(lat / WMM_RAD_TO_DEG);
+   c->valid = 1;
+   c->sums++;
+   return c->decl;
+  }
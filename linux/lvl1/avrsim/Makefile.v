@@ -0,0 +1,55 @@
+#=======================================================================
+# Host (Linux) build of the Arduino version of GPSSIM -- compiles
+# arduino/gpssim/gpssim.pde as C++ against the stand-ins in this
+# directory (WProgram.h, avr/io.h, avr/pgmspace.h, avrhost.h), which
+# count the AVR's floating point, formatting and serial work per second.
+# See avrhost.cpp.
+#=======================================================================
+
+# Standard defines:
+CC  	=	g++
+LD  	=	g++
+oDir	=	.
+Bin	=	.
+PDE	=	../../../arduino/gpssim/gpssim.pde
+
+incDirs	=	-I.
+
+LD_FLAGS =	-s
+LIBS	=	-lm
+C_FLAGS	=	-O -Wall -DAVR_HOST
+
+EXOBJS	=\
+	$(oDir)/gpssim.o \
+	$(oDir)/avrhost.o
+
+ALLOBJS	=	$(EXOBJS)
+ALLBIN	=	$(Bin)/avrgpssim
+ALLTGT	=	$(Bin)/avrgpssim
+
+#@# Targets follow ---------------------------------
+
+all:	$(ALLTGT)
+
+objs:	$(ALLOBJS)
+
+cleanobjs:
+	rm -f $(ALLOBJS)
+
+cleanbin:
+	rm -f $(ALLBIN)
+
+clean:	cleanobjs cleanbin
+
+cleanall:	cleanobjs cleanbin
+
+#@# Dependency rules follow -----------------------------
+
+$(Bin)/avrgpssim: $(EXOBJS)
+	$(LD) -o $(Bin)/avrgpssim $(EXOBJS) $(LD_FLAGS) $(LIBS)
+
+$(oDir)/gpssim.o: $(PDE) WProgram.h avrhost.h avr/io.h avr/pgmspace.h avr/interrupt.h avr/sleep.h
+	$(CC) $(C_FLAGS) $(incDirs) -x c++ -c -o $@ $(PDE)
+
+$(oDir)/avrhost.o: avrhost.cpp avrhost.h
+	$(CC) $(C_FLAGS) $(incDirs) -c -o $@ avrhost.cpp
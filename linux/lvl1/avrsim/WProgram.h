@@ -0,0 +1,18 @@
+/* WProgram.h -- host stand-in for the Arduino core header, see avrhost.h */
+
+#ifndef WPROGRAM_H__
+#define WPROGRAM_H__
+
+#include "avrhost.h"
+
+/* gpssim's trace points become the cycle attribution sections */
+#define EVTRACE_BEGIN(name)  avrhost_begin(name)
+#define EVTRACE_END(name)    avrhost_end(name)
+
+/* waiting for room in the transmit ring (TX_RING) -- with IDLE_SLEEP the
+   sketch sleeps instead, which runs the UART too */
+#ifndef IDLE_SLEEP
+#define TX_WAIT()  avrhost_tx_wait()
+#endif
+
+#endif
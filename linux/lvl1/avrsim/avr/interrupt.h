@@ -0,0 +1,16 @@
+/* avr/interrupt.h -- host stand-in, see ../avrhost.h
+
+   An ISR is an ordinary function, which avrhost.cpp calls from its UART model
+*/
+
+#ifndef AVR_INTERRUPT_H__
+#define AVR_INTERRUPT_H__
+
+#include "../avrhost.h"
+
+#define ISR(vect)  void vect(void)
+
+#define cli()
+#define sei()
+
+#endif
@@ -0,0 +1,27 @@
+/* avr/io.h -- host stand-in, see ../avrhost.h */
+
+#ifndef AVR_IO_H__
+#define AVR_IO_H__
+
+#include "../avrhost.h"
+
+/* stack pointer register -- a plausible top of RAM for an ATmega328 */
+#define SP 0x08FF
+
+/* UARTs -- UCSRnB and UDRn are declared in avrhost.h.  UBRRnH tells a 
+   sketch that Serial1-Serial3 are there, as on the Mega; the first UART's
+   interrupt has its 328 name as well. */
+#define UDRIE0 5
+#define UDRIE1 5
+#define UDRIE2 5
+#define UDRIE3 5
+#define UBRR1H 0xCD
+#define UBRR2H 0xD5
+#define UBRR3H 0x135
+#define USART0_UDRE_vect avr_usart0_udre_isr
+#define USART1_UDRE_vect avr_usart1_udre_isr
+#define USART2_UDRE_vect avr_usart2_udre_isr
+#define USART3_UDRE_vect avr_usart3_udre_isr
+#define USART_UDRE_vect  avr_usart0_udre_isr
+
+#endif
@@ -0,0 +1,18 @@
+/* avr/pgmspace.h -- host stand-in, see ../avrhost.h
+
+   Tables stay in ordinary memory -- each read is counted as 1, 2 or 4 flash bytes
+*/
+
+#ifndef AVR_PGMSPACE_H__
+#define AVR_PGMSPACE_H__
+
+#include "../avrhost.h"
+
+#define PROGMEM
+
+#define pgm_read_byte(addr)   avr_pgm_byte(addr)
+#define pgm_read_word(addr)   avr_pgm_word(addr)
+#define pgm_read_dword(addr)  avr_pgm_dword(addr)
+#define pgm_read_float(addr)  avr_pgm_float(addr)
+
+#endif
@@ -0,0 +1,19 @@
+/* avr/sleep.h -- host stand-in, see ../avrhost.h
+
+   sleep_cpu() moves the cycle clock on to the next interrupt that would
+   wake the AVR from idle mode, see avrhost_sleep()
+*/
+
+#ifndef AVR_SLEEP_H__
+#define AVR_SLEEP_H__
+
+#include "../avrhost.h"
+
+#define SLEEP_MODE_IDLE 0
+
+#define set_sleep_mode(mode)
+#define sleep_enable()
+#define sleep_disable()
+#define sleep_cpu()  avrhost_sleep()
+
+#endif
@@ -0,0 +1,877 @@
+/* avrhost.cpp -- runs the Arduino (ARDUINO) version of gpssim natively on
+                  Linux, and reports where the AVR's cycles would go for each
+                  simulated second
+
+   GLF GPSSIM for LVL1 -- host build of the Arduino code path
+
+   usage:  avrgpssim [KEYWORD=value ...]
+
+      OUT=file       NMEA output on Serial (default standard output)
+      OUTn=file      NMEA output on Serial1, Serial2, Serial3 (n = 1-3, 
+                     default none) -- see PORTn_BAUD in gpssim
+      REPORT=file    cycle report (default standard error)
+      COST=file      cycle cost model, lines of  NAME cycles  (see avrcost.cfg)
+      F_CPU=hz       AVR clock (default 16000000)
+      SECONDS=n      stop after n simulated seconds (default: whole script)
+
+   Every counted operation adds its modeled cost to one cycle clock, and
+   millis() reads that clock -- so with REALTIME the sketch's wait for the
+   next second is what is left of the budget.  While waiting, millis()
+   skips ahead to the next millisecond instead of counting each poll.
+
+   Cycles are charged to the section of gpssim that is running (its
+   EVTRACE_BEGIN/END points), and a simulated second ends with every 
+   flt_hz'th "render_epoch" (OUTPUT_HZ).  Time in "wait_seconds" is idle, 
+   everything else busy.
+
+   Built with TX_RING, the sketch sends from its own data register empty
+   interrupt.  The UART is modeled as a shift register fed from UDR0 at 10
+   bit times per byte, and the interrupt is run (as section "tx_interrupt",
+   busy) whenever it is enabled and UDR0 is free -- at the next millis(), or
+   straight away while the sketch waits for room in its ring ("tx_ring_full").
+   The Mega's four UARTs are modeled, each with its own wire and interrupt;
+   the wire column is the busiest port's.
+
+   Built with IDLE_SLEEP, the sketch sleeps in its waits.  A sleep moves the
+   clock on to the next millisecond (timer 0's millis() interrupt) or the 
+   next transmit interrupt, whichever comes first, and is charged to section
+   "sleep" -- neither busy nor awake.  Each wake-up costs WAKE cycles.  The
+   "awake" column is the part of each second not asleep, 100% without 
+   IDLE_SLEEP.
+
+   Only double is narrowed to the AVR's 32 bits (avrhost.h).  int and long
+   keep the host's widths, so an int or long overflow that the AVR would
+   have does not show here -- this build checks timing, not arithmetic.
+*/
+
+#include "avrhost.h"
+
+#undef double
+#undef sprintf
+#undef rand
+
+#include <strings.h>
+
+
+/* the sketch */
+void setup(void);
+void loop(void);
+extern int flt_hz;
+
+/* its transmit interrupts, if built with TX_RING (and PORTn_BAUD) */
+void avr_usart0_udre_isr(void) __attribute__((weak));
+void avr_usart1_udre_isr(void) __attribute__((weak));
+void avr_usart2_udre_isr(void) __attribute__((weak));
+void avr_usart3_udre_isr(void) __attribute__((weak));
+
+
+/* -------- cost model ------------------------------------------------------ */
+
+/* rough figures for avr-libc's libm and formatting on an ATmega at 16 MHz --
+   change them with COST=file */
+
+long long avr_count[AVR_NUM_OPS];
+unsigned long long avr_cycles = 0;
+
+unsigned long avr_cost[AVR_NUM_OPS] =
+  {
+   110,      /* FADD */
+   150,      /* FMUL */
+   480,      /* FDIV */
+   60,       /* FCMP */
+   80,       /* FCONV */
+   520,      /* FSQRT */
+   1700,     /* FTRIG */
+   2200,     /* FATRIG */
+   70,       /* FOTHER */
+   2400,     /* DTOSTRF */
+   600,      /* SPRINTF */
+   90,       /* SPRINTF_CHAR */
+   3,        /* PGM_BYTE */
+   0,        /* SERIAL_BYTE -- set from the baud rate, see HardwareSerial::begin() */
+   40,       /* MILLIS */
+   60,       /* TX_BYTE */
+   80        /* WAKE */
+  };
+
+static const char *cost_names[AVR_NUM_OPS] =
+  {
+   "FADD", "FMUL", "FDIV", "FCMP", "FCONV", "FSQRT", "FTRIG", "FATRIG",
+   "FOTHER", "DTOSTRF", "SPRINTF", "SPRINTF_CHAR", "PGM_BYTE", "SERIAL_BYTE",
+   "MILLIS", "TX_BYTE", "WAKE"
+  };
+
+static unsigned long f_cpu = 16000000L;
+static int serial_cost_given = 0;
+static long max_seconds = 0;
+
+static FILE *rpt_unit = NULL;
+
+
+/* -------- UART state ------------------------------------------------------ */
+
+#define NUM_UARTS 4
+
+typedef struct
+  {
+   long baud;                        /* 0 -- not begun */
+   FILE *unit;                       /* its output, NULL for none */
+   void (*isr)(void);                /* data register empty, NULL without TX_RING */
+   avr_ucsrb *ucsrb;
+   unsigned long long byte_cycles;   /* 10 bit times */
+   unsigned long long wire_free;     /* shift register done with its byte */
+   unsigned long long udr_free;      /* UDRn can take the next byte */
+   unsigned long long udrie_since;   /* interrupt enabled */
+   long long bytes;                  /* sent, whole run */
+   long long sec_bytes;              /* sent, this second */
+  }
+   uart_model;
+
+avr_ucsrb UCSR0B(0), UCSR1B(1), UCSR2B(2), UCSR3B(3);
+avr_udr UDR0(0), UDR1(1), UDR2(2), UDR3(3);
+
+static uart_model uarts[NUM_UARTS] =
+  {
+   { 0, NULL, avr_usart0_udre_isr, &UCSR0B, 0, 0, 0, 0, 0, 0 },
+   { 0, NULL, avr_usart1_udre_isr, &UCSR1B, 0, 0, 0, 0, 0, 0 },
+   { 0, NULL, avr_usart2_udre_isr, &UCSR2B, 0, 0, 0, 0, 0, 0 },
+   { 0, NULL, avr_usart3_udre_isr, &UCSR3B, 0, 0, 0, 0, 0, 0 }
+  };
+
+
+int read_cost(char fname[])
+  {
+   FILE *unit;
+   char line[200];
+   char name[40];
+   unsigned long val;
+   int i;
+   int lineno = 0;
+
+   unit = fopen(fname,"r");
+   if (unit == NULL)
+     {
+      fprintf(stderr,"Can't open cost file %s\n",fname);
+      return 0;
+     }
+
+   while (fgets(line,sizeof(line),unit) != NULL)
+     {
+      lineno++;
+      if (sscanf(line,"%39s %lu",name,&val) != 2)
+        {
+         continue;
+        }
+
+      if ((name[0] == '#') || (name[0] == ';'))
+        {
+         continue;
+        }
+
+      if (strcasecmp(name,"F_CPU") == 0)
+        {
+         f_cpu = val;
+         continue;
+        }
+
+      for (i=0; i<AVR_NUM_OPS; i++)
+        {
+         if (strcasecmp(name,cost_names[i]) == 0)
+           {
+            avr_cost[i] = val;
+            if (i == AVR_SERIAL_BYTE)
+              {
+               serial_cost_given = 1;
+              }
+            break;
+           }
+        }
+
+      if (i >= AVR_NUM_OPS)
+        {
+         fprintf(stderr,"%s line %d: unknown cost %s\n",fname,lineno,name);
+        }
+     }
+
+   fclose(unit);
+   return 1;
+  }
+
+
+/* -------- sections -------------------------------------------------------- */
+
+#define MAX_SECTIONS 32
+#define MAX_DEPTH 8
+
+#define IDLE_SECTION "wait_seconds"
+#define EPOCH_SECTION "render_epoch"
+#define SLEEP_SECTION "sleep"
+
+typedef struct
+  {
+   const char *name;
+   unsigned long long cycles;
+   long calls;
+  }
+   section;
+
+static section sections[MAX_SECTIONS] = { { "(other)", 0, 0 } };
+static int nsections = 1;
+
+static int sect_stack[MAX_DEPTH] = { 0 };
+static int sect_depth = 0;
+static int idle_sect = -1;
+static int sleep_sect = -1;
+
+/* cycle clock at the last change of section */
+static unsigned long long sect_mark = 0;
+
+/* this simulated second */
+static long sim_second = 0;
+static long sec_epochs = 0;
+static unsigned long long sec_start = 0;
+static unsigned long long sec_idle = 0;
+static unsigned long long sec_sleep = 0;
+static long long sec_count[AVR_NUM_OPS];
+
+/* whole run */
+static unsigned long long total_busy = 0;
+static unsigned long long total_sleep = 0;
+static unsigned long long max_busy = 0;
+static long max_busy_second = 0;
+static long over_budget = 0;
+static long over_wire = 0;
+
+
+static void charge(void)
+  {
+   unsigned long long delta;
+   int s;
+
+   delta = avr_cycles - sect_mark;
+   s = sect_stack[sect_depth];
+   sections[s].cycles += delta;
+   if (s == idle_sect)
+     {
+      sec_idle += delta;
+     }
+   if (s == sleep_sect)
+     {
+      sec_sleep += delta;
+     }
+   sect_mark = avr_cycles;
+  }
+
+
+static int find_section(const char *name)
+  {
+   int i;
+
+   for (i=0; i<nsections; i++)
+     {
+      if (strcmp(sections[i].name,name) == 0)
+        {
+         return i;
+        }
+     }
+
+   if (nsections >= MAX_SECTIONS)
+     {
+      return 0;
+     }
+
+   sections[nsections].name = name;
+   sections[nsections].cycles = 0;
+   sections[nsections].calls = 0;
+   if (strcmp(name,IDLE_SECTION) == 0)
+     {
+      idle_sect = nsections;
+     }
+   if (strcmp(name,SLEEP_SECTION) == 0)
+     {
+      sleep_sect = nsections;
+     }
+   return nsections++;
+  }
+
+
+static void report_header(void)
+  {
+   int u;
+
+   fprintf(rpt_unit,"AVR cycle budget -- F_CPU %lu Hz, serial %ld baud, ",f_cpu,uarts[0].baud);
+   for (u=1; u<NUM_UARTS; u++)
+     {
+      if (uarts[u].baud > 0)
+        {
+         fprintf(rpt_unit,"Serial%d %ld baud, ",u,uarts[u].baud);
+        }
+     }
+   if (uarts[0].isr != NULL)
+     {
+      fprintf(rpt_unit,"transmit ring, %lu cycles per byte in the interrupt\n",avr_cost[AVR_TX_BYTE]);
+     }
+   else if (serial_cost_given)
+     {
+      fprintf(rpt_unit,"%lu cycles per byte sent\n",avr_cost[AVR_SERIAL_BYTE]);
+     }
+   else
+     {
+      fprintf(rpt_unit,"Serial.write() waits for each byte (%lu cycles)\n",avr_cost[AVR_SERIAL_BYTE]);
+     }
+
+   fprintf(rpt_unit,"\n   sec      busy  budget  awake  arith  math dtostrf sprintf bytes  wire\n");
+  }
+
+
+/* close one simulated second and write its line of the report */
+static void end_second(void)
+  {
+   unsigned long long busy;
+   unsigned long long cycles;
+   long long n[AVR_NUM_OPS];
+   double budget;
+   double awake;
+   double wire = 0.0;
+   double port_wire;
+   int i;
+
+   charge();
+   for (i=0; i<AVR_NUM_OPS; i++)
+     {
+      n[i] = avr_count[i] - sec_count[i];
+      sec_count[i] = avr_count[i];
+     }
+
+   cycles = avr_cycles - sec_start;
+   busy = cycles - sec_idle - sec_sleep;
+   awake = ((cycles > 0) ? 100.0 * (double)(cycles - sec_sleep) / (double)cycles : 100.0);
+   total_sleep += sec_sleep;
+   sec_start = avr_cycles;
+   sec_idle = 0;
+   sec_sleep = 0;
+   sim_second++;
+
+   if (sim_second == 1)
+     {
+      report_header();
+     }
+
+   /* bytes sent either way */
+   n[AVR_SERIAL_BYTE] += n[AVR_TX_BYTE];
+
+   budget = 100.0 * (double)busy / (double)f_cpu;
+   for (i=0; i<NUM_UARTS; i++)
+     {
+      if (uarts[i].baud > 0)
+        {
+         port_wire = 100.0 * (double)uarts[i].sec_bytes * 10.0 / (double)uarts[i].baud;
+         if (port_wire > wire)
+           {
+            wire = port_wire;
+           }
+        }
+      uarts[i].sec_bytes = 0;
+     }
+
+   fprintf(rpt_unit,"%6ld %9llu %6.1f%% %5.1f%% %6lld %5lld %7lld %7lld %5lld %4.0f%%%s%s\n",
+           sim_second,busy,budget,awake,
+           n[AVR_FADD] + n[AVR_FMUL] + n[AVR_FDIV] + n[AVR_FCMP] + n[AVR_FCONV],
+           n[AVR_FSQRT] + n[AVR_FTRIG] + n[AVR_FATRIG] + n[AVR_FOTHER],
+           n[AVR_DTOSTRF],n[AVR_SPRINTF],n[AVR_SERIAL_BYTE],wire,
+           ((busy > f_cpu) ? "  OVER BUDGET" : ""),
+           ((wire > 100.0) ? "  OVER WIRE" : ""));
+
+   total_busy += busy;
+   if (busy > max_busy)
+     {
+      max_busy = busy;
+      max_busy_second = sim_second;
+     }
+   if (busy > f_cpu)
+     {
+      over_budget++;
+     }
+   if (wire > 100.0)
+     {
+      over_wire++;
+     }
+
+   if ((max_seconds > 0) && (sim_second >= max_seconds))
+     {
+      avrhost_finish();
+     }
+  }
+
+
+void avrhost_begin(const char *name)
+  {
+   int s;
+
+   charge();
+   s = find_section(name);
+   sections[s].calls++;
+   if (sect_depth < MAX_DEPTH-1)
+     {
+      sect_depth++;
+     }
+   sect_stack[sect_depth] = s;
+  }
+
+
+void avrhost_end(const char *name)
+  {
+   charge();
+   if (sect_depth > 0)
+     {
+      sect_depth--;
+     }
+
+   if ((strcmp(name,EPOCH_SECTION) == 0) && (++sec_epochs >= flt_hz))
+     {
+      sec_epochs = 0;
+      end_second();
+     }
+  }
+
+
+/* -------- end of run ------------------------------------------------------ */
+
+static int by_cycles_desc(const void *a, const void *b)
+  {
+   unsigned long long ca = *(const unsigned long long *)a;
+   unsigned long long cb = *(const unsigned long long *)b;
+
+   return ((ca < cb) ? 1 : ((ca > cb) ? -1 : 0));
+  }
+
+
+void avrhost_finish(void)
+  {
+   /* cycles and index pairs, sorted on cycles */
+   unsigned long long rank[MAX_SECTIONS > AVR_NUM_OPS ? MAX_SECTIONS : AVR_NUM_OPS][2];
+   double per;
+   int i;
+   int n;
+
+   charge();
+   for (i=0; i<NUM_UARTS; i++)
+     {
+      if (uarts[i].unit != NULL)
+        {
+         fflush(uarts[i].unit);
+        }
+     }
+
+   if (sim_second == 0)
+     {
+      fprintf(rpt_unit,"No simulated seconds\n");
+      exit(0);
+     }
+
+   per = (double)sim_second;
+   fprintf(rpt_unit,"\n%ld simulated seconds -- busy %.0f cycles/second average (%.1f%%), "
+                    "most %llu at second %ld (%.1f%%)\n",
+           sim_second,(double)total_busy/per,100.0*(double)total_busy/per/(double)f_cpu,
+           max_busy,max_busy_second,100.0*(double)max_busy/(double)f_cpu);
+   fprintf(rpt_unit,"seconds over cycle budget: %ld   over serial wire time: %ld\n",
+           over_budget,over_wire);
+   fprintf(rpt_unit,"awake %.1f%% of the time, asleep %.1f%%\n",
+           100.0 - 100.0*(double)total_sleep/(double)sec_start,
+           100.0*(double)total_sleep/(double)sec_start);
+   if ((uarts[1].baud > 0) || (uarts[2].baud > 0) || (uarts[3].baud > 0))
+     {
+      for (i=0; i<NUM_UARTS; i++)
+        {
+         if (uarts[i].baud > 0)
+           {
+            fprintf(rpt_unit,"UART %d  %6ld baud %8.1f bytes/sec  wire %5.1f%%\n",
+                    i,uarts[i].baud,(double)uarts[i].bytes/per,
+                    100.0*(double)uarts[i].bytes/per*10.0/(double)uarts[i].baud);
+           }
+        }
+     }
+
+   /* operations ranked by the cycles they cost */
+   for (i=0; i<AVR_NUM_OPS; i++)
+     {
+      rank[i][0] = (unsigned long long)avr_count[i] * avr_cost[i];
+      rank[i][1] = i;
+     }
+   qsort(rank,AVR_NUM_OPS,sizeof(rank[0]),by_cycles_desc);
+
+   fprintf(rpt_unit,"\noperation        count/sec  cycles each   cycles/sec   of busy\n");
+   for (i=0; i<AVR_NUM_OPS; i++)
+     {
+      n = (int)rank[i][1];
+      if (avr_count[n] == 0)
+        {
+         continue;
+        }
+      fprintf(rpt_unit,"%-14s %11.1f %12lu %12.0f %8.1f%%%s\n",
+              cost_names[n],(double)avr_count[n]/per,avr_cost[n],
+              (double)rank[i][0]/per,
+              ((n == AVR_MILLIS) ? 0.0 : 100.0*(double)rank[i][0]/(double)total_busy),
+              ((n == AVR_MILLIS) ? "  (mostly idle polling)" : ""));
+     }
+
+   /* sections ranked by the cycles spent in them (not in nested sections) */
+   for (i=0; i<nsections; i++)
+     {
+      rank[i][0] = sections[i].cycles;
+      rank[i][1] = i;
+     }
+   qsort(rank,nsections,sizeof(rank[0]),by_cycles_desc);
+
+   fprintf(rpt_unit,"\nsection          calls/sec   cycles/sec   of busy\n");
+   for (i=0; i<nsections; i++)
+     {
+      n = (int)rank[i][1];
+      fprintf(rpt_unit,"%-14s %11.1f %12.0f %8.1f%%%s\n",
+              sections[n].name,(double)sections[n].calls/per,(double)rank[i][0]/per,
+              (((n == idle_sect) || (n == sleep_sect)) ? 0.0 : 100.0*(double)rank[i][0]/(double)total_busy),
+              ((n == idle_sect) ? "  (idle)" : ((n == sleep_sect) ? "  (asleep)" : "")));
+     }
+
+   fflush(rpt_unit);
+   exit(0);
+  }
+
+
+/* -------- UART ------------------------------------------------------------ */
+
+#define ISR_SECTION "tx_interrupt"
+#define FULL_SECTION "tx_ring_full"
+
+static unsigned long long isr_time = 0;      /* when the running interrupt was due */
+static int in_isr = 0;
+
+#define UDRIE_BIT (1 << 5)
+
+
+/* cycle at which a UART's data register empty interrupt is due, 0 if disabled */
+static unsigned long long isr_due(int u)
+  {
+   if ((uarts[u].isr == NULL) || !(uarts[u].ucsrb->v & UDRIE_BIT))
+     {
+      return 0;
+     }
+   return ((uarts[u].udr_free > uarts[u].udrie_since) ? uarts[u].udr_free : uarts[u].udrie_since);
+  }
+
+
+/* the UART whose interrupt is due first, -1 if none is enabled */
+static int next_isr(unsigned long long *due)
+  {
+   unsigned long long d;
+   int u;
+   int first = -1;
+
+   *due = 0;
+   for (u=0; u<NUM_UARTS; u++)
+     {
+      d = isr_due(u);
+      if ((d != 0) && ((first < 0) || (d < *due)))
+        {
+         first = u;
+         *due = d;
+        }
+     }
+   return first;
+  }
+
+
+/* run every interrupt due by now, in turn -- each sends a byte, or disables
+   itself */
+static void uart_run(void)
+  {
+   unsigned long long due;
+   int u;
+
+   if (in_isr)
+     {
+      return;
+     }
+
+   while (((u = next_isr(&due)) >= 0) && (due <= avr_cycles))
+     {
+      in_isr = 1;
+      isr_time = due;
+      avrhost_begin(ISR_SECTION);
+      uarts[u].isr();
+      avrhost_end(ISR_SECTION);
+      in_isr = 0;
+     }
+  }
+
+
+avr_ucsrb &avr_ucsrb::operator|=(int bits)
+  {
+   if ((bits & UDRIE_BIT) && !(v & UDRIE_BIT))
+     {
+      uarts[uart].udrie_since = avr_cycles;
+     }
+   v |= (uint8_t)bits;
+   return *this;
+  }
+
+
+avr_udr &avr_udr::operator=(uint8_t kar)
+  {
+   uart_model *m = &uarts[uart];
+   unsigned long long start;
+
+   /* the byte waits in UDRn until the shift register is free */
+   start = (in_isr ? isr_time : avr_cycles);
+   if (start < m->wire_free)
+     {
+      start = m->wire_free;
+     }
+   m->udr_free = start;
+   m->wire_free = start + m->byte_cycles;
+
+   AVR_COUNT(AVR_TX_BYTE,1);
+   m->bytes++;
+   m->sec_bytes++;
+   if (m->unit != NULL)
+     {
+      fputc(kar,m->unit);
+     }
+   return *this;
+  }
+
+
+void avrhost_tx_wait(void)
+  {
+   unsigned long long due;
+
+   avrhost_begin(FULL_SECTION);
+   next_isr(&due);
+   if (due > avr_cycles)
+     {
+      avr_cycles = due;
+     }
+   else if (due == 0)
+     {
+      avr_cycles += 8;    /* a turn of the wait loop */
+     }
+   uart_run();
+   avrhost_end(FULL_SECTION);
+  }
+
+
+/* -------- sleep ----------------------------------------------------------- */
+
+/* TRUE just after a sleep -- the clock is already on the tick, so millis() 
+   must not skip another millisecond */
+static int woke = 0;
+
+void avrhost_sleep(void)
+  {
+   unsigned long long per_ms;
+   unsigned long long wake;
+   unsigned long long due;
+
+   per_ms = f_cpu / 1000;
+   wake = ((avr_cycles / per_ms) + 1) * per_ms;
+   next_isr(&due);
+   if ((due != 0) && (due < wake))
+     {
+      /* an interrupt already pending ends the sleep straight away */
+      wake = ((due > avr_cycles) ? due : avr_cycles);
+     }
+
+   avrhost_begin(SLEEP_SECTION);
+   avr_cycles = wake;
+   avrhost_end(SLEEP_SECTION);
+
+   AVR_COUNT(AVR_WAKE,1);
+   uart_run();
+   woke = 1;
+  }
+
+
+/* -------- Arduino core ---------------------------------------------------- */
+
+HardwareSerial Serial(0), Serial1(1), Serial2(2), Serial3(3);
+
+void HardwareSerial::begin(long baud)
+  {
+   uarts[uart].baud = baud;
+   if (baud > 0)
+     {
+      uarts[uart].byte_cycles = (unsigned long long)(f_cpu * 10.0 / baud);
+     }
+
+   /* with no TX buffer, write() spins until the UART takes each byte --
+      10 bit times of cycles (only Serial is used that way) */
+   if (!serial_cost_given && (baud > 0) && (uart == 0))
+     {
+      avr_cost[AVR_SERIAL_BYTE] = (unsigned long)(f_cpu * 10.0 / baud);
+     }
+  }
+
+
+void HardwareSerial::write(uint8_t kar)
+  {
+   AVR_COUNT(AVR_SERIAL_BYTE,1);
+   uarts[uart].bytes++;
+   uarts[uart].sec_bytes++;
+   if (uarts[uart].unit != NULL)
+     {
+      fputc(kar,uarts[uart].unit);
+     }
+  }
+
+
+void HardwareSerial::print(const char *strg)
+  {
+   while (*strg)
+     {
+      write((uint8_t)*strg++);
+     }
+  }
+
+
+unsigned long millis(void)
+  {
+   unsigned long long per_ms;
+
+   AVR_COUNT(AVR_MILLIS,1);
+   per_ms = f_cpu / 1000;
+
+   /* idle -- nothing to do until the next millisecond */
+   if ((sect_stack[sect_depth] == idle_sect) && !woke)
+     {
+      avr_cycles = ((avr_cycles / per_ms) + 1) * per_ms;
+     }
+   woke = 0;
+   uart_run();
+
+   return (unsigned long)(avr_cycles / per_ms);
+  }
+
+
+unsigned long micros(void)
+  {
+   AVR_COUNT(AVR_MILLIS,1);
+   uart_run();
+   return (unsigned long)(avr_cycles / (f_cpu / 1000000));
+  }
+
+
+void delay(unsigned long ms)
+  {
+   avr_cycles += (unsigned long long)ms * (f_cpu / 1000);
+  }
+
+
+char *dtostrf(avrfloat val, signed char width, unsigned char prec, char *s)
+  {
+   AVR_COUNT(AVR_DTOSTRF,1);
+   sprintf(s,"%*.*f",width,prec,(double)val.v);
+   return s;
+  }
+
+
+int avr_sprintf(char *s, const char *fmt, ...)
+  {
+   va_list args;
+   int len;
+
+   va_start(args,fmt);
+   len = vsprintf(s,fmt,args);
+   va_end(args);
+
+   AVR_COUNT(AVR_SPRINTF,1);
+   if (len > 0)
+     {
+      AVR_COUNT(AVR_SPRINTF_CHAR,len);
+     }
+   return len;
+  }
+
+
+/* -------- main ------------------------------------------------------------ */
+
+int main(int argc, char *argv[])
+  {
+   char *val;
+   int i;
+
+   FILE *unit = NULL;
+
+   uarts[0].unit = stdout;
+   rpt_unit = stderr;
+
+   for (i=1; i<argc; i++)
+     {
+      val = strchr(argv[i],'=');
+      if (val == NULL)
+        {
+         fprintf(stderr,"Expected KEYWORD=value, not %s\n",argv[i]);
+         return 1;
+        }
+      *val++ = 0;
+
+      if (strcasecmp(argv[i],"OUT") == 0)
+        {
+         unit = uarts[0].unit = fopen(val,"wb");
+        }
+      else if ((strncasecmp(argv[i],"OUT",3) == 0) && (argv[i][3] >= '1') && (argv[i][3] <= '3')
+               && (argv[i][4] == 0))
+        {
+         unit = uarts[argv[i][3] - '0'].unit = fopen(val,"wb");
+        }
+      else if (strcasecmp(argv[i],"REPORT") == 0)
+        {
+         rpt_unit = fopen(val,"w");
+        }
+      else if (strcasecmp(argv[i],"COST") == 0)
+        {
+         if (!read_cost(val))
+           {
+            return 1;
+           }
+        }
+      else if (strcasecmp(argv[i],"F_CPU") == 0)
+        {
+         f_cpu = strtoul(val,NULL,10);
+        }
+      else if (strcasecmp(argv[i],"SECONDS") == 0)
+        {
+         max_seconds = atol(val);
+        }
+      else
+        {
+         fprintf(stderr,"Unknown keyword %s\n",argv[i]);
+         return 1;
+        }
+
+      if ((strncasecmp(argv[i],"OUT",3) == 0) && (unit == NULL))
+        {
+         fprintf(stderr,"Can't open %s\n",val);
+         return 1;
+        }
+      if (rpt_unit == NULL)
+        {
+         fprintf(stderr,"Can't open %s\n",val);
+         return 1;
+        }
+     }
+
+   if (f_cpu < 1000)
+     {
+      fprintf(stderr,"F_CPU too low\n");
+      return 1;
+     }
+
+   /* setup() runs the whole script, and calls avrhost_finish() at the end */
+   setup();
+   for (;;)
+     {
+      loop();
+     }
+
+   return 0;
+  }
@@ -0,0 +1,297 @@
+/* avrhost.h -- host (Linux) stand-ins for the Arduino/AVR environment, so
+                that the ARDUINO code path of gpssim.pde compiles and runs
+                natively as C++ -- see avrhost.cpp
+
+   On the AVR "double" is a 32-bit float done in software, and every
+   floating point operation, every formatting call and every byte sent
+   costs cycles out of the 16 MHz budget.  Here "double" is replaced by
+   the class avrfloat, which holds a real 32-bit float (so results round
+   like the AVR) and counts each operation.  A cycle cost model (avrcost.cfg)
+   turns the counts into AVR cycles, and millis() runs on those modeled
+   cycles, so the sketch paces itself as it would on the board.
+
+   NOT modeled: int is 16 bits and long is 32 bits on the AVR, but keep
+   their host sizes here -- and integer arithmetic is not counted.
+*/
+
+#ifndef AVRHOST_H__
+#define AVRHOST_H__
+
+/* system headers first -- "double" is redefined at the end of this file */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdarg.h>
+
+
+/* operation classes counted -- each has a cycle cost in the model */
+enum avr_op
+  {
+   AVR_FADD = 0,     /* add or subtract */
+   AVR_FMUL,
+   AVR_FDIV,
+   AVR_FCMP,
+   AVR_FCONV,        /* integer to float or float to integer */
+   AVR_FSQRT,
+   AVR_FTRIG,        /* sin, cos, tan */
+   AVR_FATRIG,       /* asin, acos, atan, atan2 */
+   AVR_FOTHER,       /* fabs, floor, ceil, fmod, pow */
+   AVR_DTOSTRF,      /* per call */
+   AVR_SPRINTF,      /* per call */
+   AVR_SPRINTF_CHAR, /* per character produced */
+   AVR_PGM_BYTE,     /* per byte read from flash */
+   AVR_SERIAL_BYTE,  /* per byte queued to the UART */
+   AVR_MILLIS,       /* per call */
+   AVR_TX_BYTE,      /* per byte sent by the transmit interrupt (TX_RING) */
+   AVR_WAKE,         /* per wake-up from sleep (IDLE_SLEEP) */
+   AVR_NUM_OPS
+  };
+
+extern long long avr_count[AVR_NUM_OPS];
+extern unsigned long long avr_cycles;
+extern unsigned long avr_cost[AVR_NUM_OPS];
+
+/* add n operations of class op to the counts and the cycle clock */
+#define AVR_COUNT(op,n)  { avr_count[op] += (n); avr_cycles += (unsigned long long)(n) * avr_cost[op]; }
+
+/* named sections for attributing cycles -- gpssim's EVTRACE_BEGIN/END
+   points are used, see WProgram.h */
+void avrhost_begin(const char *name);
+void avrhost_end(const char *name);
+
+/* write the report and exit -- called where the sketch would idle forever */
+void avrhost_finish(void);
+
+/* the sketch's transmit ring is full -- run the UART until it takes a byte */
+void avrhost_tx_wait(void);
+
+/* the sketch sleeps until the next interrupt -- see avr/sleep.h */
+void avrhost_sleep(void);
+
+
+/* ----------------------------------------------------------------------- */
+
+class avrfloat
+  {
+   public:
+      float v;
+
+      avrfloat() : v(0.0f) { }
+      avrfloat(double d) : v((float)d) { }     /* constants -- folded by compiler */
+      avrfloat(float f) : v(f) { }
+      avrfloat(int i) : v((float)i) { AVR_COUNT(AVR_FCONV,1); }
+      avrfloat(long i) : v((float)i) { AVR_COUNT(AVR_FCONV,1); }
+      avrfloat(unsigned int i) : v((float)i) { AVR_COUNT(AVR_FCONV,1); }
+      avrfloat(unsigned long i) : v((float)i) { AVR_COUNT(AVR_FCONV,1); }
+
+      operator float() const { AVR_COUNT(AVR_FCONV,1); return v; }
+
+      avrfloat operator-() const { return avrfloat(-v); }    /* sign flip, free */
+
+      avrfloat &operator+=(const avrfloat &b) { AVR_COUNT(AVR_FADD,1); v += b.v; return *this; }
+      avrfloat &operator-=(const avrfloat &b) { AVR_COUNT(AVR_FADD,1); v -= b.v; return *this; }
+      avrfloat &operator*=(const avrfloat &b) { AVR_COUNT(AVR_FMUL,1); v *= b.v; return *this; }
+      avrfloat &operator/=(const avrfloat &b) { AVR_COUNT(AVR_FDIV,1); v /= b.v; return *this; }
+  };
+
+
+/* binary operators for avrfloat with avrfloat and with every arithmetic
+   type, so that mixed expressions never fall back on the built-in
+   operators through operator float() */
+
+#define AVR_ARITH(op,cls) \
+   inline avrfloat operator op(const avrfloat &a, const avrfloat &b) \
+     { AVR_COUNT(cls,1); return avrfloat((float)(a.v op b.v)); }
+
+#define AVR_COMPARE(op) \
+   inline bool operator op(const avrfloat &a, const avrfloat &b) \
+     { AVR_COUNT(AVR_FCMP,1); return a.v op b.v; }
+
+#define AVR_MIXED(T) \
+   inline avrfloat operator+(const avrfloat &a, T b) { return a + avrfloat(b); } \
+   inline avrfloat operator+(T a, const avrfloat &b) { return avrfloat(a) + b; } \
+   inline avrfloat operator-(const avrfloat &a, T b) { return a - avrfloat(b); } \
+   inline avrfloat operator-(T a, const avrfloat &b) { return avrfloat(a) - b; } \
+   inline avrfloat operator*(const avrfloat &a, T b) { return a * avrfloat(b); } \
+   inline avrfloat operator*(T a, const avrfloat &b) { return avrfloat(a) * b; } \
+   inline avrfloat operator/(const avrfloat &a, T b) { return a / avrfloat(b); } \
+   inline avrfloat operator/(T a, const avrfloat &b) { return avrfloat(a) / b; } \
+   inline bool operator<(const avrfloat &a, T b) { return a < avrfloat(b); } \
+   inline bool operator<(T a, const avrfloat &b) { return avrfloat(a) < b; } \
+   inline bool operator>(const avrfloat &a, T b) { return a > avrfloat(b); } \
+   inline bool operator>(T a, const avrfloat &b) { return avrfloat(a) > b; } \
+   inline bool operator<=(const avrfloat &a, T b) { return a <= avrfloat(b); } \
+   inline bool operator<=(T a, const avrfloat &b) { return avrfloat(a) <= b; } \
+   inline bool operator>=(const avrfloat &a, T b) { return a >= avrfloat(b); } \
+   inline bool operator>=(T a, const avrfloat &b) { return avrfloat(a) >= b; } \
+   inline bool operator==(const avrfloat &a, T b) { return a == avrfloat(b); } \
+   inline bool operator==(T a, const avrfloat &b) { return avrfloat(a) == b; } \
+   inline bool operator!=(const avrfloat &a, T b) { return a != avrfloat(b); } \
+   inline bool operator!=(T a, const avrfloat &b) { return avrfloat(a) != b; }
+
+AVR_ARITH(+,AVR_FADD)
+AVR_ARITH(-,AVR_FADD)
+AVR_ARITH(*,AVR_FMUL)
+AVR_ARITH(/,AVR_FDIV)
+
+AVR_COMPARE(<)
+AVR_COMPARE(>)
+AVR_COMPARE(<=)
+AVR_COMPARE(>=)
+AVR_COMPARE(==)
+AVR_COMPARE(!=)
+
+AVR_MIXED(int)
+AVR_MIXED(long)
+AVR_MIXED(unsigned int)
+AVR_MIXED(unsigned long)
+AVR_MIXED(float)
+AVR_MIXED(double)
+
+
+/* avr-libc math, single precision */
+
+#define AVR_MATH1(name,cls) \
+   inline avrfloat name(const avrfloat &a) { AVR_COUNT(cls,1); return avrfloat((float)name##f(a.v)); }
+
+AVR_MATH1(sqrt,AVR_FSQRT)
+AVR_MATH1(sin,AVR_FTRIG)
+AVR_MATH1(cos,AVR_FTRIG)
+AVR_MATH1(tan,AVR_FTRIG)
+AVR_MATH1(asin,AVR_FATRIG)
+AVR_MATH1(acos,AVR_FATRIG)
+AVR_MATH1(atan,AVR_FATRIG)
+AVR_MATH1(fabs,AVR_FOTHER)
+AVR_MATH1(floor,AVR_FOTHER)
+AVR_MATH1(ceil,AVR_FOTHER)
+
+inline avrfloat atan2(const avrfloat &a, const avrfloat &b)
+  {
+   AVR_COUNT(AVR_FATRIG,1);
+   return avrfloat((float)atan2f(a.v,b.v));
+  }
+
+inline avrfloat fmod(const avrfloat &a, const avrfloat &b)
+  {
+   AVR_COUNT(AVR_FOTHER,1);
+   return avrfloat((float)fmodf(a.v,b.v));
+  }
+
+inline avrfloat pow(const avrfloat &a, const avrfloat &b)
+  {
+   AVR_COUNT(AVR_FOTHER,1);
+   return avrfloat((float)powf(a.v,b.v));
+  }
+
+
+/* avr-libc dtostrf() -- negative width left-justifies */
+char *dtostrf(avrfloat val, signed char width, unsigned char prec, char *s);
+
+/* sprintf() with its output counted -- the sketch has no %f formats */
+int avr_sprintf(char *s, const char *fmt, ...);
+#define sprintf avr_sprintf
+
+
+/* flash table reads -- see avr/pgmspace.h */
+
+inline unsigned char avr_pgm_byte(const unsigned char *p)
+  {
+   AVR_COUNT(AVR_PGM_BYTE,1);
+   return *p;
+  }
+
+inline unsigned int avr_pgm_word(const unsigned int *p)
+  {
+   AVR_COUNT(AVR_PGM_BYTE,2);
+   return *p;
+  }
+
+inline unsigned long avr_pgm_dword(const unsigned long *p)
+  {
+   AVR_COUNT(AVR_PGM_BYTE,4);
+   return *p;
+  }
+
+inline long avr_pgm_dword(const long *p)
+  {
+   AVR_COUNT(AVR_PGM_BYTE,4);
+   return *p;
+  }
+
+inline float avr_pgm_float(const avrfloat *p)
+  {
+   AVR_COUNT(AVR_PGM_BYTE,4);
+   return p->v;
+  }
+
+inline float avr_pgm_float(const float *p)
+  {
+   AVR_COUNT(AVR_PGM_BYTE,4);
+   return *p;
+  }
+
+
+/* avr-libc rand() is 15 bits (RAND_MAX 0x7FFF) -- glibc's is 31 */
+#define rand()  (rand() >> 16)
+#undef RAND_MAX
+#define RAND_MAX 0x7FFF
+
+
+/* ----------------------------------------------------------------------- */
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+
+/* the host has the Mega's four UARTs -- a 328 sketch uses only Serial */
+
+class HardwareSerial
+  {
+   public:
+      int uart;
+
+      HardwareSerial(int n) : uart(n) { }
+      void begin(long baud);
+      void write(uint8_t kar);
+      void print(const char *strg);
+  };
+
+extern HardwareSerial Serial, Serial1, Serial2, Serial3;
+
+
+/* the UART registers used by an interrupt driven transmit -- writing UDRn
+   puts a byte on that UART's modeled wire, and while UDRIEn is set in UCSRnB
+   its data register empty interrupt (USARTn_UDRE_vect, see avr/io.h) is run
+   each time the UART can take another byte */
+
+class avr_ucsrb
+  {
+   public:
+      int uart;
+      uint8_t v;
+
+      avr_ucsrb(int n) : uart(n), v(0) { }
+      operator uint8_t() const { return v; }
+      avr_ucsrb &operator|=(int bits);
+      avr_ucsrb &operator&=(int bits) { v &= (uint8_t)bits; return *this; }
+  };
+
+class avr_udr
+  {
+   public:
+      int uart;
+
+      avr_udr(int n) : uart(n) { }
+      avr_udr &operator=(uint8_t kar);
+  };
+
+extern avr_ucsrb UCSR0B, UCSR1B, UCSR2B, UCSR3B;
+extern avr_udr UDR0, UDR1, UDR2, UDR3;
+
+
+/* from here on, the sketch's "double" is the counted 32-bit float */
+#define double avrfloat
+
+#endif
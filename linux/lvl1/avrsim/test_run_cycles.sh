@@ -0,0 +1,2 @@
+#!/bin/sh
+./avrgpssim OUT=ix.txt REPORT=cycles.txt COST=avrcost.cfg
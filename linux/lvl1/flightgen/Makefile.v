@@ -0,0 +1,49 @@
+#=======================================================================
+# Offline balloon flight generator for GPSSIM -- flies a flight (or a
+# batch) with the flight model library and writes the waypoints.  See
+# flightgen.c.
+#=======================================================================
+
+# Standard defines:
+CC  	=	gcc
+LD  	=	gcc
+oDir	=	.
+Bin	=	.
+libDirs	=	-L../../clibrary
+
+incDirs	=	-I../../clibrary
+
+LD_FLAGS =	-s
+LIBS	=	-lflight -lwgs84 -ldegtrig -lm
+C_FLAGS	=	-O
+
+EXOBJS	=\
+	$(oDir)/flightgen.o
+
+ALLOBJS	=	$(EXOBJS)
+ALLBIN	=	$(Bin)/flightgen
+ALLTGT	=	$(Bin)/flightgen
+
+#@# Targets follow ---------------------------------
+
+all:	$(ALLTGT)
+
+objs:	$(ALLOBJS)
+
+cleanobjs:
+	rm -f $(ALLOBJS)
+
+cleanbin:
+	rm -f $(ALLBIN)
+
+clean:	cleanobjs cleanbin
+
+cleanall:	cleanobjs cleanbin
+
+#@# Dependency rules follow -----------------------------
+
+$(Bin)/flightgen: $(EXOBJS)
+	$(LD) -o $(Bin)/flightgen $(EXOBJS) $(libDirs) $(LD_FLAGS) $(LIBS)
+
+$(oDir)/flightgen.o: flightgen.c ../../clibrary/flight.h ../../clibrary/wgs84.h
+	$(CC) $(C_FLAGS) $(incDirs) -c -o $@ flightgen.c
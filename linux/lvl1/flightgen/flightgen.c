@@ -0,0 +1,264 @@
+/* flightgen.c -- flies a balloon flight (or a batch of them) with the flight
+                  model library and writes the track as gpssim waypoints
+
+   GLF GPSSIM for LVL1 -- offline flight generator
+
+   usage:  flightgen flight.flt [flights [track.wpt]]
+
+   flight.flt holds the launch and balloon as "KEYWORD value" lines (see
+   fl_read_params() in the flight library, and balloon.flt with gpssim).
+   With more than one flight, the others are spread by the file's
+   VARY_GAS, VARY_BURST and VARY_WIND percentages, and all are flown
+   together -- the burst and landing of each are listed (or summed up,
+   for more than 20).  The track of the first flight goes to track.wpt in
+   the waypoint format of linux/lvl1/wppack, so it can be packed for the
+   Arduino, or is listed to standard output if no file is given.
+
+   gpssim on Windows/Linux can fly the same file itself (FLIGHT=file).
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "flight.h"
+#include "wgs84.h"
+
+#define TRUE 1
+#define FALSE 0
+
+
+/* days since 1 Jan 1950 for a DDMMYY date (years 1950-2049) -- as wppack */
+long day_number(long date)
+  {
+   static int mdays[12] = { 31,28,31,30,31,30,31,31,30,31,30,31 };
+   int da, mo, yr;
+   int i;
+   long days = 0;
+
+   da = (int)(date / 10000L);
+   mo = (int)((date / 100L) % 100L);
+   yr = (int)(date % 100L);
+   yr += ((yr < 50) ? 2000 : 1900);
+
+   for (i=1950; i<yr; i++)
+     {
+      days += (((i % 4) == 0) && (((i % 100) != 0) || ((i % 400) == 0))) ? 366 : 365;
+     }
+   for (i=1; i<mo; i++)
+     {
+      days += mdays[i-1];
+      if ((i == 2) && ((yr % 4) == 0) && (((yr % 100) != 0) || ((yr % 400) == 0)))
+        {
+         days++;
+        }
+     }
+   return days + da - 1;
+  }
+
+
+/* DDMMYY for a day number */
+long day_date(long days)
+  {
+   static int mdays[12] = { 31,28,31,30,31,30,31,31,30,31,30,31 };
+   int yr, mo, len, leap;
+
+   for (yr=1950; ; yr++)
+     {
+      leap = (((yr % 4) == 0) && (((yr % 100) != 0) || ((yr % 400) == 0)));
+      len = (leap ? 366 : 365);
+      if (days < len)
+        {
+         break;
+        }
+      days -= len;
+     }
+   for (mo=1; mo<12; mo++)
+     {
+      len = mdays[mo-1] + (((mo == 2) && leap) ? 1 : 0);
+      if (days < len)
+        {
+         break;
+        }
+      days -= len;
+     }
+   return (days + 1) * 10000L + mo * 100L + (yr % 100);
+  }
+
+
+/* degrees to the DDMM.mmm of the waypoint file */
+double ddmm(double deg)
+  {
+   double sgn = 1.0;
+   int whole;
+
+   if (deg < 0.0)
+     {
+      sgn = -1.0;
+      deg = -deg;
+     }
+   whole = (int)deg;
+   return sgn * (whole * 100.0 + (deg - whole) * 60.0);
+  }
+
+
+/* meters on the WGS 84 ellipsoid */
+double distance(double lat1, double lon1, double lat2, double lon2)
+  {
+   double d, az1, az2;
+
+   wgs_inverse(lat1,lon1,lat2,lon2,&d,&az1,&az2);
+   return d;
+  }
+
+
+void write_track(FILE *unit, fl_params *p, fl_track *trk)
+  {
+   long start, secs;
+   int i;
+
+   start = day_number(p->date) * 86400L + (p->time / 10000L) * 3600L
+           + ((p->time / 100L) % 100L) * 60L + (p->time % 100L);
+
+   fprintf(unit,"# %d waypoints flown by flightgen\n",trk->count);
+   for (i=0; i<trk->count; i++)
+     {
+      secs = start + trk->secs[i];
+      fprintf(unit,"%06ld  %06ld  %9.3f  %10.3f  %8.1f\n",
+              day_date(secs / 86400L),
+              (secs % 86400L) / 3600L * 10000L + (secs % 3600L) / 60L * 100L + secs % 60L,
+              ddmm(trk->lat[i]),ddmm(trk->lon[i]),trk->alt[i]);
+     }
+  }
+
+
+void list_flights(fl_batch *b, fl_params *p)
+  {
+   int i;
+
+   printf("flight   burst s   burst m   landed s    landed lat    long      drift km\n");
+   for (i=0; i<b->count; i++)
+     {
+      printf("%5d  %9.0f %9.0f %10.0f  %11.5f %11.5f %9.1f\n",
+             i,b->burst_secs[i],b->burst_alt[i],b->land_secs[i],b->land_lat[i],b->land_lon[i],
+             distance(p->lat,p->lon,b->land_lat[i],b->land_lon[i]) / 1000.0);
+     }
+  }
+
+
+void sum_flights(fl_batch *b)
+  {
+   double burst_lo, burst_hi, burst_sum, land_lo, land_hi, land_sum, d, d_hi, d_sum;
+   int i;
+
+   burst_lo = land_lo = 1e30;
+   burst_hi = land_hi = d_hi = -1e30;
+   burst_sum = land_sum = d_sum = 0.0;
+
+   for (i=0; i<b->count; i++)
+     {
+      burst_lo = (b->burst_alt[i] < burst_lo) ? b->burst_alt[i] : burst_lo;
+      burst_hi = (b->burst_alt[i] > burst_hi) ? b->burst_alt[i] : burst_hi;
+      burst_sum += b->burst_alt[i];
+      land_lo = (b->land_secs[i] < land_lo) ? b->land_secs[i] : land_lo;
+      land_hi = (b->land_secs[i] > land_hi) ? b->land_secs[i] : land_hi;
+      land_sum += b->land_secs[i];
+
+      /* landing spread, from the nominal flight's landing */
+      d = distance(b->land_lat[0],b->land_lon[0],b->land_lat[i],b->land_lon[i]);
+      d_hi = (d > d_hi) ? d : d_hi;
+      d_sum += d;
+     }
+
+   printf("burst altitude m   %8.0f to %8.0f, mean %8.0f\n",burst_lo,burst_hi,burst_sum / b->count);
+   printf("landing after s    %8.0f to %8.0f, mean %8.0f\n",land_lo,land_hi,land_sum / b->count);
+   printf("landing from nominal km  mean %.1f, farthest %.1f\n",d_sum / b->count / 1000.0,d_hi / 1000.0);
+  }
+
+
+int main(int argc, char *argv[])
+  {
+   fl_params p;
+   fl_winds w;
+   fl_batch b;
+   fl_track trk;
+   FILE *unit;
+   clock_t t0, t1;
+   int n, landed;
+
+   if ((argc < 2) || (argc > 4))
+     {
+      fprintf(stderr,"usage:  flightgen flight.flt [flights [track.wpt]]\n");
+      return 1;
+     }
+
+   fl_default_params(&p);
+   if (!fl_read_params(&p,argv[1]))
+     {
+      fprintf(stderr,"%s\n",fl_error);
+      return 1;
+     }
+
+   w.count = 0;
+   if (p.winds[0] && (fl_read_winds(&w,p.winds) == 0))
+     {
+      fprintf(stderr,"%s\n",fl_error);
+      return 1;
+     }
+
+   n = 1;
+   if (argc > 2)
+     {
+      n = atoi(argv[2]);
+      if (n < 1)
+        {
+         fprintf(stderr,"Need at least 1 flight\n");
+         return 1;
+        }
+     }
+
+   if (!fl_batch_init(&b,&p,n))
+     {
+      fprintf(stderr,"Out of memory for %d flights\n",n);
+      return 1;
+     }
+   memset(&trk,0,sizeof(fl_track));
+
+   t0 = clock();
+   landed = fl_fly(&b,&p,&w,&trk);
+   t1 = clock();
+
+   fprintf(stderr,"%d flight%s, %d landed -- %.0f seconds of flight in %.1f ms (%d steps a second)\n",
+           n,((n > 1) ? "s" : ""),landed,b.secs,1000.0 * (t1 - t0) / CLOCKS_PER_SEC,p.steps);
+
+   if (n <= 20)
+     {
+      list_flights(&b,&p);
+     }
+   else
+     {
+      sum_flights(&b);
+     }
+
+   unit = stdout;
+   if (argc > 3)
+     {
+      unit = fopen(argv[3],"w");
+      if (unit == NULL)
+        {
+         fprintf(stderr,"Can't open %s\n",argv[3]);
+         return 1;
+        }
+     }
+   write_track(unit,&p,&trk);
+   if (unit != stdout)
+     {
+      fclose(unit);
+     }
+
+   fl_track_free(&trk);
+   fl_batch_free(&b);
+   return 0;
+  }
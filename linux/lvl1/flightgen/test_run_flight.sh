@@ -0,0 +1,2 @@
+#!/bin/sh
+cd ../gpssim && ../flightgen/flightgen balloon.flt 100 ../flightgen/balloon.wpt
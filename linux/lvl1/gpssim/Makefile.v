@@ -18,7 +18,7 @@ libDirs	=	-L../../clibrary
 incDirs	=	-I../../clibrary
 
 LD_FLAGS =	-s
-LIBS	=	-lgftermio -lcalensub -lobsolete -lgflib -lm
+LIBS	=	-levtrace -lalmanac -lsidtime -lmatrix -lflight -lwindgrid -lwgs84 -lwmm -lgeoid -ldegtrig -lgmnoise -lgftermio -lcalensub -lobsolete -lgflib -lrt -lpthread -lm
 C_FLAGS	=	-O
 
 SRCS	=\
@@ -58,5 +58,5 @@ $(Bin)/lxgpssim: $(EXOBJS)
 	$(LD) -o $(Bin)/lxgpssim $(EXOBJS) $(incDirs) $(libDirs) $(LD_FLAGS) $(LIBS)
 
 $(oDir)/gpssim.o: gpssim.c ../../clibrary/gflib.h ../../clibrary/calensub.h \
- ../../clibrary/obsolete.h ../../clibrary/gftermio.h
+ ../../clibrary/obsolete.h ../../clibrary/gftermio.h ../../clibrary/evtrace.h ../../clibrary/almanac.h ../../clibrary/sidtime.h ../../clibrary/matrix.h ../../clibrary/flight.h ../../clibrary/windgrid.h ../../clibrary/wgs84.h ../../clibrary/wmm.h ../../clibrary/geoid.h ../../clibrary/degtrig.h ../../clibrary/gmnoise.h
 	$(CC) $(C_FLAGS) $(incDirs) -c -o $@ $<
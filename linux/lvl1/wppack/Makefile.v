@@ -0,0 +1,45 @@
+#=======================================================================
+# Offline waypoint packer for the Arduino version of GPSSIM -- makes the
+# packed_script[] flash table read with PACKED_SCRIPT.  See wppack.c.
+#=======================================================================
+
+# Standard defines:
+CC  	=	gcc
+LD  	=	gcc
+oDir	=	.
+Bin	=	.
+
+LD_FLAGS =	-s
+LIBS	=	-lm
+C_FLAGS	=	-O
+
+EXOBJS	=\
+	$(oDir)/wppack.o
+
+ALLOBJS	=	$(EXOBJS)
+ALLBIN	=	$(Bin)/wppack
+ALLTGT	=	$(Bin)/wppack
+
+#@# Targets follow ---------------------------------
+
+all:	$(ALLTGT)
+
+objs:	$(ALLOBJS)
+
+cleanobjs:
+	rm -f $(ALLOBJS)
+
+cleanbin:
+	rm -f $(ALLBIN)
+
+clean:	cleanobjs cleanbin
+
+cleanall:	cleanobjs cleanbin
+
+#@# Dependency rules follow -----------------------------
+
+$(Bin)/wppack: $(EXOBJS)
+	$(LD) -o $(Bin)/wppack $(EXOBJS) $(LD_FLAGS) $(LIBS)
+
+$(oDir)/wppack.o: wppack.c
+	$(CC) $(C_FLAGS) -c -o $@ wppack.c
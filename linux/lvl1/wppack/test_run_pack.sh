@@ -0,0 +1,2 @@
+#!/bin/sh
+./wppack snox4.wpt packed.h
@@ -0,0 +1,364 @@
+/* wppack.c -- packs a gpssim waypoint list into the compact byte table
+               packed_script[] for Arduino flash (gpssim's PACKED_SCRIPT)
+
+   GLF GPSSIM for LVL1 -- offline waypoint packer
+
+   usage:  wppack waypoints.wpt [packed.h]
+
+   The waypoint file has one waypoint per line, as in gpssim's date_time[]
+   and lat_long_alt[] tables:
+
+      DDMMYY  HHMMSS  lat DDMM.mmm  long DDDMM.mmm  alt meters
+
+   with south and west negative; blank lines and lines starting with # are
+   skipped.  The C table goes to packed.h (or standard output), to paste
+   into gpssim.c in place of the packed_script[] there.
+
+   Packed format -- all numbers are varints (7 bits per byte, least
+   significant first, high bit set on all but the last byte), and signed
+   ones are zigzag coded (0,-1,1,-2,... as 0,1,2,3,...) so small changes
+   either way take one byte:
+
+      first waypoint   date DDMMYY, time HHMMSS, then lat, long, alt
+      each after       seconds since the waypoint before (signed, never 0),
+                       then the change in lat, long and alt
+      end              0 seconds
+
+   lat and long are held as DDMM.mmm times 1000 and alt as meters times 10,
+   so that gpssim's decoder (wp_next()) gets back exactly the numbers in
+   the file, to 3 decimals of a minute and 1 decimal of a meter.  A waypoint
+   takes about 9 bytes instead of the 20 of the tables.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define TRUE 1
+#define FALSE 0
+
+#define MAX_BYTES 60000         /* Arduino tables must stay under 64K anyway */
+
+typedef struct
+  {
+   long date;                   /* DDMMYY */
+   long time;                   /* HHMMSS */
+   long secs;                   /* seconds since 1 Jan 1950 */
+   long lat;                    /* DDMM.mmm * 1000 */
+   long lon;
+   long alt;                    /* meters * 10 */
+  }
+   waypoint;
+
+unsigned char packed[MAX_BYTES];
+int npacked = 0;
+
+
+/* days since 1 Jan 1950 for a DDMMYY date (years 1950-2049), -1 if invalid */
+long day_number(long date)
+  {
+   static int mdays[12] = { 31,28,31,30,31,30,31,31,30,31,30,31 };
+   int da, mo, yr;
+   int i;
+   long days = 0;
+
+   da = (int)(date / 10000L);
+   mo = (int)((date / 100L) % 100L);
+   yr = (int)(date % 100L);
+   yr += ((yr < 50) ? 2000 : 1900);
+
+   if ((mo < 1) || (mo > 12) || (da < 1) || (da > 31))
+     {
+      return -1L;
+     }
+
+   for (i=1950; i<yr; i++)
+     {
+      days += (((i % 4) == 0) && (((i % 100) != 0) || ((i % 400) == 0))) ? 366 : 365;
+     }
+   for (i=1; i<mo; i++)
+     {
+      days += mdays[i-1];
+      if ((i == 2) && ((yr % 4) == 0) && (((yr % 100) != 0) || ((yr % 400) == 0)))
+        {
+         days++;
+        }
+     }
+   return days + da - 1;
+  }
+
+
+/* value times scale as an integer -- FALSE if it has more decimals than that */
+int scaled(double val, double scale, long *out)
+  {
+   double s;
+
+   s = val * scale;
+   *out = (long)floor(s + 0.5);
+   return (fabs(s - (double)*out) < 1e-6 * scale);
+  }
+
+
+void put_byte(int b)
+  {
+   if (npacked >= MAX_BYTES)
+     {
+      fprintf(stderr,"Packed table too large\n");
+      exit(1);
+     }
+   packed[npacked++] = (unsigned char)b;
+  }
+
+
+void put_varint(unsigned long val)
+  {
+   while (val >= 0x80UL)
+     {
+      put_byte((int)(val & 0x7FUL) | 0x80);
+      val >>= 7;
+     }
+   put_byte((int)val);
+  }
+
+
+void put_zigzag(long val)
+  {
+   put_varint((val < 0) ? ((unsigned long)(-(val + 1)) << 1) | 1UL : (unsigned long)val << 1);
+  }
+
+
+/* reading back, as gpssim does */
+
+int get_pos = 0;
+
+unsigned long get_varint(void)
+  {
+   unsigned long val = 0;
+   int shift = 0;
+   int b;
+
+   do
+     {
+      b = packed[get_pos++];
+      val |= (unsigned long)(b & 0x7F) << shift;
+      shift += 7;
+     }
+   while (b & 0x80);
+   return val;
+  }
+
+
+long get_zigzag(void)
+  {
+   unsigned long u;
+
+   u = get_varint();
+   return ((u & 1UL) ? -(long)(u >> 1) - 1L : (long)(u >> 1));
+  }
+
+
+int read_waypoints(FILE *unit, waypoint **list)
+  {
+   char line[200];
+   double lat, lon, alt;
+   waypoint *wp = NULL;
+   int n = 0;
+   int size = 0;
+   int lineno = 0;
+   long days;
+
+   while (fgets(line,sizeof(line),unit) != NULL)
+     {
+      lineno++;
+      if ((line[strspn(line," \t\r\n")] == 0) || (line[strspn(line," \t")] == '#'))
+        {
+         continue;
+        }
+
+      if (n >= size)
+        {
+         size += 256;
+         wp = (waypoint *)realloc(wp,size * sizeof(waypoint));
+         if (wp == NULL)
+           {
+            fprintf(stderr,"Out of memory\n");
+            exit(1);
+           }
+        }
+
+      if (sscanf(line,"%ld %ld %lf %lf %lf",&wp[n].date,&wp[n].time,&lat,&lon,&alt) != 5)
+        {
+         fprintf(stderr,"line %d: expected DDMMYY HHMMSS lat long alt\n",lineno);
+         exit(1);
+        }
+
+      days = day_number(wp[n].date);
+      if ((days < 0) || (wp[n].time < 0) || (wp[n].time > 235959L))
+        {
+         fprintf(stderr,"line %d: bad date or time\n",lineno);
+         exit(1);
+        }
+      wp[n].secs = days * 86400L + (wp[n].time / 10000L) * 3600L
+                   + ((wp[n].time / 100L) % 100L) * 60L + (wp[n].time % 100L);
+
+      /* a step back in time gives a segment with no output -- the built-in
+         flight has one, so it is kept */
+      if ((n > 0) && (wp[n].secs == wp[n-1].secs))
+        {
+         fprintf(stderr,"line %d: same time as the waypoint before\n",lineno);
+         exit(1);
+        }
+      if ((n > 0) && (wp[n].secs < wp[n-1].secs))
+        {
+         fprintf(stderr,"line %d: time goes back (no output for this segment)\n",lineno);
+        }
+
+      if (!scaled(lat,1000.0,&wp[n].lat) || !scaled(lon,1000.0,&wp[n].lon))
+        {
+         fprintf(stderr,"line %d: lat/long rounded to 3 decimals\n",lineno);
+        }
+      if (!scaled(alt,10.0,&wp[n].alt))
+        {
+         fprintf(stderr,"line %d: alt rounded to 1 decimal\n",lineno);
+        }
+      n++;
+     }
+
+   *list = wp;
+   return n;
+  }
+
+
+void pack(waypoint wp[], int n)
+  {
+   int i;
+
+   put_varint((unsigned long)wp[0].date);
+   put_varint((unsigned long)wp[0].time);
+   put_zigzag(wp[0].lat);
+   put_zigzag(wp[0].lon);
+   put_zigzag(wp[0].alt);
+
+   for (i=1; i<n; i++)
+     {
+      put_zigzag(wp[i].secs - wp[i-1].secs);
+      put_zigzag(wp[i].lat - wp[i-1].lat);
+      put_zigzag(wp[i].lon - wp[i-1].lon);
+      put_zigzag(wp[i].alt - wp[i-1].alt);
+     }
+
+   put_varint(0UL);
+  }
+
+
+/* decode the table again and compare -- TRUE if it is right */
+int check(waypoint wp[], int n)
+  {
+   long lat, lon, alt, secs;
+   int i;
+
+   get_pos = 0;
+   if ((get_varint() != (unsigned long)wp[0].date) || (get_varint() != (unsigned long)wp[0].time))
+     {
+      return FALSE;
+     }
+   secs = wp[0].secs;
+   lat = 0;
+   lon = 0;
+   alt = 0;
+
+   for (i=0; i<n; i++)
+     {
+      if (i > 0)
+        {
+         secs += get_zigzag();
+        }
+      lat += get_zigzag();
+      lon += get_zigzag();
+      alt += get_zigzag();
+      if ((secs != wp[i].secs) || (lat != wp[i].lat) || (lon != wp[i].lon) || (alt != wp[i].alt))
+        {
+         return FALSE;
+        }
+     }
+
+   return ((get_varint() == 0UL) && (get_pos == npacked));
+  }
+
+
+void write_table(FILE *unit, char fname[], int n)
+  {
+   int i;
+
+   fprintf(unit,"/* %d waypoints from %s, packed by wppack --\n"
+                "   %d bytes instead of %d as date_time[] and lat_long_alt[] */\n\n",
+           n,fname,npacked,n * 20 + 20);
+   fprintf(unit,"#ifdef USEFLASH\n unsigned char packed_script[] PROGMEM =\n#else\n"
+                " unsigned char packed_script[] =\n#endif\n  {\n");
+
+   for (i=0; i<npacked; i++)
+     {
+      fprintf(unit,"%s0x%02X%s",((i % 12) == 0) ? "   " : " ",packed[i],
+              (i == npacked - 1) ? "\n" : (((i % 12) == 11) ? ",\n" : ","));
+     }
+
+   fprintf(unit,"  };\n");
+  }
+
+
+int main(int argc, char *argv[])
+  {
+   FILE *unit;
+   waypoint *wp;
+   int n;
+
+   if ((argc < 2) || (argc > 3))
+     {
+      fprintf(stderr,"usage:  wppack waypoints.wpt [packed.h]\n");
+      return 1;
+     }
+
+   unit = fopen(argv[1],"r");
+   if (unit == NULL)
+     {
+      fprintf(stderr,"Can't open %s\n",argv[1]);
+      return 1;
+     }
+   n = read_waypoints(unit,&wp);
+   fclose(unit);
+
+   if (n < 2)
+     {
+      fprintf(stderr,"Need at least 2 waypoints\n");
+      return 1;
+     }
+
+   pack(wp,n);
+   if (!check(wp,n))
+     {
+      fprintf(stderr,"Packed table does not decode to the waypoints\n");
+      return 1;
+     }
+
+   unit = stdout;
+   if (argc > 2)
+     {
+      unit = fopen(argv[2],"w");
+      if (unit == NULL)
+        {
+         fprintf(stderr,"Can't open %s\n",argv[2]);
+         return 1;
+        }
+     }
+   write_table(unit,argv[1],n);
+   if (unit != stdout)
+     {
+      fclose(unit);
+     }
+
+   fprintf(stderr,"%d waypoints, %d bytes (%.1f per waypoint) -- %d as tables\n",
+           n,npacked,(double)npacked / n,n * 20 + 20);
+   free(wp);
+   return 0;
+  }
@@ -0,0 +1,161 @@
+/* degtrig.c -- degree trigonometry library -- sin, cos, atan2 and acos of
+                degrees by polynomials, one at a time or over arrays, with
+                no C library math calls -- see degtrig.h
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "degtrig.h"
+
+#define DT_SQRT3   1.7320508075688772935274463415059
+#define DT_TAN15   0.26794919243112270647255365849413   /* 2 - sqrt(3) */
+
+
+/* ------------------------------------------------------------------------ */
+
+/* atan2 in degrees -- the ratio of the smaller to the larger of |y| and
+   |x| (0 to 1), moved below tan(15 degrees), then turned back out into
+   its octant */
+static double dt_kernel_atan2(double y, double x)
+  {
+   double ax, ay, big, t, t2, p, a;
+   int swap, high;
+
+   ax = fabs(x);
+   ay = fabs(y);
+   swap = (ay > ax);
+   big = swap ? ay : ax;
+   t = swap ? ax : ay;
+   t = (big > 0.0) ? t / big : 0.0;
+
+   high = (t > DT_TAN15);
+   t = high ? ((t * DT_SQRT3) - 1.0) / (DT_SQRT3 + t) : t;
+   t2 = t * t;
+
+   /* Taylor series -- the next term, t^27/27, is below 2e-17 */
+   p = -1.0 / 25.0;
+   p = (p * t2) + (1.0 / 23.0);
+   p = (p * t2) - (1.0 / 21.0);
+   p = (p * t2) + (1.0 / 19.0);
+   p = (p * t2) - (1.0 / 17.0);
+   p = (p * t2) + (1.0 / 15.0);
+   p = (p * t2) - (1.0 / 13.0);
+   p = (p * t2) + (1.0 / 11.0);
+   p = (p * t2) - (1.0 / 9.0);
+   p = (p * t2) + (1.0 / 7.0);
+   p = (p * t2) - (1.0 / 5.0);
+   p = (p * t2) + (1.0 / 3.0);
+   a = (t - (t * t2 * p)) * DT_RAD_TO_DEG;
+
+   a = high ? a + 30.0 : a;
+   a = swap ? 90.0 - a : a;
+   a = (x < 0.0) ? 180.0 - a : a;
+   return (y < 0.0) ? -a : a;
+  }
+
+
+double dt_sin(double deg)
+  {
+   double s;
+
+   dt_sincos_array(1,&deg,&s,NULL);
+   return s;
+  }
+
+
+double dt_cos(double deg)
+  {
+   double c;
+
+   dt_sincos_array(1,&deg,NULL,&c);
+   return c;
+  }
+
+
+void dt_sincos(double deg, double *s, double *c)
+  {
+   dt_sincos_array(1,&deg,s,c);
+  }
+
+
+double dt_atan2(double y, double x)
+  {
+   return dt_kernel_atan2(y,x);
+  }
+
+
+double dt_acos(double c)
+  {
+   c = (c > 1.0) ? 1.0 : ((c < -1.0) ? -1.0 : c);
+   return dt_kernel_atan2(sqrt((1.0 - c) * (1.0 + c)),c);
+  }
+
+
+/* sin and cos together -- deg less 90 degrees times the nearest whole
+   quarter turn is exact, and leaves -45 to +45 degrees for the series.
+   The quarter turns are rounded by conversion to int, not floor(), and
+   the whole kernel is written into the one loop (which the compiler
+   splits on s and c being NULL), so that it vectorizes. */
+void dt_sincos_array(int n, double deg[], double s[], double c[])
+  {
+   double d, x, x2, ps, pc, sgn, si, ci;
+   int i, q, k;
+
+   for (i=0; i<n; i++)
+     {
+      d = deg[i];
+      q = (int)((d / 90.0) + ((d < 0.0) ? -0.5 : 0.5));
+      x = (d - (90.0 * q)) * DT_DEG_TO_RAD;
+      x2 = x * x;
+      k = q & 3;                            /* quarter turns, 0 to 3 */
+
+      /* Taylor series -- the next terms, x^17/17! and x^18/18!, are below
+         5e-17 at 45 degrees */
+      ps = -1.0 / 1307674368000.0;
+      ps = (ps * x2) + (1.0 / 6227020800.0);
+      ps = (ps * x2) - (1.0 / 39916800.0);
+      ps = (ps * x2) + (1.0 / 362880.0);
+      ps = (ps * x2) - (1.0 / 5040.0);
+      ps = (ps * x2) + (1.0 / 120.0);
+      ps = (ps * x2) - (1.0 / 6.0);
+      ps = x + (x * x2 * ps);
+
+      pc = 1.0 / 20922789888000.0;
+      pc = (pc * x2) - (1.0 / 87178291200.0);
+      pc = (pc * x2) + (1.0 / 479001600.0);
+      pc = (pc * x2) - (1.0 / 3628800.0);
+      pc = (pc * x2) + (1.0 / 40320.0);
+      pc = (pc * x2) - (1.0 / 720.0);
+      pc = (pc * x2) + (1.0 / 24.0);
+      pc = (pc * x2) - 0.5;
+      pc = 1.0 + (x2 * pc);
+
+      /* quarter turns:  sin, cos  ->  cos, -sin  ->  -sin, -cos  ->  -cos, sin */
+      sgn = (k >= 2) ? -1.0 : 1.0;
+      si = sgn * ((k & 1) ? pc : ps);
+      sgn = ((k == 1) || (k == 2)) ? -1.0 : 1.0;
+      ci = sgn * ((k & 1) ? ps : pc);
+
+      if (s != NULL)
+        {
+         s[i] = si;
+        }
+      if (c != NULL)
+        {
+         c[i] = ci;
+        }
+     }
+  }
+
+
+void dt_atan2_array(int n, double y[], double x[], double deg[])
+  {
+   int i;
+
+   for (i=0; i<n; i++)
+     {
+      deg[i] = dt_kernel_atan2(y[i],x[i]);
+     }
+  }
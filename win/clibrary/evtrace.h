@@ -0,0 +1,62 @@
+/* evtrace.h -- header file for
+                event tracing library which records begin/end events
+                in memory and writes them out as a Chrome trace (JSON)
+                file, viewable in chrome://tracing or ui.perfetto.dev
+
+   Each thread which records events gets its own ring buffer of fixed
+   size, allocated on its first event.  A ring is written only by its
+   own thread, so no locking is done while recording.  When a ring is
+   full the OLDEST events are overwritten, so memory stays bounded no
+   matter how long the program runs -- the trace file holds the most
+   recent events of each thread.
+
+   Recording is off until evtrace_open() is called, and the macros
+   EVTRACE_BEGIN() / EVTRACE_END() cost only a test of a global flag
+   while it is off.  Event names are NOT copied -- pass string
+   constants (or strings that outlive the trace).
+*/
+
+#ifndef EVTRACE_H__
+#define EVTRACE_H__
+
+#include <stdio.h>
+
+/* default ring size per thread (events, rounded up to power of 2) --
+   each event takes 24 bytes, so the default is 1.5 MB per thread */
+#define EVTRACE_DEFAULT_EVENTS 65536L
+
+typedef struct
+  {
+   double ts;            /* microseconds since evtrace_open() */
+   const char *name;     /* event name (not copied) */
+   int ph;               /* 'B' = begin, 'E' = end */
+  }
+   evtrace_rec;
+
+/* nonzero while recording -- tested by the macros below */
+extern volatile int evtrace_enabled;
+
+/* start recording -- events are written to fname by evtrace_close();
+   events_per_thread <= 0 selects EVTRACE_DEFAULT_EVENTS (a later open
+   keeps the size of the first, whose rings are reused) --
+   returns 1 (TRUE) if recording was started, else 0 (FALSE) */
+int evtrace_open(char fname[], long events_per_thread);
+
+/* record the beginning or the end of a named span on this thread --
+   spans must nest, and the two calls should use the same name */
+void evtrace_begin(const char *name);
+void evtrace_end(const char *name);
+
+/* stop recording, wait for events being written on other threads, and
+   write the trace file -- the rings are kept for
+   reuse by a later evtrace_open(), since other threads may still hold
+   them -- safe to call more than once (e.g. from atexit() and main()) */
+void evtrace_close(void);
+
+/* number of events overwritten (dropped oldest) so far, all threads */
+long evtrace_dropped(void);
+
+#define EVTRACE_BEGIN(name)  { if (evtrace_enabled) evtrace_begin(name); }
+#define EVTRACE_END(name)    { if (evtrace_enabled) evtrace_end(name); }
+
+#endif
@@ -0,0 +1,69 @@
+/* gmnoise.h -- header file for
+                Gauss-Markov noise library which makes correlated random
+                errors, like those of a GPS receiver's position, from a fast
+                generator of normally distributed numbers
+
+   Normal numbers come from the ziggurat method of G. Marsaglia and W. W.
+   Tsang ("The Ziggurat Method for Generating Random Variables", Journal
+   of Statistical Software 5, 8 (2000)), 128 layers, driven by xorshift128+
+   generators (S. Vigna, 2014).  gm_normal_fill() works a whole array at a
+   time, in passes with no branching from element to element:  GM_LANES
+   generators step side by side to make the random bits (gcc -O3 turns this
+   into SIMD code), every number is taken as if it fell inside its layer's
+   rectangle (it does 99% of the time -- this pass looks up the layer's
+   tables, and vectorizes only where the compiler will gather), and a last
+   scalar pass redoes the few that fell in a wedge or the tail.  That is
+   about 3 times as fast as the polar method on drand48().
+
+   A first order Gauss-Markov process is the usual model of a slowly
+   wandering error -- each value is the one before, decayed toward 0 with
+   time constant tau, plus a fresh normal kick:
+
+      x[k+1] = phi x[k] + sqrt(1 - phi^2) w[k],   phi = exp(-dt / tau)
+
+   gm_process_fill() gives the process with a standard deviation of 1
+   (scale it by the error wanted), starting from a random value of the
+   same spread, so it needs no settling time.  Successive calls carry on
+   the same process.
+*/
+
+#ifndef GMNOISE_H__
+#define GMNOISE_H__
+
+#define GM_LANES  8                  /* generators stepped side by side */
+
+typedef struct
+  {
+   unsigned long long s0[GM_LANES];
+   unsigned long long s1[GM_LANES];
+  }
+   gm_rng;
+
+typedef struct
+  {
+   double phi;                       /* decay per step */
+   double drive;                     /* sqrt(1 - phi^2) */
+   double x;                         /* last value */
+   int started;
+  }
+   gm_process;
+
+
+/* seed the generators (and, the first time, build the ziggurat tables) --
+   the same seed gives the same numbers */
+void gm_seed(gm_rng *r, unsigned long seed);
+
+/* n numbers uniform on [0, 1) */
+void gm_uniform_fill(gm_rng *r, int n, double out[]);
+
+/* n numbers normally distributed, mean 0 and standard deviation 1 */
+void gm_normal_fill(gm_rng *r, int n, double out[]);
+
+/* a process with time constant tau_secs, sampled every dt_secs (tau 0
+   gives white noise) */
+void gm_process_init(gm_process *p, double tau_secs, double dt_secs);
+
+/* the next n values of the process, standard deviation 1 */
+void gm_process_fill(gm_process *p, gm_rng *r, int n, double out[]);
+
+#endif
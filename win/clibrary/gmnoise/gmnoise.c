@@ -0,0 +1,254 @@
+/* gmnoise.c -- Gauss-Markov noise library -- xorshift128+ generators side by
+                side, ziggurat normal numbers a whole array at a time, and
+                first order Gauss-Markov processes made from them -- see
+                gmnoise.h
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "gmnoise.h"
+
+/* numbers made at a time -- a multiple of GM_LANES */
+#define GM_CHUNK   256
+
+#define GM_TAIL    3.442619855899     /* start of the tail, the last layer's edge */
+#define GM_AREA    9.91256303526217e-3   /* of each layer */
+#define GM_2_31    2147483648.0
+#define GM_2_M53   (1.0 / 9007199254740992.0)
+
+/* the ziggurat -- edge of each layer scaled to the random integers (kn),
+   width of an integer step (wn) and the density at the edge (fn) */
+static double gm_kn[128];
+static double gm_wn[128];
+static double gm_fn[128];
+static int gm_ready = 0;
+
+
+/* ------------------------------------------------------------------------ */
+
+static void gm_tables(void)
+  {
+   double dn, tn, q;
+   int i;
+
+   dn = GM_TAIL;
+   tn = dn;
+   q = GM_AREA / exp(-0.5 * dn * dn);
+   gm_kn[0] = (dn / q) * GM_2_31;
+   gm_kn[1] = 0.0;
+   gm_wn[0] = q / GM_2_31;
+   gm_wn[127] = dn / GM_2_31;
+   gm_fn[0] = 1.0;
+   gm_fn[127] = exp(-0.5 * dn * dn);
+   for (i=126; i>=1; i--)
+     {
+      dn = sqrt(-2.0 * log((GM_AREA / dn) + exp(-0.5 * dn * dn)));
+      gm_kn[i+1] = (dn / tn) * GM_2_31;
+      tn = dn;
+      gm_fn[i] = exp(-0.5 * dn * dn);
+      gm_wn[i] = dn / GM_2_31;
+     }
+   gm_ready = 1;
+  }
+
+
+/* SplitMix64, only to spread a seed over the generators' state */
+static unsigned long long gm_splitmix(unsigned long long *x)
+  {
+   unsigned long long z;
+
+   *x += 0x9E3779B97F4A7C15ULL;
+   z = *x;
+   z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+   z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+   return z ^ (z >> 31);
+  }
+
+
+void gm_seed(gm_rng *r, unsigned long seed)
+  {
+   unsigned long long x;
+   int l;
+
+   if (!gm_ready)
+     {
+      gm_tables();
+     }
+   x = (unsigned long long)seed;
+   for (l=0; l<GM_LANES; l++)
+     {
+      r->s0[l] = gm_splitmix(&x);
+      r->s1[l] = gm_splitmix(&x) | 1ULL;    /* never all zero */
+     }
+  }
+
+
+/* one step of the first generator, for the odd number needed one at a time */
+static unsigned long long gm_next(gm_rng *r)
+  {
+   unsigned long long x, y;
+
+   x = r->s0[0];
+   y = r->s1[0];
+   r->s0[0] = y;
+   x ^= x << 23;
+   r->s1[0] = x ^ y ^ (x >> 17) ^ (y >> 26);
+   return r->s1[0] + y;
+  }
+
+
+/* random bits, n rounded up to a whole step of the generators -- the
+   inner loop steps every lane at once */
+static void gm_bits(gm_rng *r, int n, unsigned long long bits[])
+  {
+   unsigned long long x, y;
+   int i, l;
+
+   for (i=0; i<n; i+=GM_LANES)
+     {
+      for (l=0; l<GM_LANES; l++)
+        {
+         x = r->s0[l];
+         y = r->s1[l];
+         r->s0[l] = y;
+         x ^= x << 23;
+         r->s1[l] = x ^ y ^ (x >> 17) ^ (y >> 26);
+         bits[i+l] = r->s1[l] + y;
+        }
+     }
+  }
+
+
+void gm_uniform_fill(gm_rng *r, int n, double out[])
+  {
+   unsigned long long bits[GM_CHUNK];
+   int i, j, m;
+
+   for (i=0; i<n; i+=GM_CHUNK)
+     {
+      m = ((n - i) < GM_CHUNK) ? (n - i) : GM_CHUNK;
+      gm_bits(r,m,bits);
+      for (j=0; j<m; j++)
+        {
+         out[i+j] = (double)(bits[j] >> 11) * GM_2_M53;
+        }
+     }
+  }
+
+
+/* a uniform number on (0, 1), never 0 -- for log() */
+static double gm_open_uniform(gm_rng *r)
+  {
+   return ((double)(gm_next(r) >> 11) + 0.5) * GM_2_M53;
+  }
+
+
+/* the slow way, for a number outside its layer's rectangle -- a wedge
+   under the curve is tested against the density itself, the tail (layer 0)
+   by Marsaglia's exponential method; failing, try again */
+static double gm_nfix(gm_rng *r, unsigned long long b)
+  {
+   double hz, x, y;
+   int iz;
+
+   for (;;)
+     {
+      iz = (int)((b >> 8) & 127);
+      hz = (double)(int)(unsigned int)(b >> 32);
+      x = hz * gm_wn[iz];
+      if (iz == 0)
+        {
+         do
+           {
+            x = -log(gm_open_uniform(r)) / GM_TAIL;
+            y = -log(gm_open_uniform(r));
+           }
+         while ((y + y) < (x * x));
+         return (hz > 0.0) ? GM_TAIL + x : -GM_TAIL - x;
+        }
+      if ((gm_fn[iz] + gm_open_uniform(r) * (gm_fn[iz-1] - gm_fn[iz])) < exp(-0.5 * x * x))
+        {
+         return x;
+        }
+      b = gm_next(r);
+      iz = (int)((b >> 8) & 127);
+      hz = (double)(int)(unsigned int)(b >> 32);
+      if (fabs(hz) < gm_kn[iz])
+        {
+         return hz * gm_wn[iz];
+        }
+     }
+  }
+
+
+void gm_normal_fill(gm_rng *r, int n, double out[])
+  {
+   unsigned long long bits[GM_CHUNK];
+   int miss[GM_CHUNK];
+   double hz;
+   int i, j, m, iz;
+
+   for (i=0; i<n; i+=GM_CHUNK)
+     {
+      m = ((n - i) < GM_CHUNK) ? (n - i) : GM_CHUNK;
+      gm_bits(r,m,bits);
+
+      /* layer from 7 bits, a signed 32 bit integer from the top half --
+         inside the layer's rectangle it is the answer as it stands */
+      for (j=0; j<m; j++)
+        {
+         iz = (int)((bits[j] >> 8) & 127);
+         hz = (double)(int)(unsigned int)(bits[j] >> 32);
+         out[i+j] = hz * gm_wn[iz];
+         miss[j] = (fabs(hz) >= gm_kn[iz]);
+        }
+
+      for (j=0; j<m; j++)
+        {
+         if (miss[j])
+           {
+            out[i+j] = gm_nfix(r,bits[j]);
+           }
+        }
+     }
+  }
+
+
+void gm_process_init(gm_process *p, double tau_secs, double dt_secs)
+  {
+   p->phi = (tau_secs > 0.0) ? exp(-dt_secs / tau_secs) : 0.0;
+   p->drive = sqrt(1.0 - (p->phi * p->phi));
+   p->x = 0.0;
+   p->started = 0;
+  }
+
+
+void gm_process_fill(gm_process *p, gm_rng *r, int n, double out[])
+  {
+   double x;
+   int k;
+
+   if (n <= 0)
+     {
+      return;
+     }
+   gm_normal_fill(r,n,out);
+
+   /* the first value is drawn from the steady spread itself */
+   k = 0;
+   x = p->x;
+   if (!p->started)
+     {
+      x = out[0];
+      p->started = 1;
+      k = 1;
+     }
+   for (; k<n; k++)
+     {
+      x = (p->phi * x) + (p->drive * out[k]);
+      out[k] = x;
+     }
+   p->x = x;
+  }
@@ -0,0 +1,278 @@
+/* windgrid.c -- gridded wind field library -- reads a latitude/longitude/
+                 altitude grid of winds and interpolates it at any position,
+                 keeping the last grid cell found -- see windgrid.h
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "windgrid.h"
+
+char wg_error[200] = "";
+
+
+/* ------------------------------------------------------------------------ */
+
+/* next blank separated word of the file, skipping # comments -- 0 at end */
+static int wg_word(FILE *unit, char word[], int size)
+  {
+   int ch, n;
+
+   for (;;)
+     {
+      ch = getc(unit);
+      while ((ch != EOF) && isspace(ch))
+        {
+         ch = getc(unit);
+        }
+      if (ch != '#')
+        {
+         break;
+        }
+      while ((ch != EOF) && (ch != '\n'))
+        {
+         ch = getc(unit);
+        }
+     }
+   if (ch == EOF)
+     {
+      return 0;
+     }
+
+   for (n=0; (ch != EOF) && !isspace(ch) && (ch != '#'); ch=getc(unit))
+     {
+      if (n < size - 1)
+        {
+         word[n++] = (char)ch;
+        }
+     }
+   if (ch == '#')
+     {
+      ungetc(ch,unit);
+     }
+   word[n] = 0;
+   return 1;
+  }
+
+
+static int wg_number(FILE *unit, double *val)
+  {
+   char word[40];
+   char *end;
+
+   if (!wg_word(unit,word,40))
+     {
+      return 0;
+     }
+   *val = strtod(word,&end);
+   return ((end != word) && (*end == 0));
+  }
+
+
+static int wg_keyword(FILE *unit, char key[])
+  {
+   char word[40];
+   int i;
+
+   if (!wg_word(unit,word,40))
+     {
+      return 0;
+     }
+   for (i=0; word[i]; i++)
+     {
+      word[i] = tolower(word[i]);
+     }
+   return (strcmp(word,key) == 0);
+  }
+
+
+long wg_read(windgrid *g, char fname[])
+  {
+   FILE *unit;
+   double v[3];
+   long n, i;
+
+   memset(g,0,sizeof(windgrid));
+   unit = fopen(fname,"r");
+   if (unit == NULL)
+     {
+      sprintf(wg_error,"Can't open %.150s",fname);
+      return 0;
+     }
+
+   if (!wg_keyword(unit,"grid") || !wg_number(unit,&v[0]) || !wg_number(unit,&v[1]) ||
+       !wg_number(unit,&v[2]) || (v[0] < 1) || (v[1] < 1) || (v[2] < 1))
+     {
+      sprintf(wg_error,"%.100s: expected GRID nlat nlon nalt",fname);
+      fclose(unit);
+      return 0;
+     }
+   g->nlat = (int)v[0];
+   g->nlon = (int)v[1];
+   g->nalt = (int)v[2];
+
+   if (!wg_keyword(unit,"lat") || !wg_number(unit,&g->lat0) || !wg_number(unit,&g->dlat) ||
+       !wg_keyword(unit,"long") || !wg_number(unit,&g->lon0) || !wg_number(unit,&g->dlon) ||
+       (g->dlat <= 0.0) || (g->dlon <= 0.0))
+     {
+      sprintf(wg_error,"%.100s: expected LAT first spacing, LONG first spacing",fname);
+      fclose(unit);
+      return 0;
+     }
+
+   n = (long)g->nlat * g->nlon * g->nalt;
+   g->alt = (double *)malloc(g->nalt * sizeof(double));
+   g->wind = (double *)malloc(2 * n * sizeof(double));
+   if ((g->alt == NULL) || (g->wind == NULL))
+     {
+      sprintf(wg_error,"%.100s: out of memory for %ld nodes",fname,n);
+      fclose(unit);
+      wg_free(g);
+      return 0;
+     }
+
+   if (!wg_keyword(unit,"alt"))
+     {
+      sprintf(wg_error,"%.100s: expected ALT and %d altitudes",fname,g->nalt);
+      fclose(unit);
+      wg_free(g);
+      return 0;
+     }
+   for (i=0; i<g->nalt; i++)
+     {
+      if (!wg_number(unit,&g->alt[i]) || ((i > 0) && (g->alt[i] <= g->alt[i-1])))
+        {
+         sprintf(wg_error,"%.100s: expected %d ascending altitudes",fname,g->nalt);
+         fclose(unit);
+         wg_free(g);
+         return 0;
+        }
+     }
+
+   for (i=0; i<2*n; i++)
+     {
+      if (!wg_number(unit,&g->wind[i]))
+        {
+         sprintf(wg_error,"%.100s: expected %ld east, north pairs -- found %ld numbers",fname,n,i);
+         fclose(unit);
+         wg_free(g);
+         return 0;
+        }
+     }
+
+   fclose(unit);
+   return n;
+  }
+
+
+void wg_free(windgrid *g)
+  {
+   free(g->alt);
+   free(g->wind);
+   memset(g,0,sizeof(windgrid));
+  }
+
+
+void wg_cache_clear(wg_cache *c)
+  {
+   memset(c,0,sizeof(wg_cache));
+   c->k = -1;
+  }
+
+
+/* find the cell holding a position (already inside the grid) and load its
+   corners -- a grid with one point in some direction gets a cell of zero
+   size there, with both corners the same */
+static void wg_find(windgrid *g, wg_cache *c, double lat, double lon, double alt)
+  {
+   long base, node;
+   int i, j, k, i1, j1, k1, corner;
+
+   i = (int)((lat - g->lat0) / g->dlat);
+   i = (i > g->nlat - 2) ? g->nlat - 2 : i;
+   i = (i < 0) ? 0 : i;
+   i1 = (g->nlat > 1) ? i + 1 : i;
+
+   j = (int)((lon - g->lon0) / g->dlon);
+   j = (j > g->nlon - 2) ? g->nlon - 2 : j;
+   j = (j < 0) ? 0 : j;
+   j1 = (g->nlon > 1) ? j + 1 : j;
+
+   /* altitudes are uneven -- step from the last cell, as a balloon moves a
+      level at a time */
+   k = (c->k < 0) ? 0 : c->k;
+   while ((k < g->nalt - 2) && (alt >= g->alt[k+1]))
+     {
+      k++;
+     }
+   while ((k > 0) && (alt < g->alt[k]))
+     {
+      k--;
+     }
+   k1 = (g->nalt > 1) ? k + 1 : k;
+
+   c->k = k;
+   c->lat_lo = g->lat0 + i * g->dlat;
+   c->lat_hi = g->lat0 + i1 * g->dlat;
+   c->lon_lo = g->lon0 + j * g->dlon;
+   c->lon_hi = g->lon0 + j1 * g->dlon;
+   c->alt_lo = g->alt[k];
+   c->alt_hi = g->alt[k1];
+   c->rlat = (i1 > i) ? 1.0 / g->dlat : 0.0;
+   c->rlon = (j1 > j) ? 1.0 / g->dlon : 0.0;
+   c->ralt = (k1 > k) ? 1.0 / (g->alt[k1] - g->alt[k]) : 0.0;
+
+   for (corner=0; corner<8; corner++)
+     {
+      base = ((long)((corner & 4) ? k1 : k) * g->nlat + ((corner & 2) ? i1 : i)) * g->nlon;
+      node = base + ((corner & 1) ? j1 : j);
+      c->east[corner] = g->wind[2 * node];
+      c->north[corner] = g->wind[2 * node + 1];
+     }
+   c->misses++;
+  }
+
+
+void wg_wind(windgrid *g, wg_cache *c, double lat, double lon, double alt,
+             double *east, double *north)
+  {
+   double fx, fy, fz, e0, e1, e2, e3, n0, n1, n2, n3;
+   double top;
+
+   /* outside the grid, the nearest edge */
+   top = g->lat0 + (g->nlat - 1) * g->dlat;
+   lat = (lat < g->lat0) ? g->lat0 : ((lat > top) ? top : lat);
+   top = g->lon0 + (g->nlon - 1) * g->dlon;
+   lon = (lon < g->lon0) ? g->lon0 : ((lon > top) ? top : lon);
+   alt = (alt < g->alt[0]) ? g->alt[0] : ((alt > g->alt[g->nalt-1]) ? g->alt[g->nalt-1] : alt);
+
+   if ((c->k < 0) || (lat < c->lat_lo) || (lat > c->lat_hi) || (lon < c->lon_lo) ||
+       (lon > c->lon_hi) || (alt < c->alt_lo) || (alt > c->alt_hi))
+     {
+      wg_find(g,c,lat,lon,alt);
+     }
+
+   fx = (lon - c->lon_lo) * c->rlon;
+   fy = (lat - c->lat_lo) * c->rlat;
+   fz = (alt - c->alt_lo) * c->ralt;
+
+   /* along longitude, then latitude, then altitude */
+   e0 = c->east[0] + fx * (c->east[1] - c->east[0]);
+   e1 = c->east[2] + fx * (c->east[3] - c->east[2]);
+   e2 = c->east[4] + fx * (c->east[5] - c->east[4]);
+   e3 = c->east[6] + fx * (c->east[7] - c->east[6]);
+   n0 = c->north[0] + fx * (c->north[1] - c->north[0]);
+   n1 = c->north[2] + fx * (c->north[3] - c->north[2]);
+   n2 = c->north[4] + fx * (c->north[5] - c->north[4]);
+   n3 = c->north[6] + fx * (c->north[7] - c->north[6]);
+
+   e0 += fy * (e1 - e0);
+   e2 += fy * (e3 - e2);
+   n0 += fy * (n1 - n0);
+   n2 += fy * (n3 - n2);
+
+   *east = e0 + fz * (e2 - e0);
+   *north = n0 + fz * (n2 - n0);
+  }
@@ -0,0 +1,105 @@
+/* wmm.h -- header file for
+            World Magnetic Model library which reads the model's spherical
+            harmonic coefficients (the WMM.COF file published with each
+            5-year model by NOAA NCEI and the British Geological Survey)
+            and gives the magnetic field -- declination above all -- at a
+            place, altitude and date
+
+   The model is summed as described in the WMM technical report:  the
+   place is turned into geocentric spherical coordinates, the Schmidt
+   semi-normalized associated Legendre functions and their derivatives
+   are built up by recursion, and the field in spherical coordinates is
+   rotated back to the ellipsoid.  The constant factors of the Legendre
+   recursion are worked out once, when the file is read, and the
+   coefficients are brought to a date only when the date changes.
+
+   A declination changes by a tenth of a degree over tens of kilometers
+   and over months, so a moving receiver need not sum the model every
+   fix:  wmm_cached_declination() keeps the last answer in a wmm_cache
+   and sums the model again only when the position has moved further, or
+   the date has changed more, than the cache's window.
+
+   WMM.COF layout (the model is valid for 5 years from its epoch):
+
+          2020.0            WMM-2020        12/10/2019
+        1  0  -29404.5       0.0        6.7        0.0
+        n  m  g (nT)   h (nT)   g per year   h per year
+        ...
+      999999999999999999999999999999999999999999999999
+
+   Latitude and longitude are geodetic degrees (north and east positive),
+   altitude is meters above the WGS 84 ellipsoid, dates are decimal years
+   (e.g. 2021.5).
+*/
+
+#ifndef WMM_H__
+#define WMM_H__
+
+#define WMM_MAX_DEGREE  12                /* WMM is degree and order 12 */
+#define WMM_TERMS       (((WMM_MAX_DEGREE + 1) * (WMM_MAX_DEGREE + 2)) / 2)
+
+/* index of the (n,m) term */
+#define WMM_INDEX(n,m)  (((n) * ((n) + 1)) / 2 + (m))
+
+typedef struct
+  {
+   char name[32];                    /* e.g. WMM-2020 */
+   double epoch;                     /* decimal year */
+   int degree;                       /* highest n in the file */
+   double g[WMM_TERMS];              /* main field at the epoch, nT */
+   double h[WMM_TERMS];
+   double gdot[WMM_TERMS];           /* secular variation, nT/year */
+   double hdot[WMM_TERMS];
+
+   /* Legendre recursion factors, from wmm_read() */
+   double rec_a[WMM_TERMS];          /* (2n-1) / sqrt(n^2 - m^2) */
+   double rec_b[WMM_TERMS];          /* sqrt((n-1)^2 - m^2) / sqrt(n^2 - m^2) */
+   double rec_d[WMM_MAX_DEGREE + 1]; /* sqrt((2n-1) / 2n) for the m = n terms */
+
+   /* coefficients brought to date_year */
+   double date_year;
+   double gt[WMM_TERMS];
+   double ht[WMM_TERMS];
+  }
+   wmm_model;
+
+typedef struct
+  {
+   double max_km;                    /* window -- 0 for every call */
+   double max_years;
+   int valid;
+   double lat;                       /* last place summed */
+   double lon;
+   double alt;
+   double year;
+   double km_lat;                    /* km in a degree there */
+   double km_lon;
+   double decl;                      /* and its answer */
+   long sums;                        /* times the model was summed */
+   long calls;
+  }
+   wmm_cache;
+
+
+/* last error from wmm_read() */
+extern char wmm_error[];
+
+/* read a WMM.COF file -- returns the degree of the model, 0 (and
+   wmm_error set) if it can't be read */
+int wmm_read(wmm_model *mod, char fname[]);
+
+/* the field at a place -- declination and inclination in degrees (east
+   and down positive), horizontal and total intensity in nT; any output
+   pointer may be NULL */
+void wmm_field(wmm_model *mod, double lat, double lon, double alt, double year,
+               double *decl, double *incl, double *horiz, double *total);
+
+/* declination only */
+double wmm_declination(wmm_model *mod, double lat, double lon, double alt, double year);
+
+/* a cache summing again after max_km of movement or max_secs of time */
+void wmm_cache_init(wmm_cache *c, double max_km, double max_secs);
+double wmm_cached_declination(wmm_model *mod, wmm_cache *c,
+                              double lat, double lon, double alt, double year);
+
+#endif